@@ -43,7 +43,7 @@ public:
       ShaderVertexLayoutDescription(ShaderVertexLayoutDescription::Normal,
         ShaderVertexLayoutDescription::FormatFloat3),
       ShaderVertexLayoutDescription(ShaderVertexLayoutDescription::BiNormal,
-        ShaderVertexLayoutDescription::FormatFloat3),
+        ShaderVertexLayoutDescription::FormatFloat4),
       };
 
     auto readAll = [](QString str) -> QByteArray
@@ -3,7 +3,8 @@ layout (std140) uniform cb1 { mat4 view; mat4 proj; };
 
 in vec3 position;
 in vec3 normal;
-in vec3 binormal;
+// The tangent, with the bitangent's sign in w.
+in vec4 binormal;
 in vec2 textureCoordinate;
 
 out vec3 vPosition;
@@ -16,9 +17,9 @@ void main(void)
   {
   vTexOut = textureCoordinate;
 
-  vNormalMat[1] = binormal;
+  vNormalMat[0] = binormal.xyz;
+  vNormalMat[1] = cross(normal, binormal.xyz) * binormal.w;
   vNormalMat[2] = normal;
-  vNormalMat[0] = cross(normal, binormal);
 
   vMvPos = (modelView * vec4(position, 1.0)).xyz;
   vPosition = position;
@@ -5,6 +5,8 @@
 #include "XRasteriserState.h"
 #include "XTransform.h"
 #include "XTexture.h"
+#include "XTangentGenerator.h"
+#include "XCore.h"
 
 namespace Eks
 {
@@ -20,36 +22,52 @@ public:
     _t = 0.0f;
     }
 
+  // A plane with position, texture coordinate, normal and a tangent from TangentGenerator,
+  // which carries the bitangent's sign in w.
   static void initPlane(Renderer* r, Geometry *geo)
     {
-    const float vert[] = {
-      -10, 0, -10,
-      0, 0,
-      0, 1, 0,
-      1, 0, 0,
-      10, 0, 10,
-      1, 1,
-      0, 1, 0,
-      1, 0, 0,
-      10, 0, -10,
-      1, 0,
-      0, 1, 0,
-      1, 0, 0,
-      10, 0, 10,
-      1, 1,
-      0, 1, 0,
-      1, 0, 0,
-      -10, 0, 10,
-      0, 1,
-      0, 1, 0,
-      1, 0, 0,
-      -10, 0, -10,
-      0, 0,
-      0, 1, 0,
-      1, 0, 0,
+    const Vector3D positions[] = {
+      Vector3D(-10, 0, -10),
+      Vector3D(10, 0, 10),
+      Vector3D(10, 0, -10),
+      Vector3D(10, 0, 10),
+      Vector3D(-10, 0, 10),
+      Vector3D(-10, 0, -10),
     };
-    const xsize vertCount = X_ARRAY_COUNT(vert) / 11;
-    Geometry::delayedCreate(*geo, r, vert, sizeof(float) * 11, vertCount);
+    const Vector2D texCoords[] = {
+      Vector2D(0, 0),
+      Vector2D(1, 1),
+      Vector2D(1, 0),
+      Vector2D(1, 1),
+      Vector2D(0, 1),
+      Vector2D(0, 0),
+    };
+    const xsize vertCount = X_ARRAY_COUNT(positions);
+    const Vector3D normals[vertCount] = {
+      Vector3D(0, 1, 0),
+      Vector3D(0, 1, 0),
+      Vector3D(0, 1, 0),
+      Vector3D(0, 1, 0),
+      Vector3D(0, 1, 0),
+      Vector3D(0, 1, 0),
+    };
+    const xuint32 indices[] = { 0, 1, 2, 3, 4, 5 };
+
+    Vector<Vector4D> tangents(Core::defaultAllocator());
+    TangentGenerator gen(Core::defaultAllocator());
+    gen.generate(positions, normals, texCoords, vertCount, indices, X_ARRAY_COUNT(indices), &tangents);
+
+    float vert[vertCount * 12];
+    for(xsize i = 0; i < vertCount; ++i)
+      {
+      float *v = vert + i * 12;
+      Eigen::Map<Vector3D>(v) = positions[i];
+      Eigen::Map<Vector2D>(v + 3) = texCoords[i];
+      Eigen::Map<Vector3D>(v + 5) = normals[i];
+      Eigen::Map<Vector4D>(v + 8) = tangents[i];
+      }
+
+    Geometry::delayedCreate(*geo, r, vert, sizeof(float) * 12, vertCount);
     }
 
   void initialise(Renderer* r)
@@ -71,7 +89,7 @@ public:
       ShaderVertexLayoutDescription(ShaderVertexLayoutDescription::Normal,
         ShaderVertexLayoutDescription::FormatFloat3),
       ShaderVertexLayoutDescription(ShaderVertexLayoutDescription::BiNormal,
-        ShaderVertexLayoutDescription::FormatFloat3),
+        ShaderVertexLayoutDescription::FormatFloat4),
       };
 
     auto readAll = [](QString str) -> QByteArray
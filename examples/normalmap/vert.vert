@@ -2,7 +2,8 @@ layout (std140) uniform cb0 { mat4 model; mat4 modelView; mat4 modelViewProj; };
 layout (std140) uniform cb1 { mat4 view; mat4 proj; };
 in vec3 position;
 in vec3 normal;
-in vec3 binormal;
+// The tangent, with the bitangent's sign in w.
+in vec4 binormal;
 in vec2 textureCoordinate;
 out vec2 texOut;
 out vec3 mvPos;
@@ -12,9 +13,9 @@ void main(void)
   {
   texOut = textureCoordinate;
 
-  normalMat[1] = binormal;
+  normalMat[0] = binormal.xyz;
+  normalMat[1] = cross(normal, binormal.xyz) * binormal.w;
   normalMat[2] = normal;
-  normalMat[0] = cross(normal, binormal);
 
   mvPos = (modelView * vec4(position, 1.0)).xyz;
   gl_Position = modelViewProj * vec4(position, 1.0);
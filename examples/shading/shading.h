@@ -35,7 +35,15 @@ public:
       ShaderVertexLayoutDescription::TextureCoordinate,
     };
 
-    m.bakeTriangles(r, semantics, X_ARRAY_COUNT(semantics), igeo, geo);
+    // Normals are folded into two shorts, the vertex shader unfolds them.
+    ShaderVertexLayoutDescription::Format formats[] = {
+      ShaderVertexLayoutDescription::FormatFloat3,
+      ShaderVertexLayoutDescription::FormatOctahedralNormal,
+      ShaderVertexLayoutDescription::FormatFloat2,
+    };
+    xCompileTimeAssert(X_ARRAY_COUNT(semantics) == X_ARRAY_COUNT(formats));
+
+    m.bakeTriangles(r, semantics, X_ARRAY_COUNT(semantics), igeo, geo, formats);
     }
 
   void initialise(Renderer* r)
@@ -46,12 +54,21 @@ public:
         "layout (std140) uniform cb0 { mat4 model; mat4 modelView; mat4 modelViewProj; };"
         "layout (std140) uniform cb1 { mat4 view; mat4 proj; };"
         "in vec3 position;"
-        "in vec3 normal;"
+        "in vec2 normal;"
         "out vec3 vNormal;"
         "out vec3 vPos;"
+        "vec3 octahedralDecode(vec2 e)"
+        "  {"
+        "  vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));"
+        "  if(n.z < 0.0)"
+        "    {"
+        "    n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);"
+        "    }"
+        "  return normalize(n);"
+        "  }"
         "void main(void)"
         "  {"
-        "  vNormal = normal;"
+        "  vNormal = octahedralDecode(normal);"
         "  vPos = (modelView * vec4(position, 1.0)).xyz;"
         "  gl_Position = modelViewProj * vec4(position, 1.0);"
         "  }";
@@ -61,7 +78,7 @@ public:
       ShaderVertexLayoutDescription(ShaderVertexLayoutDescription::Position,
         ShaderVertexLayoutDescription::FormatFloat3),
       ShaderVertexLayoutDescription(ShaderVertexLayoutDescription::Normal,
-        ShaderVertexLayoutDescription::FormatFloat3),
+        ShaderVertexLayoutDescription::FormatOctahedralNormal),
       ShaderVertexLayoutDescription(ShaderVertexLayoutDescription::TextureCoordinate,
         ShaderVertexLayoutDescription::FormatFloat2),
       };
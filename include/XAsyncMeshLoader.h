@@ -0,0 +1,113 @@
+#ifndef XASYNCMESHLOADER_H
+#define XASYNCMESHLOADER_H
+
+#include "XObjLoader.h"
+#include <atomic>
+#include <future>
+#include <thread>
+
+namespace Eks
+{
+
+// Parses and bakes an OBJ file on a background thread, so the calling thread stays responsive.
+//
+// Poll state() and progress() from the UI thread each frame, or wait on future(). Once the
+// load has succeeded, call upload() on the render thread to create the GPU buffers.
+class EKS3D_EXPORT AsyncMeshLoader : private ObjLoader::Monitor
+  {
+public:
+  enum State
+    {
+    Idle,
+    Loading,
+    Succeeded,
+    Failed,
+    Cancelled
+    };
+
+  // The CPU side buffers produced by a load.
+  struct Result
+    {
+    Result(AllocatorBase *allocator);
+
+    xsize vertexSize;
+    xsize vertexCount;
+    Vector<xuint8> vertices;
+    // Narrowed to 16 bits on upload if the vertex count allows.
+    Vector<xuint32> indices;
+    Vector<ObjLoader::Submesh> submeshes;
+    };
+
+  // The allocator is used from the loading threads, and must be thread safe.
+  AsyncMeshLoader(AllocatorBase *allocator);
+  // Cancels any load in progress, and waits for it to stop.
+  ~AsyncMeshLoader();
+
+  // Begin loading [path] on a background thread, parsing it with ObjLoader::loadParallel.
+  // [items] is copied. Normals the file does not contain are generated with
+  // [normalCreaseAngle], as ObjLoader::computeUnusedElements. Returns false if a load is
+  // already in progress.
+  bool start(const char *path,
+    const ShaderVertexLayoutDescription::Semantic *items,
+    xsize itemCount,
+    Real normalCreaseAngle = -1.0f);
+
+  // Ask a load in progress to stop, it then finishes in the Cancelled state.
+  void cancel();
+
+  // Also report parsing to [monitor], from the loading threads. Set it before start().
+  void setMonitor(ObjLoader::Monitor *monitor) { _monitor = monitor; }
+
+  // Block until the background thread finishes.
+  void wait();
+
+  State state() const { return (State)_state.load(); }
+  bool isLoading() const { return state() == Loading; }
+
+  // The fraction of the load completed, from 0 to 1.
+  float progress() const;
+
+  // Becomes ready with true if the load succeeded, or false if it failed or was cancelled.
+  std::shared_future<bool> future() const { return _future; }
+
+  // Only valid once the load has succeeded, and until upload().
+  const Result &result() const;
+
+  // Why the last load failed, null terminated, if it threw, and empty otherwise. Only valid
+  // once the load has finished.
+  const String &error() const { return _error; }
+
+  // Create [geo], and [idx] if it is non-null, then release the CPU buffers. Call on the
+  // render thread once the load has succeeded, returns false before then.
+  bool upload(Renderer *r, Geometry *geo, IndexGeometry *idx);
+
+private:
+  X_DISABLE_COPY(AsyncMeshLoader);
+
+  void begin(xsize totalBytes);
+  bool advance(xsize bytes);
+
+  bool run(const char *path, Real normalCreaseAngle);
+  void setError(const char *error);
+  void setError(const String &error);
+
+  AllocatorBase *_allocator;
+  ShaderVertexLayoutDescription::Semantic _items[ObjLoader::MaxElements];
+  xsize _itemCount;
+
+  Result _result;
+  String _error;
+  ObjLoader::Monitor *_monitor;
+
+  std::thread _thread;
+  std::shared_future<bool> _future;
+  std::atomic<int> _state;
+  std::atomic<bool> _cancelled;
+  std::atomic<xsize> _totalBytes;
+  std::atomic<xsize> _parsedBytes;
+  std::atomic<int> _stage;
+  };
+
+}
+
+#endif // XASYNCMESHLOADER_H
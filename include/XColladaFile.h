@@ -1,30 +1,61 @@
 #ifndef XCOLLADAFILE_H
 #define XCOLLADAFILE_H
 
-#if 0
-
 #include "X3DGlobal.h"
-#include "QDomDocument"
-#include "XHash"
-#include "QStringList"
+#include "XObjLoader.h"
 
-class Geometry;
-class QDomElement;
+namespace Eks
+{
 
-class EKS3D_EXPORT XColladaFile
-    {
+// Imports the geometry of COLLADA (.dae) documents into the same element data as ObjLoader,
+// so the result is completed with loader().computeUnusedElements() and baked with
+// loader().bake() or loader().bakeIndexed().
+//
+// The document is scanned once in place, tags and number arrays are referenced as pointer
+// ranges into it and no DOM is built. float_array and p contents are parsed straight from
+// the document, large ones split across threads. Every geometry's triangles, polylist and
+// polygons blocks are imported, one Submesh each, named after the geometry and with the
+// block's material. Scene node transforms are not applied.
+class EKS3D_EXPORT ColladaFile
+  {
 public:
-    XColladaFile( QString );
-    
-    bool geometryExists( QString );
-    QStringList geometryNames() const;
-    Geometry geometry( QString ) const;
+  enum
+    {
+    // Arrays with fewer bytes of text are parsed on the calling thread.
+    MinimumParallelArraySize = 256 * 1024,
+    MaxInputs = 8
+    };
+
+  ColladaFile(AllocatorBase *allocator);
+
+  // The loader whose formats the elements are initialised with, and which bakes them.
+  ObjLoader &loader() { return _loader; }
+
+  // Import every geometry in [data]. [elements] and [triangles] are filled as by
+  // ObjLoader::load, elements no geometry contains are left empty for computeUnusedElements.
+  bool load(const char *data,
+    xsize dataSize,
+    const ShaderVertexLayoutDescription::Semantic *items,
+    xsize itemCount,
+    Vector<VectorI3D> *triangles,
+    xsize *vertexSize,
+    ObjLoader::ElementData *elements,
+    Vector<ObjLoader::Submesh> *submeshes = 0);
+
+  // Memory map the file at [path] and import it with load().
+  bool loadFile(const char *path,
+    const ShaderVertexLayoutDescription::Semantic *items,
+    xsize itemCount,
+    Vector<VectorI3D> *triangles,
+    xsize *vertexSize,
+    ObjLoader::ElementData *elements,
+    Vector<ObjLoader::Submesh> *submeshes = 0);
 
 private:
-    XHash <QString, QDomElement> _geometries;
-    QDomDocument _document;
-    };
+  AllocatorBase *_allocator;
+  ObjLoader _loader;
+  };
 
-#endif
+}
 
-#endif // XCOLLADA_H
+#endif // XCOLLADAFILE_H
@@ -0,0 +1,133 @@
+#ifndef XCOOKEDMESH_H
+#define XCOOKEDMESH_H
+
+#include "X3DGlobal.h"
+#include "XShader.h"
+#include "XGeometry.h"
+#include "XBoundingBox.h"
+#include "QFile"
+#include "QByteArray"
+
+namespace Eks
+{
+
+// A versioned binary container for baked mesh data. Vertex data is stored interleaved, ready
+// to pass straight to Geometry::delayedCreate, and indices ready for IndexGeometry::delayedCreate.
+//
+// The file is laid out as a Header, then Layout and Submesh tables, then 16 byte aligned vertex
+// and index data. Values are in the writer's byte order, which is recorded in the header, and
+// files from a machine of the other byte order are rejected rather than swapped.
+class EKS3D_EXPORT CookedMesh
+  {
+public:
+  enum
+    {
+    Magic = 0x4d534b45, // "EKSM"
+    ByteOrderMark = 0x01020304,
+    Version = 2,
+    DataAlignment = 16,
+    MaxNameLength = 64
+    };
+
+  struct Layout
+    {
+    xuint32 semantic;
+    xuint32 format;
+    xuint32 offset;
+    xuint32 padding;
+    };
+
+  struct Submesh
+    {
+    char name[MaxNameLength];
+    char material[MaxNameLength];
+    xuint32 firstIndex;
+    xuint32 indexCount;
+    float minimum[3];
+    float maximum[3];
+    };
+
+  struct Header
+    {
+    xuint32 magic;
+    xuint32 byteOrder;
+    xuint32 version;
+    xuint32 padding;
+    xuint32 layoutCount;
+    xuint32 submeshCount;
+    xuint32 vertexSize;
+    xuint32 vertexCount;
+    xuint32 indexType;
+    xuint32 indexCount;
+    float minimum[3];
+    float maximum[3];
+    xuint64 layoutOffset;
+    xuint64 submeshOffset;
+    xuint64 vertexOffset;
+    xuint64 indexOffset;
+    };
+
+  // Everything needed to write a cooked file. [submeshes] may be empty, in which case a
+  // single unnamed submesh covering every index is written.
+  struct Source
+    {
+    Source();
+
+    const ShaderVertexLayoutDescription *layout;
+    xsize layoutCount;
+
+    const void *vertexData;
+    xsize vertexSize;
+    xsize vertexCount;
+
+    IndexGeometry::Type indexType;
+    const void *indexData;
+    xsize indexCount;
+
+    BoundingBox bounds;
+
+    const Submesh *submeshes;
+    xsize submeshCount;
+    };
+
+  static bool write(const char *path, const Source &source);
+  static xsize indexSize(IndexGeometry::Type type);
+
+  CookedMesh();
+  ~CookedMesh();
+
+  // Map the file at [path], and validate its header and tables.
+  bool open(const char *path);
+  void close();
+
+  bool isValid() const { return _header != 0; }
+
+  const Header &header() const { xAssert(_header); return *_header; }
+
+  const Layout *layout() const;
+  // Fill [descs] with up to [count] layout descriptions, returns the number in the file.
+  xsize layoutDescriptions(ShaderVertexLayoutDescription *descs, xsize count) const;
+
+  const Submesh *submeshes() const;
+  BoundingBox bounds() const;
+
+  const void *vertexData() const;
+  const void *indexData() const;
+
+  bool createGeometry(Renderer *r, Geometry *geo) const;
+  bool createIndexGeometry(Renderer *r, IndexGeometry *geo) const;
+
+private:
+  X_DISABLE_COPY(CookedMesh);
+
+  bool validate(const xuint8 *data, xsize size);
+
+  QFile _file;
+  QByteArray _contents;
+  const xuint8 *_data;
+  const Header *_header;
+  };
+
+}
+
+#endif // XCOOKEDMESH_H
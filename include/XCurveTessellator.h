@@ -0,0 +1,61 @@
+#ifndef XCURVETESSELLATOR_H
+#define XCURVETESSELLATOR_H
+
+#include "X3DGlobal.h"
+#include "Math/XMathVector.h"
+#include "Containers/XVector.h"
+#include "XTransform.h"
+
+namespace Eks
+{
+
+template <typename T> class AbstractCurve;
+
+// Samples curves adaptively, so the lines between samples stay within a pixel tolerance of
+// the curve once projected. Const, so one tessellator can be shared by many threads.
+class EKS3D_EXPORT CurveTessellator
+  {
+public:
+  enum
+    {
+    // Curves are split evenly this many times before the error is measured, so a bend
+    // symmetric about a span's middle is still found.
+    MinSpans = 4,
+    // Deepest a span is halved, spans crossing the eye plane are halved down to it.
+    MaxDepth = 16,
+
+    // Fewer curves are tessellated on the calling thread.
+    MinParallelCurves = 64
+    };
+
+  typedef Vector3D (*SampleFunction)(Real t, const void *context);
+
+  // [toClip] maps curve points to clip space, for a target [viewport] pixels in size.
+  CurveTessellator(const ComplexTransform &toClip, const Vector2D &viewport, Real pixelTolerance);
+
+  // Append to [points] samples from [minimumT] to [maximumT] of the curve sample(t, context)
+  // traces, both ends included.
+  void tessellate(SampleFunction sample, const void *context, Real minimumT, Real maximumT, Vector<Vector3D> *points) const;
+  void tessellate(const AbstractCurve<Vector3D> &curve, Vector<Vector3D> *points) const;
+
+private:
+  struct Sample
+    {
+    Real t;
+    Vector3D point;
+    Vector4D clip;
+    };
+
+  Sample sample(SampleFunction fn, const void *context, Real t) const;
+  void subdivide(SampleFunction fn, const void *context, const Sample &a, const Sample &b, xsize depth, Vector<Vector3D> *points) const;
+  // How far, in pixels, the line from [a] to [b] misses [mid].
+  Real error(const Sample &a, const Sample &mid, const Sample &b) const;
+
+  ComplexTransform _toClip;
+  Vector2D _halfViewport;
+  Real _tolerance;
+  };
+
+}
+
+#endif // XCURVETESSELLATOR_H
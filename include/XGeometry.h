@@ -18,9 +18,44 @@ public:
 
   static bool delayedCreate(Geometry &ths, Renderer *r, const void *data, xsize size, xsize count);
 
+  // Create [ths] from [count] elements of [size] bytes, which write(data, context) fills in
+  // place. Where the renderer can map buffers [data] is the mapping, and nothing is copied.
+  static bool delayedCreate(
+    Geometry &ths,
+    Renderer *r,
+    xsize size,
+    xsize count,
+    void (*write)(void *data, void *context),
+    void *context);
+
+  // delayedCreate, with fn(void *data) filling the elements.
+  template <typename Fn> static bool delayedCreateWith(Geometry &ths, Renderer *r, xsize size, xsize count, Fn &fn)
+    {
+    return delayedCreate(ths, r, size, count, [](void *data, void *ctx) { (*(Fn *)ctx)(data); }, &fn);
+    }
+
+  // Overwrite elements [first, first + count) of the created [ths] in place, write(data, context)
+  // filling them. Returns false if [ths] can't be updated, or holds fewer or different sized
+  // elements, the caller should create it again. Only sizes are known here, callers changing
+  // the layout within an element size must create it again themselves.
+  static bool delayedUpdate(
+    Geometry &ths,
+    xsize size,
+    xsize first,
+    xsize count,
+    void (*write)(void *data, void *context),
+    void *context);
+
+  template <typename Fn> static bool delayedUpdateWith(Geometry &ths, xsize size, xsize first, xsize count, Fn &fn)
+    {
+    return delayedUpdate(ths, size, first, count, [](void *data, void *ctx) { (*(Fn *)ctx)(data); }, &fn);
+    }
+
 private:
   X_DISABLE_COPY(Geometry);
 
+  static void release(Geometry &ths);
+
   Renderer *_renderer;
   };
 
@@ -30,6 +65,8 @@ public:
   enum Type
     {
     Unsigned16,
+    Unsigned32,
+    Unsigned8,
 
     TypeCount
     };
@@ -44,9 +81,78 @@ public:
     const void *indexData,
     xsize indexCount);
 
+  // Create [ths] from [indexCount] indices of [type], which write(data, context) fills in
+  // place, as Geometry::delayedCreate does.
+  static bool delayedCreate(
+    IndexGeometry &ths,
+    Renderer *r,
+    Type type,
+    xsize indexCount,
+    void (*write)(void *data, void *context),
+    void *context);
+
+  template <typename Fn> static bool delayedCreateWith(IndexGeometry &ths, Renderer *r, Type type, xsize indexCount, Fn &fn)
+    {
+    return delayedCreate(ths, r, type, indexCount, [](void *data, void *ctx) { (*(Fn *)ctx)(data); }, &fn);
+    }
+
+  // Overwrite indices [first, first + count) of [ths], as Geometry::delayedUpdate does.
+  static bool delayedUpdate(
+    IndexGeometry &ths,
+    Type type,
+    xsize first,
+    xsize count,
+    void (*write)(void *data, void *context),
+    void *context);
+
+  template <typename Fn> static bool delayedUpdateWith(IndexGeometry &ths, Type type, xsize first, xsize count, Fn &fn)
+    {
+    return delayedUpdate(ths, type, first, count, [](void *data, void *ctx) { (*(Fn *)ctx)(data); }, &fn);
+    }
+
+  // Overwrite indices [first, first + count) of [ths] with 32 bit [indices], narrowed to [type].
+  static bool delayedUpdateNarrowed(
+    IndexGeometry &ths,
+    Type type,
+    const xuint32 *indices,
+    xsize first,
+    xsize count);
+
+  // Create [ths] from 32 bit [indices] into [vertexCount] vertices, stored as typeFor(vertexCount).
+  static bool delayedCreateNarrowest(
+    IndexGeometry &ths,
+    Renderer *r,
+    const xuint32 *indices,
+    xsize indexCount,
+    xsize vertexCount);
+
+  // Size in bytes of one index of [type].
+  static xsize typeSize(Type type)
+    {
+    const xsize sizes[] =
+    {
+      sizeof(xuint16),
+      sizeof(xuint32),
+      sizeof(xuint8)
+    };
+    xCompileTimeAssert(X_ARRAY_COUNT(sizes) == TypeCount);
+
+    xAssert(type < TypeCount);
+    return sizes[type];
+    }
+
+  // The narrowest type able to index [vertexCount] vertices. Unsigned8 is never picked, D3D11
+  // has no 8 bit indices and most GPUs widen them on upload.
+  static Type typeFor(xsize vertexCount)
+    {
+    return vertexCount <= (xsize)std::numeric_limits<xuint16>::max() + 1 ? Unsigned16 : Unsigned32;
+    }
+
 private:
   X_DISABLE_COPY(IndexGeometry);
 
+  static void release(IndexGeometry &ths);
+
   Renderer *_renderer;
   };
 
@@ -0,0 +1,126 @@
+#ifndef XGLTFLOADER_H
+#define XGLTFLOADER_H
+
+#include "X3DGlobal.h"
+#include "Containers/XStringSimple.h"
+#include "XShader.h"
+#include "XGeometry.h"
+#include "XBoundingBox.h"
+#include "XTransform.h"
+#include "QFile"
+#include "QByteArray"
+
+namespace Eks
+{
+
+// Loads glTF 2.0 meshes, from binary .glb files or .gltf files with embedded or external
+// buffers.
+//
+// Accessors are exposed as views of the loaded buffers, in the ShaderVertexLayoutDescription
+// format matching their component type, so vertex and index data can be passed to
+// Geometry and IndexGeometry without conversion. Each mesh primitive is a submesh. Texture
+// coordinates are kept as stored, with a top left origin.
+class EKS3D_EXPORT GltfLoader
+  {
+public:
+  enum
+    {
+    MaxAttributes = 8
+    };
+
+  static const xsize NoIndex = ~(xsize)0;
+
+  // [stride] bytes apart, [count] elements of [format], starting at [data].
+  struct Attribute
+    {
+    ShaderVertexLayoutDescription::Semantic semantic;
+    ShaderVertexLayoutDescription::Format format;
+    const xuint8 *data;
+    xsize stride;
+    xsize count;
+    };
+
+  // A triangle list. Attributes glTF has no semantic for, or in formats with no matching
+  // ShaderVertexLayoutDescription::Format, are left out.
+  struct Primitive
+    {
+    Attribute attributes[MaxAttributes];
+    xsize attributeCount;
+    xsize vertexCount;
+
+    // Tightly packed, or null if the primitive isn't indexed.
+    const xuint8 *indexData;
+    IndexGeometry::Type indexType;
+    xsize indexCount;
+
+    // The material's index in the file, or NoIndex.
+    xsize material;
+    BoundingBox bounds;
+    };
+
+  struct Mesh
+    {
+    String name;
+    xsize firstPrimitive;
+    xsize primitiveCount;
+    };
+
+  struct Node
+    {
+    String name;
+    // Indices into meshes() and nodes(), or NoIndex.
+    xsize mesh;
+    xsize parent;
+    Transform local;
+    // The product of the node's and its parents' transforms.
+    Transform world;
+    };
+
+  GltfLoader(AllocatorBase *allocator);
+  ~GltfLoader();
+
+  // Load from [data], which must stay valid while the loader is used. External buffers are
+  // resolved relative to [basePath], and fail to load without it.
+  bool load(const char *data, xsize dataSize, const char *basePath = 0);
+
+  // Memory map the file at [path], which stays open until the loader is cleared, and load it.
+  bool loadFile(const char *path);
+
+  void clear();
+
+  const Vector<Mesh> &meshes() const { return _meshes; }
+  const Vector<Primitive> &primitives() const { return _primitives; }
+  const Vector<Node> &nodes() const { return _nodes; }
+
+  // Fill [descs] with up to [count] descriptions of the vertex data createGeometry() uploads
+  // for [primitive], and return the attribute count. The offsets are those within the file's
+  // buffer view if the primitive can be uploaded from it directly, packed otherwise.
+  static xsize layoutDescriptions(const Primitive &primitive, ShaderVertexLayoutDescription *descs, xsize count);
+
+  // True if [primitive]'s attributes are interleaved in one buffer view, so createGeometry()
+  // uploads the view directly.
+  static bool isInterleaved(const Primitive &primitive, const xuint8 **vertexData, xsize *vertexSize);
+
+  // Create [geo] from [primitive]'s attributes, interleaving them first if they are stored
+  // apart, and [indexGeo] from its indices. 8 bit indices are widened to 16 bits.
+  bool createGeometry(const Primitive &primitive, Renderer *r, Geometry *geo) const;
+  static bool createIndexGeometry(const Primitive &primitive, Renderer *r, IndexGeometry *indexGeo);
+
+private:
+  X_DISABLE_COPY(GltfLoader);
+
+  AllocatorBase *_allocator;
+
+  QFile _file;
+  QByteArray _contents;
+  // Decoded data uris and external buffers.
+  Vector<xuint8> _ownedData;
+
+  Vector<Mesh> _meshes;
+  Vector<Primitive> _primitives;
+  Vector<Node> _nodes;
+  };
+
+}
+
+#endif // XGLTFLOADER_H
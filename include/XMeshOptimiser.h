@@ -0,0 +1,97 @@
+#ifndef XMESHOPTIMISER_H
+#define XMESHOPTIMISER_H
+
+#include "X3DGlobal.h"
+#include "Math/XMathVector.h"
+#include "Containers/XVector.h"
+
+namespace Eks
+{
+
+// Reorders indexed triangle lists between baking and upload, for the GPU's post transform
+// vertex cache, for less overdraw, and for vertex fetch locality.
+//
+// The passes are meant to run in order: optimiseVertexCache, optimiseOverdraw, then
+// optimiseVertexFetch. Each works on a range of indices, so submeshes can be optimised
+// separately to keep their ranges intact.
+class EKS3D_EXPORT MeshOptimiser
+  {
+public:
+  enum
+    {
+    // The LRU cache size Forsyth's scoring models, larger than real caches on purpose.
+    ScoringCacheSize = 32,
+    // The FIFO cache size used for analysis and overdraw clustering.
+    DefaultCacheSize = 16
+    };
+
+  struct Statistics
+    {
+    // Average cache miss ratio, transformed vertices per triangle. 0.5 is ideal, 3 the worst.
+    Real acmr;
+    // Average transformed to vertex ratio, transformed vertices per vertex used. 1 is ideal.
+    Real atvr;
+    xsize transformedVertices;
+    };
+
+  MeshOptimiser(AllocatorBase *allocator);
+
+  // Reorder the triangles in [indices] for vertex cache hits, using Tom Forsyth's linear
+  // speed vertex cache optimisation.
+  void optimiseVertexCache(xuint32 *indices, xsize indexCount, xsize vertexCount);
+
+  // Split cache optimised [indices] into clusters at cache flushes, and where the cluster's
+  // miss ratio is within [threshold] of its hard cluster's, then order the clusters outward
+  // facing first, after Sander et al. "Fast Triangle Reordering for Vertex Locality and
+  // Reduced Overdraw". [positions] are three floats, [positionStride] bytes apart.
+  void optimiseOverdraw(
+    xuint32 *indices,
+    xsize indexCount,
+    const float *positions,
+    xsize positionStride,
+    xsize vertexCount,
+    Real threshold = 1.05f);
+
+  // Renumber vertices in first use order, reordering [vertexData] to match. Vertices not
+  // referenced by [indices] are kept, after the used ones. Returns the used vertex count.
+  xsize optimiseVertexFetch(
+    xuint32 *indices,
+    xsize indexCount,
+    xuint8 *vertexData,
+    xsize vertexCount,
+    xsize vertexSize);
+
+  // Run all three passes over [indices], with positions as three floats at [positionOffset]
+  // in each vertex. Fills [before] and [after] if they are non-null.
+  xsize optimise(
+    xuint32 *indices,
+    xsize indexCount,
+    xuint8 *vertexData,
+    xsize vertexCount,
+    xsize vertexSize,
+    xsize positionOffset,
+    Statistics *before = 0,
+    Statistics *after = 0);
+
+  // Simulate a FIFO cache of [cacheSize] vertices over [indices].
+  Statistics analyseVertexCache(
+    const xuint32 *indices,
+    xsize indexCount,
+    xsize vertexCount,
+    xsize cacheSize = DefaultCacheSize);
+
+  // Fill [remap] with the first use order of each of [vertexCount] vertices, unused vertices
+  // follow in their original order. Returns the used vertex count.
+  static xsize buildFetchRemap(
+    const xuint32 *indices,
+    xsize indexCount,
+    xsize vertexCount,
+    xuint32 *remap);
+
+private:
+  AllocatorBase *_allocator;
+  };
+
+}
+
+#endif // XMESHOPTIMISER_H
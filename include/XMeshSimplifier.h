@@ -0,0 +1,94 @@
+#ifndef XMESHSIMPLIFIER_H
+#define XMESHSIMPLIFIER_H
+
+#include "X3DGlobal.h"
+#include "Math/XMathVector.h"
+#include "Containers/XVector.h"
+
+namespace Eks
+{
+
+// Reduces indexed triangle lists by collapsing edges in quadric error order, after Garland
+// and Heckbert "Surface Simplification Using Quadric Error Metrics".
+//
+// Edges only collapse onto existing vertices, so simplified index lists keep using the
+// original vertex data. Vertices sharing a position with different attributes form seams,
+// which only collapse along the seam with both sides moving together, open borders only
+// collapse along the border, and anything more complex is locked.
+class EKS3D_EXPORT MeshSimplifier
+  {
+public:
+  // Baked vertex and index data, positions are three floats at [positionOffset] in each vertex.
+  struct Mesh
+    {
+    xuint8 *vertexData;
+    xsize vertexSize;
+    xsize vertexCount;
+    xsize positionOffset;
+    const xuint32 *indices;
+    xsize indexCount;
+    };
+
+  struct Lod
+    {
+    xsize firstIndex;
+    xsize indexCount;
+    // Vertices [0, vertexCount) hold every vertex the level uses.
+    xsize vertexCount;
+    // The error reached, relative to the mesh's largest extent.
+    Real error;
+    };
+
+  struct LodChain
+    {
+    LodChain(AllocatorBase *allocator);
+
+    // Every level's indices, finest level first.
+    Vector<xuint32> indices;
+    Vector<Lod> lods;
+    };
+
+  MeshSimplifier(AllocatorBase *allocator);
+
+  // Simplify [indices] towards [targetIndexCount] indices, stopping early rather than exceed
+  // [targetError], relative to the mesh's largest extent. Writes the result to [destination],
+  // which needs room for [indexCount] indices, and returns the result's index count.
+  xsize simplify(
+    const xuint32 *indices,
+    xsize indexCount,
+    const float *positions,
+    xsize positionStride,
+    xsize vertexCount,
+    xsize targetIndexCount,
+    Real targetError,
+    xuint32 *destination,
+    Real *resultError = 0);
+
+  // Build the mesh itself as the first level, then one level per entry of [ratios], the
+  // fraction of [mesh]'s triangles to keep, each limited to [targetError]. Levels that could
+  // not be reduced further are left out. The vertex data is reordered in place so coarser
+  // levels use a prefix of it, [chain]'s indices refer to the new order.
+  void buildLodChain(
+    const Mesh &mesh,
+    const Real *ratios,
+    xsize ratioCount,
+    Real targetError,
+    LodChain *chain);
+
+  // Build chains for [meshCount] meshes, one mesh per thread. [chains] are filled in order.
+  static void buildLodChains(
+    AllocatorBase *allocator,
+    const Mesh *meshes,
+    xsize meshCount,
+    const Real *ratios,
+    xsize ratioCount,
+    Real targetError,
+    LodChain *chains);
+
+private:
+  AllocatorBase *_allocator;
+  };
+
+}
+
+#endif // XMESHSIMPLIFIER_H
@@ -0,0 +1,81 @@
+#ifndef XMESHLETBUILDER_H
+#define XMESHLETBUILDER_H
+
+#include "X3DGlobal.h"
+#include "Math/XMathVector.h"
+#include "Containers/XVector.h"
+#include "XBoundingBox.h"
+
+namespace Eks
+{
+
+class Frustum;
+
+// Partitions an indexed triangle list into small clusters of nearby, similarly facing
+// triangles, so dense meshes can be culled in pieces and drawn as index ranges.
+class EKS3D_EXPORT MeshletBuilder
+  {
+public:
+  enum
+    {
+    DefaultMaxVertices = 64,
+    DefaultMaxTriangles = 124
+    };
+
+  struct Meshlet
+    {
+    xuint32 firstIndex;
+    xuint32 indexCount;
+    xuint32 vertexCount;
+
+    BoundingBox bounds;
+    Vector3D centre;
+    Real radius;
+
+    // Every triangle faces within the cone around [coneAxis]. [coneCutoff] is 1 when the
+    // triangles face too many ways to ever be back facing together.
+    Vector3D coneAxis;
+    Real coneCutoff;
+    };
+
+  struct DrawRange
+    {
+    xsize firstIndex;
+    xsize indexCount;
+    };
+
+  MeshletBuilder(AllocatorBase *allocator);
+
+  // Reorder the triangles in [indices] so each meshlet is a contiguous range, and fill
+  // [meshlets]. [positions] are three floats, [positionStride] bytes apart. Cache optimised
+  // input gives meshlets with better vertex locality.
+  void build(
+    xuint32 *indices,
+    xsize indexCount,
+    const float *positions,
+    xsize positionStride,
+    xsize vertexCount,
+    Vector<Meshlet> *meshlets,
+    xsize maxVertices = DefaultMaxVertices,
+    xsize maxTriangles = DefaultMaxTriangles);
+
+  // True if every triangle in [meshlet] faces away from [cameraPosition].
+  static bool isBackFacing(const Meshlet &meshlet, const Vector3D &cameraPosition);
+
+  // Append the index ranges of the meshlets inside [frustum] and not back facing to [ranges],
+  // merging neighbouring ranges. [frustum] and [cameraPosition] are in the mesh's space.
+  // Returns the number of triangles left to draw.
+  static xsize cull(
+    const Meshlet *meshlets,
+    xsize meshletCount,
+    const Frustum &frustum,
+    const Vector3D &cameraPosition,
+    Vector<DrawRange> *ranges);
+
+private:
+  AllocatorBase *_allocator;
+  };
+
+}
+
+#endif // XMESHLETBUILDER_H
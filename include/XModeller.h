@@ -9,6 +9,8 @@
 #include "XTransform.h"
 #include "XShader.h"
 #include "Containers/XVector.h"
+#include "XPrimitiveCache.h"
+#include "XParallel.h"
 
 namespace Eks
 {
@@ -27,25 +29,57 @@ public:
   Modeller(AllocatorBase *, xsize initialSize=1024);
   ~Modeller();
 
+  // Bake the vertex data for [semanticOrder] into [geo]. [formats] holds a format per
+  // semantic, if it is null every semantic is baked as floats.
   void bakeVertices(
       Renderer *r,
       const ShaderVertexLayoutDescription::Semantic *semanticOrder,
       xsize semanticCount,
-      Geometry *geo);
+      Geometry *geo,
+      const ShaderVertexLayoutDescription::Format *formats = 0);
 
   void bakeTriangles(
       Renderer *r,
       const ShaderVertexLayoutDescription::Semantic *semanticOrder,
       xsize semanticCount,
       IndexGeometry *index,
-      Geometry *geo = 0);
+      Geometry *geo = 0,
+      const ShaderVertexLayoutDescription::Format *formats = 0);
 
   void bakeLines(
       Renderer *r,
       const ShaderVertexLayoutDescription::Semantic *semanticOrder,
       xsize semanticCount,
       IndexGeometry *index,
-      Geometry *geo = 0);
+      Geometry *geo = 0,
+      const ShaderVertexLayoutDescription::Format *formats = 0);
+
+  // Push what changed since the last bake into the buffers it baked, taking the same
+  // arguments as the bake. Only the changed range is uploaded, buffers are created again
+  // when the data grows or its layout changes. Changes are tracked against the last vertex,
+  // triangle and line buffer baked, updating any other buffer bakes it whole.
+  void updateVertices(
+      Renderer *r,
+      const ShaderVertexLayoutDescription::Semantic *semanticOrder,
+      xsize semanticCount,
+      Geometry *geo,
+      const ShaderVertexLayoutDescription::Format *formats = 0);
+
+  void updateTriangles(
+      Renderer *r,
+      const ShaderVertexLayoutDescription::Semantic *semanticOrder,
+      xsize semanticCount,
+      IndexGeometry *index,
+      Geometry *geo = 0,
+      const ShaderVertexLayoutDescription::Format *formats = 0);
+
+  void updateLines(
+      Renderer *r,
+      const ShaderVertexLayoutDescription::Semantic *semanticOrder,
+      xsize semanticCount,
+      IndexGeometry *index,
+      Geometry *geo = 0,
+      const ShaderVertexLayoutDescription::Format *formats = 0);
 
   // Fixed Functionality GL Emulation
   enum Type { None, Quads, Triangles, Lines };
@@ -61,10 +95,58 @@ public:
   void colour( const Eks::Vector4D & );
   inline void colour( Real, Real, Real, Real = 1.0 );
 
+  // Bulk data, for generated geometry. Positions and normals are transformed as one batch,
+  // and the begin() type and automatic normals are ignored. addVertices() returns the index
+  // of the first vertex added, the new vertices take the current normal, texture and colour
+  // state as vertex() would.
+  xsize addVertices( const Vector3D *positions, xsize count );
+  // Replace the attributes of the last [count] vertices added.
+  void addNormals( const Vector3D *normals, xsize count );
+  void addTextures( const Vector2D *textures, xsize count );
+  void addColours( const Vector4D *colours, xsize count );
+  // Append [count] triangle corners, each indexing a vertex relative to [firstVertex].
+  void addTriangles( const xuint32 *indices, xsize count, xsize firstVertex = 0 );
+
+  // Overwrite existing data from element [first], for editing a baked mesh in place.
+  // Positions and normals are transformed as above.
+  void setVertices( xsize first, const Vector3D *positions, xsize count );
+  void setNormals( xsize first, const Vector3D *normals, xsize count );
+  void setTextures( xsize first, const Vector2D *textures, xsize count );
+  void setColours( xsize first, const Vector4D *colours, xsize count );
+  void setTriangles( xsize first, const xuint32 *indices, xsize count, xsize firstVertex = 0 );
+
   void setNormalsAutomatic( bool=true );
   bool normalsAutomatic( ) const;
 
+  // Replace the normals of the triangles drawn so far with smooth normals, faces are only
+  // smoothed together where they meet within [creaseAngle] radians.
+  void generateSmoothNormals( Real creaseAngle = X_PI / 3.0f );
+
+  // Reorder the triangles drawn so far for the vertex cache and overdraw, then renumber the
+  // vertices in first use order. Lines are remapped to the new vertex order.
+  void optimiseTriangles();
+
+  // Take [other]'s transform, current state and primitive cache, but none of its geometry,
+  // so a Modeller on another thread can carry on from it.
+  void copyState( const Modeller &other );
+
+  // Append the geometry of [count] Modellers, in order, rebasing their indices. Parts are
+  // copied in parallel, the result only depends on their order.
+  void merge( const Modeller *const *parts, xsize count );
+
+  // Call fn(Modeller &part, xsize job) for [jobCount] jobs across threads, each into its own
+  // Modeller starting from this one's state, then merge the parts in job order. The output
+  // is the same however many threads are used. The parts allocate from this Modeller's
+  // allocator on the worker threads, so it must be thread safe.
+  template <typename Fn> void buildParallel( xsize jobCount, Fn fn );
+
+  // When set, spheres, cones, wire circles and cubes are copied from [cache] rather than
+  // tessellated on each draw. Cached spheres are skipped while normals are automatic.
+  void setPrimitiveCache( PrimitiveCache *cache );
+  PrimitiveCache *primitiveCache( ) const;
+
   // Draw Functions
+  void drawPrimitive(const PrimitiveCache::Primitive &primitive, const Transform &instance = Transform::Identity());
   void drawWireCube(const BoundingBox &cube);
   void drawWireCircle(const Vector3D &pos, const Vector3D &normal, float radius, xsize pts=24);
 
@@ -91,6 +173,21 @@ public:
       const Vector3D &center=Vector3D() );
 
   void drawCurve(const AbstractCurve<Vector3D> &, xsize segments );
+  // Tessellate adaptively, with as few lines as keep within [pixelTolerance] pixels of the
+  // curve, where [projection] maps the Modeller's output to clip space for a [viewport] pixel
+  // target. Bake the lines with bakeLines.
+  void drawCurve(
+      const AbstractCurve<Vector3D> &,
+      const ComplexTransform &projection,
+      const Vector2D &viewport,
+      Real pixelTolerance = 0.5f );
+  // As above for [count] curves, tessellated in parallel and appended in order.
+  void drawCurves(
+      const AbstractCurve<Vector3D> *const *curves,
+      xsize count,
+      const ComplexTransform &projection,
+      const Vector2D &viewport,
+      Real pixelTolerance = 0.5f );
 
   void setTransform( const Transform & );
   Transform transform( ) const;
@@ -99,16 +196,60 @@ public:
   void restore();
 
 private:
+  friend class PrimitiveCache;
+
+  // Append [primitive], with its positions transformed by [points] and normals by [normals].
+  void appendPrimitive(const PrimitiveCache::Primitive &primitive, const Transform &points, const Matrix3x3 &normals);
+
   inline Vector3D transformPoint(const Vector3D & );
-  inline void transformPoints(Vector <Vector3D> & );
+  inline void transformPoints(Vector3D *, xsize count );
+
+  // One tangent per vertex with its bitangent sign in w, for the BiNormal semantic.
+  void generateTangents(Vector<Vector4D> *tangents) const;
+
+  // Elements [begin, end) changed since [baked] elements were last baked into [target].
+  struct DirtyRange
+    {
+    DirtyRange() : begin(0), end(0), baked(0), target(0) { }
+    void mark(xsize from, xsize to);
+    void reset(xsize size, const void *into) { begin = end = 0; baked = size; target = into; }
+
+    xsize begin;
+    xsize end;
+    xsize baked;
+    const void *target;
+    };
+
+  // The semantics and formats vertices were last baked with.
+  struct VertexLayout
+    {
+    enum { MaxSemantics = 8 };
+    VertexLayout() : count(0) { }
+    bool equals(const ShaderVertexLayoutDescription::Semantic *semantics, const ShaderVertexLayoutDescription::Format *formats, xsize semanticCount) const;
+    void set(const ShaderVertexLayoutDescription::Semantic *semantics, const ShaderVertexLayoutDescription::Format *formats, xsize semanticCount);
+
+    // Longer layouts aren't stored, and never compare equal.
+    xsize count;
+    ShaderVertexLayoutDescription::Semantic semantics[MaxSemantics];
+    ShaderVertexLayoutDescription::Format formats[MaxSemantics];
+    };
+
+  void writeVertices(
+      Renderer *r,
+      const ShaderVertexLayoutDescription::Semantic *semanticOrder,
+      xsize semanticCount,
+      Geometry *geo,
+      const ShaderVertexLayoutDescription::Format *formats,
+      bool update);
+  void writeIndices(Renderer *r, IndexGeometry *index, const Vector<xuint32> &indices, DirtyRange &dirty, bool update);
 
   inline Vector3D transformNormal( Vector3D );
-  inline void transformNormals(Vector <Vector3D> &, bool reNormalize );
+  inline void transformNormals(Vector3D *, xsize count, bool reNormalize );
 
   AllocatorBase *_allocator;
 
-  Vector<xuint16> _triIndices;
-  Vector<xuint16> _linIndices;
+  Vector<xuint32> _triIndices;
+  Vector<xuint32> _linIndices;
 
   Vector<Vector3D> _vertex;
   Vector<Vector2D> _texture;
@@ -134,8 +275,52 @@ private:
 
   Transform _transform;
   int _quadCount;
+
+  PrimitiveCache *_primitiveCache;
+
+  DirtyRange _dirtyVertices;
+  VertexLayout _bakedLayout;
+  DirtyRange _dirtyTriangles;
+  DirtyRange _dirtyLines;
   };
 
+template <typename Fn> void Modeller::buildParallel( xsize jobCount, Fn fn )
+  {
+  Vector<Modeller *> parts(_allocator);
+  parts.resize(jobCount, 0);
+  for( xsize i = 0; i < jobCount; ++i )
+    {
+    parts[i] = _allocator->create<Modeller>(_allocator, 0);
+    parts[i]->copyState(*this);
+    }
+
+  try
+    {
+    ParallelUtilities::forRanges(jobCount, 1, [&](xsize, xsize begin, xsize end)
+      {
+      for( xsize j = begin; j < end; ++j )
+        {
+        fn(*parts[j], j);
+        }
+      });
+
+    merge(parts.data(), jobCount);
+    }
+  catch(...)
+    {
+    for( xsize i = 0; i < jobCount; ++i )
+      {
+      _allocator->destroy(parts[i]);
+      }
+    throw;
+    }
+
+  for( xsize i = 0; i < jobCount; ++i )
+    {
+    _allocator->destroy(parts[i]);
+    }
+  }
+
 void Modeller::vertex( Real x, Real y, Real z )
   { vertex( Vector3D(x,y,z) ); }
 
@@ -0,0 +1,55 @@
+#ifndef XNORMALGENERATOR_H
+#define XNORMALGENERATOR_H
+
+#include "X3DGlobal.h"
+#include "Math/XMathVector.h"
+#include "Containers/XVector.h"
+
+namespace Eks
+{
+
+// Generates smooth vertex normals for an indexed triangle list.
+//
+// Face normals are area weighted and accumulated per shared position. Faces meeting at a
+// position are only smoothed together when the angle between them is within the crease
+// angle, so hard edges stay hard. Corners that end up with the same normal share it.
+class EKS3D_EXPORT NormalGenerator
+  {
+public:
+  enum
+    {
+    MinimumParallelTriangles = 16 * 1024,
+    MinimumParallelPositions = 16 * 1024
+    };
+
+  NormalGenerator(AllocatorBase *allocator);
+
+  // [positionIndices] holds three position indices per triangle. On return [normals] holds the
+  // generated normals and [normalIndices] one index into [normals] per triangle corner.
+  // [creaseAngle] is in radians, a value of X_PI or more smooths every shared position.
+  void generate(
+    const Vector3D *positions,
+    xsize positionCount,
+    const xuint32 *positionIndices,
+    xsize indexCount,
+    Real creaseAngle,
+    Vector<Vector3D> *normals,
+    Vector<xuint32> *normalIndices);
+
+  // Map each of [count] positions to the index of the first position equal to it, so
+  // positions duplicated per face can be treated as shared.
+  static void weldPositions(
+    const Vector3D *positions,
+    xsize count,
+    Vector<xuint32> *remap);
+
+  // Normalise [count] vectors in place, zero length vectors are left as zero.
+  static void normalise(Vector3D *vectors, xsize count);
+
+private:
+  AllocatorBase *_allocator;
+  };
+
+}
+
+#endif // XNORMALGENERATOR_H
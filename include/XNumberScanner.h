@@ -0,0 +1,274 @@
+#ifndef XNUMBERSCANNER_H
+#define XNUMBERSCANNER_H
+
+#include "X3DGlobal.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+# define X_NUMBER_SCANNER_SIMD 1
+# include <emmintrin.h>
+#else
+# define X_NUMBER_SCANNER_SIMD 0
+#endif
+
+namespace Eks
+{
+
+// Locale independent number parsing for the mesh loaders. All functions work in place on
+// [pos, end), never read outside it, and never allocate.
+namespace NumberScanner
+{
+
+inline bool isDigit(char c)
+  {
+  return (unsigned char)(c - '0') < 10;
+  }
+
+// Find the length of the run of decimal digits at the start of [pos, end).
+inline xsize digitRunLength(const char *pos, const char *end)
+  {
+  const char *start = pos;
+
+#if X_NUMBER_SCANNER_SIMD
+  const __m128i lower = _mm_set1_epi8('0' - 1);
+  const __m128i upper = _mm_set1_epi8('9' + 1);
+  while(end - pos >= 16)
+    {
+    __m128i chars = _mm_loadu_si128((const __m128i *)pos);
+    __m128i digits = _mm_and_si128(_mm_cmpgt_epi8(chars, lower), _mm_cmplt_epi8(chars, upper));
+    xuint32 mask = (xuint32)_mm_movemask_epi8(digits);
+    if(mask != 0xFFFF)
+      {
+      xuint32 nonDigits = ~mask & 0xFFFF;
+      xsize run = 0;
+      while((nonDigits & 1) == 0)
+        {
+        nonDigits >>= 1;
+        ++run;
+        }
+      return (pos - start) + run;
+      }
+    pos += 16;
+    }
+#endif
+
+  while(pos < end && isDigit(*pos))
+    {
+    ++pos;
+    }
+
+  return pos - start;
+  }
+
+namespace detail
+{
+// Accumulate [count] digits into [value], returning the number of digits that did not fit.
+inline xsize accumulateDigits(const char *pos, xsize count, xuint64 &value, xsize &significant)
+  {
+  const xsize MaxSignificant = 19;
+  xsize dropped = 0;
+  for(xsize i = 0; i < count; ++i)
+    {
+    if(significant < MaxSignificant)
+      {
+      value = value * 10 + (xuint64)(pos[i] - '0');
+      if(value != 0)
+        {
+        ++significant;
+        }
+      }
+    else
+      {
+      ++dropped;
+      }
+    }
+  return dropped;
+  }
+
+inline double powerOfTen(int exponent)
+  {
+  static const double exact[] =
+    {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+
+  if(exponent >= 0 && exponent < (int)X_ARRAY_COUNT(exact))
+    {
+    return exact[exponent];
+    }
+  return std::pow(10.0, (double)exponent);
+  }
+
+// inf and nan are rare enough to hand to strtod, via a bounded copy.
+template <typename T> bool scanSpecial(const char *&pos, const char *end, T *out)
+  {
+  char buffer[16];
+  xsize length = std::min((xsize)(end - pos), X_ARRAY_COUNT(buffer) - 1);
+  std::copy(pos, pos + length, buffer);
+  buffer[length] = '\0';
+
+  char *parsedEnd = 0;
+  double value = strtod(buffer, &parsedEnd);
+  if(parsedEnd == buffer)
+    {
+    return false;
+    }
+
+  pos += parsedEnd - buffer;
+  *out = (T)value;
+  return true;
+  }
+}
+
+// Scan a real number ([+-]digits[.digits][(e|E)[+-]digits]) from the start of [pos, end).
+// On success [pos] is moved past the number. Doubles match strtod when the significant
+// digits fit in 53 bits and the decimal exponent is within [-22, 22], and floats are rounded
+// from that double. Longer mantissas, of which 19 digits are kept, and larger exponents are
+// rounded more than once, so the result can be an ulp from strtof or strtod.
+template <typename T> bool scanReal(const char *&pos, const char *end, T *out)
+  {
+  const char *p = pos;
+  bool negative = false;
+  if(p < end && (*p == '-' || *p == '+'))
+    {
+    negative = *p == '-';
+    ++p;
+    }
+
+  if(p < end && (*p == 'i' || *p == 'I' || *p == 'n' || *p == 'N'))
+    {
+    return detail::scanSpecial(pos, end, out);
+    }
+
+  xuint64 mantissa = 0;
+  xsize significant = 0;
+  int exponent = 0;
+
+  xsize integerDigits = digitRunLength(p, end);
+  exponent += (int)detail::accumulateDigits(p, integerDigits, mantissa, significant);
+  p += integerDigits;
+
+  xsize fractionDigits = 0;
+  if(p < end && *p == '.')
+    {
+    ++p;
+    fractionDigits = digitRunLength(p, end);
+    xsize dropped = detail::accumulateDigits(p, fractionDigits, mantissa, significant);
+    exponent -= (int)(fractionDigits - dropped);
+    p += fractionDigits;
+    }
+
+  if(integerDigits == 0 && fractionDigits == 0)
+    {
+    return false;
+    }
+
+  if(p < end && (*p == 'e' || *p == 'E'))
+    {
+    const char *expStart = p + 1;
+    bool expNegative = false;
+    if(expStart < end && (*expStart == '-' || *expStart == '+'))
+      {
+      expNegative = *expStart == '-';
+      ++expStart;
+      }
+
+    xsize expDigits = digitRunLength(expStart, end);
+    if(expDigits)
+      {
+      int expValue = 0;
+      for(xsize i = 0; i < expDigits && expValue < 100000; ++i)
+        {
+        expValue = expValue * 10 + (expStart[i] - '0');
+        }
+      exponent += expNegative ? -expValue : expValue;
+      p = expStart + expDigits;
+      }
+    }
+
+  // Exact when the mantissa fits in a double and the power of ten is exact.
+  double value = (double)mantissa;
+  if(mantissa != 0)
+    {
+    if(exponent < 0 && exponent >= -22)
+      {
+      value /= detail::powerOfTen(-exponent);
+      }
+    else if(exponent < -300)
+      {
+      // 10^exponent alone would underflow before the mantissa is applied.
+      value *= detail::powerOfTen(exponent + 300);
+      value *= detail::powerOfTen(-300);
+      }
+    else
+      {
+      value *= detail::powerOfTen(exponent);
+      }
+    }
+
+  *out = (T)(negative ? -value : value);
+  pos = p;
+  return true;
+  }
+
+// Scan a decimal integer ([+-]digits) from the start of [pos, end).
+// On success [pos] is moved past the number.
+template <typename T> bool scanInteger(const char *&pos, const char *end, T *out)
+  {
+  const char *p = pos;
+  bool negative = false;
+  if(p < end && (*p == '-' || *p == '+'))
+    {
+    negative = *p == '-';
+    if(negative && !std::numeric_limits<T>::is_signed)
+      {
+      return false;
+      }
+    ++p;
+    }
+
+  xsize digits = digitRunLength(p, end);
+  if(digits == 0)
+    {
+    return false;
+    }
+
+  // The most negative value's magnitude is one more than max().
+  const xuint64 limit = (xuint64)std::numeric_limits<T>::max() + (negative ? 1 : 0);
+  xuint64 value = 0;
+  for(xsize i = 0; i < digits; ++i)
+    {
+    const xuint64 digit = (xuint64)(p[i] - '0');
+    if(value > (limit - digit) / 10)
+      {
+      return false;
+      }
+    value = value * 10 + digit;
+    }
+
+  *out = negative ? (T)(0 - value) : (T)value;
+  pos = p + digits;
+  return true;
+  }
+
+// Parse all of [begin, end) as a real, failing if anything is left over.
+template <typename T> bool parseReal(const char *begin, const char *end, T *out)
+  {
+  return scanReal(begin, end, out) && begin == end;
+  }
+
+// Parse all of [begin, end) as an integer, failing if anything is left over.
+template <typename T> bool parseInteger(const char *begin, const char *end, T *out)
+  {
+  return scanInteger(begin, end, out) && begin == end;
+  }
+
+}
+
+}
+
+#endif // XNUMBERSCANNER_H
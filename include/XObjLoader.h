@@ -5,6 +5,9 @@
 #include "Math/XMathVector.h"
 #include "Containers/XStringSimple.h"
 #include "XShader.h"
+#include "XBoundingBox.h"
+
+class Eks3DTest;
 
 namespace Eks
 {
@@ -20,8 +23,11 @@ public:
     {
     ExpectedVertices = 1024,
     ExpectedLineLength = 512,
-    ExpectedFloatLength = 32,
-    MaxComponent = 3
+    MaxComponent = 3,
+    // Read elements, plus a generated BiNormal.
+    MaxElements = MaxComponent + 1,
+    MinimumParallelChunkSize = 1024 * 1024,
+    MonitorInterval = 256 * 1024
     };
 
   typedef Vector<Char, ExpectedLineLength> LineCache;
@@ -31,31 +37,196 @@ public:
   struct ElementData
     {
     Vector<ElementVector> data;
+    // The bitangent sign of each generated tangent in [data], baked as its w. Empty for
+    // other elements.
+    Vector<Real> signs;
     const ObjLoader::ObjElement *desc;
+    // The format the element is baked in.
+    ShaderVertexLayoutDescription::Format format;
+    };
+
+  // Receives baked, non-indexed vertices from loadStreaming(), one batch at a time.
+  // [vertexData] is only valid for the duration of the call.
+  class BatchReceiver
+    {
+  public:
+    virtual ~BatchReceiver() { }
+    virtual void receive(const xuint8 *vertexData, xsize vertexCount, xsize vertexSize) = 0;
+    };
+
+  // Observes the parsing done by load(), loadParallel() and loadStreaming(), and can cancel it.
+  class Monitor
+    {
+  public:
+    virtual ~Monitor() { }
+    // Called once before [totalBytes] of data are parsed.
+    virtual void begin(xsize totalBytes) = 0;
+    // Called about every MonitorInterval bytes with the bytes parsed since the last call,
+    // from several threads at once under loadParallel(). Return false to cancel the load,
+    // which then returns false.
+    virtual bool advance(xsize bytes) = 0;
+    };
+
+  // Appends each batch to a single vertex buffer, and creates a Geometry from it once loading
+  // is complete. Pass [expectedBytes] if the output size is known, to avoid reallocation.
+  class EKS3D_EXPORT GeometryBatchReceiver : public BatchReceiver
+    {
+  public:
+    GeometryBatchReceiver(AllocatorBase *allocator, xsize expectedBytes = 0);
+
+    void receive(const xuint8 *vertexData, xsize vertexCount, xsize vertexSize);
+
+    xsize vertexCount() const { return _vertexCount; }
+    bool create(Renderer *r, Geometry *geo);
+
+  private:
+    Vector<xuint8> _data;
+    xsize _vertexSize;
+    xsize _vertexCount;
+    };
+
+  // A run of triangles sharing an object or group name, and a material, from o, g and usemtl
+  // lines. [firstIndex] and [indexCount] index the loaded triangle corners, which bake() and
+  // bakeIndexed() keep in order, so each submesh can be drawn as a range of the baked buffers.
+  struct Submesh
+    {
+    Submesh() : firstIndex(0), indexCount(0) { }
+
+    String name;
+    String material;
+    xsize firstIndex;
+    xsize indexCount;
+    BoundingBox bounds;
     };
 
   ObjLoader(AllocatorBase *allocator);
 
+  // Bake elements for [semantic] in [fmt], instead of as floats, in loads started after
+  // the call. Pass FormatCount to restore floats.
+  void setFormat(ShaderVertexLayoutDescription::Semantic semantic, ShaderVertexLayoutDescription::Format fmt);
+
+  // Report parsing progress to [monitor], or stop reporting if it is null.
+  void setMonitor(Monitor *monitor) { _monitor = monitor; }
+  Monitor *monitor() const { return _monitor; }
+
+  // Parse [data] in place, tokens are referenced as pointer ranges into [data]
+  // and no line or token is copied. If [submeshes] is non-null, the non-empty submeshes
+  // are appended to it.
   bool load(const char *data,
     xsize dataSize,
     const ShaderVertexLayoutDescription::Semantic *items,
     xsize itemCount,
     Vector<VectorI3D> *triangles,
     xsize *vertexSize,
-    ElementData *elements);
+    ElementData *elements,
+    Vector<Submesh> *submeshes = 0);
 
+  // Split loadParallel() input into chunks of at least [minimumChunkSize] bytes, and at most
+  // [maximumChunks] of them, or one per thread if it is zero. Small chunks are mostly useful
+  // for testing the stitching on small files.
+  void setParallelChunking(xsize minimumChunkSize, xsize maximumChunks = 0)
+    {
+    _parallelChunkSize = minimumChunkSize;
+    _parallelChunks = maximumChunks;
+    }
+
+  // Split [data] at newlines into chunks, MinimumParallelChunkSize or as set by
+  // setParallelChunking(), parse them on worker threads, and stitch the results in file
+  // order. The output is identical to load(), the loader's allocator must be thread safe.
+  bool loadParallel(const char *data,
+    xsize dataSize,
+    const ShaderVertexLayoutDescription::Semantic *items,
+    xsize itemCount,
+    Vector<VectorI3D> *triangles,
+    xsize *vertexSize,
+    ElementData *elements,
+    Vector<Submesh> *submeshes = 0);
+
+  // Memory map the file at [path] and parse it with load(), or loadParallel().
+  bool loadFile(const char *path,
+    const ShaderVertexLayoutDescription::Semantic *items,
+    xsize itemCount,
+    Vector<VectorI3D> *triangles,
+    xsize *vertexSize,
+    ElementData *elements,
+    bool parallel = false,
+    Vector<Submesh> *submeshes = 0);
+
+  // Parse [data] in place, baking every [batchTriangles] triangles and handing them to
+  // [receiver]. Only the element data and one batch are held in memory. Elements the file
+  // does not contain are generated per triangle, flat normals for normals, zero otherwise.
+  // Which elements those are is decided when the first batch is baked, so an element whose
+  // records only follow the first batch of faces is generated for the whole file.
+  bool loadStreaming(const char *data,
+    xsize dataSize,
+    const ShaderVertexLayoutDescription::Semantic *items,
+    xsize itemCount,
+    xsize *vertexSize,
+    BatchReceiver *receiver,
+    xsize batchTriangles = ExpectedVertices);
+
+  // Memory map the file at [path] and parse it with loadStreaming().
+  bool loadFileStreaming(const char *path,
+    const ShaderVertexLayoutDescription::Semantic *items,
+    xsize itemCount,
+    xsize *vertexSize,
+    BatchReceiver *receiver,
+    xsize batchTriangles = ExpectedVertices);
+
+  // Generate elements the file did not contain. Normals are smoothed across faces within
+  // [normalCreaseAngle] radians using NormalGenerator, or are flat per face if it is negative.
+  // Elements which can't be generated, like texture coordinates, are zero filled.
   void computeUnusedElements(ElementData *elements,
       xsize itemCount,
-      Vector<VectorI3D> *triangles);
+      Vector<VectorI3D> *triangles,
+      Real normalCreaseAngle = -1.0f);
 
   bool bake(const Vector<VectorI3D> &triangles,
     const ElementData *elementData,
     xsize elementCount,
     Vector<xuint8> *dataOut);
 
+  // Bake one vertex per unique (position, texcoord, normal) index tuple, and an index buffer
+  // referencing them, suitable for IndexGeometry::delayedCreate with IndexGeometry::Unsigned16.
+  // Throws a ParseException if there are more unique vertices than 16 bit indices can address.
+  bool bakeIndexed(const Vector<VectorI3D> &triangles,
+    const ElementData *elementData,
+    xsize elementCount,
+    Vector<xuint8> *dataOut,
+    Vector<xuint16> *indicesOut);
+
+  // As above with 32 bit indices, so any number of unique vertices can be indexed. Pass the
+  // result to IndexGeometry::delayedCreateNarrowest so small meshes keep 16 bit indices.
+  bool bakeIndexed(const Vector<VectorI3D> &triangles,
+    const ElementData *elementData,
+    xsize elementCount,
+    Vector<xuint8> *dataOut,
+    Vector<xuint32> *indicesOut);
+
   const ObjElement *findObjectDescriptionForSemantic(ShaderVertexLayoutDescription::Semantic s);
 
+  // Prepare [elements] for [items] in this loader's formats, and find the baked vertex size.
+  // Importers for other formats use this before filling the elements themselves, so
+  // computeUnusedElements() and the bake functions work on their output too.
+  bool initialiseElements(
+    const ShaderVertexLayoutDescription::Semantic *items,
+    xsize itemCount,
+    xsize *vertexSize,
+    ElementData *elements);
+
 private:
+  friend class ::Eks3DTest;
+
+  // The original parser, which copies each line into a LineCache before tokenising.
+  // Kept as a reference for load() in tests, and for benchmarking against it.
+  bool loadLineCached(const char *data,
+    xsize dataSize,
+    const ShaderVertexLayoutDescription::Semantic *items,
+    xsize itemCount,
+    Vector<VectorI3D> *triangles,
+    xsize *vertexSize,
+    ElementData *elements);
+
   bool findElementType(
     const LineCache &line,
     const ShaderVertexLayoutDescription::Semantic *items,
@@ -72,7 +243,10 @@ private:
     xsize elementCount);
 
   Eks::AllocatorBase *_allocator;
-  Eks::String _scratchString;
+  Monitor *_monitor;
+  xsize _parallelChunkSize;
+  xsize _parallelChunks;
+  ShaderVertexLayoutDescription::Format _formats[ShaderVertexLayoutDescription::SemanticCount];
   };
 
 }
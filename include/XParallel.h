@@ -0,0 +1,96 @@
+#ifndef XPARALLEL_H
+#define XPARALLEL_H
+
+#include "X3DGlobal.h"
+#include <algorithm>
+#include <thread>
+#include <exception>
+#include <vector>
+
+namespace Eks
+{
+
+namespace ParallelUtilities
+{
+
+// The number of worker threads used by the parallel helpers.
+xsize EKS3D_EXPORT threadCount();
+
+// The number of ranges forRanges will split [count] items into.
+inline xsize rangeCount(xsize count, xsize minRange, xsize maxRanges = 0)
+  {
+  if(count == 0)
+    {
+    return 0;
+    }
+
+  if(maxRanges == 0)
+    {
+    maxRanges = threadCount();
+    }
+
+  minRange = std::max(minRange, (xsize)1);
+  xsize ranges = std::max((xsize)1, count / minRange);
+  return std::min(ranges, maxRanges);
+  }
+
+// Split [0, count) into contiguous ranges of at least [minRange] items, and call
+// fn(rangeIndex, begin, end) for each range, with the calling thread taking the first.
+// If [maxRanges] is zero it defaults to threadCount(), so the split can differ between
+// machines, pass it when results must not depend on the split. Blocks until all ranges
+// are complete, then rethrows the exception from the lowest failing range, if any.
+template <typename Fn> void forRanges(xsize count, xsize minRange, Fn fn, xsize maxRanges = 0)
+  {
+  const xsize ranges = rangeCount(count, minRange, maxRanges);
+  if(ranges <= 1)
+    {
+    if(ranges == 1)
+      {
+      fn((xsize)0, (xsize)0, count);
+      }
+    return;
+    }
+
+  std::vector<std::exception_ptr> errors(ranges);
+  auto run = [&](xsize r)
+    {
+    const xsize begin = (count * r) / ranges;
+    const xsize end = (count * (r + 1)) / ranges;
+    try
+      {
+      fn(r, begin, end);
+      }
+    catch(...)
+      {
+      errors[r] = std::current_exception();
+      }
+    };
+
+  std::vector<std::thread> threads;
+  threads.reserve(ranges - 1);
+  for(xsize r = 1; r < ranges; ++r)
+    {
+    threads.emplace_back(run, r);
+    }
+
+  run(0);
+
+  for(xsize i = 0; i < threads.size(); ++i)
+    {
+    threads[i].join();
+    }
+
+  for(xsize r = 0; r < ranges; ++r)
+    {
+    if(errors[r])
+      {
+      std::rethrow_exception(errors[r]);
+      }
+    }
+  }
+
+}
+
+}
+
+#endif // XPARALLEL_H
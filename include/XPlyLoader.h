@@ -0,0 +1,87 @@
+#ifndef XPLYLOADER_H
+#define XPLYLOADER_H
+
+#include "X3DGlobal.h"
+#include "XObjLoader.h"
+#include "XGeometry.h"
+
+namespace Eks
+{
+
+// Loads Stanford PLY meshes and point clouds, in ascii and either binary byte order.
+//
+// Vertex properties x, y, z, nx, ny, nz and u, v (or s, t, texture_u, texture_v) map onto
+// Position, Normal and TextureCoordinate. Faces come from the face element's vertex_indices
+// list, and are split into fans. Other elements and properties are skipped.
+class EKS3D_EXPORT PlyLoader
+  {
+public:
+  enum
+    {
+    MaxElements = 8,
+    MaxProperties = 32
+    };
+
+  PlyLoader(AllocatorBase *allocator);
+
+  // The loader whose formats the elements are initialised with, and which bakes them.
+  ObjLoader &loader() { return _loader; }
+
+  // Read [data] into [elements] and [triangles] as ObjLoader::load does. Every corner
+  // indexes the same vertex in each element, elements the file has no properties for are
+  // left empty for computeUnusedElements.
+  bool load(const char *data,
+    xsize dataSize,
+    const ShaderVertexLayoutDescription::Semantic *items,
+    xsize itemCount,
+    Vector<VectorI3D> *triangles,
+    xsize *vertexSize,
+    ObjLoader::ElementData *elements);
+
+  // Find the vertex data in [data] if it is already laid out as [items] are baked: binary in
+  // this machine's byte order, with float properties for each item in order and nothing else,
+  // and four uchar red, green, blue and alpha properties for Colour in
+  // FormatNormalisedUnsignedByte4. [vertexData] then points into [data], and no copy is needed.
+  static bool findDirectVertexData(const char *data,
+    xsize dataSize,
+    const ShaderVertexLayoutDescription::Semantic *items,
+    xsize itemCount,
+    const xuint8 **vertexData,
+    xsize *vertexSize,
+    xsize *vertexCount);
+
+  // Create [geo] straight from the vertex data in [data], which must be laid out as
+  // findDirectVertexData requires, and [indexGeo] from the triangulated faces, if non-null.
+  // Returns false if the layout doesn't match, callers can then fall back to load() and a bake.
+  bool createDirect(const char *data,
+    xsize dataSize,
+    const ShaderVertexLayoutDescription::Semantic *items,
+    xsize itemCount,
+    Renderer *r,
+    Geometry *geo,
+    IndexGeometry *indexGeo = 0);
+
+  // Memory map the file at [path] and read it with load().
+  bool loadFile(const char *path,
+    const ShaderVertexLayoutDescription::Semantic *items,
+    xsize itemCount,
+    Vector<VectorI3D> *triangles,
+    xsize *vertexSize,
+    ObjLoader::ElementData *elements);
+
+  // Memory map the file at [path] and create geometry from the mapping with createDirect().
+  bool createDirectFromFile(const char *path,
+    const ShaderVertexLayoutDescription::Semantic *items,
+    xsize itemCount,
+    Renderer *r,
+    Geometry *geo,
+    IndexGeometry *indexGeo = 0);
+
+private:
+  AllocatorBase *_allocator;
+  ObjLoader _loader;
+  };
+
+}
+
+#endif // XPLYLOADER_H
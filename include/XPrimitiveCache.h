@@ -0,0 +1,110 @@
+#ifndef XPRIMITIVECACHE_H
+#define XPRIMITIVECACHE_H
+
+#include "X3DGlobal.h"
+#include "Math/XMathVector.h"
+#include "Containers/XVector.h"
+#include <atomic>
+#include <mutex>
+
+namespace Eks
+{
+
+class Modeller;
+
+// Unit primitives tessellated once per set of parameters, which Modeller instances by
+// transform instead of recomputing them. A cache can be shared by Modellers on different
+// threads, and finding a primitive that is already built doesn't lock. For instanced drawing,
+// draw a primitive into an empty Modeller with Modeller::drawPrimitive() and bake it once.
+class EKS3D_EXPORT PrimitiveCache
+  {
+public:
+  enum Type
+    {
+    Sphere,
+    Cone,
+    WireCircle,
+    Cube
+    };
+
+  // Vertex data as Modeller draws it, with an identity transform. Normals and textures are
+  // empty or have an element per position.
+  struct Primitive
+    {
+    Primitive(AllocatorBase *allocator)
+        : positions(allocator),
+          normals(allocator),
+          textures(allocator),
+          triangles(allocator),
+          lines(allocator)
+      {
+      }
+
+    Vector<Vector3D> positions;
+    Vector<Vector3D> normals;
+    Vector<Vector2D> textures;
+    Vector<xuint32> triangles;
+    Vector<xuint32> lines;
+    };
+
+  PrimitiveCache(AllocatorBase *allocator);
+  ~PrimitiveCache();
+
+  // A sphere of radius one at the origin.
+  const Primitive &sphere(xuint32 lats, xuint32 longs);
+  // A cone with its base circle of radius one around the origin, and its tip at (1, 0, 0).
+  // The circle's up axis is y, and its across axis -z.
+  const Primitive &cone(xuint32 divs, bool capped);
+  // A circle of radius one in the xy plane, starting at (0, 1, 0).
+  const Primitive &wireCircle(xuint32 points);
+  // A unit cube centred on the origin, textured with offsets [textureX] and [textureY].
+  const Primitive &cube(Real textureX, Real textureY);
+
+  // Destroy every primitive, invalidating all references returned so far. Must not be
+  // called while another thread is using the cache.
+  void clear();
+
+private:
+  X_DISABLE_COPY(PrimitiveCache);
+
+  enum
+    {
+    BucketCount = 64
+    };
+
+  struct Key
+    {
+    Type type;
+    xuint32 a;
+    xuint32 b;
+    bool capped;
+
+    bool equals(const Key &other) const
+      {
+      return type == other.type && a == other.a && b == other.b && capped == other.capped;
+      }
+    };
+
+  // Entries are immutable once published at the head of their bucket's chain.
+  struct Entry
+    {
+    Key key;
+    Primitive *primitive;
+    Entry *next;
+    };
+
+  static xsize bucket(const Key &key);
+  static const Entry *findInChain(const Entry *first, const Key &key);
+  const Primitive &find(const Key &key);
+  Primitive *build(const Key &key);
+
+  AllocatorBase *_allocator;
+
+  // Serialises building and clearing, lookups read the buckets without it.
+  std::mutex _lock;
+  std::atomic<Entry *> _buckets[BucketCount];
+  };
+
+}
+
+#endif // XPRIMITIVECACHE_H
@@ -200,6 +200,7 @@ struct RendererDrawFunctions
   {
   // draw the given geometry
   void (*indexedTriangles)(Renderer *r, const IndexGeometry *indices, const Geometry *vert);
+  void (*indexedTrianglesRange)(Renderer *r, const IndexGeometry *indices, const Geometry *vert, xsize firstIndex, xsize indexCount);
   void (*triangles)(Renderer *r, const Geometry *vert);
   void (*patch)(Renderer *r, const Geometry *vert, xuint8 vertCount);
   void (*indexedLines)(Renderer *r, const IndexGeometry *indices, const Geometry *vert);
@@ -217,6 +218,48 @@ struct RendererFramebufferFunctions
   Texture2D *(*getTexture)(Renderer *r, FrameBuffer *buffer, xuint32 mode);
   };
 
+// creation writing straight into buffer memory, these may be null.
+struct RendererBufferFunctions
+  {
+  // Create the buffer, then call write(data, context) with memory to fill, ideally a mapping
+  // of the buffer, which is uploaded from once write returns.
+  bool (*geometry)(
+      Renderer *r,
+      Geometry *g,
+      xsize elementSize,
+      xsize elementCount,
+      void (*write)(void *data, void *context),
+      void *context);
+
+  bool (*indexGeometry)(
+      Renderer *r,
+      IndexGeometry *g,
+      int type,
+      xsize indexCount,
+      void (*write)(void *data, void *context),
+      void *context);
+
+  // Overwrite elements [first, first + count) of an existing buffer with what write fills.
+  // Returns false if the buffer holds different elements, or fewer of them.
+  bool (*updateGeometry)(
+      Renderer *r,
+      Geometry *g,
+      xsize elementSize,
+      xsize first,
+      xsize count,
+      void (*write)(void *data, void *context),
+      void *context);
+
+  bool (*updateIndexGeometry)(
+      Renderer *r,
+      IndexGeometry *g,
+      int type,
+      xsize first,
+      xsize count,
+      void (*write)(void *data, void *context),
+      void *context);
+  };
+
 struct RendererFunctions
   {
   RendererCreateFunctions create;
@@ -225,6 +268,7 @@ struct RendererFunctions
   RendererGetFunctions get;
   RendererDrawFunctions draw;
   RendererFramebufferFunctions frame;
+  RendererBufferFunctions buffer;
   };
 
 }
@@ -289,6 +333,12 @@ public:
     functions().draw.indexedTriangles(this, i, g);
     }
 
+  // draw [indexCount] indices from [firstIndex], for example one submesh of a shared buffer.
+  void drawTriangles(const IndexGeometry *i, const Geometry *g, xsize firstIndex, xsize indexCount)
+    {
+    functions().draw.indexedTrianglesRange(this, i, g, firstIndex, indexCount);
+    }
+
   void drawLines(const Geometry *g)
     {
     functions().draw.lines(this, g);
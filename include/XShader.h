@@ -22,6 +22,22 @@ public:
     FormatFloat3,
     FormatFloat4,
 
+    // Compact formats, written by VertexEncoder. Normalised formats map integers to
+    // [-1, 1], or [0, 1] when unsigned, and read as floats in the shader.
+    FormatHalf2,
+    FormatHalf4,
+    FormatNormalisedShort2,
+    FormatNormalisedShort4,
+    FormatNormalisedUnsignedShort2,
+    FormatNormalisedByte4,
+    FormatNormalisedUnsignedByte4,
+    // Unsigned x, y and z in 10 bits each and w in 2, packed into 32 bits. GL and D3D11
+    // only share the unsigned layout, signed data must be biased into [0, 1].
+    FormatNormalisedUnsigned10_10_10_2,
+    // A unit vector folded onto an octahedron, in two normalised shorts, which the shader
+    // unfolds back to three components, as the shading example's vertex shader does.
+    FormatOctahedralNormal,
+
     FormatCount
     };
 
@@ -65,6 +81,56 @@ public:
     {
     }
 
+  // Size in bytes of one attribute of format [fmt].
+  static xsize formatSize(Format fmt)
+    {
+    const xsize sizes[] =
+    {
+      sizeof(float) * 1,
+      sizeof(float) * 2,
+      sizeof(float) * 3,
+      sizeof(float) * 4,
+      sizeof(xuint16) * 2,
+      sizeof(xuint16) * 4,
+      sizeof(xint16) * 2,
+      sizeof(xint16) * 4,
+      sizeof(xuint16) * 2,
+      sizeof(xint8) * 4,
+      sizeof(xuint8) * 4,
+      sizeof(xuint32),
+      sizeof(xint16) * 2
+    };
+    xCompileTimeAssert(X_ARRAY_COUNT(sizes) == FormatCount);
+
+    xAssert(fmt < FormatCount);
+    return sizes[fmt];
+    }
+
+  // The number of float values one attribute of format [fmt] is encoded from.
+  static xsize formatComponents(Format fmt)
+    {
+    const xuint8 components[] =
+    {
+      1,
+      2,
+      3,
+      4,
+      2,
+      4,
+      2,
+      4,
+      2,
+      4,
+      4,
+      4,
+      3
+    };
+    xCompileTimeAssert(X_ARRAY_COUNT(components) == FormatCount);
+
+    xAssert(fmt < FormatCount);
+    return components[fmt];
+    }
+
   Semantic semantic;
   Format format;
   xsize offset;
@@ -0,0 +1,61 @@
+#ifndef XTANGENTGENERATOR_H
+#define XTANGENTGENERATOR_H
+
+#include "X3DGlobal.h"
+#include "Math/XMathVector.h"
+#include "Containers/XVector.h"
+
+namespace Eks
+{
+
+// Generates per vertex tangents for an indexed triangle list, for the BiNormal semantic.
+//
+// Follows MikkTSpace: each triangle's texture space tangent is projected into the plane of
+// the vertex normal and weighted by the corner angle, then the sum is normalised and made
+// orthogonal to the normal. The tangent points along increasing u, and its w holds the
+// bitangent's sign, so the bitangent along increasing v is w * cross(normal, tangent).
+class EKS3D_EXPORT TangentGenerator
+  {
+public:
+  enum
+    {
+    MinimumParallelTriangles = 16 * 1024,
+    MinimumParallelVertices = 16 * 1024
+    };
+
+  TangentGenerator(AllocatorBase *allocator);
+
+  // [indices] holds three vertex indices per triangle, into [positions], [normals] and
+  // [texCoords]. On return [tangents] holds one unit tangent per vertex, with its sign in w.
+  void generate(
+    const Vector3D *positions,
+    const Vector3D *normals,
+    const Vector2D *texCoords,
+    xsize vertexCount,
+    const xuint32 *indices,
+    xsize indexCount,
+    Vector<Vector4D> *tangents);
+
+  // The unnormalised directions of increasing u and v across a triangle, or zero if its
+  // texture coordinates are degenerate.
+  static Vector3D triangleTangent(
+    const Vector3D &p0, const Vector3D &p1, const Vector3D &p2,
+    const Vector2D &t0, const Vector2D &t1, const Vector2D &t2);
+  static Vector3D triangleBitangent(
+    const Vector3D &p0, const Vector3D &p1, const Vector3D &p2,
+    const Vector2D &t0, const Vector2D &t1, const Vector2D &t2);
+
+  // -1 if [bitangent] points against cross(normal, tangent), else 1.
+  static Real bitangentSign(const Vector3D &normal, const Vector3D &tangent, const Vector3D &bitangent);
+
+  // Make [tangent] a unit vector orthogonal to [normal], picking any perpendicular if
+  // the two are parallel or [tangent] is zero.
+  static Vector3D orthogonalise(const Vector3D &tangent, const Vector3D &normal);
+
+private:
+  AllocatorBase *_allocator;
+  };
+
+}
+
+#endif // XTANGENTGENERATOR_H
@@ -0,0 +1,37 @@
+#ifndef XVERTEXENCODER_H
+#define XVERTEXENCODER_H
+
+#include "X3DGlobal.h"
+#include "Math/XMathVector.h"
+#include "XShader.h"
+
+namespace Eks
+{
+
+// Converts float vertex attributes to and from the ShaderVertexLayoutDescription formats.
+class EKS3D_EXPORT VertexEncoder
+  {
+public:
+  typedef ShaderVertexLayoutDescription::Format Format;
+
+  // Write [valueCount] values as one attribute of [fmt] to [out], which must have room for
+  // ShaderVertexLayoutDescription::formatSize(fmt) bytes. Components the values do not
+  // cover are written as zero. Normalised formats clamp values to their range.
+  static void encode(Format fmt, const Real *values, xsize valueCount, xuint8 *out);
+
+  // Read one attribute of [fmt] from [in] into [values], which must have room for
+  // ShaderVertexLayoutDescription::formatComponents(fmt) values.
+  static void decode(Format fmt, const xuint8 *in, Real *values);
+
+  // IEEE half precision conversion, rounding to nearest even.
+  static xuint16 toHalf(float value);
+  static float fromHalf(xuint16 value);
+
+  // Fold the unit vector [normal] onto an octahedron, giving coordinates in [-1, 1].
+  static Vector2D octahedralEncode(const Vector3D &normal);
+  static Vector3D octahedralDecode(const Vector2D &encoded);
+  };
+
+}
+
+#endif // XVERTEXENCODER_H
@@ -0,0 +1,43 @@
+#ifndef XVERTEXINTERLEAVER_H
+#define XVERTEXINTERLEAVER_H
+
+#include "X3DGlobal.h"
+
+namespace Eks
+{
+
+// Interleaves float vertex attribute arrays into one vertex buffer, writing each vertex
+// whole in a single pass over the data.
+class EKS3D_EXPORT VertexInterleaver
+  {
+public:
+  enum
+    {
+    MaxStreams = 8,
+    MaxComponents = 4,
+
+    // Meshes with fewer vertices are interleaved on the calling thread.
+    MinParallelVertices = 64 * 1024
+    };
+
+  // [count] elements of [components] values, tightly packed. Vertices past [count] are
+  // written as zeros.
+  struct Stream
+    {
+    const Real *data;
+    xsize components;
+    xsize count;
+    };
+
+  // The size in bytes of a vertex made from [streams].
+  static xsize vertexSize(const Stream *streams, xsize streamCount);
+
+  // Write [vertexCount] vertices to [out], each holding an element from every stream in
+  // order, packed. Common layouts use kernels specialised for their component counts, and
+  // large meshes are split across threads.
+  static void interleave(const Stream *streams, xsize streamCount, xsize vertexCount, void *out);
+  };
+
+}
+
+#endif // XVERTEXINTERLEAVER_H
@@ -228,7 +228,16 @@ bool createVertexShaderComponent(
       DXGI_FORMAT_R32_FLOAT,
       DXGI_FORMAT_R32G32_FLOAT,
       DXGI_FORMAT_R32G32B32_FLOAT,
-      DXGI_FORMAT_R32G32B32A32_FLOAT
+      DXGI_FORMAT_R32G32B32A32_FLOAT,
+      DXGI_FORMAT_R16G16_FLOAT,
+      DXGI_FORMAT_R16G16B16A16_FLOAT,
+      DXGI_FORMAT_R16G16_SNORM,
+      DXGI_FORMAT_R16G16B16A16_SNORM,
+      DXGI_FORMAT_R16G16_UNORM,
+      DXGI_FORMAT_R8G8B8A8_SNORM,
+      DXGI_FORMAT_R8G8B8A8_UNORM,
+      DXGI_FORMAT_R10G10B10A2_UNORM,
+      DXGI_FORMAT_R16G16_SNORM
     };
     xCompileTimeAssert(X_ARRAY_COUNT(formatMap) == ShaderVertexLayoutDescription::FormatCount);
 
@@ -239,6 +248,7 @@ bool createVertexShaderComponent(
       {
       currentVertexDesc->SemanticName = semanticMap[vertexDescriptions->semantic];
       currentVertexDesc->SemanticIndex = 0; // increase for matrices...
+      xAssert(formatMap[vertexDescriptions->format] != DXGI_FORMAT_UNKNOWN);
       currentVertexDesc->Format = formatMap[vertexDescriptions->format]; // increase for matrices...
       currentVertexDesc->AlignedByteOffset = (UINT)vertexDescriptions->offset;
 
@@ -308,10 +318,14 @@ bool createIndexGeometry(
 
   const Format typeMap[] =
   {
-    { DXGI_FORMAT_R16_UINT, sizeof(xuint16) }
+    { DXGI_FORMAT_R16_UINT, sizeof(xuint16) },
+    { DXGI_FORMAT_R32_UINT, sizeof(xuint32) },
+    // D3D11 has no 8 bit index format.
+    { DXGI_FORMAT_UNKNOWN, sizeof(xuint8) }
   };
   xCompileTimeAssert(X_ARRAY_COUNT(typeMap) == IndexGeometry::TypeCount);
   const Format &typeData = typeMap[type];
+  xAssert(typeData.format != DXGI_FORMAT_UNKNOWN);
   geo->format = typeData.format;
 
   xsize dataSize = indexCount * typeData.elementSize;
@@ -521,10 +535,11 @@ void drawLines(Renderer *r, const Geometry *vert)
     );
   }
 
-void drawIndexedTriangles(Renderer *r, const IndexGeometry *indices, const Geometry *vert)
+void drawIndexedTrianglesRange(Renderer *r, const IndexGeometry *indices, const Geometry *vert, xsize first, xsize count)
   {
   const XD3DVertexBufferImpl *geo = vert->data<XD3DVertexBufferImpl>();
   const XD3DIndexBufferImpl *idx = indices->data<XD3DIndexBufferImpl>();
+  xAssert(first + count <= idx->count);
 
   UINT stride = (UINT)geo->elementSize;
   UINT offset = 0;
@@ -545,12 +560,18 @@ void drawIndexedTriangles(Renderer *r, const IndexGeometry *indices, const Geome
   D3D(r)->_d3dContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 
   D3D(r)->_d3dContext->DrawIndexed(
-    (UINT)idx->count,
-    0,
+    (UINT)count,
+    (UINT)first,
     0
     );
   }
 
+void drawIndexedTriangles(Renderer *r, const IndexGeometry *indices, const Geometry *vert)
+  {
+  const XD3DIndexBufferImpl *idx = indices->data<XD3DIndexBufferImpl>();
+  drawIndexedTrianglesRange(r, indices, vert, 0, idx->count);
+  }
+
 
 void drawIndexedLines(Renderer *r, const IndexGeometry *indices, const Geometry *vert)
   {
@@ -754,6 +775,7 @@ detail::RendererFunctions d3dfns =
     },
     {
       drawIndexedTriangles,
+      drawIndexedTrianglesRange,
       drawTriangles,
       drawIndexedLines,
       drawLines,
@@ -25,6 +25,16 @@
 # include "QGLFunctions"
 #endif
 
+// Vertex formats newer than some headers, half floats need GL 3.0 or
+// ARB_half_float_vertex, and packed 10:10:10:2 needs GL 3.3.
+#ifndef GL_HALF_FLOAT
+# define GL_HALF_FLOAT 0x140B
+#endif
+
+#ifndef GL_UNSIGNED_INT_2_10_10_10_REV
+# define GL_UNSIGNED_INT_2_10_10_10_REV 0x8368
+#endif
+
 #include "Containers/XStringSimple.h"
 #include "Memory/XAllocatorBase.h"
 #include "XFramebuffer.h"
@@ -118,8 +128,10 @@ public:
     }
 
   template <xuint32 PRIMITIVE> static void drawIndexedPrimitive21(Renderer *r, const IndexGeometry *indices, const Geometry *vert);
+  template <xuint32 PRIMITIVE> static void drawIndexedPrimitiveRange21(Renderer *r, const IndexGeometry *indices, const Geometry *vert, xsize first, xsize count);
   template <xuint32 PRIMITIVE> static void drawPrimitive21(Renderer *r, const Geometry *vert);
   template <xuint32 PRIMITIVE> static void drawIndexedPrimitive33(Renderer *r, const IndexGeometry *indices, const Geometry *vert);
+  template <xuint32 PRIMITIVE> static void drawIndexedPrimitiveRange33(Renderer *r, const IndexGeometry *indices, const Geometry *vert, xsize first, xsize count);
   template <xuint32 PRIMITIVE> static void drawPrimitive33(Renderer *r, const Geometry *vert);
 
   static void drawPatch33(Renderer *r, const Geometry *vert, xuint8 vertCount);
@@ -412,6 +424,21 @@ class XGLBuffer
   {
 public:
   bool init(GLRendererImpl *, const void *data, xuint32 type, xuint32 renderType, xsize size);
+  // Create the buffer and let [write] fill a mapping of it.
+  bool initWritten(
+      GLRendererImpl *,
+      xuint32 type,
+      xuint32 renderType,
+      xsize size,
+      void (*write)(void *data, void *context),
+      void *context);
+  // Overwrite [size] bytes at [offset] with what [write] fills.
+  bool update(
+      xuint32 type,
+      xsize offset,
+      xsize size,
+      void (*write)(void *data, void *context),
+      void *context);
   ~XGLBuffer();
 
   unsigned int _buffer;
@@ -424,6 +451,42 @@ class XGLIndexGeometryCache : public XGLBuffer
   {
 public:
   bool init(GLRendererImpl *, const void *data, IndexGeometry::Type type, xsize elementCount);
+  bool initWritten(
+      GLRendererImpl *,
+      IndexGeometry::Type type,
+      xsize elementCount,
+      void (*write)(void *data, void *context),
+      void *context);
+
+  static bool createWritten(
+      Renderer *ren,
+      IndexGeometry *g,
+      int elementType,
+      xsize elementCount,
+      void (*write)(void *data, void *context),
+      void *context)
+    {
+    XGLIndexGeometryCache *cache = g->create<XGLIndexGeometryCache>();
+    return cache->initWritten(GL_REND(ren), (IndexGeometry::Type)elementType, elementCount, write, context);
+    }
+
+  static bool update(
+      Renderer *,
+      IndexGeometry *g,
+      int elementType,
+      xsize first,
+      xsize count,
+      void (*write)(void *data, void *context),
+      void *context)
+    {
+    XGLIndexGeometryCache *cache = g->data<XGLIndexGeometryCache>();
+    const xsize size = IndexGeometry::typeSize((IndexGeometry::Type)elementType);
+    if(size != cache->indexSize() || first + count > cache->_indexCount)
+      {
+      return false;
+      }
+    return cache->XGLBuffer::update(GL_ELEMENT_ARRAY_BUFFER, first * size, count * size, write, context);
+    }
 
   static bool create(
       Renderer *ren,
@@ -437,6 +500,21 @@ public:
     return true;
     }
 
+  xsize indexSize() const
+    {
+    if(_indexType == GL_UNSIGNED_INT)
+      {
+      return sizeof(xuint32);
+      }
+    if(_indexType == GL_UNSIGNED_BYTE)
+      {
+      return sizeof(xuint8);
+      }
+
+    xAssert(_indexType == GL_UNSIGNED_SHORT);
+    return sizeof(xuint16);
+    }
+
   GLuint _indexCount;
   unsigned int _indexType;
   };
@@ -448,6 +526,41 @@ class XGLGeometryCache : public XGLBuffer
   {
 public:
   bool init( GLRendererImpl *, const void *data, xsize elementSize, xsize elementCount );
+  bool initWritten(
+      GLRendererImpl *,
+      xsize elementSize,
+      xsize elementCount,
+      void (*write)(void *data, void *context),
+      void *context);
+
+  static bool createWritten(
+      Renderer *ren,
+      Geometry *g,
+      xsize elementSize,
+      xsize elementCount,
+      void (*write)(void *data, void *context),
+      void *context)
+    {
+    XGLGeometryCache *cache = g->create<XGLGeometryCache>();
+    return cache->initWritten(GL_REND(ren), elementSize, elementCount, write, context);
+    }
+
+  static bool update(
+      Renderer *,
+      Geometry *g,
+      xsize elementSize,
+      xsize first,
+      xsize count,
+      void (*write)(void *data, void *context),
+      void *context)
+    {
+    XGLGeometryCache *cache = g->data<XGLGeometryCache>();
+    if(elementSize != cache->_elementSize || first + count > cache->_elementCount)
+      {
+      return false;
+      }
+    return cache->XGLBuffer::update(GL_ARRAY_BUFFER, first * elementSize, count * elementSize, write, context);
+    }
 
   static bool create(
       Renderer *ren,
@@ -649,12 +762,8 @@ public:
         attr.offset = (xuint8)vertexSize;
         }
 
-      xCompileTimeAssert(ShaderVertexLayoutDescription::FormatFloat1 == 0);
-      xCompileTimeAssert(ShaderVertexLayoutDescription::FormatFloat2 == 1);
-      xCompileTimeAssert(ShaderVertexLayoutDescription::FormatFloat3 == 2);
-      xCompileTimeAssert(ShaderVertexLayoutDescription::FormatFloat4 == 3);
-      attr.components = desc.format + 1;
-      xAssert(attr.components <= 4);
+      xAssert(desc.format < ShaderVertexLayoutDescription::FormatCount);
+      attr.format = (xuint8)desc.format;
 
       xAssert(vertexSize < std::numeric_limits<xuint8>::max());
       vertexSize = std::max(vertexSize, (xuint8)(attr.offset + attr.size()));
@@ -690,16 +799,46 @@ public:
   struct Attribute
     {
     xuint8 offset;
-    xuint8 components;
+    xuint8 format;
     xuint8 semantic;
-    // type is currently always float.
 
     inline xsize size() const
       {
-      return components * sizeof(float);
+      return ShaderVertexLayoutDescription::formatSize((ShaderVertexLayoutDescription::Format)format);
       }
     };
 
+  struct AttributeFormat
+    {
+    GLint components;
+    GLenum type;
+    GLboolean normalised;
+    };
+
+  static const AttributeFormat &attributeFormat(xuint8 format)
+    {
+    static const AttributeFormat formats[] =
+    {
+      { 1, GL_FLOAT, GL_FALSE },
+      { 2, GL_FLOAT, GL_FALSE },
+      { 3, GL_FLOAT, GL_FALSE },
+      { 4, GL_FLOAT, GL_FALSE },
+      { 2, GL_HALF_FLOAT, GL_FALSE },
+      { 4, GL_HALF_FLOAT, GL_FALSE },
+      { 2, GL_SHORT, GL_TRUE },
+      { 4, GL_SHORT, GL_TRUE },
+      { 2, GL_UNSIGNED_SHORT, GL_TRUE },
+      { 4, GL_BYTE, GL_TRUE },
+      { 4, GL_UNSIGNED_BYTE, GL_TRUE },
+      { 4, GL_UNSIGNED_INT_2_10_10_10_REV, GL_TRUE },
+      { 2, GL_SHORT, GL_TRUE }
+    };
+    xCompileTimeAssert(X_ARRAY_COUNT(formats) == ShaderVertexLayoutDescription::FormatCount);
+
+    xAssert(format < ShaderVertexLayoutDescription::FormatCount);
+    return formats[format];
+    }
+
   Attribute _attrs[ShaderVertexLayoutDescription::SemanticCount];
   xuint8 _attrCount;
   Eks::GLRendererImpl* _renderer;
@@ -710,15 +849,16 @@ public:
     for(GLuint i = 0, s = (GLuint)_attrCount; i < s; ++i)
       {
       const Attribute &attr = _attrs[i];
+      const AttributeFormat &format = attributeFormat(attr.format);
 
       xsize offset = (xsize)attr.offset;
 
       glEnableVertexAttribArray(i) GLE;
       glVertexAttribPointer(
             i,
-            attr.components,
-            GL_FLOAT,
-            GL_FALSE,
+            format.components,
+            format.type,
+            format.normalised,
             vertexSize,
             (GLvoid*)offset) GLE;
       }
@@ -1190,6 +1330,18 @@ template <xuint32 PRIMITIVE> void GLRendererImpl::drawIndexedPrimitive21(
     const IndexGeometry *indices,
     const Geometry *vert)
   {
+  xAssert(indices);
+  const XGLIndexGeometryCache *idx = indices->data<XGLIndexGeometryCache>();
+  drawIndexedPrimitiveRange21<PRIMITIVE>(ren, indices, vert, 0, idx->_indexCount);
+  }
+
+template <xuint32 PRIMITIVE> void GLRendererImpl::drawIndexedPrimitiveRange21(
+    Renderer *ren,
+    const IndexGeometry *indices,
+    const Geometry *vert,
+    xsize first,
+    xsize count)
+  {
   GLRendererImpl* r = GL_REND(ren);
   xAssert(r->_currentShader);
   xAssert(r->_vertexLayout);
@@ -1208,7 +1360,8 @@ template <xuint32 PRIMITIVE> void GLRendererImpl::drawIndexedPrimitive21(
   XGLVertexLayout *l = r->_vertexLayout->data<XGLVertexLayout>();
   l->bindVertexData(gC);
 
-  glDrawElements(PRIMITIVE, idx->_indexCount, idx->_indexType, (GLvoid*)((char*)NULL)) GLE;
+  xAssert(first + count <= idx->_indexCount);
+  glDrawElements(PRIMITIVE, (GLsizei)count, idx->_indexType, (GLvoid*)((char*)NULL + first * idx->indexSize())) GLE;
   l->unbindVertexData();
 
   glBindBuffer(GL_ARRAY_BUFFER, 0) GLE;
@@ -1220,6 +1373,18 @@ template <xuint32 PRIMITIVE> void GLRendererImpl::drawIndexedPrimitive33(
     const IndexGeometry *indices,
     const Geometry *vert)
   {
+  xAssert(indices);
+  const XGLIndexGeometryCache *idx = indices->data<XGLIndexGeometryCache>();
+  drawIndexedPrimitiveRange33<PRIMITIVE>(ren, indices, vert, 0, idx->_indexCount);
+  }
+
+template <xuint32 PRIMITIVE> void GLRendererImpl::drawIndexedPrimitiveRange33(
+    Renderer *ren,
+    const IndexGeometry *indices,
+    const Geometry *vert,
+    xsize first,
+    xsize count)
+  {
   GLRendererImpl* r = GL_REND(ren);
   xAssert(r->_currentShader);
   xAssert(r->_vertexLayout);
@@ -1234,7 +1399,8 @@ template <xuint32 PRIMITIVE> void GLRendererImpl::drawIndexedPrimitive33(
   XGLVertexLayout *l = r->_vertexLayout->data<XGLVertexLayout>();
   l->bindVAO(gC, idx);
 
-  glDrawElements(PRIMITIVE, idx->_indexCount, idx->_indexType, (GLvoid*)((char*)NULL)) GLE;
+  xAssert(first + count <= idx->_indexCount);
+  glDrawElements(PRIMITIVE, (GLsizei)count, idx->_indexType, (GLvoid*)((char*)NULL + first * idx->indexSize())) GLE;
 
   l->unbindVAO();
   }
@@ -1353,6 +1519,7 @@ detail::RendererFunctions gl21fns =
   },
   {
     GLRendererImpl::drawIndexedPrimitive21<GL_TRIANGLES>,
+    GLRendererImpl::drawIndexedPrimitiveRange21<GL_TRIANGLES>,
     GLRendererImpl::drawPrimitive21<GL_TRIANGLES>,
     GLRendererImpl::drawPatch33,
     GLRendererImpl::drawIndexedPrimitive21<GL_LINES>,
@@ -1366,6 +1533,13 @@ detail::RendererFunctions gl21fns =
     XGL21Framebuffer::endRender,
     XGL21Framebuffer::present,
     XGL21Framebuffer::getTexture
+  },
+  {
+    // GL 2.1 can't map buffers, but updates them with glBufferSubData.
+    nullptr,
+    nullptr,
+    XGLGeometryCache::update,
+    XGLIndexGeometryCache::update
   }
 };
 
@@ -1418,6 +1592,7 @@ detail::RendererFunctions gl33fns =
   },
   {
     GLRendererImpl::drawIndexedPrimitive33<GL_TRIANGLES>,
+    GLRendererImpl::drawIndexedPrimitiveRange33<GL_TRIANGLES>,
     GLRendererImpl::drawPrimitive33<GL_TRIANGLES>,
     GLRendererImpl::drawPatch33,
     GLRendererImpl::drawIndexedPrimitive33<GL_LINES>,
@@ -1431,6 +1606,12 @@ detail::RendererFunctions gl33fns =
     XGL33Framebuffer::endRender,
     XGL33Framebuffer::present,
     XGL33Framebuffer::getTexture
+  },
+  {
+    XGLGeometryCache::createWritten,
+    XGLIndexGeometryCache::createWritten,
+    XGLGeometryCache::update,
+    XGLIndexGeometryCache::update
   }
 };
 #endif
@@ -2286,6 +2467,71 @@ bool XGLBuffer::init( GLRendererImpl *, const void *data, xuint32 type, xuint32
   }
 
 
+#ifdef STANDARD_OPENGL
+bool XGLBuffer::initWritten(
+    GLRendererImpl *,
+    xuint32 type,
+    xuint32 renderType,
+    xsize size,
+    void (*write)(void *data, void *context),
+    void *context)
+  {
+  glGenBuffers(1, &_buffer);
+
+  glBindBuffer(type, _buffer) GLE;
+  glBufferData(type, size, nullptr, renderType) GLE;
+
+  bool written = false;
+  if(size)
+    {
+    void *mapped = glMapBufferRange(type, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT) GLE;
+    if(mapped)
+      {
+      write(mapped, context);
+      // The contents are lost if the mapping was invalidated while written.
+      written = glUnmapBuffer(type) == GL_TRUE GLE;
+      }
+
+    if(!written)
+      {
+      TemporaryAllocator alloc(Core::temporaryAllocator());
+      Vector<xuint8> data(&alloc);
+      data.resize(size);
+      write(data.data(), context);
+      glBufferSubData(type, 0, size, data.data()) GLE;
+      }
+    }
+
+  glBindBuffer(type, 0) GLE;
+
+  return true;
+  }
+#endif
+
+bool XGLBuffer::update(
+    xuint32 type,
+    xsize offset,
+    xsize size,
+    void (*write)(void *data, void *context),
+    void *context)
+  {
+  if(!size)
+    {
+    return true;
+    }
+
+  TemporaryAllocator alloc(Core::temporaryAllocator());
+  Vector<xuint8> data(&alloc);
+  data.resize(size);
+  write(data.data(), context);
+
+  glBindBuffer(type, _buffer) GLE;
+  glBufferSubData(type, offset, size, data.data()) GLE;
+  glBindBuffer(type, 0) GLE;
+
+  return true;
+  }
+
 XGLBuffer::~XGLBuffer( )
   {
   glDeleteBuffers(1, &_buffer) GLE;
@@ -2304,7 +2550,10 @@ bool XGLIndexGeometryCache::init(GLRendererImpl *r, const void *data, IndexGeome
 
   Type typeMap[] =
   {
-    { GL_UNSIGNED_SHORT, sizeof(xuint16) }
+    { GL_UNSIGNED_SHORT, sizeof(xuint16) },
+    // GLES 2 needs OES_element_index_uint for 32 bit indices.
+    { GL_UNSIGNED_INT, sizeof(xuint32) },
+    { GL_UNSIGNED_BYTE, sizeof(xuint8) }
   };
   xCompileTimeAssert(IndexGeometry::TypeCount == X_ARRAY_COUNT(typeMap));
 
@@ -2315,6 +2564,30 @@ bool XGLIndexGeometryCache::init(GLRendererImpl *r, const void *data, IndexGeome
   return XGLBuffer::init(r, data, GL_ELEMENT_ARRAY_BUFFER, GL_STATIC_DRAW, dataSize);
   }
 
+#ifdef STANDARD_OPENGL
+bool XGLIndexGeometryCache::initWritten(
+    GLRendererImpl *r,
+    IndexGeometry::Type type,
+    xsize elementCount,
+    void (*write)(void *data, void *context),
+    void *context)
+  {
+  const xuint32 glTypes[] =
+  {
+    GL_UNSIGNED_SHORT,
+    GL_UNSIGNED_INT,
+    GL_UNSIGNED_BYTE
+  };
+  xCompileTimeAssert(IndexGeometry::TypeCount == X_ARRAY_COUNT(glTypes));
+
+  _indexType = glTypes[type];
+  _indexCount = (GLuint)elementCount;
+
+  xsize dataSize = elementCount * IndexGeometry::typeSize(type);
+  return XGLBuffer::initWritten(r, GL_ELEMENT_ARRAY_BUFFER, GL_STATIC_DRAW, dataSize, write, context);
+  }
+#endif
+
 //----------------------------------------------------------------------------------------------------------------------
 // GEOMETRY CACHE
 //----------------------------------------------------------------------------------------------------------------------
@@ -2331,6 +2604,25 @@ bool XGLGeometryCache::init(GLRendererImpl *r, const void *data, xsize elementSi
   return XGLBuffer::init(r, data, GL_ARRAY_BUFFER, GL_STATIC_DRAW, dataSize);
   }
 
+#ifdef STANDARD_OPENGL
+bool XGLGeometryCache::initWritten(
+    GLRendererImpl *r,
+    xsize elementSize,
+    xsize elementCount,
+    void (*write)(void *data, void *context),
+    void *context)
+  {
+  _vao = 0;
+  _linkedLayout = nullptr;
+  _linkedIndices = nullptr;
+
+  xsize dataSize = elementSize * elementCount;
+  _elementCount = (GLuint)elementCount;
+  _elementSize = (GLuint)elementSize;
+  return XGLBuffer::initWritten(r, GL_ARRAY_BUFFER, GL_STATIC_DRAW, dataSize, write, context);
+  }
+#endif
+
 }
 
 #endif
@@ -0,0 +1,253 @@
+#include "XAsyncMeshLoader.h"
+#include "XGeometry.h"
+#include "Utilities/XParseException.h"
+#include <exception>
+
+namespace Eks
+{
+
+namespace
+{
+
+enum Stage
+  {
+  Parsing,
+  Generating,
+  Baking,
+  Complete
+  };
+
+// The progress reached at the start of each stage, parsing takes most of the time.
+const float StageProgress[] = { 0.0f, 0.8f, 0.85f, 1.0f };
+
+}
+
+AsyncMeshLoader::Result::Result(AllocatorBase *allocator)
+    : vertexSize(0),
+      vertexCount(0),
+      vertices(allocator),
+      indices(allocator),
+      submeshes(allocator)
+  {
+  }
+
+AsyncMeshLoader::AsyncMeshLoader(AllocatorBase *allocator)
+    : _allocator(allocator),
+      _itemCount(0),
+      _result(allocator),
+      _monitor(0),
+      _state(Idle),
+      _cancelled(false),
+      _totalBytes(0),
+      _parsedBytes(0),
+      _stage(Parsing)
+  {
+  }
+
+AsyncMeshLoader::~AsyncMeshLoader()
+  {
+  cancel();
+  wait();
+  }
+
+bool AsyncMeshLoader::start(
+    const char *path,
+    const ShaderVertexLayoutDescription::Semantic *items,
+    xsize itemCount,
+    Real normalCreaseAngle)
+  {
+  if(isLoading() || itemCount > ObjLoader::MaxElements)
+    {
+    return false;
+    }
+
+  wait();
+
+  for(xsize i = 0; i < itemCount; ++i)
+    {
+    _items[i] = items[i];
+    }
+  _itemCount = itemCount;
+
+  _result.vertexSize = 0;
+  _result.vertexCount = 0;
+  _result.vertices.clear();
+  _result.indices.clear();
+  _result.submeshes.clear();
+  _error = String();
+
+  _cancelled = false;
+  _totalBytes = 0;
+  _parsedBytes = 0;
+  _stage = Parsing;
+  _state = Loading;
+
+  // The path is copied with its terminator, the caller's may not outlive the thread.
+  String ownedPath(path, strlen(path) + 1, _allocator);
+
+  std::packaged_task<bool ()> task([this, ownedPath, normalCreaseAngle]()
+    {
+    bool succeeded = false;
+    bool threw = true;
+    try
+      {
+      succeeded = run(ownedPath.data(), normalCreaseAngle);
+      threw = false;
+      }
+    catch(const ParseException &e)
+      {
+      setError(e.error().message());
+      }
+    catch(const std::exception &e)
+      {
+      setError(e.what());
+      }
+    catch(...)
+      {
+      setError("Unknown error");
+      }
+
+    _stage = Complete;
+    _state = succeeded ? Succeeded : (_cancelled && !threw ? Cancelled : Failed);
+    return succeeded;
+    });
+
+  _future = task.get_future().share();
+  _thread = std::thread(std::move(task));
+  return true;
+  }
+
+void AsyncMeshLoader::cancel()
+  {
+  _cancelled = true;
+  }
+
+void AsyncMeshLoader::wait()
+  {
+  if(_thread.joinable())
+    {
+    _thread.join();
+    }
+  }
+
+float AsyncMeshLoader::progress() const
+  {
+  const int stage = _stage;
+  if(stage != Parsing)
+    {
+    return StageProgress[stage];
+    }
+
+  const xsize total = _totalBytes;
+  if(!total)
+    {
+    return 0.0f;
+    }
+
+  const float parsed = (float)std::min((xsize)_parsedBytes, total) / total;
+  return parsed * StageProgress[Generating];
+  }
+
+const AsyncMeshLoader::Result &AsyncMeshLoader::result() const
+  {
+  xAssert(state() == Succeeded);
+  return _result;
+  }
+
+bool AsyncMeshLoader::upload(Renderer *r, Geometry *geo, IndexGeometry *idx)
+  {
+  xAssert(geo);
+  if(state() != Succeeded || !_result.vertexCount)
+    {
+    return false;
+    }
+
+  bool created = Geometry::delayedCreate(*geo, r, _result.vertices.data(), _result.vertexSize, _result.vertexCount);
+  if(created && idx && _result.indices.size())
+    {
+    created = IndexGeometry::delayedCreateNarrowest(*idx, r, _result.indices.data(), _result.indices.size(), _result.vertexCount);
+    }
+
+  _result.vertices.clear();
+  _result.indices.clear();
+  _result.vertexCount = 0;
+  return created;
+  }
+
+void AsyncMeshLoader::begin(xsize totalBytes)
+  {
+  _totalBytes = totalBytes;
+  if(_monitor)
+    {
+    _monitor->begin(totalBytes);
+    }
+  }
+
+bool AsyncMeshLoader::advance(xsize bytes)
+  {
+  _parsedBytes += bytes;
+  if(_monitor && !_monitor->advance(bytes))
+    {
+    _cancelled = true;
+    }
+  return !_cancelled;
+  }
+
+void AsyncMeshLoader::setError(const char *error)
+  {
+  // Called while handling a failure, which must not escape the task and leave it Loading.
+  try
+    {
+    _error = String(error, strlen(error) + 1, _allocator);
+    }
+  catch(...)
+    {
+    }
+  }
+
+void AsyncMeshLoader::setError(const String &error)
+  {
+  try
+    {
+    _error = String(error.data(), error.size(), _allocator);
+    }
+  catch(...)
+    {
+    }
+  }
+
+bool AsyncMeshLoader::run(const char *path, Real normalCreaseAngle)
+  {
+  ObjLoader loader(_allocator);
+  loader.setMonitor(this);
+
+  Vector<VectorI3D> tris(_allocator);
+  ObjLoader::ElementData elements[ObjLoader::MaxElements];
+  if(!loader.loadFile(path, _items, _itemCount, &tris, &_result.vertexSize, elements, true, &_result.submeshes))
+    {
+    return false;
+    }
+
+  _stage = Generating;
+  if(_cancelled)
+    {
+    return false;
+    }
+  loader.computeUnusedElements(elements, _itemCount, &tris, normalCreaseAngle);
+
+  _stage = Baking;
+  if(_cancelled)
+    {
+    return false;
+    }
+
+  if(!loader.bakeIndexed(tris, elements, _itemCount, &_result.vertices, &_result.indices))
+    {
+    return false;
+    }
+
+  _result.vertexCount = _result.vertexSize ? _result.vertices.size() / _result.vertexSize : 0;
+  return !_cancelled;
+  }
+
+}
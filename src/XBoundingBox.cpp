@@ -211,9 +211,9 @@ bool BoundingBox::intersects(const Line &in, float &outT) const
 
 bool BoundingBox::contains( const Vector3D &in ) const
   {
-  return in.x() <= _minimum.x() && in.x() >= _maximum.x() &&
-         in.y() <= _minimum.y() && in.y() >= _maximum.y() &&
-         in.z() <= _minimum.z() && in.z() >= _maximum.z();
+  return in.x() >= _minimum.x() && in.x() <= _maximum.x() &&
+         in.y() >= _minimum.y() && in.y() <= _maximum.y() &&
+         in.z() >= _minimum.z() && in.z() <= _maximum.z();
   }
 
 bool BoundingBox::contains( const BoundingBox &smaller ) const
@@ -1,410 +1,927 @@
 #include "XColladaFile.h"
-#include "XGeometry.h"
-#include "QFile"
-#include "QDebug"
+#include "Containers/XStringBuilder.h"
+#include "Utilities/XParseException.h"
+#include "XParallel.h"
+#include "XNumberScanner.h"
+#include "XMappedFile.h"
+#include <algorithm>
+#include <cstring>
 
-#if 0
+namespace Eks
+{
 
-XList<int> getListInt( QString data )
-    {
-    QTextStream stream( &data, QIODevice::ReadOnly );
-    XList<int> ret;
+namespace
+{
 
-    int oldPos( -1 );
-    while( !stream.atEnd() && oldPos != stream.pos() )
-        {
-        oldPos = stream.pos();
+const xsize Unused = Eks::maxFor(Unused);
 
-        int x;
-        stream >> x;
-        ret << x;
-        }
-    return ret;
-    }
+// A run of the document, referenced in place.
+struct Range
+  {
+  Range() : begin(0), end(0) { }
+  Range(const char *b, const char *e) : begin(b), end(e) { }
+
+  bool isEmpty() const { return begin == end; }
+  xsize length() const { return end - begin; }
 
-XList<Real> getList1D( QString data, int count )
+  bool equals(const char *str, xsize strLength) const
     {
-    QTextStream stream( &data, QIODevice::ReadOnly );
-    XList<Real> ret;
+    return length() == strLength && memcmp(begin, str, strLength) == 0;
+    }
+  bool equals(const char *str) const { return equals(str, strlen(str)); }
+  bool equals(const Range &other) const { return equals(other.begin, other.length()); }
+
+  const char *begin;
+  const char *end;
+  };
+
+inline bool isSpace(char c)
+  {
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+  }
+
+struct Tag
+  {
+  Range name;
+  Range attributes;
+  bool closing;
+  bool selfClosing;
+  // The text between the tag and the next one.
+  Range content;
+  };
+
+// Walks the tags of an XML document in order, without building a tree. Comments,
+// processing instructions, doctypes and CDATA sections are skipped.
+class XmlScanner
+  {
+public:
+  XmlScanner(const char *begin, const char *end) : _pos(begin), _end(end)
+    {
+    }
 
-    for( int i=0; i<count; i++ )
+  bool next(Tag *tag)
+    {
+    while(_pos < _end)
+      {
+      const char *open = (const char *)memchr(_pos, '<', _end - _pos);
+      if(!open)
         {
-        float x;
-        stream >> x;
-        ret << x;
+        _pos = _end;
+        return false;
         }
-    return ret;
-    }
 
-XList<Eks::Vector2D> getList2D( QString data, int count )
-    {
-    QTextStream stream( &data, QIODevice::ReadOnly );
-    XList<Eks::Vector2D> ret;
+      const char *p = open + 1;
+      if(p < _end && *p == '!')
+        {
+        if(_end - p >= 3 && p[1] == '-' && p[2] == '-')
+          {
+          _pos = skipPast(p, "-->");
+          }
+        else if(_end - p >= 8 && memcmp(p, "![CDATA[", 8) == 0)
+          {
+          _pos = skipPast(p, "]]>");
+          }
+        else
+          {
+          _pos = skipPast(p, ">");
+          }
+        continue;
+        }
+      if(p < _end && *p == '?')
+        {
+        _pos = skipPast(p, "?>");
+        continue;
+        }
 
-    for( int i=0; i<count; i++ )
+      tag->closing = p < _end && *p == '/';
+      if(tag->closing)
         {
-        float x, y;
-        stream >> x >> y;
-        ret << Eks::Vector2D( x, y );
+        ++p;
         }
-    return ret;
-    }
 
-XList<Eks::Vector3D> getList3D( QString data, int count )
-    {
-    QTextStream stream( &data, QIODevice::ReadOnly );
-    XList<Eks::Vector3D> ret;
+      const char *nameEnd = p;
+      while(nameEnd < _end && !isSpace(*nameEnd) && *nameEnd != '>' && *nameEnd != '/')
+        {
+        ++nameEnd;
+        }
+      tag->name = Range(p, nameEnd);
 
-    for( int i=0; i<count; i++ )
+      // Attribute values may hold '>', so quotes are tracked to find the end of the tag.
+      const char *close = nameEnd;
+      char quote = 0;
+      while(close < _end && (quote || *close != '>'))
         {
-        float x, y, z;
-        stream >> x >> y >> z;
-        ret << Eks::Vector3D( x, y, z );
+        if(quote)
+          {
+          quote = *close == quote ? 0 : quote;
+          }
+        else if(*close == '"' || *close == '\'')
+          {
+          quote = *close;
+          }
+        ++close;
+        }
+      if(close == _end)
+        {
+        throw Eks::ParseException(X_PARSE_ERROR(Eks::StringBuilder() << "Unterminated COLLADA tag '" << Eks::String(p, nameEnd - p) << "'"));
         }
-    return ret;
-    }
 
-XList<Eks::Vector4D> getList4D( QString data, int count )
-    {
-    QTextStream stream( &data, QIODevice::ReadOnly );
-    XList<Eks::Vector4D> ret;
+      tag->selfClosing = close > nameEnd && close[-1] == '/';
+      tag->attributes = Range(nameEnd, tag->selfClosing ? close - 1 : close);
 
-    for( int i=0; i<count; i++ )
+      const char *contentBegin = close + 1;
+      const char *contentEnd = (const char *)memchr(contentBegin, '<', _end - contentBegin);
+      tag->content = Range(contentBegin, contentEnd ? contentEnd : _end);
+      if(tag->selfClosing || tag->closing)
         {
-        float x, y, z, w;
-        stream >> x >> y >> z >> w;
-        ret << Eks::Vector4D( x, y, z, w );
+        tag->content = Range(contentBegin, contentBegin);
         }
-    return ret;
+
+      _pos = contentBegin;
+      return true;
+      }
+
+    return false;
     }
 
-XColladaFile::XColladaFile( QString name ) : _document( "COLLADA" )
+private:
+  const char *skipPast(const char *pos, const char *terminator)
     {
-    QFile f( name );
-    if( !f.open( QFile::ReadOnly ) )
+    const xsize length = strlen(terminator);
+    while(_end - pos >= (ptrdiff_t)length)
+      {
+      const char *first = (const char *)memchr(pos, terminator[0], _end - pos - length + 1);
+      if(!first)
         {
-        return;
+        break;
         }
-    _document.setContent( f.readAll() );
-
-    QDomElement docElement( _document.documentElement() );
-
-    int num = 0;
-    if( !docElement.isNull() && docElement.tagName() == "COLLADA" )
+      if(memcmp(first, terminator, length) == 0)
         {
-        QDomElement colladaElement = docElement.firstChildElement("library_geometries");
-        if( !colladaElement.isNull() )
-            {
-            QDomElement geometryElement = colladaElement.firstChildElement("geometry");
-            while( !geometryElement.isNull() )
-                {
-                QString str( geometryElement.attribute("name") );
-                if( str == "" )
-                    {
-                    str = QString::number( num );
-                    }
-
-                QDomElement meshElement( geometryElement.firstChildElement() );
-                if( !meshElement.isNull() && meshElement.tagName() == "mesh" )
-                    {
-                    _geometries.insert( str, meshElement );
-                    }
-
-                num++;
-                geometryElement = geometryElement.nextSiblingElement("geometry");
-                }
-            }
+        return first + length;
         }
+      pos = first + 1;
+      }
+    return _end;
     }
 
-bool XColladaFile::geometryExists( QString in )
+  const char *_pos;
+  const char *_end;
+  };
+
+Range attribute(const Tag &tag, const char *name)
+  {
+  const char *pos = tag.attributes.begin;
+  const char *end = tag.attributes.end;
+  while(pos < end)
     {
-    return _geometries.contains( in );
+    while(pos < end && isSpace(*pos))
+      {
+      ++pos;
+      }
+
+    const char *nameBegin = pos;
+    while(pos < end && *pos != '=' && !isSpace(*pos))
+      {
+      ++pos;
+      }
+    const Range attributeName(nameBegin, pos);
+
+    while(pos < end && (isSpace(*pos) || *pos == '='))
+      {
+      ++pos;
+      }
+    if(pos == end || (*pos != '"' && *pos != '\''))
+      {
+      break;
+      }
+
+    const char quote = *pos++;
+    const char *valueBegin = pos;
+    while(pos < end && *pos != quote)
+      {
+      ++pos;
+      }
+    const Range value(valueBegin, pos);
+    ++pos;
+
+    if(attributeName.equals(name))
+      {
+      return value;
+      }
     }
 
-QStringList XColladaFile::geometryNames() const
+  return Range();
+  }
+
+xsize integerAttribute(const Tag &tag, const char *name, xsize defaultValue)
+  {
+  const Range value = attribute(tag, name);
+  xsize result = 0;
+  if(value.isEmpty() || !NumberScanner::parseInteger(value.begin, value.end, &result))
     {
-    return _geometries.keys();
+    return defaultValue;
     }
-
-Geometry XColladaFile::geometry( QString name ) const
+  return result;
+  }
+
+// A reference to a source, with the leading '#' removed.
+Range urlAttribute(const Tag &tag, const char *name)
+  {
+  Range value = attribute(tag, name);
+  if(!value.isEmpty() && *value.begin == '#')
+    {
+    ++value.begin;
+    }
+  return value;
+  }
+
+enum InputSemantic
+  {
+  InputVertex,
+  InputPosition,
+  InputNormal,
+  InputTexCoord,
+  InputOther
+  };
+
+struct Input
+  {
+  InputSemantic semantic;
+  Range source;
+  xsize offset;
+  xsize set;
+  };
+
+struct Source
+  {
+  Range id;
+  Range values;
+  xsize stride;
+  xsize count;
+  };
+
+enum PrimitiveType
+  {
+  Triangles,
+  Polylist,
+  Polygons
+  };
+
+struct Primitive
+  {
+  PrimitiveType type;
+  Range material;
+  Input inputs[ColladaFile::MaxInputs];
+  xsize inputCount;
+  Range vcount;
+  // Polygons have a p per polygon, the others a single p.
+  xsize firstP;
+  xsize pCount;
+  };
+
+struct DocumentGeometry
+  {
+  Range name;
+  xsize firstSource;
+  xsize sourceCount;
+  Input vertexInputs[ColladaFile::MaxInputs];
+  xsize vertexInputCount;
+  xsize firstPrimitive;
+  xsize primitiveCount;
+  };
+
+struct Document
+  {
+  Document(AllocatorBase *allocator)
+      : geometries(allocator),
+        sources(allocator),
+        primitives(allocator),
+        ps(allocator)
     {
-    Geometry ret;
+    }
 
-    XHash <QString, XList<Real> > attr1D;
-    XHash <QString, XList<Eks::Vector2D> > attr2D;
-    XHash <QString, XList<Eks::Vector3D> > attr3D;
-    XHash <QString, XList<Eks::Vector4D> > attr4D;
+  Vector<DocumentGeometry> geometries;
+  Vector<Source> sources;
+  Vector<Primitive> primitives;
+  Vector<Range> ps;
+  };
 
-    if( !_geometries.contains( name ) )
-        {
-        return ret;
-        }
+Input readInput(const Tag &tag)
+  {
+  const Range semantic = attribute(tag, "semantic");
 
-    QDomElement mesh( _geometries[name] );
+  Input input;
+  input.semantic = InputOther;
+  if(semantic.equals("VERTEX"))
+    {
+    input.semantic = InputVertex;
+    }
+  else if(semantic.equals("POSITION"))
+    {
+    input.semantic = InputPosition;
+    }
+  else if(semantic.equals("NORMAL"))
+    {
+    input.semantic = InputNormal;
+    }
+  else if(semantic.equals("TEXCOORD"))
+    {
+    input.semantic = InputTexCoord;
+    }
 
-    QDomElement sourceElement( mesh.firstChildElement("source") );
-    while( !sourceElement.isNull() )
+  input.source = urlAttribute(tag, "source");
+  input.offset = integerAttribute(tag, "offset", 0);
+  input.set = integerAttribute(tag, "set", 0);
+  return input;
+  }
+
+// Record the geometry libraries of the document at [data] in one pass. Everything outside
+// a geometry's mesh is skipped.
+void scanDocument(const char *data, xsize dataSize, Document *doc)
+  {
+  XmlScanner scanner(data, data + dataSize);
+
+  bool inMesh = false;
+  bool inVertices = false;
+  bool inHole = false;
+  xsize source = Unused;
+  xsize primitive = Unused;
+
+  Tag tag;
+  while(scanner.next(&tag))
+    {
+    const Range &name = tag.name;
+    if(tag.closing)
+      {
+      if(name.equals("mesh") || name.equals("geometry"))
+        {
+        inMesh = false;
+        }
+      else if(name.equals("source"))
+        {
+        source = Unused;
+        }
+      else if(name.equals("vertices"))
+        {
+        inVertices = false;
+        }
+      else if(name.equals("ph"))
+        {
+        inHole = false;
+        }
+      else if(name.equals("triangles") || name.equals("polylist") || name.equals("polygons"))
+        {
+        primitive = Unused;
+        }
+      continue;
+      }
+
+    if(name.equals("geometry"))
+      {
+      DocumentGeometry geometry;
+      geometry.name = attribute(tag, "name");
+      if(geometry.name.isEmpty())
+        {
+        geometry.name = attribute(tag, "id");
+        }
+      geometry.firstSource = doc->sources.size();
+      geometry.sourceCount = 0;
+      geometry.vertexInputCount = 0;
+      geometry.firstPrimitive = doc->primitives.size();
+      geometry.primitiveCount = 0;
+      doc->geometries << geometry;
+      }
+    else if(name.equals("mesh"))
+      {
+      inMesh = !tag.selfClosing && doc->geometries.size();
+      }
+    else if(!inMesh)
+      {
+      continue;
+      }
+    else if(name.equals("source"))
+      {
+      Source s;
+      s.id = attribute(tag, "id");
+      s.stride = 1;
+      s.count = Unused;
+      doc->sources << s;
+      ++doc->geometries.back().sourceCount;
+      source = tag.selfClosing ? Unused : doc->sources.size() - 1;
+      }
+    else if(name.equals("float_array"))
+      {
+      if(source != Unused)
+        {
+        doc->sources[source].values = tag.content;
+        }
+      }
+    else if(name.equals("accessor"))
+      {
+      if(source != Unused)
+        {
+        doc->sources[source].stride = std::max(integerAttribute(tag, "stride", 1), (xsize)1);
+        doc->sources[source].count = integerAttribute(tag, "count", Unused);
+        }
+      }
+    else if(name.equals("vertices"))
+      {
+      inVertices = !tag.selfClosing;
+      }
+    else if(name.equals("triangles") || name.equals("polylist") || name.equals("polygons"))
+      {
+      Primitive p;
+      p.type = name.equals("triangles") ? Triangles : name.equals("polylist") ? Polylist : Polygons;
+      p.material = attribute(tag, "material");
+      p.inputCount = 0;
+      p.firstP = doc->ps.size();
+      p.pCount = 0;
+      doc->primitives << p;
+      ++doc->geometries.back().primitiveCount;
+      primitive = tag.selfClosing ? Unused : doc->primitives.size() - 1;
+      }
+    else if(name.equals("input"))
+      {
+      if(inVertices)
         {
-        QString name( sourceElement.attribute("id") );
+        DocumentGeometry &geometry = doc->geometries.back();
+        if(geometry.vertexInputCount < ColladaFile::MaxInputs)
+          {
+          geometry.vertexInputs[geometry.vertexInputCount++] = readInput(tag);
+          }
+        }
+      else if(primitive != Unused)
+        {
+        Primitive &p = doc->primitives[primitive];
+        if(p.inputCount == ColladaFile::MaxInputs)
+          {
+          throw Eks::ParseException(X_PARSE_ERROR(Eks::StringBuilder() << "COLLADA primitive has more than " << (xsize)ColladaFile::MaxInputs << " inputs"));
+          }
+        p.inputs[p.inputCount++] = readInput(tag);
+        }
+      }
+    else if(name.equals("ph"))
+      {
+      // Polygons with holes aren't imported.
+      inHole = !tag.selfClosing;
+      }
+    else if(name.equals("vcount"))
+      {
+      if(primitive != Unused)
+        {
+        doc->primitives[primitive].vcount = tag.content;
+        }
+      }
+    else if(name.equals("p"))
+      {
+      if(primitive != Unused && !inHole)
+        {
+        doc->ps << tag.content;
+        ++doc->primitives[primitive].pCount;
+        }
+      }
+    }
+  }
 
-        QDomElement arrayElement( sourceElement.firstChildElement("float_array") );
+inline bool scanNumber(const char *&pos, const char *end, float *out)
+  {
+  return NumberScanner::scanReal(pos, end, out);
+  }
 
-        int count( arrayElement.attribute("count").toInt() );
+inline bool scanNumber(const char *&pos, const char *end, xuint32 *out)
+  {
+  return NumberScanner::scanInteger(pos, end, out);
+  }
 
-        int size = 0;
+inline const char *skipToSpace(const char *pos, const char *end)
+  {
+  while(pos < end && !isSpace(*pos))
+    {
+    ++pos;
+    }
+  return pos;
+  }
 
-        // Analyse Array Contents
-            {
-            QDomElement techniqueElement( sourceElement.firstChildElement("technique_common") );
-            if( !techniqueElement.isNull() )
-                {
-                QDomElement accessorElement( techniqueElement.firstChildElement("accessor") );
-                if( !accessorElement.isNull() )
-                    {
-
-                    QDomElement paramElement( accessorElement.firstChildElement("param") );
-                    while( !paramElement.isNull() )
-                        {
-                        paramElement = paramElement.nextSiblingElement("param");
-                        size++;
-                        }
-                    }
-                }
-            }
+// Parse the whitespace separated numbers in [pos, end) to [out], which has room for all of them.
+template <typename T> T *parseNumberRange(const char *pos, const char *end, T *out)
+  {
+  while(pos < end)
+    {
+    while(pos < end && isSpace(*pos))
+      {
+      ++pos;
+      }
+    if(pos == end)
+      {
+      break;
+      }
+
+    const char *token = pos;
+    if(!scanNumber(pos, end, out) || (pos < end && !isSpace(*pos)))
+      {
+      throw Eks::ParseException(X_PARSE_ERROR(Eks::StringBuilder() << "Error reading COLLADA number '" << Eks::String(token, skipToSpace(token, end) - token) << "'"));
+      }
+    ++out;
+    }
+  return out;
+  }
+
+xsize countTokens(const char *pos, const char *end)
+  {
+  xsize count = 0;
+  bool inToken = false;
+  for(; pos < end; ++pos)
+    {
+    const bool space = isSpace(*pos);
+    count += (!space && !inToken) ? 1 : 0;
+    inToken = !space;
+    }
+  return count;
+  }
+
+// Parse every number in [text] to [out]. Large arrays are split at whitespace and each
+// piece counted, then parsed straight to its offset in [out], on worker threads.
+template <typename T> void parseNumbers(const Range &text, Vector<T> *out, AllocatorBase *allocator)
+  {
+  const xsize size = text.length();
+  const xsize MinimumRange = ColladaFile::MinimumParallelArraySize;
+  if(ParallelUtilities::rangeCount(size, MinimumRange) <= 1)
+    {
+    out->resize(countTokens(text.begin, text.end), T());
+    parseNumberRange(text.begin, text.end, out->data());
+    return;
+    }
 
-        xAssert( ( count % size ) == 0 );
+  // Both passes split the same way, with each split moved forward to the next whitespace.
+  auto split = [&](xsize offset)
+    {
+    return skipToSpace(text.begin + offset, text.end);
+    };
 
-        if( size == 1 )
-            {
-            XList<Real> floats( getList1D( arrayElement.text(), count/size ) );
-            attr1D.insert( name, floats );
-            }
-        else if( size == 2 )
-            {
-            XList<Eks::Vector2D> floats( getList2D( arrayElement.text(), count/size ) );
-            attr2D.insert( name, floats );
-            }
-        else if( size == 3 )
-            {
-            XList<Eks::Vector3D> floats( getList3D( arrayElement.text(), count/size ) );
-            attr3D.insert( name, floats );
-            }
-        else if( size == 4 )
-            {
-            XList<Eks::Vector4D> floats( getList4D( arrayElement.text(), count/size ) );
-            attr4D.insert( name, floats );
-            }
+  Vector<xsize> counts(allocator);
+  counts.resize(ParallelUtilities::rangeCount(size, MinimumRange) + 1, 0);
+  ParallelUtilities::forRanges(size, MinimumRange, [&](xsize r, xsize begin, xsize end)
+    {
+    counts[r + 1] = countTokens(split(begin), split(end));
+    });
 
-        sourceElement = sourceElement.nextSiblingElement("source");
-        }
+  for(xsize r = 1; r < counts.size(); ++r)
+    {
+    counts[r] += counts[r - 1];
+    }
 
-    unsigned int inputNum = 0;
-    unsigned int maxOffset = 0;
+  out->resize(counts.back(), T());
+  ParallelUtilities::forRanges(size, MinimumRange, [&](xsize r, xsize begin, xsize end)
+    {
+    parseNumberRange(split(begin), split(end), out->data() + counts[r]);
+    });
+  }
 
-    int posOff = -1;
-    XList<Eks::Vector3D> *posPtr = 0;
-    int norOff = -1;
-    XList<Eks::Vector3D> *norPtr = 0;
-    int texOff = -1;
-    XList<Eks::Vector2D> *texPtr = 0;
+InputSemantic inputSemantic(ShaderVertexLayoutDescription::Semantic semantic)
+  {
+  switch(semantic)
+    {
+  case ShaderVertexLayoutDescription::Position:
+    return InputPosition;
+  case ShaderVertexLayoutDescription::Normal:
+    return InputNormal;
+  case ShaderVertexLayoutDescription::TextureCoordinate:
+    return InputTexCoord;
+  default:
+    return InputOther;
+    }
+  }
+
+// Find the input for [semantic] in [primitive], preferring the lowest set, or through its
+// VERTEX input from the geometry's vertices.
+bool findInput(const DocumentGeometry &geometry, const Primitive &primitive, InputSemantic semantic, Input *result)
+  {
+  const Input *found = 0;
+  const Input *vertex = 0;
+  for(xsize i = 0; i < primitive.inputCount; ++i)
+    {
+    const Input &input = primitive.inputs[i];
+    if(input.semantic == semantic && (!found || input.set < found->set))
+      {
+      found = &input;
+      }
+    else if(input.semantic == InputVertex)
+      {
+      vertex = &input;
+      }
+    }
 
-    QDomElement inputParent;
+  if(found)
+    {
+    *result = *found;
+    return true;
+    }
 
-    // could search for different polygon sections here
-    if( !mesh.firstChildElement("polylist").isNull() )
-        {
-        inputParent = mesh.firstChildElement("polylist");
-        }
-    else if( !mesh.firstChildElement("triangles").isNull() )
+  if(vertex)
+    {
+    for(xsize i = 0; i < geometry.vertexInputCount; ++i)
+      {
+      const Input &input = geometry.vertexInputs[i];
+      if(input.semantic == semantic && (!found || input.set < found->set))
         {
-        inputParent = mesh.firstChildElement("triangles");
+        found = &input;
         }
-    else
+      }
+
+    if(found)
+      {
+      *result = *found;
+      result->offset = vertex->offset;
+      return true;
+      }
+    }
+
+  return false;
+  }
+
+const Source &findSource(const Document &doc, const DocumentGeometry &geometry, const Range &id)
+  {
+  for(xsize i = geometry.firstSource, end = geometry.firstSource + geometry.sourceCount; i < end; ++i)
+    {
+    if(doc.sources[i].id.equals(id))
+      {
+      return doc.sources[i];
+      }
+    }
+
+  throw Eks::ParseException(X_PARSE_ERROR(Eks::StringBuilder() << "COLLADA source '" << Eks::String(id.begin, id.length()) << "' not found"));
+  }
+
+// A source appended to an element's data, once per geometry.
+struct LoadedSource
+  {
+  const Source *source;
+  xsize item;
+  xsize base;
+  xsize count;
+  };
+
+}
+
+ColladaFile::ColladaFile(AllocatorBase *allocator)
+    : _allocator(allocator),
+      _loader(allocator)
+  {
+  }
+
+bool ColladaFile::load(
+    const char *data,
+    xsize dataSize,
+    const ShaderVertexLayoutDescription::Semantic *items,
+    xsize itemCount,
+    Vector<VectorI3D> *triangles,
+    xsize *vertexSize,
+    ObjLoader::ElementData *elements,
+    Vector<ObjLoader::Submesh> *submeshes)
+  {
+  xAssert(triangles);
+  xAssert(vertexSize);
+  xAssert(elements);
+
+  if(itemCount > ObjLoader::MaxElements || !_loader.initialiseElements(items, itemCount, vertexSize, elements))
+    {
+    xAssertFail();
+    return false;
+    }
+
+  // Triangle components for the elements COLLADA inputs can provide.
+  InputSemantic semantics[ObjLoader::MaxComponent];
+  xsize indexedCount = 0;
+  xsize positionItem = Unused;
+  for(xsize i = 0; i < itemCount && i < ObjLoader::MaxComponent; ++i)
+    {
+    semantics[i] = inputSemantic(items[i]);
+    if(semantics[i] == InputOther)
+      {
+      break;
+      }
+    if(semantics[i] == InputPosition)
+      {
+      positionItem = i;
+      }
+    ++indexedCount;
+    }
+
+  Document doc(_allocator);
+  scanDocument(data, dataSize, &doc);
+
+  // Elements some primitive provides get a zero entry for the primitives without them,
+  // elements none provide are left empty to be generated.
+  bool provided[ObjLoader::MaxComponent] = { false, false, false };
+  for(xsize g = 0; g < doc.geometries.size(); ++g)
+    {
+    const DocumentGeometry &geometry = doc.geometries[g];
+    for(xsize p = geometry.firstPrimitive; p < geometry.firstPrimitive + geometry.primitiveCount; ++p)
+      {
+      for(xsize i = 0; i < indexedCount; ++i)
         {
-        inputParent = mesh.firstChildElement("polygons");
+        Input input;
+        provided[i] = provided[i] || findInput(geometry, doc.primitives[p], semantics[i], &input);
         }
+      }
+    }
 
-    QDomElement inputElement = inputParent.firstChildElement("input");
-    while( !inputElement.isNull() )
-        {
-        QString semantic = inputElement.attribute("semantic");
-        unsigned int offset = inputElement.attribute("offset").toUInt();
-        QString location;
+  xsize zeroIndex[ObjLoader::MaxComponent] = { Unused, Unused, Unused };
 
-        if( offset > maxOffset )
-            {
-            maxOffset = offset;
-            }
+  Vector<LoadedSource> loaded(_allocator);
+  Vector<float> values(_allocator);
+  Vector<xuint32> indices(_allocator);
+  Vector<xuint32> vcount(_allocator);
+
+  for(xsize g = 0; g < doc.geometries.size(); ++g)
+    {
+    const DocumentGeometry &geometry = doc.geometries[g];
+    loaded.clear();
+
+    for(xsize p = geometry.firstPrimitive; p < geometry.firstPrimitive + geometry.primitiveCount; ++p)
+      {
+      const Primitive &primitive = doc.primitives[p];
 
-        if( semantic == "VERTEX" )
+      // Where each element is read from in the primitive's index tuples.
+      xsize itemSources[ObjLoader::MaxComponent] = { Unused, Unused, Unused };
+      xsize itemOffsets[ObjLoader::MaxComponent] = { 0, 0, 0 };
+      for(xsize i = 0; i < indexedCount; ++i)
+        {
+        Input input;
+        if(!findInput(geometry, primitive, semantics[i], &input))
+          {
+          if(i == positionItem)
             {
-            QDomElement vertivesElement( mesh.firstChildElement("vertices").firstChildElement("input") );
-            xAssert( vertivesElement.attribute("semantic") == "POSITION" );
-            semantic = "POSITION";
-            location = vertivesElement.attribute("source");
+            throw Eks::ParseException(X_PARSE_ERROR(Eks::StringBuilder() << "COLLADA geometry '" << Eks::String(geometry.name.begin, geometry.name.length()) << "' has a primitive without positions"));
             }
-        else
+          if(provided[i] && zeroIndex[i] == Unused)
             {
-            location = inputElement.attribute("source");
+            zeroIndex[i] = elements[i].data.size();
+            elements[i].data << ObjLoader::ElementVector::Zero();
             }
+          continue;
+          }
 
-        location = location.mid(1);
-
-        if( semantic == "POSITION" )
+        const Source &source = findSource(doc, geometry, input.source);
+        for(xsize l = 0; l < loaded.size(); ++l)
+          {
+          if(loaded[l].source == &source && loaded[l].item == i)
             {
-            Q_FOREACH( QString name, attr3D.keys() )
-                {
-                if( name == location )
-                    {
-                    posPtr = &(attr3D[name]);
-                    posOff = offset;
-                    }
-                }
+            itemSources[i] = l;
             }
-        if( semantic == "NORMAL" )
+          }
+
+        if(itemSources[i] == Unused)
+          {
+          parseNumbers(source.values, &values, _allocator);
+
+          LoadedSource s;
+          s.source = &source;
+          s.item = i;
+          s.base = elements[i].data.size();
+          s.count = values.size() / source.stride;
+          if(source.count != Unused)
             {
-            Q_FOREACH( QString name, attr3D.keys() )
-                {
-                if( name == location )
-                    {
-                    norPtr = &(attr3D[name]);
-                    norOff = offset;
-                    }
-                }
+            s.count = std::min(s.count, source.count);
             }
-        if( semantic == "TEXCOORD" )
+
+          const xsize components = std::min(source.stride, (xsize)ObjLoader::MaxComponent);
+          for(xsize v = 0; v < s.count; ++v)
             {
-            Q_FOREACH( QString name, attr2D.keys() )
-                {
-                if( name == location )
-                    {
-                    texPtr = &(attr2D[name]);
-                    texOff = offset;
-                    }
-                }
+            ObjLoader::ElementVector element = ObjLoader::ElementVector::Zero();
+            for(xsize c = 0; c < components; ++c)
+              {
+              element(c) = values[v * source.stride + c];
+              }
+            if(semantics[i] == InputTexCoord)
+              {
+              element.y() = 1.0f - element.y();
+              }
+            elements[i].data << element;
             }
 
-        ++inputNum;
-        inputElement = inputElement.nextSiblingElement("input");
+          itemSources[i] = loaded.size();
+          loaded << s;
+          }
+        itemOffsets[i] = input.offset;
         }
 
-    xAssert( posOff != -1 );
-
-    XList <Eks::Vector3D> positions;
-    XList <Eks::Vector3D> normals;
-    XList <Eks::Vector2D> textures;
-
-    XList <unsigned int> indices;
-
-    int vertexSize = maxOffset + 1;
-
-    if( !mesh.firstChildElement("triangles").isNull() )
+      xsize tupleSize = 1;
+      for(xsize i = 0; i < primitive.inputCount; ++i)
         {
-        QDomElement triangles = mesh.firstChildElement("triangles");
-        unsigned int triangleSize = 3 * vertexSize;
-
-        XList <int> triIndexes = getListInt( triangles.firstChildElement("p").text() );
-        xAssert( ( triIndexes.size()%triangleSize ) == 0 );
+        tupleSize = std::max(tupleSize, primitive.inputs[i].offset + 1);
+        }
 
-        unsigned int triNum = 0;
-        for( int x=0; x<triIndexes.size(); x+=triangleSize )
+      const xsize firstIndex = triangles->size();
+      auto emitCorner = [&](const xuint32 *tuple)
+        {
+        VectorI3D corner = VectorI3D::Zero();
+        for(xsize i = 0; i < indexedCount; ++i)
+          {
+          if(itemSources[i] == Unused)
             {
-            for( unsigned int y=0; y<3; y++ )
-                {
-                indices << positions.size();
-                positions << (*posPtr)[triIndexes[x+(y*vertexSize)+posOff]];
-                if( norPtr )
-                    {
-                    normals << (*norPtr)[triIndexes[x+(y*vertexSize)+norOff]];
-                    }
-                if( texPtr )
-                    {
-                    textures << (*texPtr)[triIndexes[x+(y*vertexSize)+texOff]];
-                    }
-                }
-            triNum++;
+            corner(i) = zeroIndex[i] != Unused ? (int)zeroIndex[i] : 0;
+            continue;
             }
-        }
-    else if( !mesh.firstChildElement("polylist").isNull() )
-        {
-        QDomElement polygons = mesh.firstChildElement("polylist");
 
-        QDomElement pE = polygons.firstChildElement("p");
-        QDomElement vcount = polygons.firstChildElement("vcount");
-        if( !pE.isNull() && !vcount.isNull() )
+          const xuint32 index = tuple[itemOffsets[i]];
+          const LoadedSource &source = loaded[itemSources[i]];
+          if(index >= source.count)
             {
-            XList <int> polySizes = getListInt( vcount.text() );
-            XList <int> polyIndices = getListInt( pE.text() );
-
-            int startPoly=0;
-
-            for( int x=0; x<polySizes.size(); x++ )
-                {
-                int firstVertex = positions.size();
-
-                for( int y=0; y<polySizes[x]; y++ )
-                    {
-                    positions << (*posPtr)[polyIndices[startPoly]];
-                    if( norPtr )
-                        {
-                        normals << (*norPtr)[polyIndices[startPoly+1]];
-                        }
-                    if( texPtr )
-                        {
-                        textures << (*texPtr)[polyIndices[startPoly+2]];
-                        }
-                    startPoly += vertexSize;
-                    }
-
-                for( int y=0; y<polySizes[x]-2; y++ )
-                    {
-                    indices << firstVertex << firstVertex+y+1 << firstVertex+y+2;
-                    }
-                }
+            throw Eks::ParseException(X_PARSE_ERROR(Eks::StringBuilder() << "COLLADA index out of range [" << index << "/" << source.count << "]"));
             }
+          corner(i) = (int)(source.base + index);
+          }
+        *triangles << corner;
+        };
 
-            pE = pE.nextSiblingElement("p");
-        }
-    else
+      // Polygons are split into fans.
+      auto emitPolygon = [&](const xuint32 *tuples, xsize cornerCount)
         {
-        QDomElement polygons = mesh.firstChildElement("polygons");
+        for(xsize c = 2; c < cornerCount; ++c)
+          {
+          emitCorner(tuples);
+          emitCorner(tuples + (c - 1) * tupleSize);
+          emitCorner(tuples + c * tupleSize);
+          }
+        };
+
+      if(primitive.type == Polylist)
+        {
+        parseNumbers(primitive.vcount, &vcount, _allocator);
+        }
 
-        QDomElement pE = polygons.firstChildElement("p");
-        while( !pE.isNull() )
+      for(xsize i = primitive.firstP; i < primitive.firstP + primitive.pCount; ++i)
+        {
+        parseNumbers(doc.ps[i], &indices, _allocator);
+        if((indices.size() % tupleSize) != 0)
+          {
+          throw Eks::ParseException(X_PARSE_ERROR(Eks::StringBuilder() << "COLLADA p holds " << indices.size() << " indices, not a multiple of " << tupleSize));
+          }
+        const xsize tupleCount = indices.size() / tupleSize;
+
+        if(primitive.type == Triangles)
+          {
+          for(xsize t = 0; t + 3 <= tupleCount; t += 3)
             {
-            XList <int> polyIndices = getListInt( pE.text() );
-
-            int firstVertex = positions.size();
-            for( int x=0; x<polyIndices.size(); x+=vertexSize )
-                {
-                positions << (*posPtr)[polyIndices[x]];
-                if( norPtr )
-                    {
-                    normals << (*norPtr)[polyIndices[x+1]];
-                    }
-                if( texPtr )
-                    {
-                    textures << (*texPtr)[polyIndices[x+2]];
-                    }
-                }
-
-            for( int x=0; x<(polyIndices.size()/vertexSize)-2; x++ )
-                {
-                indices << firstVertex << firstVertex+x+1 << firstVertex+x+2;
-                }
-
-            pE = pE.nextSiblingElement("p");
+            emitPolygon(indices.data() + t * tupleSize, 3);
             }
+          }
+        else if(primitive.type == Polygons)
+          {
+          emitPolygon(indices.data(), tupleCount);
+          }
+        else
+          {
+          xsize tuple = 0;
+          for(xsize v = 0; v < vcount.size(); ++v)
+            {
+            if(tuple + vcount[v] > tupleCount)
+              {
+              throw Eks::ParseException(X_PARSE_ERROR(Eks::StringBuilder() << "COLLADA polylist vcount exceeds its " << tupleCount << " vertices"));
+              }
+            emitPolygon(indices.data() + tuple * tupleSize, vcount[v]);
+            tuple += vcount[v];
+            }
+          }
         }
 
-    ret.setAttribute( "vertex", positions );
-    ret.setAttribute( "normal", normals );
-    ret.setAttribute( "texture", textures );
-
-    ret.setTriangles( indices );
-
-    return ret;
+      if(submeshes && triangles->size() > firstIndex)
+        {
+        ObjLoader::Submesh submesh;
+        submesh.name = String(geometry.name.begin, geometry.name.length(), _allocator);
+        submesh.material = String(primitive.material.begin, primitive.material.length(), _allocator);
+        submesh.firstIndex = firstIndex;
+        submesh.indexCount = triangles->size() - firstIndex;
+        if(positionItem != Unused)
+          {
+          const Vector<ObjLoader::ElementVector> &positions = elements[positionItem].data;
+          for(xsize idx = firstIndex; idx < triangles->size(); ++idx)
+            {
+            submesh.bounds.unite(positions[(*triangles)[idx](positionItem)]);
+            }
+          }
+        (*submeshes) << submesh;
+        }
+      }
     }
 
-#endif
+  return true;
+  }
+
+bool ColladaFile::loadFile(
+    const char *path,
+    const ShaderVertexLayoutDescription::Semantic *items,
+    xsize itemCount,
+    Vector<VectorI3D> *triangles,
+    xsize *vertexSize,
+    ObjLoader::ElementData *elements,
+    Vector<ObjLoader::Submesh> *submeshes)
+  {
+  return withMappedFile(path, [&](const char *data, xsize dataSize)
+    {
+    return load(data, dataSize, items, itemCount, triangles, vertexSize, elements, submeshes);
+    });
+  }
+
+}
@@ -0,0 +1,311 @@
+#include "XCookedMesh.h"
+
+namespace Eks
+{
+
+namespace
+{
+
+xuint64 alignOffset(xuint64 offset)
+  {
+  return (offset + CookedMesh::DataAlignment - 1) & ~(xuint64)(CookedMesh::DataAlignment - 1);
+  }
+
+// Whether [bytes] at [offset] fit in [size] bytes, with [offset] a multiple of [alignment].
+bool sectionFits(xuint64 offset, xuint64 bytes, xuint64 alignment, xsize size)
+  {
+  return offset % alignment == 0 && offset <= size && bytes <= size - offset;
+  }
+
+bool writePadded(QFile &file, xuint64 *written, xuint64 offset)
+  {
+  static const char zeros[CookedMesh::DataAlignment] = { 0 };
+  xAssert(offset >= *written && offset - *written < CookedMesh::DataAlignment);
+
+  const xsize padding = (xsize)(offset - *written);
+  if(padding && file.write(zeros, padding) != (qint64)padding)
+    {
+    return false;
+    }
+  *written = offset;
+  return true;
+  }
+
+bool writeBlock(QFile &file, xuint64 *written, const void *data, xsize size)
+  {
+  if(size && file.write((const char *)data, size) != (qint64)size)
+    {
+    return false;
+    }
+  *written += size;
+  return true;
+  }
+
+void writeBounds(const BoundingBox &bounds, float (&minimum)[3], float (&maximum)[3])
+  {
+  for(xsize i = 0; i < 3; ++i)
+    {
+    minimum[i] = bounds.isValid() ? (float)bounds.minimum()(i) : 0.0f;
+    maximum[i] = bounds.isValid() ? (float)bounds.maximum()(i) : 0.0f;
+    }
+  }
+
+}
+
+CookedMesh::Source::Source()
+    : layout(0),
+      layoutCount(0),
+      vertexData(0),
+      vertexSize(0),
+      vertexCount(0),
+      indexType(IndexGeometry::Unsigned16),
+      indexData(0),
+      indexCount(0),
+      submeshes(0),
+      submeshCount(0)
+  {
+  }
+
+xsize CookedMesh::indexSize(IndexGeometry::Type type)
+  {
+  return IndexGeometry::typeSize(type);
+  }
+
+bool CookedMesh::write(const char *path, const Source &source)
+  {
+  xAssert(source.layout && source.layoutCount);
+  xAssert(source.vertexData && source.vertexSize && source.vertexCount);
+
+  Submesh defaultSubmesh;
+  memset(&defaultSubmesh, 0, sizeof(Submesh));
+  defaultSubmesh.indexCount = (xuint32)source.indexCount;
+  writeBounds(source.bounds, defaultSubmesh.minimum, defaultSubmesh.maximum);
+
+  const Submesh *submeshes = source.submeshCount ? source.submeshes : &defaultSubmesh;
+  const xsize submeshCount = source.submeshCount ? source.submeshCount : 1;
+
+  Header header;
+  memset(&header, 0, sizeof(Header));
+  header.magic = Magic;
+  header.byteOrder = ByteOrderMark;
+  header.version = Version;
+  header.layoutCount = (xuint32)source.layoutCount;
+  header.submeshCount = (xuint32)submeshCount;
+  header.vertexSize = (xuint32)source.vertexSize;
+  header.vertexCount = (xuint32)source.vertexCount;
+  header.indexType = (xuint32)source.indexType;
+  header.indexCount = (xuint32)source.indexCount;
+  writeBounds(source.bounds, header.minimum, header.maximum);
+
+  header.layoutOffset = sizeof(Header);
+  header.submeshOffset = header.layoutOffset + sizeof(Layout) * source.layoutCount;
+  header.vertexOffset = alignOffset(header.submeshOffset + sizeof(Submesh) * submeshCount);
+  header.indexOffset = alignOffset(header.vertexOffset + source.vertexSize * source.vertexCount);
+
+  QFile file(QString::fromUtf8(path));
+  if(!file.open(QFile::WriteOnly))
+    {
+    return false;
+    }
+
+  xuint64 written = 0;
+  if(!writeBlock(file, &written, &header, sizeof(Header)))
+    {
+    return false;
+    }
+
+  xsize offset = 0;
+  for(xsize i = 0; i < source.layoutCount; ++i)
+    {
+    const ShaderVertexLayoutDescription &desc = source.layout[i];
+
+    Layout layout;
+    layout.semantic = (xuint32)desc.semantic;
+    layout.format = (xuint32)desc.format;
+    layout.offset = (xuint32)(desc.offset == ShaderVertexLayoutDescription::OffsetPackTight ? offset : desc.offset);
+    layout.padding = 0;
+    offset = layout.offset + ShaderVertexLayoutDescription::formatSize(desc.format);
+
+    if(!writeBlock(file, &written, &layout, sizeof(Layout)))
+      {
+      return false;
+      }
+    }
+
+  if(!writeBlock(file, &written, submeshes, sizeof(Submesh) * submeshCount) ||
+     !writePadded(file, &written, header.vertexOffset) ||
+     !writeBlock(file, &written, source.vertexData, source.vertexSize * source.vertexCount) ||
+     !writePadded(file, &written, header.indexOffset) ||
+     !writeBlock(file, &written, source.indexData, indexSize(source.indexType) * source.indexCount))
+    {
+    return false;
+    }
+
+  return true;
+  }
+
+CookedMesh::CookedMesh()
+    : _data(0),
+      _header(0)
+  {
+  }
+
+CookedMesh::~CookedMesh()
+  {
+  close();
+  }
+
+bool CookedMesh::open(const char *path)
+  {
+  close();
+
+  _file.setFileName(QString::fromUtf8(path));
+  if(!_file.open(QFile::ReadOnly))
+    {
+    return false;
+    }
+
+  const xsize size = (xsize)_file.size();
+  const uchar *mapped = size ? _file.map(0, size) : 0;
+  if(mapped)
+    {
+    _data = mapped;
+    }
+  else
+    {
+    _contents = _file.readAll();
+    _file.close();
+    _data = (const xuint8 *)_contents.constData();
+    }
+
+  if(!validate(_data, size))
+    {
+    close();
+    return false;
+    }
+
+  return true;
+  }
+
+void CookedMesh::close()
+  {
+  // Closing the file releases the mapping.
+  _file.close();
+  _contents = QByteArray();
+  _data = 0;
+  _header = 0;
+  }
+
+bool CookedMesh::validate(const xuint8 *data, xsize size)
+  {
+  if(!data || size < sizeof(Header))
+    {
+    return false;
+    }
+
+  const Header *header = (const Header *)data;
+  if(header->magic != Magic ||
+     header->byteOrder != ByteOrderMark ||
+     header->version != Version ||
+     header->indexType >= IndexGeometry::TypeCount)
+    {
+    return false;
+    }
+
+  const xuint64 vertexBytes = (xuint64)header->vertexSize * header->vertexCount;
+  const xuint64 indexBytes = (xuint64)indexSize((IndexGeometry::Type)header->indexType) * header->indexCount;
+  if(!sectionFits(header->layoutOffset, (xuint64)sizeof(Layout) * header->layoutCount, alignof(Layout), size) ||
+     !sectionFits(header->submeshOffset, (xuint64)sizeof(Submesh) * header->submeshCount, alignof(Submesh), size) ||
+     !sectionFits(header->vertexOffset, vertexBytes, DataAlignment, size) ||
+     !sectionFits(header->indexOffset, indexBytes, DataAlignment, size))
+    {
+    return false;
+    }
+
+  const Layout *layout = (const Layout *)(data + header->layoutOffset);
+  for(xsize i = 0; i < header->layoutCount; ++i)
+    {
+    if(layout[i].semantic >= ShaderVertexLayoutDescription::SemanticCount ||
+       layout[i].format >= ShaderVertexLayoutDescription::FormatCount ||
+       layout[i].offset + ShaderVertexLayoutDescription::formatSize((ShaderVertexLayoutDescription::Format)layout[i].format) > header->vertexSize)
+      {
+      return false;
+      }
+    }
+
+  const Submesh *submeshes = (const Submesh *)(data + header->submeshOffset);
+  for(xsize i = 0; i < header->submeshCount; ++i)
+    {
+    if((xuint64)submeshes[i].firstIndex + submeshes[i].indexCount > header->indexCount)
+      {
+      return false;
+      }
+    }
+
+  _header = header;
+  return true;
+  }
+
+const CookedMesh::Layout *CookedMesh::layout() const
+  {
+  xAssert(_header);
+  return (const Layout *)(_data + _header->layoutOffset);
+  }
+
+xsize CookedMesh::layoutDescriptions(ShaderVertexLayoutDescription *descs, xsize count) const
+  {
+  const Layout *l = layout();
+  for(xsize i = 0; i < count && i < _header->layoutCount; ++i)
+    {
+    descs[i] = ShaderVertexLayoutDescription(
+      (ShaderVertexLayoutDescription::Semantic)l[i].semantic,
+      (ShaderVertexLayoutDescription::Format)l[i].format,
+      l[i].offset);
+    }
+  return _header->layoutCount;
+  }
+
+const CookedMesh::Submesh *CookedMesh::submeshes() const
+  {
+  xAssert(_header);
+  return (const Submesh *)(_data + _header->submeshOffset);
+  }
+
+BoundingBox CookedMesh::bounds() const
+  {
+  xAssert(_header);
+  return BoundingBox(
+    Vector3D(_header->minimum[0], _header->minimum[1], _header->minimum[2]),
+    Vector3D(_header->maximum[0], _header->maximum[1], _header->maximum[2]));
+  }
+
+const void *CookedMesh::vertexData() const
+  {
+  xAssert(_header);
+  return _data + _header->vertexOffset;
+  }
+
+const void *CookedMesh::indexData() const
+  {
+  xAssert(_header);
+  return _data + _header->indexOffset;
+  }
+
+bool CookedMesh::createGeometry(Renderer *r, Geometry *geo) const
+  {
+  xAssert(_header && geo);
+  return Geometry::delayedCreate(*geo, r, vertexData(), _header->vertexSize, _header->vertexCount);
+  }
+
+bool CookedMesh::createIndexGeometry(Renderer *r, IndexGeometry *geo) const
+  {
+  xAssert(_header && geo);
+  if(!_header->indexCount)
+    {
+    return false;
+    }
+
+  return IndexGeometry::delayedCreate(*geo, r, (IndexGeometry::Type)_header->indexType, indexData(), _header->indexCount);
+  }
+
+}
@@ -0,0 +1,133 @@
+#include "XCurveTessellator.h"
+#include "Math/XMathCurve.h"
+#include <limits>
+
+namespace Eks
+{
+
+namespace
+{
+
+Vector3D sampleCurve(Real t, const void *context)
+  {
+  return static_cast<const AbstractCurve<Vector3D> *>(context)->sample(t);
+  }
+
+// True if [a], [b] and [c] are all outside one of the clip planes.
+bool outsideClip(const Vector4D &a, const Vector4D &b, const Vector4D &c)
+  {
+  for(xsize i = 0; i < 3; ++i)
+    {
+    if((a(i) > a(3) && b(i) > b(3) && c(i) > c(3)) ||
+       (a(i) < -a(3) && b(i) < -b(3) && c(i) < -c(3)))
+      {
+      return true;
+      }
+    }
+  return false;
+  }
+
+}
+
+CurveTessellator::CurveTessellator(const ComplexTransform &toClip, const Vector2D &viewport, Real pixelTolerance)
+    : _toClip(toClip),
+      _halfViewport(viewport * 0.5f),
+      _tolerance(pixelTolerance)
+  {
+  xAssert(pixelTolerance > 0.0f);
+  }
+
+void CurveTessellator::tessellate(const AbstractCurve<Vector3D> &curve, Vector<Vector3D> *points) const
+  {
+  tessellate(sampleCurve, &curve, curve.minimumT(), curve.maximumT(), points);
+  }
+
+void CurveTessellator::tessellate(
+    SampleFunction fn,
+    const void *context,
+    Real minimumT,
+    Real maximumT,
+    Vector<Vector3D> *points) const
+  {
+  const Real span = (maximumT - minimumT) / MinSpans;
+
+  Sample a = sample(fn, context, minimumT);
+  *points << a.point;
+  for(xsize i = 1; i <= MinSpans; ++i)
+    {
+    const Sample b = sample(fn, context, i == MinSpans ? maximumT : minimumT + span * i);
+    subdivide(fn, context, a, b, 0, points);
+    a = b;
+    }
+  }
+
+CurveTessellator::Sample CurveTessellator::sample(SampleFunction fn, const void *context, Real t) const
+  {
+  Sample s;
+  s.t = t;
+  s.point = fn(t, context);
+  s.clip = _toClip.matrix() * s.point.homogeneous();
+  return s;
+  }
+
+void CurveTessellator::subdivide(
+    SampleFunction fn,
+    const void *context,
+    const Sample &a,
+    const Sample &b,
+    xsize depth,
+    Vector<Vector3D> *points) const
+  {
+  if(depth < MaxDepth)
+    {
+    const Sample mid = sample(fn, context, (a.t + b.t) * 0.5f);
+    if(error(a, mid, b) > _tolerance)
+      {
+      subdivide(fn, context, a, mid, depth + 1, points);
+      subdivide(fn, context, mid, b, depth + 1, points);
+      return;
+      }
+    }
+
+  *points << b.point;
+  }
+
+Real CurveTessellator::error(const Sample &a, const Sample &mid, const Sample &b) const
+  {
+  const Real eps = std::numeric_limits<Real>::epsilon();
+  const bool aFront = a.clip(3) > eps;
+  const bool midFront = mid.clip(3) > eps;
+  const bool bFront = b.clip(3) > eps;
+
+  // Nothing behind the eye is seen, and a span crossing the eye plane has no screen size.
+  if(!aFront && !midFront && !bFront)
+    {
+    return 0.0f;
+    }
+  if(!aFront || !midFront || !bFront)
+    {
+    return std::numeric_limits<Real>::infinity();
+    }
+
+  if(outsideClip(a.clip, mid.clip, b.clip))
+    {
+    return 0.0f;
+    }
+
+  const Vector2D screenA = (a.clip.head<2>() / a.clip(3)).cwiseProduct(_halfViewport);
+  const Vector2D screenMid = (mid.clip.head<2>() / mid.clip(3)).cwiseProduct(_halfViewport);
+  const Vector2D screenB = (b.clip.head<2>() / b.clip(3)).cwiseProduct(_halfViewport);
+
+  const Vector2D chord = screenB - screenA;
+  const Vector2D toMid = screenMid - screenA;
+  const Real lengthSq = chord.squaredNorm();
+  Real along = 0.0f;
+  if(lengthSq > eps)
+    {
+    along = std::min(std::max(toMid.dot(chord) / lengthSq, 0.0f), 1.0f);
+    }
+
+  return (toMid - chord * along).norm();
+  }
+
+}
@@ -18,10 +18,11 @@ Frustum::Frustum( const Vector3D &point, const Vector3D &look, const Vector3D &a
   float fovUpY = tan(Eks::degreesToRadians(viewAngle)/2.0f);
   float fovUpX = tan(Eks::degreesToRadians(viewAngle*aspect)/2.0f);
 
+  // Every plane faces into the frustum.
   // near plane
-  _planes[NearPlane] = Plane(point+(lookNorm*nearPlane), -lookNorm);
+  _planes[NearPlane] = Plane(point+(lookNorm*nearPlane), lookNorm);
   // far plane
-  _planes[FarPlane] = Plane(point+(lookNorm*farPlane), lookNorm);
+  _planes[FarPlane] = Plane(point+(lookNorm*farPlane), -lookNorm);
 
   // top plane
   _planes[TopPlane] = Plane(point, (lookNorm + (fovUpY * upNorm)).cross(across) );
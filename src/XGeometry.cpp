@@ -2,6 +2,10 @@
 #include "XRenderer.h"
 #include "XTriangle.h"
 #include "XBoundingBox.h"
+#include "XCore.h"
+#include "Memory/XTemporaryAllocator.h"
+#include "Containers/XVector.h"
+#include <algorithm>
 
 namespace Eks
 {
@@ -31,10 +35,61 @@ bool Geometry::delayedCreate(
     xsize elementSize,
     xsize elementCount)
   {
+  release(ths);
   ths._renderer = r;
   return r->functions().create.geometry(r, &ths, data, elementSize, elementCount);
   }
 
+bool Geometry::delayedCreate(
+    Geometry &ths,
+    Renderer *r,
+    xsize elementSize,
+    xsize elementCount,
+    void (*write)(void *data, void *context),
+    void *context)
+  {
+  if(r->functions().buffer.geometry)
+    {
+    release(ths);
+    ths._renderer = r;
+    return r->functions().buffer.geometry(r, &ths, elementSize, elementCount, write, context);
+    }
+
+  TemporaryAllocator alloc(Core::temporaryAllocator());
+  Vector<xuint8> data(&alloc);
+  data.resize(elementSize * elementCount);
+  write(data.data(), context);
+
+  return delayedCreate(ths, r, data.data(), elementSize, elementCount);
+  }
+
+bool Geometry::delayedUpdate(
+    Geometry &ths,
+    xsize elementSize,
+    xsize first,
+    xsize count,
+    void (*write)(void *data, void *context),
+    void *context)
+  {
+  Renderer *r = ths._renderer;
+  if(!r || !r->functions().buffer.updateGeometry)
+    {
+    return false;
+    }
+
+  return r->functions().buffer.updateGeometry(r, &ths, elementSize, first, count, write, context);
+  }
+
+void Geometry::release(Geometry &ths)
+  {
+  // Creating over an existing buffer would leak it.
+  if(ths._renderer)
+    {
+    ths._renderer->functions().destroy.geometry(ths._renderer, &ths);
+    ths._renderer = 0;
+    }
+  }
+
 IndexGeometry::IndexGeometry(Renderer *r, Type type, const void *data, xsize dataSize)
     : _renderer(0)
   {
@@ -60,10 +115,114 @@ bool IndexGeometry::delayedCreate(
     const void *index,
     xsize indexCount)
   {
+  release(ths);
   ths._renderer = r;
   return r->functions().create.indexGeometry(r, &ths, type, index, indexCount);
   }
 
+bool IndexGeometry::delayedCreate(
+    IndexGeometry &ths,
+    Renderer *r,
+    Type type,
+    xsize indexCount,
+    void (*write)(void *data, void *context),
+    void *context)
+  {
+  if(r->functions().buffer.indexGeometry)
+    {
+    release(ths);
+    ths._renderer = r;
+    return r->functions().buffer.indexGeometry(r, &ths, type, indexCount, write, context);
+    }
+
+  TemporaryAllocator alloc(Core::temporaryAllocator());
+  Vector<xuint8> data(&alloc);
+  data.resize(typeSize(type) * indexCount);
+  write(data.data(), context);
+
+  return delayedCreate(ths, r, type, data.data(), indexCount);
+  }
+
+bool IndexGeometry::delayedUpdate(
+    IndexGeometry &ths,
+    Type type,
+    xsize first,
+    xsize count,
+    void (*write)(void *data, void *context),
+    void *context)
+  {
+  Renderer *r = ths._renderer;
+  if(!r || !r->functions().buffer.updateIndexGeometry)
+    {
+    return false;
+    }
+
+  return r->functions().buffer.updateIndexGeometry(r, &ths, type, first, count, write, context);
+  }
+
+bool IndexGeometry::delayedUpdateNarrowed(
+    IndexGeometry &ths,
+    Type type,
+    const xuint32 *indices,
+    xsize first,
+    xsize count)
+  {
+  auto narrow = [type, indices, first, count](void *data)
+    {
+    if(type == Unsigned32)
+      {
+      std::copy(indices + first, indices + first + count, (xuint32 *)data);
+      return;
+      }
+
+    xAssert(type == Unsigned16);
+    xuint16 *narrowed = (xuint16 *)data;
+    for(xsize i = 0; i < count; ++i)
+      {
+      xAssert(indices[first + i] <= std::numeric_limits<xuint16>::max());
+      narrowed[i] = (xuint16)indices[first + i];
+      }
+    };
+
+  return delayedUpdateWith(ths, type, first, count, narrow);
+  }
+
+void IndexGeometry::release(IndexGeometry &ths)
+  {
+  if(ths._renderer)
+    {
+    ths._renderer->functions().destroy.indexGeometry(ths._renderer, &ths);
+    ths._renderer = 0;
+    }
+  }
+
+bool IndexGeometry::delayedCreateNarrowest(
+    IndexGeometry &ths,
+    Renderer *r,
+    const xuint32 *indices,
+    xsize indexCount,
+    xsize vertexCount)
+  {
+  const Type type = typeFor(vertexCount);
+  if(type == Unsigned32)
+    {
+    return delayedCreate(ths, r, Unsigned32, indices, indexCount);
+    }
+
+  // Narrowed straight into the buffer where it can be mapped.
+  auto narrow = [indices, indexCount, vertexCount](void *data)
+    {
+    xuint16 *narrowed = (xuint16 *)data;
+    for(xsize i = 0; i < indexCount; ++i)
+      {
+      xAssert(indices[i] < vertexCount);
+      narrowed[i] = (xuint16)indices[i];
+      }
+    };
+
+  return delayedCreateWith(ths, r, Unsigned16, indexCount, narrow);
+  }
+
 }
 
 /*
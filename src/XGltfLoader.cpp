@@ -0,0 +1,1075 @@
+#include "XGltfLoader.h"
+#include "Containers/XStringBuilder.h"
+#include "Utilities/XParseException.h"
+#include "XNumberScanner.h"
+#include <algorithm>
+#include <cstring>
+
+namespace Eks
+{
+
+const xsize GltfLoader::NoIndex;
+
+namespace
+{
+
+const xsize Unused = GltfLoader::NoIndex;
+
+const xuint32 GlbMagic = 0x46546C67; // "glTF"
+const xuint32 GlbJsonChunk = 0x4E4F534A; // "JSON"
+const xuint32 GlbBinaryChunk = 0x004E4942; // "BIN"
+
+const xsize MaxJsonDepth = 64;
+
+enum ComponentType
+  {
+  Byte = 5120,
+  UnsignedByte = 5121,
+  Short = 5122,
+  UnsignedShort = 5123,
+  UnsignedInt = 5125,
+  Float = 5126
+  };
+
+const xsize TrianglesMode = 4;
+
+inline bool isSpace(char c)
+  {
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+  }
+
+struct JsonValue
+  {
+  enum Type
+    {
+    Null,
+    False,
+    True,
+    Number,
+    String,
+    Array,
+    Object
+    };
+
+  Type type;
+  // Strings exclude their quotes, escapes are left in place.
+  const char *begin;
+  const char *end;
+  // The member name, for values in an object.
+  const char *key;
+  const char *keyEnd;
+
+  // Children directly follow their parent, linked through [next].
+  xsize childCount;
+  xsize next;
+  };
+
+// A JSON document parsed in place into a flat list of values, the root first.
+class JsonDocument
+  {
+public:
+  JsonDocument(AllocatorBase *allocator) : _values(allocator), _pos(0), _end(0)
+    {
+    }
+
+  void parse(const char *begin, const char *end)
+    {
+    _values.clear();
+    _pos = begin;
+    _end = end;
+    parseValue(0);
+
+    skipSpace();
+    if(_pos != _end)
+      {
+      error("trailing data");
+      }
+    }
+
+  const JsonValue &value(xsize index) const
+    {
+    return _values[index];
+    }
+
+  bool is(xsize index, JsonValue::Type type) const
+    {
+    return index != Unused && _values[index].type == type;
+    }
+
+  xsize firstChild(xsize index) const
+    {
+    return index != Unused && _values[index].childCount ? index + 1 : Unused;
+    }
+
+  xsize next(xsize index) const
+    {
+    return _values[index].next;
+    }
+
+  xsize member(xsize object, const char *name) const
+    {
+    if(!is(object, JsonValue::Object))
+      {
+      return Unused;
+      }
+
+    const xsize length = strlen(name);
+    for(xsize child = firstChild(object); child != Unused; child = next(child))
+      {
+      const JsonValue &v = _values[child];
+      if((xsize)(v.keyEnd - v.key) == length && memcmp(v.key, name, length) == 0)
+        {
+        return child;
+        }
+      }
+    return Unused;
+    }
+
+  // The children of [array], or nothing if it isn't an array.
+  void elements(xsize array, Vector<xsize> *out) const
+    {
+    out->clear();
+    if(!is(array, JsonValue::Array))
+      {
+      return;
+      }
+
+    for(xsize child = firstChild(array); child != Unused; child = next(child))
+      {
+      *out << child;
+      }
+    }
+
+  double number(xsize index, double defaultValue) const
+    {
+    if(!is(index, JsonValue::Number))
+      {
+      return defaultValue;
+      }
+
+    double result = 0.0;
+    NumberScanner::parseReal(_values[index].begin, _values[index].end, &result);
+    return result;
+    }
+
+  xsize integer(xsize index, xsize defaultValue) const
+    {
+    const double result = number(index, -1.0);
+    if(result < 0.0 || result != (double)(xsize)result)
+      {
+      return defaultValue;
+      }
+    return (xsize)result;
+    }
+
+  bool boolean(xsize index, bool defaultValue) const
+    {
+    return is(index, JsonValue::True) || (defaultValue && !is(index, JsonValue::False));
+    }
+
+  bool equals(xsize index, const char *str) const
+    {
+    if(!is(index, JsonValue::String))
+      {
+      return false;
+      }
+    const xsize length = strlen(str);
+    const JsonValue &v = _values[index];
+    return (xsize)(v.end - v.begin) == length && memcmp(v.begin, str, length) == 0;
+    }
+
+  String string(xsize index, AllocatorBase *allocator) const
+    {
+    if(!is(index, JsonValue::String))
+      {
+      return String();
+      }
+    return String(_values[index].begin, _values[index].end - _values[index].begin, allocator);
+    }
+
+private:
+  void error(const char *message) const
+    {
+    throw Eks::ParseException(X_PARSE_ERROR(Eks::StringBuilder() << "Invalid glTF JSON, " << message));
+    }
+
+  void skipSpace()
+    {
+    while(_pos < _end && isSpace(*_pos))
+      {
+      ++_pos;
+      }
+    }
+
+  void expect(char c)
+    {
+    skipSpace();
+    if(_pos == _end || *_pos != c)
+      {
+      error("unexpected character");
+      }
+    ++_pos;
+    }
+
+  // Move past a string, [_pos] is at the opening quote.
+  void parseString(const char **begin, const char **end)
+    {
+    ++_pos;
+    *begin = _pos;
+    while(_pos < _end && *_pos != '"')
+      {
+      _pos += *_pos == '\\' ? 2 : 1;
+      }
+    if(_pos >= _end)
+      {
+      error("unterminated string");
+      }
+    *end = _pos++;
+    }
+
+  void parseLiteral(const char *literal)
+    {
+    const xsize length = strlen(literal);
+    if((xsize)(_end - _pos) < length || memcmp(_pos, literal, length) != 0)
+      {
+      error("unknown literal");
+      }
+    _pos += length;
+    }
+
+  xsize parseValue(xsize depth)
+    {
+    if(depth > MaxJsonDepth)
+      {
+      error("nested too deeply");
+      }
+
+    skipSpace();
+    if(_pos == _end)
+      {
+      error("unexpected end");
+      }
+
+    const xsize index = _values.size();
+    JsonValue value;
+    value.type = JsonValue::Null;
+    value.begin = _pos;
+    value.end = _pos;
+    value.key = 0;
+    value.keyEnd = 0;
+    value.childCount = 0;
+    value.next = Unused;
+    _values << value;
+
+    const char c = *_pos;
+    if(c == '{' || c == '[')
+      {
+      const bool object = c == '{';
+      const char close = object ? '}' : ']';
+      _values[index].type = object ? JsonValue::Object : JsonValue::Array;
+      ++_pos;
+
+      skipSpace();
+      if(_pos < _end && *_pos == close)
+        {
+        ++_pos;
+        return index;
+        }
+
+      xsize previous = Unused;
+      for(;;)
+        {
+        const char *key = 0;
+        const char *keyEnd = 0;
+        if(object)
+          {
+          skipSpace();
+          if(_pos == _end || *_pos != '"')
+            {
+            error("expected a member name");
+            }
+          parseString(&key, &keyEnd);
+          expect(':');
+          }
+
+        const xsize child = parseValue(depth + 1);
+        _values[child].key = key;
+        _values[child].keyEnd = keyEnd;
+        if(previous != Unused)
+          {
+          _values[previous].next = child;
+          }
+        previous = child;
+        ++_values[index].childCount;
+
+        skipSpace();
+        if(_pos < _end && *_pos == ',')
+          {
+          ++_pos;
+          continue;
+          }
+        expect(close);
+        break;
+        }
+      }
+    else if(c == '"')
+      {
+      _values[index].type = JsonValue::String;
+      parseString(&_values[index].begin, &_values[index].end);
+      }
+    else if(c == 't')
+      {
+      _values[index].type = JsonValue::True;
+      parseLiteral("true");
+      }
+    else if(c == 'f')
+      {
+      _values[index].type = JsonValue::False;
+      parseLiteral("false");
+      }
+    else if(c == 'n')
+      {
+      parseLiteral("null");
+      }
+    else
+      {
+      double number = 0.0;
+      if(!NumberScanner::scanReal(_pos, _end, &number))
+        {
+        error("unexpected character");
+        }
+      _values[index].type = JsonValue::Number;
+      _values[index].end = _pos;
+      }
+
+    return index;
+    }
+
+  Vector<JsonValue> _values;
+  const char *_pos;
+  const char *_end;
+  };
+
+xuint32 readUint32(const char *data)
+  {
+  xuint32 value;
+  memcpy(&value, data, sizeof(value));
+  return value;
+  }
+
+struct Buffer
+  {
+  // Either [data] or an offset into the owned data, until every buffer is loaded.
+  const xuint8 *data;
+  xsize ownedOffset;
+  xsize length;
+  };
+
+struct BufferView
+  {
+  const xuint8 *data;
+  xsize length;
+  xsize stride;
+  };
+
+struct Accessor
+  {
+  const xuint8 *data;
+  xsize stride;
+  xsize elementSize;
+  xsize count;
+  xsize componentType;
+  xsize components;
+  bool normalised;
+  // From the accessor's min and max, when both have three values.
+  bool hasBounds;
+  BoundingBox bounds;
+  };
+
+xsize componentSize(xsize componentType)
+  {
+  switch(componentType)
+    {
+  case Byte:
+  case UnsignedByte:
+    return 1;
+  case Short:
+  case UnsignedShort:
+    return 2;
+  case UnsignedInt:
+  case Float:
+    return 4;
+  default:
+    return 0;
+    }
+  }
+
+xsize typeComponents(const JsonDocument &json, xsize type)
+  {
+  const char *names[] = { "SCALAR", "VEC2", "VEC3", "VEC4" };
+  for(xsize i = 0; i < X_ARRAY_COUNT(names); ++i)
+    {
+    if(json.equals(type, names[i]))
+      {
+      return i + 1;
+      }
+    }
+  return json.equals(type, "MAT2") ? 4 : json.equals(type, "MAT3") ? 9 : json.equals(type, "MAT4") ? 16 : 0;
+  }
+
+// The layout format reading [accessor] as stored, or FormatCount if there is none.
+ShaderVertexLayoutDescription::Format formatFor(const Accessor &accessor)
+  {
+  typedef ShaderVertexLayoutDescription Desc;
+  if(accessor.componentType == Float)
+    {
+    const Desc::Format floats[] = { Desc::FormatFloat1, Desc::FormatFloat2, Desc::FormatFloat3, Desc::FormatFloat4 };
+    return accessor.components <= 4 ? floats[accessor.components - 1] : Desc::FormatCount;
+    }
+
+  if(!accessor.normalised)
+    {
+    return Desc::FormatCount;
+    }
+
+  if(accessor.componentType == Short && accessor.components == 2)
+    {
+    return Desc::FormatNormalisedShort2;
+    }
+  if(accessor.componentType == Short && accessor.components == 4)
+    {
+    return Desc::FormatNormalisedShort4;
+    }
+  if(accessor.componentType == UnsignedShort && accessor.components == 2)
+    {
+    return Desc::FormatNormalisedUnsignedShort2;
+    }
+  if(accessor.componentType == Byte && accessor.components == 4)
+    {
+    return Desc::FormatNormalisedByte4;
+    }
+  if(accessor.componentType == UnsignedByte && accessor.components == 4)
+    {
+    return Desc::FormatNormalisedUnsignedByte4;
+    }
+  return Desc::FormatCount;
+  }
+
+ShaderVertexLayoutDescription::Semantic semanticFor(const JsonValue &attribute)
+  {
+  struct SemanticName
+    {
+    const char *name;
+    ShaderVertexLayoutDescription::Semantic semantic;
+    };
+  const SemanticName names[] =
+    {
+    { "POSITION", ShaderVertexLayoutDescription::Position },
+    { "NORMAL", ShaderVertexLayoutDescription::Normal },
+    { "TEXCOORD_0", ShaderVertexLayoutDescription::TextureCoordinate },
+    { "COLOR_0", ShaderVertexLayoutDescription::Colour },
+    { "TANGENT", ShaderVertexLayoutDescription::BiNormal }
+    };
+
+  const xsize length = attribute.keyEnd - attribute.key;
+  for(xsize i = 0; i < X_ARRAY_COUNT(names); ++i)
+    {
+    if(strlen(names[i].name) == length && memcmp(attribute.key, names[i].name, length) == 0)
+      {
+      return names[i].semantic;
+      }
+    }
+  return ShaderVertexLayoutDescription::InvalidSemantic;
+  }
+
+const Accessor &findAccessor(const Vector<Accessor> &accessors, xsize index)
+  {
+  if(index >= accessors.size())
+    {
+    throw Eks::ParseException(X_PARSE_ERROR(Eks::StringBuilder() << "glTF accessor " << index << " out of range"));
+    }
+  return accessors[index];
+  }
+
+template <typename T> void checkIndices(const xuint8 *data, xsize count, xsize vertexCount)
+  {
+  for(xsize i = 0; i < count; ++i)
+    {
+    T index;
+    memcpy(&index, data + i * sizeof(T), sizeof(T));
+    if((xsize)index >= vertexCount)
+      {
+      throw Eks::ParseException(X_PARSE_ERROR(Eks::StringBuilder() << "glTF index out of range [" << (xsize)index << "/" << vertexCount << "]"));
+      }
+    }
+  }
+
+Transform readTransform(const JsonDocument &json, xsize node, Vector<xsize> &values)
+  {
+  Transform result = Transform::Identity();
+
+  json.elements(json.member(node, "matrix"), &values);
+  if(values.size() == 16)
+    {
+    // Column major.
+    for(xsize i = 0; i < 16; ++i)
+      {
+      result.matrix()(i % 4, i / 4) = (float)json.number(values[i], 0.0);
+      }
+    return result;
+    }
+
+  Eigen::Vector3f translation(0, 0, 0);
+  json.elements(json.member(node, "translation"), &values);
+  for(xsize i = 0; i < values.size() && i < 3; ++i)
+    {
+    translation(i) = (float)json.number(values[i], 0.0);
+    }
+
+  Eigen::Quaternionf rotation = Eigen::Quaternionf::Identity();
+  json.elements(json.member(node, "rotation"), &values);
+  if(values.size() == 4)
+    {
+    rotation = Eigen::Quaternionf(
+      (float)json.number(values[3], 1.0),
+      (float)json.number(values[0], 0.0),
+      (float)json.number(values[1], 0.0),
+      (float)json.number(values[2], 0.0));
+    }
+
+  Eigen::Vector3f scale(1, 1, 1);
+  json.elements(json.member(node, "scale"), &values);
+  for(xsize i = 0; i < values.size() && i < 3; ++i)
+    {
+    scale(i) = (float)json.number(values[i], 1.0);
+    }
+
+  result.fromPositionOrientationScale(translation, rotation, scale);
+  return result;
+  }
+
+}
+
+GltfLoader::GltfLoader(AllocatorBase *allocator)
+    : _allocator(allocator),
+      _ownedData(allocator),
+      _meshes(allocator),
+      _primitives(allocator),
+      _nodes(allocator)
+  {
+  }
+
+GltfLoader::~GltfLoader()
+  {
+  clear();
+  }
+
+void GltfLoader::clear()
+  {
+  _meshes.clear();
+  _primitives.clear();
+  _nodes.clear();
+  _ownedData.clear();
+  _contents = QByteArray();
+  _file.close();
+  }
+
+bool GltfLoader::loadFile(const char *path)
+  {
+  clear();
+
+  _file.setFileName(QString::fromUtf8(path));
+  if(!_file.open(QFile::ReadOnly))
+    {
+    return false;
+    }
+
+  const xsize size = (xsize)_file.size();
+  const char *data = (const char *)(size ? _file.map(0, size) : 0);
+  if(!data)
+    {
+    _contents = _file.readAll();
+    _file.close();
+    data = _contents.constData();
+    }
+
+  const QString fullPath = QString::fromUtf8(path);
+  const int separator = std::max(fullPath.lastIndexOf('/'), fullPath.lastIndexOf('\\'));
+  const QByteArray basePath = separator >= 0 ? fullPath.left(separator).toUtf8() : QByteArray(".");
+  return load(data, size, basePath.constData());
+  }
+
+bool GltfLoader::load(const char *data, xsize dataSize, const char *basePath)
+  {
+  _meshes.clear();
+  _primitives.clear();
+  _nodes.clear();
+  _ownedData.clear();
+
+  const char *jsonBegin = data;
+  const char *jsonEnd = data + dataSize;
+  const xuint8 *binary = 0;
+  xsize binarySize = 0;
+
+  if(dataSize >= 12 && readUint32(data) == GlbMagic)
+    {
+    const xuint32 version = readUint32(data + 4);
+    const xsize length = readUint32(data + 8);
+    if(version != 2 || length > dataSize)
+      {
+      throw Eks::ParseException(X_PARSE_ERROR(Eks::StringBuilder() << "Unsupported GLB version " << version));
+      }
+
+    jsonBegin = jsonEnd = 0;
+    for(xsize pos = 12; pos + 8 <= length;)
+      {
+      const xsize chunkLength = readUint32(data + pos);
+      const xuint32 chunkType = readUint32(data + pos + 4);
+      const char *chunk = data + pos + 8;
+      if(chunkLength > length - pos - 8)
+        {
+        throw Eks::ParseException(X_PARSE_ERROR(Eks::StringBuilder() << "GLB chunk overruns the file"));
+        }
+
+      if(chunkType == GlbJsonChunk && !jsonBegin)
+        {
+        jsonBegin = chunk;
+        jsonEnd = chunk + chunkLength;
+        }
+      else if(chunkType == GlbBinaryChunk && !binary)
+        {
+        binary = (const xuint8 *)chunk;
+        binarySize = chunkLength;
+        }
+      pos += 8 + ((chunkLength + 3) & ~(xsize)3);
+      }
+
+    if(!jsonBegin)
+      {
+      throw Eks::ParseException(X_PARSE_ERROR(Eks::StringBuilder() << "GLB file has no JSON chunk"));
+      }
+    }
+
+  JsonDocument json(_allocator);
+  json.parse(jsonBegin, jsonEnd);
+  const xsize root = 0;
+  if(!json.is(root, JsonValue::Object))
+    {
+    throw Eks::ParseException(X_PARSE_ERROR(Eks::StringBuilder() << "glTF root is not an object"));
+    }
+
+  Vector<xsize> items(_allocator);
+
+  // Buffers, with data uris and external files appended to the owned data.
+  Vector<Buffer> buffers(_allocator);
+  json.elements(json.member(root, "buffers"), &items);
+  for(xsize i = 0; i < items.size(); ++i)
+    {
+    Buffer buffer;
+    buffer.data = 0;
+    buffer.ownedOffset = _ownedData.size();
+    buffer.length = json.integer(json.member(items[i], "byteLength"), 0);
+
+    const xsize uri = json.member(items[i], "uri");
+    if(uri == Unused)
+      {
+      if(i != 0 || !binary || binarySize < buffer.length)
+        {
+        throw Eks::ParseException(X_PARSE_ERROR(Eks::StringBuilder() << "glTF buffer " << i << " has no data"));
+        }
+      buffer.data = binary;
+      }
+    else
+      {
+      const JsonValue &value = json.value(uri);
+      const char *base64 = "base64,";
+      const char *marker = std::search(value.begin, value.end, base64, base64 + 7);
+      xsize loaded = 0;
+      if(value.end - value.begin > 5 && memcmp(value.begin, "data:", 5) == 0 && marker != value.end)
+        {
+        const QByteArray decoded = QByteArray::fromBase64(QByteArray::fromRawData(marker + 7, (int)(value.end - marker - 7)));
+        loaded = (xsize)decoded.size();
+        _ownedData.resize(buffer.ownedOffset + loaded, 0);
+        memcpy(_ownedData.data() + buffer.ownedOffset, decoded.constData(), loaded);
+        }
+      else
+        {
+        if(!basePath)
+          {
+          throw Eks::ParseException(X_PARSE_ERROR(Eks::StringBuilder() << "glTF external buffer without a base path"));
+          }
+
+        QFile external(QString::fromUtf8(basePath) + "/" + QString::fromUtf8(value.begin, (int)(value.end - value.begin)));
+        if(!external.open(QFile::ReadOnly))
+          {
+          throw Eks::ParseException(X_PARSE_ERROR(Eks::StringBuilder() << "glTF buffer '" << Eks::String(value.begin, value.end - value.begin) << "' not found"));
+          }
+        const QByteArray contents = external.readAll();
+        loaded = (xsize)contents.size();
+        _ownedData.resize(buffer.ownedOffset + loaded, 0);
+        memcpy(_ownedData.data() + buffer.ownedOffset, contents.constData(), loaded);
+        }
+
+      if(loaded < buffer.length)
+        {
+        throw Eks::ParseException(X_PARSE_ERROR(Eks::StringBuilder() << "glTF buffer " << i << " is shorter than its byteLength"));
+        }
+      }
+
+    buffers << buffer;
+    }
+
+  for(xsize i = 0; i < buffers.size(); ++i)
+    {
+    if(!buffers[i].data)
+      {
+      buffers[i].data = _ownedData.data() + buffers[i].ownedOffset;
+      }
+    }
+
+  Vector<BufferView> views(_allocator);
+  json.elements(json.member(root, "bufferViews"), &items);
+  for(xsize i = 0; i < items.size(); ++i)
+    {
+    const xsize bufferIndex = json.integer(json.member(items[i], "buffer"), Unused);
+    const xsize offset = json.integer(json.member(items[i], "byteOffset"), 0);
+
+    BufferView view;
+    view.length = json.integer(json.member(items[i], "byteLength"), 0);
+    view.stride = json.integer(json.member(items[i], "byteStride"), 0);
+    if(bufferIndex >= buffers.size() || offset > buffers[bufferIndex].length || view.length > buffers[bufferIndex].length - offset)
+      {
+      throw Eks::ParseException(X_PARSE_ERROR(Eks::StringBuilder() << "glTF buffer view " << i << " is outside its buffer"));
+      }
+    view.data = buffers[bufferIndex].data + offset;
+    views << view;
+    }
+
+  Vector<xsize> values(_allocator);
+  Vector<Accessor> accessors(_allocator);
+  json.elements(json.member(root, "accessors"), &items);
+  for(xsize i = 0; i < items.size(); ++i)
+    {
+    const xsize viewIndex = json.integer(json.member(items[i], "bufferView"), Unused);
+    if(viewIndex >= views.size() || json.member(items[i], "sparse") != Unused)
+      {
+      throw Eks::ParseException(X_PARSE_ERROR(Eks::StringBuilder() << "glTF accessor " << i << " has no buffer view, or is sparse"));
+      }
+
+    const BufferView &view = views[viewIndex];
+    const xsize offset = json.integer(json.member(items[i], "byteOffset"), 0);
+
+    Accessor accessor;
+    accessor.componentType = json.integer(json.member(items[i], "componentType"), 0);
+    accessor.components = typeComponents(json, json.member(items[i], "type"));
+    accessor.normalised = json.boolean(json.member(items[i], "normalized"), false);
+    accessor.count = json.integer(json.member(items[i], "count"), 0);
+    accessor.elementSize = componentSize(accessor.componentType) * accessor.components;
+    accessor.stride = view.stride ? view.stride : accessor.elementSize;
+    accessor.data = view.data + offset;
+
+    Vector3D limits[2];
+    const char *limitNames[] = { "min", "max" };
+    accessor.hasBounds = true;
+    for(xsize l = 0; l < 2; ++l)
+      {
+      json.elements(json.member(items[i], limitNames[l]), &values);
+      accessor.hasBounds = accessor.hasBounds && values.size() == 3;
+      for(xsize c = 0; c < 3 && accessor.hasBounds; ++c)
+        {
+        limits[l](c) = (Real)json.number(values[c], 0.0);
+        }
+      }
+    if(accessor.hasBounds)
+      {
+      accessor.bounds = BoundingBox(limits[0], limits[1]);
+      }
+
+    if(!accessor.elementSize ||
+       (accessor.count && (offset > view.length || (accessor.count - 1) * accessor.stride + accessor.elementSize > view.length - offset)))
+      {
+      throw Eks::ParseException(X_PARSE_ERROR(Eks::StringBuilder() << "glTF accessor " << i << " is invalid or outside its buffer view"));
+      }
+    accessors << accessor;
+    }
+
+  Vector<xsize> primitives(_allocator);
+  json.elements(json.member(root, "meshes"), &items);
+  for(xsize m = 0; m < items.size(); ++m)
+    {
+    Mesh mesh;
+    mesh.name = json.string(json.member(items[m], "name"), _allocator);
+    mesh.firstPrimitive = _primitives.size();
+
+    json.elements(json.member(items[m], "primitives"), &primitives);
+    for(xsize p = 0; p < primitives.size(); ++p)
+      {
+      if(json.integer(json.member(primitives[p], "mode"), TrianglesMode) != TrianglesMode)
+        {
+        continue;
+        }
+
+      Primitive primitive;
+      primitive.attributeCount = 0;
+      primitive.vertexCount = Unused;
+      primitive.indexData = 0;
+      primitive.indexType = IndexGeometry::Unsigned16;
+      primitive.indexCount = 0;
+      primitive.material = json.integer(json.member(primitives[p], "material"), NoIndex);
+
+      const xsize attributes = json.member(primitives[p], "attributes");
+      const Accessor *position = 0;
+      for(xsize a = json.firstChild(attributes); a != Unused; a = json.next(a))
+        {
+        const ShaderVertexLayoutDescription::Semantic semantic = semanticFor(json.value(a));
+        const xsize accessorIndex = json.integer(a, Unused);
+        const Accessor &accessor = findAccessor(accessors, accessorIndex);
+        const ShaderVertexLayoutDescription::Format format = formatFor(accessor);
+        if(semantic == ShaderVertexLayoutDescription::InvalidSemantic ||
+           format == ShaderVertexLayoutDescription::FormatCount ||
+           primitive.attributeCount == MaxAttributes)
+          {
+          continue;
+          }
+
+        if(primitive.vertexCount != Unused && primitive.vertexCount != accessor.count)
+          {
+          throw Eks::ParseException(X_PARSE_ERROR(Eks::StringBuilder() << "glTF mesh " << m << " has attributes of different lengths"));
+          }
+        primitive.vertexCount = accessor.count;
+
+        Attribute &attribute = primitive.attributes[primitive.attributeCount++];
+        attribute.semantic = semantic;
+        attribute.format = format;
+        attribute.data = accessor.data;
+        attribute.stride = accessor.stride;
+        attribute.count = accessor.count;
+
+        if(semantic == ShaderVertexLayoutDescription::Position)
+          {
+          position = &accessor;
+          }
+        }
+
+      if(!position || position->componentType != Float || position->components != 3)
+        {
+        throw Eks::ParseException(X_PARSE_ERROR(Eks::StringBuilder() << "glTF mesh " << m << " has no float positions"));
+        }
+
+      // Files should give position bounds, but not all do.
+      primitive.bounds = position->bounds;
+      if(!position->hasBounds)
+        {
+        primitive.bounds = BoundingBox();
+        for(xsize v = 0; v < position->count; ++v)
+          {
+          float p[3];
+          memcpy(p, position->data + v * position->stride, sizeof(p));
+          primitive.bounds.unite(Vector3D(p[0], p[1], p[2]));
+          }
+        }
+
+      const xsize indices = json.integer(json.member(primitives[p], "indices"), Unused);
+      if(indices != Unused)
+        {
+        const Accessor &accessor = findAccessor(accessors, indices);
+        if(accessor.components != 1 || accessor.stride != accessor.elementSize)
+          {
+          throw Eks::ParseException(X_PARSE_ERROR(Eks::StringBuilder() << "glTF mesh " << m << " has invalid indices"));
+          }
+
+        primitive.indexData = accessor.data;
+        primitive.indexCount = accessor.count;
+        switch(accessor.componentType)
+          {
+        case UnsignedByte:
+          primitive.indexType = IndexGeometry::Unsigned8;
+          checkIndices<xuint8>(accessor.data, accessor.count, primitive.vertexCount);
+          break;
+        case UnsignedShort:
+          primitive.indexType = IndexGeometry::Unsigned16;
+          checkIndices<xuint16>(accessor.data, accessor.count, primitive.vertexCount);
+          break;
+        case UnsignedInt:
+          primitive.indexType = IndexGeometry::Unsigned32;
+          checkIndices<xuint32>(accessor.data, accessor.count, primitive.vertexCount);
+          break;
+        default:
+          throw Eks::ParseException(X_PARSE_ERROR(Eks::StringBuilder() << "glTF mesh " << m << " has invalid indices"));
+          }
+        }
+
+      _primitives << primitive;
+      }
+
+    mesh.primitiveCount = _primitives.size() - mesh.firstPrimitive;
+    _meshes << mesh;
+    }
+
+  json.elements(json.member(root, "nodes"), &items);
+  for(xsize n = 0; n < items.size(); ++n)
+    {
+    Node node;
+    node.name = json.string(json.member(items[n], "name"), _allocator);
+    node.mesh = json.integer(json.member(items[n], "mesh"), NoIndex);
+    node.parent = NoIndex;
+    node.local = readTransform(json, items[n], values);
+    node.world = node.local;
+    if(node.mesh != NoIndex && node.mesh >= _meshes.size())
+      {
+      throw Eks::ParseException(X_PARSE_ERROR(Eks::StringBuilder() << "glTF node " << n << " has an invalid mesh"));
+      }
+    _nodes << node;
+    }
+
+  for(xsize n = 0; n < items.size(); ++n)
+    {
+    json.elements(json.member(items[n], "children"), &values);
+    for(xsize c = 0; c < values.size(); ++c)
+      {
+      const xsize child = json.integer(values[c], NoIndex);
+      if(child >= _nodes.size() || child == n || _nodes[child].parent != NoIndex)
+        {
+        throw Eks::ParseException(X_PARSE_ERROR(Eks::StringBuilder() << "glTF node " << n << " has an invalid child"));
+        }
+      _nodes[child].parent = n;
+      }
+    }
+
+  // Walk each node's parents, which can't take more steps than there are nodes unless the
+  // hierarchy has a cycle.
+  for(xsize n = 0; n < _nodes.size(); ++n)
+    {
+    Transform world = _nodes[n].local;
+    xsize steps = 0;
+    for(xsize parent = _nodes[n].parent; parent != NoIndex; parent = _nodes[parent].parent)
+      {
+      if(++steps > _nodes.size())
+        {
+        throw Eks::ParseException(X_PARSE_ERROR(Eks::StringBuilder() << "glTF node hierarchy has a cycle"));
+        }
+      world = _nodes[parent].local * world;
+      }
+    _nodes[n].world = world;
+    }
+
+  return true;
+  }
+
+bool GltfLoader::isInterleaved(const Primitive &primitive, const xuint8 **vertexData, xsize *vertexSize)
+  {
+  if(!primitive.attributeCount)
+    {
+    return false;
+    }
+
+  const xsize stride = primitive.attributes[0].stride;
+  const xuint8 *base = primitive.attributes[0].data;
+  for(xsize i = 1; i < primitive.attributeCount; ++i)
+    {
+    base = std::min(base, primitive.attributes[i].data);
+    if(primitive.attributes[i].stride != stride)
+      {
+      return false;
+      }
+    }
+
+  // Every attribute must fit in the stride, and fill it, or uploading stride * count bytes
+  // could read past the end of the buffer view.
+  xsize used = 0;
+  for(xsize i = 0; i < primitive.attributeCount; ++i)
+    {
+    const Attribute &attribute = primitive.attributes[i];
+    const xsize end = (attribute.data - base) + ShaderVertexLayoutDescription::formatSize(attribute.format);
+    if(end > stride)
+      {
+      return false;
+      }
+    used = std::max(used, end);
+    }
+
+  if(used != stride)
+    {
+    return false;
+    }
+
+  *vertexData = base;
+  *vertexSize = stride;
+  return true;
+  }
+
+xsize GltfLoader::layoutDescriptions(const Primitive &primitive, ShaderVertexLayoutDescription *descs, xsize count)
+  {
+  const xuint8 *base = 0;
+  xsize stride = 0;
+  const bool interleaved = isInterleaved(primitive, &base, &stride);
+
+  xsize offset = 0;
+  for(xsize i = 0; i < primitive.attributeCount && i < count; ++i)
+    {
+    const Attribute &attribute = primitive.attributes[i];
+    descs[i] = ShaderVertexLayoutDescription(attribute.semantic, attribute.format, interleaved ? attribute.data - base : offset);
+    offset += ShaderVertexLayoutDescription::formatSize(attribute.format);
+    }
+
+  return primitive.attributeCount;
+  }
+
+bool GltfLoader::createGeometry(const Primitive &primitive, Renderer *r, Geometry *geo) const
+  {
+  xAssert(geo);
+
+  const xuint8 *vertexData = 0;
+  xsize vertexSize = 0;
+  if(isInterleaved(primitive, &vertexData, &vertexSize))
+    {
+    return Geometry::delayedCreate(*geo, r, vertexData, vertexSize, primitive.vertexCount);
+    }
+
+  for(xsize i = 0; i < primitive.attributeCount; ++i)
+    {
+    vertexSize += ShaderVertexLayoutDescription::formatSize(primitive.attributes[i].format);
+    }
+
+  Vector<xuint8> interleaved(_allocator);
+  interleaved.resize(vertexSize * primitive.vertexCount, 0);
+
+  xsize offset = 0;
+  for(xsize i = 0; i < primitive.attributeCount; ++i)
+    {
+    const Attribute &attribute = primitive.attributes[i];
+    const xsize size = ShaderVertexLayoutDescription::formatSize(attribute.format);
+    for(xsize v = 0; v < primitive.vertexCount; ++v)
+      {
+      memcpy(interleaved.data() + v * vertexSize + offset, attribute.data + v * attribute.stride, size);
+      }
+    offset += size;
+    }
+
+  return Geometry::delayedCreate(*geo, r, interleaved.data(), vertexSize, primitive.vertexCount);
+  }
+
+bool GltfLoader::createIndexGeometry(const Primitive &primitive, Renderer *r, IndexGeometry *indexGeo)
+  {
+  xAssert(indexGeo);
+  if(!primitive.indexData)
+    {
+    return false;
+    }
+
+  if(primitive.indexType == IndexGeometry::Unsigned8)
+    {
+    // D3D11 has no 8 bit indices, so they are widened to 16 bits on upload.
+    const xuint8 *indices = primitive.indexData;
+    const xsize indexCount = primitive.indexCount;
+    auto widen = [indices, indexCount](void *data)
+      {
+      std::copy(indices, indices + indexCount, (xuint16 *)data);
+      };
+    return IndexGeometry::delayedCreateWith(*indexGeo, r, IndexGeometry::Unsigned16, indexCount, widen);
+    }
+
+  return IndexGeometry::delayedCreate(*indexGeo, r, primitive.indexType, primitive.indexData, primitive.indexCount);
+  }
+
+}
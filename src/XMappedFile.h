@@ -0,0 +1,39 @@
+#ifndef XMAPPEDFILE_H
+#define XMAPPEDFILE_H
+
+#include "X3DGlobal.h"
+#include "QFile"
+
+namespace Eks
+{
+
+// Call [fn] with the contents of the file at [path], memory mapped where possible, and
+// return its result, or false if the file can't be opened. Shared by the mesh loaders.
+template <typename Fn> bool withMappedFile(const char *path, const Fn &fn)
+  {
+  QFile file(QString::fromUtf8(path));
+  if(!file.open(QFile::ReadOnly))
+    {
+    return false;
+    }
+
+  const xsize size = (xsize)file.size();
+  if(size == 0)
+    {
+    return fn((const char *)0, (xsize)0);
+    }
+
+  // The mapping is released when [file] closes, including when fn throws.
+  const uchar *mapped = file.map(0, size);
+  if(!mapped)
+    {
+    QByteArray contents = file.readAll();
+    return fn(contents.constData(), (xsize)contents.size());
+    }
+
+  return fn((const char *)mapped, size);
+  }
+
+}
+
+#endif // XMAPPEDFILE_H
@@ -0,0 +1,497 @@
+#include "XMeshOptimiser.h"
+#include <algorithm>
+#include <cmath>
+
+namespace Eks
+{
+
+namespace
+{
+
+const xuint32 Unused = 0xffffffff;
+
+const Real CacheDecayPower = 1.5f;
+const Real LastTriangleScore = 0.75f;
+const Real ValenceBoostScale = 2.0f;
+const Real ValenceBoostPower = 0.5f;
+
+Real vertexScore(xint32 cachePosition, xuint32 activeTriangles)
+  {
+  if(activeTriangles == 0)
+    {
+    // No triangles need this vertex.
+    return -1.0f;
+    }
+
+  Real score = 0.0f;
+  if(cachePosition >= 0)
+    {
+    if(cachePosition < 3)
+      {
+      // Used by the last triangle, so a fixed score regardless of position, to avoid
+      // favouring one of its edges.
+      score = LastTriangleScore;
+      }
+    else
+      {
+      const Real scaler = 1.0f / (MeshOptimiser::ScoringCacheSize - 3);
+      score = std::pow(1.0f - (cachePosition - 3) * scaler, CacheDecayPower);
+      }
+    }
+
+  // Boost vertices with few triangles left, to finish them off and avoid stray triangles.
+  score += ValenceBoostScale * std::pow((Real)activeTriangles, -ValenceBoostPower);
+  return score;
+  }
+
+const float *position(const float *positions, xsize stride, xuint32 vertex)
+  {
+  return (const float *)((const xuint8 *)positions + vertex * stride);
+  }
+
+// Simulate a FIFO cache using per vertex timestamps, a vertex is cached if fewer than
+// [cacheSize] misses happened since it was last loaded. Returns the misses for a triangle.
+xuint32 simulateTriangle(const xuint32 *tri, Vector<xuint32> &timestamps, xuint32 &time, xsize cacheSize)
+  {
+  xuint32 misses = 0;
+  for(xsize c = 0; c < 3; ++c)
+    {
+    const xuint32 v = tri[c];
+    if(time - timestamps[v] > cacheSize)
+      {
+      timestamps[v] = time++;
+      ++misses;
+      }
+    }
+  return misses;
+  }
+
+}
+
+MeshOptimiser::MeshOptimiser(AllocatorBase *allocator)
+    : _allocator(allocator)
+  {
+  }
+
+void MeshOptimiser::optimiseVertexCache(xuint32 *indices, xsize indexCount, xsize vertexCount)
+  {
+  xAssert((indexCount % 3) == 0);
+  const xsize triCount = indexCount / 3;
+  if(triCount < 2)
+    {
+    return;
+    }
+
+  // Triangles using each vertex, the first [active] of each run are not yet emitted.
+  Vector<xuint32> offsets(_allocator);
+  Vector<xuint32> active(_allocator);
+  offsets.resize(vertexCount + 1, 0);
+  active.resize(vertexCount, 0);
+  for(xsize i = 0; i < indexCount; ++i)
+    {
+    xAssert(indices[i] < vertexCount);
+    ++active[indices[i]];
+    }
+  for(xsize v = 0; v < vertexCount; ++v)
+    {
+    offsets[v + 1] = offsets[v] + active[v];
+    }
+
+  Vector<xuint32> adjacency(_allocator);
+  adjacency.resize(indexCount, 0);
+  Vector<xuint32> fill(_allocator);
+  fill.resizeAndCopy(vertexCount, offsets.data());
+  for(xsize i = 0; i < indexCount; ++i)
+    {
+    adjacency[fill[indices[i]]++] = (xuint32)(i / 3);
+    }
+
+  Vector<xint32> cachePositions(_allocator);
+  Vector<Real> vertexScores(_allocator);
+  cachePositions.resize(vertexCount, -1);
+  vertexScores.resize(vertexCount, 0.0f);
+  for(xsize v = 0; v < vertexCount; ++v)
+    {
+    vertexScores[v] = vertexScore(-1, active[v]);
+    }
+
+  Vector<Real> triangleScores(_allocator);
+  Vector<xuint8> emitted(_allocator);
+  triangleScores.resize(triCount, 0.0f);
+  emitted.resize(triCount, 0);
+
+  xuint32 best = Unused;
+  Real bestScore = -1.0f;
+  for(xsize t = 0; t < triCount; ++t)
+    {
+    const xuint32 *tri = indices + t * 3;
+    const Real score = vertexScores[tri[0]] + vertexScores[tri[1]] + vertexScores[tri[2]];
+    triangleScores[t] = score;
+    if(score > bestScore)
+      {
+      bestScore = score;
+      best = (xuint32)t;
+      }
+    }
+
+  Vector<xuint32> output(_allocator);
+  output.resize(indexCount, 0);
+
+  xuint32 cache[ScoringCacheSize + 3];
+  xuint32 newCache[ScoringCacheSize + 3];
+  xsize cacheCount = 0;
+  xsize inputCursor = 0;
+
+  for(xsize out = 0; out < triCount; ++out)
+    {
+    // Nothing in the cache has triangles left, continue from the input order.
+    if(best == Unused)
+      {
+      while(emitted[inputCursor])
+        {
+        ++inputCursor;
+        }
+      best = (xuint32)inputCursor;
+      }
+
+    const xuint32 *tri = indices + best * 3;
+    output[out * 3 + 0] = tri[0];
+    output[out * 3 + 1] = tri[1];
+    output[out * 3 + 2] = tri[2];
+    emitted[best] = 1;
+
+    for(xsize c = 0; c < 3; ++c)
+      {
+      const xuint32 v = tri[c];
+      xuint32 *tris = adjacency.data() + offsets[v];
+      const xuint32 count = active[v];
+      for(xuint32 i = 0; i < count; ++i)
+        {
+        if(tris[i] == best)
+          {
+          std::swap(tris[i], tris[count - 1]);
+          break;
+          }
+        }
+      --active[v];
+      }
+
+    // The emitted triangle's vertices move to the front, then the rest of the old cache.
+    xsize newCount = 0;
+    newCache[newCount++] = tri[0];
+    newCache[newCount++] = tri[1];
+    newCache[newCount++] = tri[2];
+    for(xsize i = 0; i < cacheCount; ++i)
+      {
+      const xuint32 v = cache[i];
+      if(v != tri[0] && v != tri[1] && v != tri[2])
+        {
+        newCache[newCount++] = v;
+        }
+      }
+
+    for(xsize i = 0; i < newCount; ++i)
+      {
+      const xuint32 v = newCache[i];
+      cachePositions[v] = i < ScoringCacheSize ? (xint32)i : -1;
+      vertexScores[v] = vertexScore(cachePositions[v], active[v]);
+      }
+
+    best = Unused;
+    bestScore = -1.0f;
+    for(xsize i = 0; i < newCount; ++i)
+      {
+      const xuint32 v = newCache[i];
+      const xuint32 *tris = adjacency.data() + offsets[v];
+      for(xuint32 a = 0; a < active[v]; ++a)
+        {
+        const xuint32 t = tris[a];
+        const xuint32 *other = indices + t * 3;
+        const Real score = vertexScores[other[0]] + vertexScores[other[1]] + vertexScores[other[2]];
+        triangleScores[t] = score;
+        if(score > bestScore)
+          {
+          bestScore = score;
+          best = t;
+          }
+        }
+      }
+
+    cacheCount = std::min(newCount, (xsize)ScoringCacheSize);
+    for(xsize i = 0; i < cacheCount; ++i)
+      {
+      cache[i] = newCache[i];
+      }
+    }
+
+  std::copy(output.data(), output.data() + indexCount, indices);
+  }
+
+void MeshOptimiser::optimiseOverdraw(
+    xuint32 *indices,
+    xsize indexCount,
+    const float *positions,
+    xsize positionStride,
+    xsize vertexCount,
+    Real threshold)
+  {
+  xAssert((indexCount % 3) == 0);
+  const xsize triCount = indexCount / 3;
+  if(triCount < 2)
+    {
+    return;
+    }
+
+  // Hard boundaries are where the cache was flushed, every vertex of a triangle missed.
+  Vector<xuint32> timestamps(_allocator);
+  timestamps.resize(vertexCount, 0);
+  xuint32 time = DefaultCacheSize + 1;
+
+  Vector<xuint8> misses(_allocator);
+  misses.resize(triCount, 0);
+  Vector<xuint32> hardBoundaries(_allocator);
+  for(xsize t = 0; t < triCount; ++t)
+    {
+    misses[t] = (xuint8)simulateTriangle(indices + t * 3, timestamps, time, DefaultCacheSize);
+    if(t == 0 || misses[t] == 3)
+      {
+      hardBoundaries << (xuint32)t;
+      }
+    }
+  hardBoundaries << (xuint32)triCount;
+
+  // Soft boundaries split each hard cluster wherever the misses so far, counted from a
+  // flushed cache, are within threshold of the whole hard cluster's ratio. Clusters may
+  // then be drawn in any order, and the cache efficiency stays within the threshold.
+  Vector<xuint32> clusters(_allocator);
+  for(xsize h = 0; h + 1 < hardBoundaries.size(); ++h)
+    {
+    const xuint32 begin = hardBoundaries[h];
+    const xuint32 end = hardBoundaries[h + 1];
+
+    xuint32 clusterMisses = 0;
+    for(xuint32 t = begin; t < end; ++t)
+      {
+      clusterMisses += misses[t];
+      }
+    const Real limit = threshold * (Real)clusterMisses / (Real)(end - begin);
+
+    xuint32 start = begin;
+    xuint32 running = 0;
+    time += DefaultCacheSize + 1;
+    clusters << start;
+    for(xuint32 t = begin; t < end; ++t)
+      {
+      running += simulateTriangle(indices + t * 3, timestamps, time, DefaultCacheSize);
+      if(t + 1 < end && (Real)running / (Real)(t + 1 - start) <= limit)
+        {
+        start = t + 1;
+        running = 0;
+        time += DefaultCacheSize + 1;
+        clusters << start;
+        }
+      }
+    }
+  const xsize clusterCount = clusters.size();
+  clusters << (xuint32)triCount;
+
+  // Sort clusters by how far they face out from the mesh centre, so occluders draw first.
+  Vector<Vector3D> centroids(_allocator);
+  Vector<Vector3D> normals(_allocator);
+  centroids.resize(clusterCount, Vector3D::Zero());
+  normals.resize(clusterCount, Vector3D::Zero());
+
+  Vector3D meshCentroid = Vector3D::Zero();
+  Real meshArea = 0.0f;
+  for(xsize c = 0; c < clusterCount; ++c)
+    {
+    Vector3D centroid = Vector3D::Zero();
+    Vector3D normal = Vector3D::Zero();
+    Real area = 0.0f;
+    for(xuint32 t = clusters[c]; t < clusters[c + 1]; ++t)
+      {
+      const xuint32 *tri = indices + t * 3;
+      const float *p0 = position(positions, positionStride, tri[0]);
+      const float *p1 = position(positions, positionStride, tri[1]);
+      const float *p2 = position(positions, positionStride, tri[2]);
+      const Vector3D a(p0[0], p0[1], p0[2]);
+      const Vector3D b(p1[0], p1[1], p1[2]);
+      const Vector3D c2(p2[0], p2[1], p2[2]);
+
+      const Vector3D n = (b - a).cross(c2 - a);
+      const Real triArea = n.norm();
+      centroid += (a + b + c2) * (triArea / 3.0f);
+      normal += n;
+      area += triArea;
+      }
+
+    if(area > 0)
+      {
+      centroids[c] = centroid / area;
+      }
+    normals[c] = normal.normalized();
+    meshCentroid += centroid;
+    meshArea += area;
+    }
+
+  if(meshArea > 0)
+    {
+    meshCentroid /= meshArea;
+    }
+
+  Vector<Real> keys(_allocator);
+  Vector<xuint32> order(_allocator);
+  keys.resize(clusterCount, 0.0f);
+  order.resize(clusterCount, 0);
+  for(xsize c = 0; c < clusterCount; ++c)
+    {
+    keys[c] = (centroids[c] - meshCentroid).dot(normals[c]);
+    order[c] = (xuint32)c;
+    }
+
+  std::stable_sort(order.data(), order.data() + clusterCount, [&keys](xuint32 a, xuint32 b)
+    {
+    return keys[a] > keys[b];
+    });
+
+  Vector<xuint32> output(_allocator);
+  output.reserve(indexCount);
+  for(xsize i = 0; i < clusterCount; ++i)
+    {
+    const xuint32 c = order[i];
+    for(xuint32 t = clusters[c]; t < clusters[c + 1]; ++t)
+      {
+      output << indices[t * 3 + 0] << indices[t * 3 + 1] << indices[t * 3 + 2];
+      }
+    }
+
+  std::copy(output.data(), output.data() + indexCount, indices);
+  }
+
+xsize MeshOptimiser::optimiseVertexFetch(
+    xuint32 *indices,
+    xsize indexCount,
+    xuint8 *vertexData,
+    xsize vertexCount,
+    xsize vertexSize)
+  {
+  Vector<xuint32> remap(_allocator);
+  remap.resize(vertexCount, 0);
+  const xsize used = buildFetchRemap(indices, indexCount, vertexCount, remap.data());
+
+  if(vertexData)
+    {
+    Vector<xuint8> reordered(_allocator);
+    reordered.resize(vertexCount * vertexSize);
+    for(xsize v = 0; v < vertexCount; ++v)
+      {
+      memcpy(reordered.data() + remap[v] * vertexSize, vertexData + v * vertexSize, vertexSize);
+      }
+    memcpy(vertexData, reordered.data(), vertexCount * vertexSize);
+    }
+
+  for(xsize i = 0; i < indexCount; ++i)
+    {
+    indices[i] = remap[indices[i]];
+    }
+
+  return used;
+  }
+
+xsize MeshOptimiser::optimise(
+    xuint32 *indices,
+    xsize indexCount,
+    xuint8 *vertexData,
+    xsize vertexCount,
+    xsize vertexSize,
+    xsize positionOffset,
+    Statistics *before,
+    Statistics *after)
+  {
+  if(before)
+    {
+    *before = analyseVertexCache(indices, indexCount, vertexCount);
+    }
+
+  optimiseVertexCache(indices, indexCount, vertexCount);
+  optimiseOverdraw(indices, indexCount, (const float *)(vertexData + positionOffset), vertexSize, vertexCount);
+  const xsize used = optimiseVertexFetch(indices, indexCount, vertexData, vertexCount, vertexSize);
+
+  if(after)
+    {
+    *after = analyseVertexCache(indices, indexCount, vertexCount);
+    }
+
+  return used;
+  }
+
+MeshOptimiser::Statistics MeshOptimiser::analyseVertexCache(
+    const xuint32 *indices,
+    xsize indexCount,
+    xsize vertexCount,
+    xsize cacheSize)
+  {
+  Vector<xuint32> timestamps(_allocator);
+  timestamps.resize(vertexCount, 0);
+  xuint32 time = (xuint32)cacheSize + 1;
+
+  Vector<xuint8> used(_allocator);
+  used.resize(vertexCount, 0);
+  xsize usedCount = 0;
+
+  Statistics stats;
+  stats.transformedVertices = 0;
+  for(xsize i = 0; i + 3 <= indexCount; i += 3)
+    {
+    stats.transformedVertices += simulateTriangle(indices + i, timestamps, time, cacheSize);
+    for(xsize c = 0; c < 3; ++c)
+      {
+      if(!used[indices[i + c]])
+        {
+        used[indices[i + c]] = 1;
+        ++usedCount;
+        }
+      }
+    }
+
+  const xsize triCount = indexCount / 3;
+  stats.acmr = triCount ? (Real)stats.transformedVertices / triCount : 0.0f;
+  stats.atvr = usedCount ? (Real)stats.transformedVertices / usedCount : 0.0f;
+  return stats;
+  }
+
+xsize MeshOptimiser::buildFetchRemap(
+    const xuint32 *indices,
+    xsize indexCount,
+    xsize vertexCount,
+    xuint32 *remap)
+  {
+  for(xsize v = 0; v < vertexCount; ++v)
+    {
+    remap[v] = Unused;
+    }
+
+  xuint32 next = 0;
+  for(xsize i = 0; i < indexCount; ++i)
+    {
+    const xuint32 v = indices[i];
+    xAssert(v < vertexCount);
+    if(remap[v] == Unused)
+      {
+      remap[v] = next++;
+      }
+    }
+
+  const xsize used = next;
+  for(xsize v = 0; v < vertexCount; ++v)
+    {
+    if(remap[v] == Unused)
+      {
+      remap[v] = next++;
+      }
+    }
+
+  return used;
+  }
+
+}
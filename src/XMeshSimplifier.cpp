@@ -0,0 +1,721 @@
+#include "XMeshSimplifier.h"
+#include "XMeshOptimiser.h"
+#include "XNormalGenerator.h"
+#include "XParallel.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace Eks
+{
+
+namespace
+{
+
+enum VertexKind
+  {
+  Manifold,
+  Border,
+  Seam,
+  Locked
+  };
+
+const xuint32 Unused = 0xffffffff;
+
+// Open edges are weighted up so borders and seams keep their shape.
+const Real EdgeWeight = 10.0f;
+
+// A triangle whose normal turns further than this cosine in a collapse is flipping.
+const Real MinimumNormalCosine = 0.25f;
+
+struct Quadric
+  {
+  Quadric()
+    {
+    memset(this, 0, sizeof(*this));
+    }
+
+  // The squared distance to the plane through [point] with unit [normal], times [weight].
+  Quadric(const Vector3D &normal, const Vector3D &point, Real weight)
+    {
+    const Real d = -normal.dot(point);
+    a00 = normal.x() * normal.x() * weight;
+    a11 = normal.y() * normal.y() * weight;
+    a22 = normal.z() * normal.z() * weight;
+    a10 = normal.y() * normal.x() * weight;
+    a20 = normal.z() * normal.x() * weight;
+    a21 = normal.z() * normal.y() * weight;
+    b0 = normal.x() * d * weight;
+    b1 = normal.y() * d * weight;
+    b2 = normal.z() * d * weight;
+    c = d * d * weight;
+    w = weight;
+    }
+
+  Quadric &operator+=(const Quadric &o)
+    {
+    a00 += o.a00; a11 += o.a11; a22 += o.a22;
+    a10 += o.a10; a20 += o.a20; a21 += o.a21;
+    b0 += o.b0; b1 += o.b1; b2 += o.b2;
+    c += o.c;
+    w += o.w;
+    return *this;
+    }
+
+  // The weighted mean squared distance of [p] to the accumulated planes.
+  Real error(const Vector3D &p) const
+    {
+    const Real x = p.x();
+    const Real y = p.y();
+    const Real z = p.z();
+
+    const Real rx = a00 * x + a10 * y + a20 * z + b0;
+    const Real ry = a10 * x + a11 * y + a21 * z + b1;
+    const Real rz = a20 * x + a21 * y + a22 * z + b2;
+    const Real result = rx * x + ry * y + rz * z + b0 * x + b1 * y + b2 * z + c;
+
+    return w > 0 ? std::max((Real)0, result) / w : 0;
+    }
+
+  Real a00, a11, a22;
+  Real a10, a20, a21;
+  Real b0, b1, b2;
+  Real c;
+  Real w;
+  };
+
+struct Collapse
+  {
+  xuint32 from;
+  xuint32 to;
+  Real error;
+  };
+
+// The triangles using each vertex, rebuilt from the current indices.
+struct Adjacency
+  {
+  Adjacency(AllocatorBase *allocator) : offsets(allocator), counts(allocator), triangles(allocator)
+    {
+    }
+
+  void build(const xuint32 *indices, xsize indexCount, xsize vertexCount)
+    {
+    counts.clear();
+    counts.resize(vertexCount, 0);
+    offsets.resize(vertexCount + 1, 0);
+    for(xsize i = 0; i < indexCount; ++i)
+      {
+      ++counts[indices[i]];
+      }
+
+    offsets[0] = 0;
+    for(xsize v = 0; v < vertexCount; ++v)
+      {
+      offsets[v + 1] = offsets[v] + counts[v];
+      counts[v] = 0;
+      }
+
+    triangles.resize(indexCount, 0);
+    for(xsize i = 0; i < indexCount; ++i)
+      {
+      const xuint32 v = indices[i];
+      triangles[offsets[v] + counts[v]++] = (xuint32)(i / 3);
+      }
+    }
+
+  // True if a triangle has the directed edge [a] to [b].
+  bool hasEdge(const xuint32 *indices, xuint32 a, xuint32 b) const
+    {
+    for(xuint32 i = offsets[a]; i < offsets[a] + counts[a]; ++i)
+      {
+      const xuint32 *tri = indices + triangles[i] * 3;
+      for(xsize c = 0; c < 3; ++c)
+        {
+        if(tri[c] == a && tri[(c + 1) % 3] == b)
+          {
+          return true;
+          }
+        }
+      }
+    return false;
+    }
+
+  Vector<xuint32> offsets;
+  Vector<xuint32> counts;
+  Vector<xuint32> triangles;
+  };
+
+class Simplification
+  {
+public:
+  Simplification(AllocatorBase *allocator)
+      : _allocator(allocator),
+        _positions(allocator),
+        _remap(allocator),
+        _wedge(allocator),
+        _kind(allocator),
+        _openOut(allocator),
+        _openIn(allocator),
+        _quadrics(allocator),
+        _adjacency(allocator)
+    {
+    }
+
+  void setup(const xuint32 *indices, xsize indexCount, const float *positions, xsize positionStride, xsize vertexCount);
+  xsize run(xuint32 *indices, xsize indexCount, xsize targetIndexCount, Real targetError, Real *resultError);
+
+private:
+  bool findSeamTarget(xuint32 from, xuint32 to, xuint32 *sibling, xuint32 *siblingTarget) const;
+  bool canCollapse(xuint32 from, xuint32 to) const;
+  bool flips(const xuint32 *indices, xuint32 from, xuint32 to) const;
+  void lockNeighbours(const xuint32 *indices, xuint32 vertex, Vector<xuint8> *locked) const;
+  void classify(const xuint32 *indices, xsize indexCount);
+  void computeQuadrics(const xuint32 *indices, xsize indexCount);
+
+  AllocatorBase *_allocator;
+
+  // Positions normalised into the unit cube, so errors are relative to the mesh size.
+  Vector<Vector3D> _positions;
+  // The first vertex sharing each vertex's position.
+  Vector<xuint32> _remap;
+  // The next vertex sharing each vertex's position, as a loop.
+  Vector<xuint32> _wedge;
+  Vector<xuint8> _kind;
+  // The vertices at the other end of each vertex's open edges, for borders and seams.
+  Vector<xuint32> _openOut;
+  Vector<xuint32> _openIn;
+  // One quadric per position, indexed by _remap.
+  Vector<Quadric> _quadrics;
+  Adjacency _adjacency;
+  };
+
+void Simplification::setup(const xuint32 *indices, xsize indexCount, const float *positions, xsize positionStride, xsize vertexCount)
+  {
+  _positions.resize(vertexCount, Vector3D::Zero());
+  Vector3D minimum = Vector3D::Constant(std::numeric_limits<Real>::max());
+  Vector3D maximum = -minimum;
+  for(xsize v = 0; v < vertexCount; ++v)
+    {
+    const float *p = (const float *)((const xuint8 *)positions + v * positionStride);
+    _positions[v] = Vector3D(p[0], p[1], p[2]);
+    minimum = minimum.cwiseMin(_positions[v]);
+    maximum = maximum.cwiseMax(_positions[v]);
+    }
+
+  NormalGenerator::weldPositions(_positions.data(), vertexCount, &_remap);
+
+  const Real extent = vertexCount ? (maximum - minimum).maxCoeff() : 0;
+  const Real scale = extent > 0 ? 1.0f / extent : 1.0f;
+  for(xsize v = 0; v < vertexCount; ++v)
+    {
+    _positions[v] = (_positions[v] - minimum) * scale;
+    }
+
+  _wedge.resize(vertexCount, 0);
+  for(xsize v = 0; v < vertexCount; ++v)
+    {
+    const xuint32 first = _remap[v];
+    if(first == v)
+      {
+      _wedge[v] = (xuint32)v;
+      }
+    else
+      {
+      _wedge[v] = _wedge[first];
+      _wedge[first] = (xuint32)v;
+      }
+    }
+
+  _adjacency.build(indices, indexCount, vertexCount);
+  classify(indices, indexCount);
+  computeQuadrics(indices, indexCount);
+  }
+
+void Simplification::classify(const xuint32 *indices, xsize indexCount)
+  {
+  const xsize vertexCount = _positions.size();
+
+  Vector<xuint8> openOutCount(_allocator);
+  Vector<xuint8> openInCount(_allocator);
+  Vector<xuint8> borderEdges(_allocator);
+  openOutCount.resize(vertexCount, 0);
+  openInCount.resize(vertexCount, 0);
+  borderEdges.resize(vertexCount, 0);
+  _openOut.resize(vertexCount, Unused);
+  _openIn.resize(vertexCount, Unused);
+
+  for(xsize i = 0; i < indexCount; ++i)
+    {
+    const xuint32 a = indices[i];
+    const xuint32 b = indices[i - (i % 3) + ((i + 1) % 3)];
+    if(_adjacency.hasEdge(indices, b, a))
+      {
+      continue;
+      }
+
+    _openOut[a] = b;
+    _openIn[b] = a;
+    openOutCount[a] = (xuint8)std::min(openOutCount[a] + 1, 2);
+    openInCount[b] = (xuint8)std::min(openInCount[b] + 1, 2);
+
+    // Without an opposite edge between any vertices at the same positions, this is a border.
+    bool border = true;
+    xuint32 w = b;
+    do
+      {
+      xuint32 o = a;
+      do
+        {
+        border = border && !_adjacency.hasEdge(indices, w, o);
+        o = _wedge[o];
+        } while(o != a);
+      w = _wedge[w];
+      } while(w != b);
+
+    if(border)
+      {
+      borderEdges[a] = 1;
+      borderEdges[b] = 1;
+      }
+    }
+
+  _kind.resize(vertexCount, Locked);
+  for(xsize v = 0; v < vertexCount; ++v)
+    {
+    const bool alone = _wedge[v] == v;
+    const bool pair = !alone && _wedge[_wedge[v]] == v;
+
+    if(alone && !openOutCount[v] && !openInCount[v])
+      {
+      _kind[v] = Manifold;
+      }
+    else if(alone && openOutCount[v] == 1 && openInCount[v] == 1)
+      {
+      _kind[v] = Border;
+      }
+    else if(pair && openOutCount[v] == 1 && openInCount[v] == 1 && !borderEdges[v] &&
+            openOutCount[_wedge[v]] == 1 && openInCount[_wedge[v]] == 1 && !borderEdges[_wedge[v]])
+      {
+      _kind[v] = Seam;
+      }
+    else
+      {
+      _kind[v] = Locked;
+      }
+    }
+  }
+
+void Simplification::computeQuadrics(const xuint32 *indices, xsize indexCount)
+  {
+  _quadrics.resize(_positions.size());
+  for(xsize i = 0; i + 3 <= indexCount; i += 3)
+    {
+    const xuint32 *tri = indices + i;
+    const Vector3D &p0 = _positions[tri[0]];
+    const Vector3D &p1 = _positions[tri[1]];
+    const Vector3D &p2 = _positions[tri[2]];
+
+    const Vector3D cross = (p1 - p0).cross(p2 - p0);
+    const Real area = cross.norm();
+    if(area <= 0)
+      {
+      continue;
+      }
+    const Vector3D normal = cross / area;
+
+    const Quadric plane(normal, p0, area * 0.5f);
+    for(xsize c = 0; c < 3; ++c)
+      {
+      _quadrics[_remap[tri[c]]] += plane;
+      }
+
+    // Open edges add a plane through the edge, perpendicular to the triangle.
+    for(xsize c = 0; c < 3; ++c)
+      {
+      const xuint32 a = tri[c];
+      const xuint32 b = tri[(c + 1) % 3];
+      if(_openOut[a] != b || _kind[a] == Manifold)
+        {
+        continue;
+        }
+
+      const Vector3D edge = _positions[b] - _positions[a];
+      const Real length = edge.norm();
+      if(length <= 0)
+        {
+        continue;
+        }
+
+      const Quadric edgePlane(edge.cross(normal).normalized(), _positions[a], length * length * EdgeWeight);
+      _quadrics[_remap[a]] += edgePlane;
+      _quadrics[_remap[b]] += edgePlane;
+      }
+    }
+  }
+
+bool Simplification::findSeamTarget(xuint32 from, xuint32 to, xuint32 *sibling, xuint32 *siblingTarget) const
+  {
+  *sibling = _wedge[from];
+  const xuint32 outTarget = _openOut[*sibling];
+  const xuint32 inTarget = _openIn[*sibling];
+  if(outTarget != Unused && _remap[outTarget] == _remap[to])
+    {
+    *siblingTarget = outTarget;
+    return true;
+    }
+  if(inTarget != Unused && _remap[inTarget] == _remap[to])
+    {
+    *siblingTarget = inTarget;
+    return true;
+    }
+  return false;
+  }
+
+bool Simplification::canCollapse(xuint32 from, xuint32 to) const
+  {
+  if(_remap[from] == _remap[to])
+    {
+    return false;
+    }
+
+  const xuint8 toKind = _kind[to];
+  switch(_kind[from])
+    {
+  case Manifold:
+    return true;
+  case Border:
+    return (toKind == Border || toKind == Locked) && (_openOut[from] == to || _openIn[from] == to);
+  case Seam:
+    {
+    xuint32 sibling;
+    xuint32 siblingTarget;
+    return (toKind == Seam || toKind == Locked) &&
+      (_openOut[from] == to || _openIn[from] == to) &&
+      findSeamTarget(from, to, &sibling, &siblingTarget);
+    }
+  default:
+    return false;
+    }
+  }
+
+bool Simplification::flips(const xuint32 *indices, xuint32 from, xuint32 to) const
+  {
+  const Vector3D &target = _positions[to];
+  for(xuint32 i = _adjacency.offsets[from]; i < _adjacency.offsets[from] + _adjacency.counts[from]; ++i)
+    {
+    const xuint32 *tri = indices + _adjacency.triangles[i] * 3;
+
+    // Triangles along the collapsed edge disappear.
+    if(_remap[tri[0]] == _remap[to] || _remap[tri[1]] == _remap[to] || _remap[tri[2]] == _remap[to])
+      {
+      continue;
+      }
+
+    Vector3D moved[3];
+    for(xsize c = 0; c < 3; ++c)
+      {
+      moved[c] = tri[c] == from ? target : _positions[tri[c]];
+      }
+
+    const Vector3D before = (_positions[tri[1]] - _positions[tri[0]]).cross(_positions[tri[2]] - _positions[tri[0]]);
+    const Vector3D after = (moved[1] - moved[0]).cross(moved[2] - moved[0]);
+
+    // Collapsing to zero area counts as flipping, as the triangle could flip unchecked later.
+    if(before.dot(after) <= MinimumNormalCosine * before.norm() * after.norm() && before.squaredNorm() > 0)
+      {
+      return true;
+      }
+    }
+  return false;
+  }
+
+void Simplification::lockNeighbours(const xuint32 *indices, xuint32 vertex, Vector<xuint8> *locked) const
+  {
+  for(xuint32 i = _adjacency.offsets[vertex]; i < _adjacency.offsets[vertex] + _adjacency.counts[vertex]; ++i)
+    {
+    const xuint32 *tri = indices + _adjacency.triangles[i] * 3;
+    for(xsize c = 0; c < 3; ++c)
+      {
+      (*locked)[_remap[tri[c]]] = 1;
+      }
+    }
+  }
+
+xsize Simplification::run(xuint32 *indices, xsize indexCount, xsize targetIndexCount, Real targetError, Real *resultError)
+  {
+  const xsize vertexCount = _positions.size();
+  const Real errorLimit = targetError * targetError;
+  Real reachedError = 0;
+
+  Vector<Collapse> candidates(_allocator);
+  Vector<xuint32> collapseTo(_allocator);
+  Vector<xuint8> locked(_allocator);
+
+  while(indexCount > targetIndexCount)
+    {
+    _adjacency.build(indices, indexCount, vertexCount);
+
+    // Each edge is considered in the cheaper valid direction.
+    candidates.clear();
+    for(xsize i = 0; i < indexCount; ++i)
+      {
+      const xuint32 a = indices[i];
+      const xuint32 b = indices[i - (i % 3) + ((i + 1) % 3)];
+      if(a > b && _adjacency.hasEdge(indices, b, a))
+        {
+        continue;
+        }
+
+      const Real error = (Quadric(_quadrics[_remap[a]]) += _quadrics[_remap[b]]).error(_positions[b]);
+      const Real reverseError = (Quadric(_quadrics[_remap[b]]) += _quadrics[_remap[a]]).error(_positions[a]);
+
+      const bool forward = canCollapse(a, b);
+      const bool reverse = canCollapse(b, a);
+      if(forward && (!reverse || error <= reverseError))
+        {
+        Collapse collapse = { a, b, error };
+        candidates << collapse;
+        }
+      else if(reverse)
+        {
+        Collapse collapse = { b, a, reverseError };
+        candidates << collapse;
+        }
+      }
+
+    std::sort(candidates.data(), candidates.data() + candidates.size(), [](const Collapse &a, const Collapse &b)
+      {
+      return a.error < b.error;
+      });
+
+    collapseTo.resize(vertexCount, 0);
+    locked.clear();
+    locked.resize(vertexCount, 0);
+    for(xsize v = 0; v < vertexCount; ++v)
+      {
+      collapseTo[v] = (xuint32)v;
+      }
+
+    // Collapses in one pass must not move the same triangles, their errors and flip checks
+    // assume the neighbourhood is otherwise unchanged.
+    const xsize triangleCount = indexCount / 3;
+    const xsize targetTriangles = targetIndexCount / 3;
+    xsize removed = 0;
+    xsize collapses = 0;
+    for(xsize i = 0; i < candidates.size() && triangleCount - removed > targetTriangles; ++i)
+      {
+      const Collapse &collapse = candidates[i];
+      if(collapse.error > errorLimit)
+        {
+        break;
+        }
+
+      const xuint32 fromPosition = _remap[collapse.from];
+      const xuint32 toPosition = _remap[collapse.to];
+      if(locked[fromPosition] || locked[toPosition])
+        {
+        continue;
+        }
+
+      if(flips(indices, collapse.from, collapse.to))
+        {
+        continue;
+        }
+
+      if(_kind[collapse.from] == Seam)
+        {
+        xuint32 sibling;
+        xuint32 siblingTarget;
+        findSeamTarget(collapse.from, collapse.to, &sibling, &siblingTarget);
+        if(flips(indices, sibling, siblingTarget))
+          {
+          continue;
+          }
+        collapseTo[sibling] = siblingTarget;
+        lockNeighbours(indices, sibling, &locked);
+        }
+
+      collapseTo[collapse.from] = collapse.to;
+      _quadrics[toPosition] += _quadrics[fromPosition];
+      lockNeighbours(indices, collapse.from, &locked);
+      locked[toPosition] = 1;
+
+      removed += _kind[collapse.from] == Border ? 1 : 2;
+      reachedError = std::max(reachedError, collapse.error);
+      ++collapses;
+      }
+
+    if(!collapses)
+      {
+      break;
+      }
+
+    // Remap the corners, dropping triangles that collapsed to a line.
+    xsize written = 0;
+    for(xsize i = 0; i < indexCount; i += 3)
+      {
+      const xuint32 a = collapseTo[indices[i + 0]];
+      const xuint32 b = collapseTo[indices[i + 1]];
+      const xuint32 c = collapseTo[indices[i + 2]];
+      if(_remap[a] == _remap[b] || _remap[b] == _remap[c] || _remap[c] == _remap[a])
+        {
+        continue;
+        }
+
+      indices[written++] = a;
+      indices[written++] = b;
+      indices[written++] = c;
+      }
+    indexCount = written;
+    }
+
+  if(resultError)
+    {
+    *resultError = std::sqrt(reachedError);
+    }
+  return indexCount;
+  }
+
+}
+
+MeshSimplifier::LodChain::LodChain(AllocatorBase *allocator)
+    : indices(allocator),
+      lods(allocator)
+  {
+  }
+
+MeshSimplifier::MeshSimplifier(AllocatorBase *allocator)
+    : _allocator(allocator)
+  {
+  }
+
+xsize MeshSimplifier::simplify(
+    const xuint32 *indices,
+    xsize indexCount,
+    const float *positions,
+    xsize positionStride,
+    xsize vertexCount,
+    xsize targetIndexCount,
+    Real targetError,
+    xuint32 *destination,
+    Real *resultError)
+  {
+  xAssert((indexCount % 3) == 0);
+  std::copy(indices, indices + indexCount, destination);
+
+  if(resultError)
+    {
+    *resultError = 0;
+    }
+  if(indexCount <= targetIndexCount)
+    {
+    return indexCount;
+    }
+
+  Simplification simplification(_allocator);
+  simplification.setup(destination, indexCount, positions, positionStride, vertexCount);
+  return simplification.run(destination, indexCount, targetIndexCount, targetError, resultError);
+  }
+
+void MeshSimplifier::buildLodChain(
+    const Mesh &mesh,
+    const Real *ratios,
+    xsize ratioCount,
+    Real targetError,
+    LodChain *chain)
+  {
+  xAssert(chain);
+  chain->indices.clear();
+  chain->lods.clear();
+
+  const float *positions = (const float *)(mesh.vertexData + mesh.positionOffset);
+  MeshOptimiser optimiser(_allocator);
+
+  chain->indices.resizeAndCopy(mesh.indexCount, mesh.indices);
+  optimiser.optimiseVertexCache(chain->indices.data(), mesh.indexCount, mesh.vertexCount);
+
+  Lod full = { 0, mesh.indexCount, mesh.vertexCount, 0 };
+  chain->lods << full;
+
+  // Each level starts from the full mesh, so errors don't compound through the chain.
+  Vector<xuint32> level(_allocator);
+  level.resize(mesh.indexCount, 0);
+  for(xsize r = 0; r < ratioCount; ++r)
+    {
+    const xsize target = (xsize)(mesh.indexCount / 3 * ratios[r]) * 3;
+
+    Real error = 0;
+    const xsize count = simplify(mesh.indices, mesh.indexCount, positions, mesh.vertexSize, mesh.vertexCount, target, targetError, level.data(), &error);
+    if(count >= chain->lods.back().indexCount)
+      {
+      continue;
+      }
+
+    optimiser.optimiseVertexCache(level.data(), count, mesh.vertexCount);
+
+    Lod lod = { chain->indices.size(), count, mesh.vertexCount, error };
+    for(xsize i = 0; i < count; ++i)
+      {
+      chain->indices << level[i];
+      }
+    chain->lods << lod;
+    }
+
+  // Number vertices in first use order from the coarsest level up, so each level's vertices
+  // are a prefix of the finer ones'.
+  Vector<xuint32> order(_allocator);
+  order.reserve(chain->indices.size());
+  for(xsize l = chain->lods.size(); l > 0; --l)
+    {
+    const Lod &lod = chain->lods[l - 1];
+    for(xsize i = 0; i < lod.indexCount; ++i)
+      {
+      order << chain->indices[lod.firstIndex + i];
+      }
+    }
+
+  Vector<xuint32> remap(_allocator);
+  remap.resize(mesh.vertexCount, 0);
+  MeshOptimiser::buildFetchRemap(order.data(), order.size(), mesh.vertexCount, remap.data());
+
+  Vector<xuint8> reordered(_allocator);
+  reordered.resize(mesh.vertexCount * mesh.vertexSize);
+  for(xsize v = 0; v < mesh.vertexCount; ++v)
+    {
+    memcpy(reordered.data() + remap[v] * mesh.vertexSize, mesh.vertexData + v * mesh.vertexSize, mesh.vertexSize);
+    }
+  memcpy(mesh.vertexData, reordered.data(), mesh.vertexCount * mesh.vertexSize);
+
+  for(xsize l = 0; l < chain->lods.size(); ++l)
+    {
+    Lod &lod = chain->lods[l];
+    xuint32 highest = 0;
+    for(xsize i = lod.firstIndex; i < lod.firstIndex + lod.indexCount; ++i)
+      {
+      chain->indices[i] = remap[chain->indices[i]];
+      highest = std::max(highest, chain->indices[i] + 1);
+      }
+    lod.vertexCount = l == 0 ? mesh.vertexCount : highest;
+    }
+  }
+
+void MeshSimplifier::buildLodChains(
+    AllocatorBase *allocator,
+    const Mesh *meshes,
+    xsize meshCount,
+    const Real *ratios,
+    xsize ratioCount,
+    Real targetError,
+    LodChain *chains)
+  {
+  ParallelUtilities::forRanges(meshCount, 1, [&](xsize, xsize begin, xsize end)
+    {
+    MeshSimplifier simplifier(allocator);
+    for(xsize i = begin; i < end; ++i)
+      {
+      simplifier.buildLodChain(meshes[i], ratios, ratioCount, targetError, &chains[i]);
+      }
+    });
+  }
+
+}
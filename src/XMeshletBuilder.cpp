@@ -0,0 +1,273 @@
+#include "XMeshletBuilder.h"
+#include "XFrustum.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace Eks
+{
+
+namespace
+{
+
+const xuint32 Unused = 0xffffffff;
+
+// A cone narrower than this, as the cosine of its widest triangle, can't be back face culled.
+const Real MinimumConeCosine = 0.1f;
+
+Vector3D position(const float *positions, xsize stride, xuint32 vertex)
+  {
+  const float *p = (const float *)((const xuint8 *)positions + vertex * stride);
+  return Vector3D(p[0], p[1], p[2]);
+  }
+
+Vector3D triangleNormal(const float *positions, xsize stride, const xuint32 *tri)
+  {
+  const Vector3D a = position(positions, stride, tri[0]);
+  const Vector3D b = position(positions, stride, tri[1]);
+  const Vector3D c = position(positions, stride, tri[2]);
+  const Vector3D normal = (b - a).cross(c - a);
+  const Real length = normal.norm();
+  return length > 0 ? Vector3D(normal / length) : Vector3D(Vector3D::Zero());
+  }
+
+}
+
+MeshletBuilder::MeshletBuilder(AllocatorBase *allocator)
+    : _allocator(allocator)
+  {
+  }
+
+void MeshletBuilder::build(
+    xuint32 *indices,
+    xsize indexCount,
+    const float *positions,
+    xsize positionStride,
+    xsize vertexCount,
+    Vector<Meshlet> *meshlets,
+    xsize maxVertices,
+    xsize maxTriangles)
+  {
+  xAssert(meshlets);
+  xAssert((indexCount % 3) == 0);
+  xAssert(maxVertices >= 3 && maxTriangles >= 1);
+  meshlets->clear();
+
+  const xsize triCount = indexCount / 3;
+  if(!triCount)
+    {
+    return;
+    }
+
+  // Triangles using each vertex.
+  Vector<xuint32> offsets(_allocator);
+  Vector<xuint32> fill(_allocator);
+  offsets.resize(vertexCount + 1, 0);
+  for(xsize i = 0; i < indexCount; ++i)
+    {
+    xAssert(indices[i] < vertexCount);
+    ++offsets[indices[i] + 1];
+    }
+  for(xsize v = 0; v < vertexCount; ++v)
+    {
+    offsets[v + 1] += offsets[v];
+    }
+  fill.resizeAndCopy(vertexCount, offsets.data());
+
+  Vector<xuint32> adjacency(_allocator);
+  adjacency.resize(indexCount, 0);
+  for(xsize i = 0; i < indexCount; ++i)
+    {
+    adjacency[fill[indices[i]]++] = (xuint32)(i / 3);
+    }
+
+  Vector<Vector3D> normals(_allocator);
+  normals.resize(triCount, Vector3D::Zero());
+  for(xsize t = 0; t < triCount; ++t)
+    {
+    normals[t] = triangleNormal(positions, positionStride, indices + t * 3);
+    }
+
+  Vector<xuint8> emitted(_allocator);
+  emitted.resize(triCount, 0);
+
+  // The meshlet each vertex was last added to, so membership is checked without clearing.
+  Vector<xuint32> vertexMeshlet(_allocator);
+  vertexMeshlet.resize(vertexCount, Unused);
+
+  Vector<xuint32> output(_allocator);
+  output.reserve(indexCount);
+  Vector<xuint32> candidates(_allocator);
+
+  xsize inputCursor = 0;
+  while(output.size() < indexCount)
+    {
+    const xuint32 meshletIndex = (xuint32)meshlets->size();
+
+    Meshlet meshlet;
+    meshlet.firstIndex = (xuint32)output.size();
+    meshlet.indexCount = 0;
+    meshlet.vertexCount = 0;
+
+    Vector3D centroid = Vector3D::Zero();
+    Vector3D normalSum = Vector3D::Zero();
+    candidates.clear();
+
+    while(emitted[inputCursor])
+      {
+      ++inputCursor;
+      }
+    xuint32 next = (xuint32)inputCursor;
+
+    while(next != Unused)
+      {
+      const xuint32 *tri = indices + next * 3;
+      emitted[next] = 1;
+      output << tri[0] << tri[1] << tri[2];
+      meshlet.indexCount += 3;
+      normalSum += normals[next];
+
+      for(xsize c = 0; c < 3; ++c)
+        {
+        const xuint32 v = tri[c];
+        if(vertexMeshlet[v] == meshletIndex)
+          {
+          continue;
+          }
+
+        vertexMeshlet[v] = meshletIndex;
+        centroid = (centroid * meshlet.vertexCount + position(positions, positionStride, v)) / (Real)(meshlet.vertexCount + 1);
+        ++meshlet.vertexCount;
+
+        for(xuint32 a = offsets[v]; a < offsets[v + 1]; ++a)
+          {
+          if(!emitted[adjacency[a]])
+            {
+            candidates << adjacency[a];
+            }
+          }
+        }
+
+      if(meshlet.indexCount / 3 >= maxTriangles)
+        {
+        break;
+        }
+
+      // Prefer triangles adding the fewest vertices, then those closest to the meshlet and
+      // facing the same way, which keeps the bounds small and the cone narrow.
+      const Vector3D averageNormal = normalSum.norm() > 0 ? Vector3D(normalSum.normalized()) : Vector3D(Vector3D::Zero());
+      next = Unused;
+      xuint32 bestAdded = 4;
+      Real bestScore = std::numeric_limits<Real>::max();
+      xsize live = 0;
+      for(xsize i = 0; i < candidates.size(); ++i)
+        {
+        const xuint32 t = candidates[i];
+        if(emitted[t])
+          {
+          continue;
+          }
+        candidates[live++] = t;
+
+        const xuint32 *other = indices + t * 3;
+        xuint32 added = 0;
+        for(xsize c = 0; c < 3; ++c)
+          {
+          added += vertexMeshlet[other[c]] != meshletIndex ? 1 : 0;
+          }
+        if(meshlet.vertexCount + added > maxVertices)
+          {
+          continue;
+          }
+
+        const Vector3D centre = (position(positions, positionStride, other[0]) +
+                                 position(positions, positionStride, other[1]) +
+                                 position(positions, positionStride, other[2])) / 3.0f;
+        const Real spread = (centre - centroid).squaredNorm();
+        const Real facing = 1.0f - normals[t].dot(averageNormal);
+        const Real score = spread * (1.0f + facing);
+        if(added < bestAdded || (added == bestAdded && score < bestScore))
+          {
+          bestAdded = added;
+          bestScore = score;
+          next = t;
+          }
+        }
+      candidates.resize(live);
+      }
+
+    // Bounds, then a cone holding every triangle normal.
+    meshlet.bounds = BoundingBox();
+    for(xuint32 i = meshlet.firstIndex; i < meshlet.firstIndex + meshlet.indexCount; ++i)
+      {
+      meshlet.bounds.unite(position(positions, positionStride, output[i]));
+      }
+    meshlet.centre = meshlet.bounds.centre();
+    meshlet.radius = 0;
+    for(xuint32 i = meshlet.firstIndex; i < meshlet.firstIndex + meshlet.indexCount; ++i)
+      {
+      const Real distance = (position(positions, positionStride, output[i]) - meshlet.centre).norm();
+      meshlet.radius = std::max(meshlet.radius, distance);
+      }
+
+    meshlet.coneAxis = normalSum.norm() > 0 ? Vector3D(normalSum.normalized()) : Vector3D(Vector3D::UnitZ());
+    Real minimumDot = 1.0f;
+    for(xuint32 i = meshlet.firstIndex; i < meshlet.firstIndex + meshlet.indexCount; i += 3)
+      {
+      minimumDot = std::min(minimumDot, triangleNormal(positions, positionStride, output.data() + i).dot(meshlet.coneAxis));
+      }
+
+    // The cutoff is the sine of the normal cone's half angle, which is the cosine of the
+    // cone of view directions that see every triangle's back.
+    meshlet.coneCutoff = minimumDot <= MinimumConeCosine ? 1.0f : std::sqrt(1.0f - minimumDot * minimumDot);
+
+    *meshlets << meshlet;
+    }
+
+  std::copy(output.data(), output.data() + indexCount, indices);
+  }
+
+bool MeshletBuilder::isBackFacing(const Meshlet &meshlet, const Vector3D &cameraPosition)
+  {
+  if(meshlet.coneCutoff >= 1.0f)
+    {
+    return false;
+    }
+
+  const Vector3D view = meshlet.centre - cameraPosition;
+  return view.dot(meshlet.coneAxis) >= meshlet.coneCutoff * view.norm() + meshlet.radius;
+  }
+
+xsize MeshletBuilder::cull(
+    const Meshlet *meshlets,
+    xsize meshletCount,
+    const Frustum &frustum,
+    const Vector3D &cameraPosition,
+    Vector<DrawRange> *ranges)
+  {
+  xAssert(ranges);
+  xsize triangles = 0;
+  for(xsize i = 0; i < meshletCount; ++i)
+    {
+    const Meshlet &meshlet = meshlets[i];
+    if(isBackFacing(meshlet, cameraPosition) || frustum.intersects(meshlet.bounds) == Frustum::Outside)
+      {
+      continue;
+      }
+
+    triangles += meshlet.indexCount / 3;
+    if(ranges->size() && ranges->back().firstIndex + ranges->back().indexCount == meshlet.firstIndex)
+      {
+      ranges->back().indexCount += meshlet.indexCount;
+      }
+    else
+      {
+      DrawRange range = { meshlet.firstIndex, meshlet.indexCount };
+      *ranges << range;
+      }
+    }
+
+  return triangles;
+  }
+
+}
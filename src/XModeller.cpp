@@ -5,10 +5,48 @@
 #include "XShader.h"
 #include "XGeometry.h"
 #include "XFrame.h"
+#include "XNormalGenerator.h"
+#include "XTangentGenerator.h"
+#include "XVertexEncoder.h"
+#include "XMeshOptimiser.h"
+#include "XVertexInterleaver.h"
+#include "XCurveTessellator.h"
+#include <algorithm>
 
 namespace Eks
 {
 
+namespace
+{
+
+// Copy [in] to [offset] in [out], zero filling up to [count] elements.
+template <typename T> void copyPadded(Vector<T> &out, xsize offset, const Vector<T> &in, xsize count)
+  {
+  const xsize copied = std::min(in.size(), count);
+  std::copy(in.data(), in.data() + copied, out.data() + offset);
+  for( xsize i = copied; i < count; ++i )
+    {
+    out[offset + i] = T::Zero();
+    }
+  }
+
+template <typename T> void permuteVertices(Vector<T> &data, const Vector<xuint32> &remap, AllocatorBase *allocator)
+  {
+  if( !data.size() )
+    {
+    return;
+    }
+
+  Vector<T> source(allocator);
+  source.resizeAndCopy(data.size(), data.data());
+  for( xsize i = 0; i < source.size(); ++i )
+    {
+    data[remap[i]] = source[i];
+    }
+  }
+
+}
+
 Modeller::Modeller(AllocatorBase *a, xsize initialSize)
   : _allocator(a),
     _triIndices(a),
@@ -18,7 +56,8 @@ Modeller::Modeller(AllocatorBase *a, xsize initialSize)
     _normals(a),
     _colours(a),
     _states(a),
-    _transform(Transform::Identity())
+    _transform(Transform::Identity()),
+    _primitiveCache(0)
   {
   _vertex.reserve(initialSize);
   _texture.reserve(initialSize);
@@ -37,17 +76,35 @@ Modeller::~Modeller( )
 class Utils
   {
 public:
+  // Write elements of [dataIn] from [first] as [fmt] at [offset] in each of [vertexCount]
+  // vertices, zeros where it has no element.
   template <typename T>
-      static void bakeArray(Vector<xuint8> &data, xsize offset, xsize stride, const Vector<T> &dataIn)
+      static void bakeArray(xuint8 *dataOut, xsize offset, xsize stride, xsize first, xsize vertexCount, const Vector<T> &dataIn, ShaderVertexLayoutDescription::Format fmt)
     {
-    xsize count = dataIn.size();
+    xsize count = dataIn.size() > first ? std::min(dataIn.size() - first, vertexCount) : 0;
 
-    xAssert((offset + (stride * (count-1))) <= data.size());
-    xuint8 *dataOut = data.data();
-    for(xsize i = 0; i < count; ++i)
+    const xsize components = T::RowsAtCompileTime;
+    if(fmt == ShaderVertexLayoutDescription::FormatFloat1 + components - 1)
+      {
+      for(xsize i = 0; i < count; ++i)
+        {
+        xuint8 *d = dataOut + offset + (stride * i);
+        memcpy(d, dataIn[first + i].data(), sizeof(Real) * components);
+        }
+      }
+    else
+      {
+      for(xsize i = 0; i < count; ++i)
+        {
+        xuint8 *d = dataOut + offset + (stride * i);
+        VertexEncoder::encode(fmt, dataIn[first + i].data(), components, d);
+        }
+      }
+
+    const xsize size = ShaderVertexLayoutDescription::formatSize(fmt);
+    for(xsize i = count; i < vertexCount; ++i)
       {
-      xuint8 *d = dataOut + offset + (stride * i);
-      memcpy(d, dataIn[i].data(), sizeof(T));
+      memset(dataOut + offset + (stride * i), 0, size);
       }
     }
   };
@@ -56,82 +113,271 @@ void Modeller::bakeVertices(
     Renderer *r,
     const ShaderVertexLayoutDescription::Semantic *semanticOrder,
     xsize semanticCount,
-    Geometry *geo)
+    Geometry *geo,
+    const ShaderVertexLayoutDescription::Format *formats)
+  {
+  writeVertices(r, semanticOrder, semanticCount, geo, formats, false);
+  }
+
+void Modeller::updateVertices(
+    Renderer *r,
+    const ShaderVertexLayoutDescription::Semantic *semanticOrder,
+    xsize semanticCount,
+    Geometry *geo,
+    const ShaderVertexLayoutDescription::Format *formats)
+  {
+  writeVertices(r, semanticOrder, semanticCount, geo, formats, true);
+  }
+
+void Modeller::DirtyRange::mark(xsize from, xsize to)
+  {
+  begin = begin < end ? std::min(begin, from) : from;
+  end = std::max(end, to);
+  }
+
+bool Modeller::VertexLayout::equals(
+    const ShaderVertexLayoutDescription::Semantic *semanticOrder,
+    const ShaderVertexLayoutDescription::Format *formatOrder,
+    xsize semanticCount) const
+  {
+  if(count != semanticCount || count > MaxSemantics)
+    {
+    return false;
+    }
+
+  for(xsize i = 0; i < count; ++i)
+    {
+    if(semantics[i] != semanticOrder[i] || formats[i] != formatOrder[i])
+      {
+      return false;
+      }
+    }
+  return true;
+  }
+
+void Modeller::VertexLayout::set(
+    const ShaderVertexLayoutDescription::Semantic *semanticOrder,
+    const ShaderVertexLayoutDescription::Format *formatOrder,
+    xsize semanticCount)
   {
-  Vector<xuint8> data(_allocator);
+  count = semanticCount;
+  for(xsize i = 0; i < semanticCount && i < MaxSemantics; ++i)
+    {
+    semantics[i] = semanticOrder[i];
+    formats[i] = formatOrder[i];
+    }
+  }
 
-  xsize semanticSizes[] =
+void Modeller::writeVertices(
+    Renderer *r,
+    const ShaderVertexLayoutDescription::Semantic *semanticOrder,
+    xsize semanticCount,
+    Geometry *geo,
+    const ShaderVertexLayoutDescription::Format *formats,
+    bool update)
+  {
+  const ShaderVertexLayoutDescription::Format defaultFormats[] =
     {
-    3,
-    4,
-    2,
-    3,
-    3,
+    ShaderVertexLayoutDescription::FormatFloat3,
+    ShaderVertexLayoutDescription::FormatFloat4,
+    ShaderVertexLayoutDescription::FormatFloat2,
+    ShaderVertexLayoutDescription::FormatFloat3,
+    ShaderVertexLayoutDescription::FormatFloat4,
     };
-  xCompileTimeAssert(X_ARRAY_COUNT(semanticSizes) == ShaderVertexLayoutDescription::SemanticCount);
+  xCompileTimeAssert(X_ARRAY_COUNT(defaultFormats) == ShaderVertexLayoutDescription::SemanticCount);
 
   xsize vertSize = 0;
+  ShaderVertexLayoutDescription::Format layoutFormats[VertexLayout::MaxSemantics];
   for(xsize i = 0; i < semanticCount; ++i)
     {
-    vertSize += semanticSizes[semanticOrder[i]];
+    const ShaderVertexLayoutDescription::Format fmt = formats ? formats[i] : defaultFormats[semanticOrder[i]];
+    vertSize += ShaderVertexLayoutDescription::formatSize(fmt);
+    if(i < VertexLayout::MaxSemantics)
+      {
+      layoutFormats[i] = fmt;
+      }
     }
-  vertSize *= sizeof(float);
 
-  data.resize(_vertex.size() * vertSize);
-
-  xsize offset = 0;
+  bool hasTangents = false;
   for(xsize i = 0; i < semanticCount; ++i)
+    {
+    hasTangents |= semanticOrder[i] == ShaderVertexLayoutDescription::BiNormal;
+    }
+
+  // The vertices to write, when updating only those changed since the last bake.
+  const xsize vertexCount = _vertex.size();
+  xsize first = 0;
+  xsize count = vertexCount;
+  update = update &&
+    vertexCount == _dirtyVertices.baked &&
+    geo == _dirtyVertices.target &&
+    _bakedLayout.equals(semanticOrder, layoutFormats, semanticCount);
+  if(update)
+    {
+    const bool dirty = _dirtyVertices.begin < _dirtyVertices.end;
+    if(hasTangents)
+      {
+      // Tangents depend on neighbouring vertices and the triangles, any change rewrites them all.
+      if(!dirty && _dirtyTriangles.begin >= _dirtyTriangles.end && _triIndices.size() == _dirtyTriangles.baked)
+        {
+        return;
+        }
+      }
+    else if(!dirty)
+      {
+      return;
+      }
+    else
+      {
+      first = _dirtyVertices.begin;
+      count = _dirtyVertices.end - first;
+      }
+    }
+
+  Vector<Vector4D> tangents(_allocator);
+  if(hasTangents)
+    {
+    generateTangents(&tangents);
+    }
+
+  // When every attribute is baked as floats, the vertices are written in one pass.
+  VertexInterleaver::Stream streams[VertexInterleaver::MaxStreams];
+  bool interleave = semanticCount <= VertexInterleaver::MaxStreams;
+  for(xsize i = 0; interleave && i < semanticCount; ++i)
     {
     ShaderVertexLayoutDescription::Semantic semantic = semanticOrder[i];
+    VertexInterleaver::Stream &stream = streams[i];
     if(semantic == ShaderVertexLayoutDescription::Position)
       {
-      Utils::bakeArray(data, offset, vertSize, _vertex);
-      offset += sizeof(float) * semanticSizes[semantic];
+      stream.data = _vertex.data()->data();
+      stream.components = 3;
+      stream.count = _vertex.size();
       }
     else if(semantic == ShaderVertexLayoutDescription::Normal)
       {
-      Utils::bakeArray(data, offset, vertSize, _normals);
-      offset += sizeof(float) * semanticSizes[semantic];
+      stream.data = _normals.size() ? _normals.data()->data() : 0;
+      stream.components = 3;
+      stream.count = _normals.size();
       }
     else if(semantic == ShaderVertexLayoutDescription::Colour)
       {
-      Utils::bakeArray(data, offset, vertSize, _colours);
-      offset += sizeof(float) * semanticSizes[semantic];
+      stream.data = _colours.size() ? _colours.data()->data() : 0;
+      stream.components = 4;
+      stream.count = _colours.size();
       }
     else if(semantic == ShaderVertexLayoutDescription::TextureCoordinate)
       {
-      Utils::bakeArray(data, offset, vertSize, _texture);
-      offset += sizeof(float) * semanticSizes[semantic];
+      stream.data = _texture.size() ? _texture.data()->data() : 0;
+      stream.components = 2;
+      stream.count = _texture.size();
       }
+    else
+      {
+      stream.data = tangents.size() ? tangents.data()->data() : 0;
+      stream.components = 4;
+      stream.count = tangents.size();
+      }
+
+    const ShaderVertexLayoutDescription::Format fmt = formats ? formats[i] : defaultFormats[semantic];
+    interleave = fmt == ShaderVertexLayoutDescription::FormatFloat1 + stream.components - 1;
     }
 
-  xsize elementCount = data.size() / vertSize;
-  xAssert((data.size() % vertSize) == 0);
+  // The vertices are written straight into the buffer when the renderer can map it.
+  auto fill = [&](void *out)
+    {
+    xuint8 *data = (xuint8 *)out;
+    if(interleave && count)
+      {
+      VertexInterleaver::Stream range[VertexInterleaver::MaxStreams];
+      for(xsize i = 0; i < semanticCount; ++i)
+        {
+        const VertexInterleaver::Stream &stream = streams[i];
+        const bool present = stream.count > first;
+        range[i].data = present ? stream.data + first * stream.components : 0;
+        range[i].components = stream.components;
+        range[i].count = present ? stream.count - first : 0;
+        }
+
+      xAssert(VertexInterleaver::vertexSize(range, semanticCount) == vertSize);
+      VertexInterleaver::interleave(range, semanticCount, count, data);
+      return;
+      }
 
-  Geometry::delayedCreate(*geo, r, data.data(), vertSize, elementCount);
+    xsize offset = 0;
+    for(xsize i = 0; i < semanticCount; ++i)
+      {
+      ShaderVertexLayoutDescription::Semantic semantic = semanticOrder[i];
+      const ShaderVertexLayoutDescription::Format fmt = formats ? formats[i] : defaultFormats[semantic];
+      if(semantic == ShaderVertexLayoutDescription::Position)
+        {
+        Utils::bakeArray(data, offset, vertSize, first, count, _vertex, fmt);
+        }
+      else if(semantic == ShaderVertexLayoutDescription::Normal)
+        {
+        Utils::bakeArray(data, offset, vertSize, first, count, _normals, fmt);
+        }
+      else if(semantic == ShaderVertexLayoutDescription::Colour)
+        {
+        Utils::bakeArray(data, offset, vertSize, first, count, _colours, fmt);
+        }
+      else if(semantic == ShaderVertexLayoutDescription::TextureCoordinate)
+        {
+        Utils::bakeArray(data, offset, vertSize, first, count, _texture, fmt);
+        }
+      else if(semantic == ShaderVertexLayoutDescription::BiNormal)
+        {
+        Utils::bakeArray(data, offset, vertSize, first, count, tangents, fmt);
+        }
+      offset += ShaderVertexLayoutDescription::formatSize(fmt);
+      }
+    };
+
+  if(update && Geometry::delayedUpdateWith(*geo, vertSize, first, count, fill))
+    {
+    _dirtyVertices.reset(vertexCount, geo);
+    return;
+    }
+
+  first = 0;
+  count = vertexCount;
+  Geometry::delayedCreateWith(*geo, r, vertSize, vertexCount, fill);
+  _dirtyVertices.reset(vertexCount, geo);
+  _bakedLayout.set(semanticOrder, layoutFormats, semanticCount);
+  }
+
+void Modeller::generateTangents(Vector<Vector4D> *tangents) const
+  {
+  const xsize vertexCount = _vertex.size();
+
+  // Normals and texture coordinates are only stored once used, pad them to the vertex count.
+  Vector<Vector3D> normals(_allocator);
+  Vector<Vector2D> texture(_allocator);
+  normals.resizeAndCopy(_normals.size(), _normals.data());
+  texture.resizeAndCopy(_texture.size(), _texture.data());
+  normals.resize(vertexCount, Vector3D::Zero());
+  texture.resize(vertexCount, Vector2D::Zero());
+
+  const xsize cornerCount = _triIndices.size() - (_triIndices.size() % 3);
+
+  TangentGenerator generator(_allocator);
+  generator.generate(_vertex.data(), normals.data(), texture.data(), vertexCount, _triIndices.data(), cornerCount, tangents);
   }
 
 void Modeller::bakeTriangles(Renderer *r,
     const ShaderVertexLayoutDescription::Semantic *semanticOrder,
     xsize semanticCount,
     IndexGeometry *index,
-    Geometry *geo)
+    Geometry *geo,
+    const ShaderVertexLayoutDescription::Format *formats)
   {
   if(geo)
     {
-    bakeVertices(r, semanticOrder, semanticCount, geo);
+    writeVertices(r, semanticOrder, semanticCount, geo, formats, false);
     }
 
   if(index)
     {
-    xAssert(_triIndices.size() < std::numeric_limits<xuint16>::max());
-
-    IndexGeometry::delayedCreate(
-      *index,
-      r,
-      IndexGeometry::Unsigned16,
-      _triIndices.data(),
-      _triIndices.size());
+    writeIndices(r, index, _triIndices, _dirtyTriangles, false);
     }
   }
 
@@ -139,26 +385,78 @@ void Modeller::bakeLines(Renderer *r,
     const ShaderVertexLayoutDescription::Semantic *semanticOrder,
     xsize semanticCount,
     IndexGeometry *index,
-    Geometry *geo)
+    Geometry *geo,
+    const ShaderVertexLayoutDescription::Format *formats)
+  {
+  if(geo)
+    {
+    writeVertices(r, semanticOrder, semanticCount, geo, formats, false);
+    }
+
+  if(index)
+    {
+    writeIndices(r, index, _linIndices, _dirtyLines, false);
+    }
+  }
+
+void Modeller::updateTriangles(Renderer *r,
+    const ShaderVertexLayoutDescription::Semantic *semanticOrder,
+    xsize semanticCount,
+    IndexGeometry *index,
+    Geometry *geo,
+    const ShaderVertexLayoutDescription::Format *formats)
   {
   if(geo)
     {
-    bakeVertices(r, semanticOrder, semanticCount, geo);
+    writeVertices(r, semanticOrder, semanticCount, geo, formats, true);
     }
 
   if(index)
     {
-    xAssert(_linIndices.size() < std::numeric_limits<xuint16>::max());
+    writeIndices(r, index, _triIndices, _dirtyTriangles, true);
+    }
+  }
+
+void Modeller::updateLines(Renderer *r,
+    const ShaderVertexLayoutDescription::Semantic *semanticOrder,
+    xsize semanticCount,
+    IndexGeometry *index,
+    Geometry *geo,
+    const ShaderVertexLayoutDescription::Format *formats)
+  {
+  if(geo)
+    {
+    writeVertices(r, semanticOrder, semanticCount, geo, formats, true);
+    }
 
-    IndexGeometry::delayedCreate(
-      *index,
-      r,
-      IndexGeometry::Unsigned16,
-      _linIndices.data(),
-      _linIndices.size());
+  if(index)
+    {
+    writeIndices(r, index, _linIndices, _dirtyLines, true);
     }
   }
 
+void Modeller::writeIndices(Renderer *r, IndexGeometry *index, const Vector<xuint32> &indices, DirtyRange &dirty, bool update)
+  {
+  const xsize indexCount = indices.size();
+  if(update && indexCount == dirty.baked && index == dirty.target)
+    {
+    if(dirty.begin >= dirty.end)
+      {
+      return;
+      }
+
+    // Fails if the vertex count has outgrown the baked index type.
+    const IndexGeometry::Type type = IndexGeometry::typeFor(_vertex.size());
+    if(IndexGeometry::delayedUpdateNarrowed(*index, type, indices.data(), dirty.begin, dirty.end - dirty.begin))
+      {
+      dirty.reset(indexCount, index);
+      return;
+      }
+    }
+
+  IndexGeometry::delayedCreateNarrowest(*index, r, indices.data(), indexCount, _vertex.size());
+  dirty.reset(indexCount, index);
+  }
 
 void Modeller::begin( Type type )
   {
@@ -205,12 +503,12 @@ void Modeller::vertex( const Vector3D &vec )
   if( _states.back().type == Lines )
     {
     _areLineIndicesSequential |= _linIndices.size() == _vertex.size();
-    _linIndices << (xuint16)(_vertex.size() - 1);
+    _linIndices << (xuint32)(_vertex.size() - 1);
     }
   else if( _states.back().type == Triangles )
     {
     _areTriangleIndicesSequential |= _triIndices.size() == _vertex.size();
-    _triIndices << (xuint16)(_vertex.size() - 1);
+    _triIndices << (xuint32)(_vertex.size() - 1);
 
     if( _states.back().normalsAutomatic && ( _triIndices.size() % 3 ) == 0 )
       {
@@ -226,13 +524,14 @@ void Modeller::vertex( const Vector3D &vec )
       Vector3D vec2(_vertex[i3] - _vertex[i1]);
 
       _normals[i1] = _normals[i2] = _normals[i3] = vec1.cross(vec2).normalized();
+      _dirtyVertices.mark(i1, _vertex.size());
       }
     }
   else if( _states.back().type == Quads )
     {
     _quadCount++;
     _areTriangleIndicesSequential = false;
-    _triIndices << (xuint16)(_vertex.size() - 1);
+    _triIndices << (xuint32)(_vertex.size() - 1);
 
     if( _quadCount == 4 )
       {
@@ -250,6 +549,7 @@ void Modeller::vertex( const Vector3D &vec )
         Vector3D vec2( _vertex[i3] - _vertex[i1]);
 
         _normals[i1] = _normals[i2] = _normals[i3] = _normals[i4] = vec1.cross(vec2).normalized();
+        _dirtyVertices.mark(i1, _vertex.size());
         }
 
       xsize idxA = _triIndices.size()-4;
@@ -276,6 +576,124 @@ void Modeller::colour( const Eks::Vector4D &col )
   _states.back().colour = col;
   }
 
+xsize Modeller::addVertices( const Vector3D *positions, xsize count )
+  {
+  const State &state = _states.back();
+  const xsize first = _vertex.size();
+  const xsize end = first + count;
+
+  if( _normals.size() || !state.normal.isZero() )
+    {
+    _normals.resize(first, Vector3D::Zero());
+    _normals.resize(end, transformNormal(state.normal));
+    }
+
+  if( _texture.size() || !state.texture.isZero() )
+    {
+    _texture.resize(first, Vector2D::Zero());
+    _texture.resize(end, state.texture);
+    }
+
+  if( _colours.size() || !state.colour.isZero() )
+    {
+    _colours.resize(first, Vector4D::Zero());
+    _colours.resize(end, state.colour);
+    }
+
+  _vertex.resizeAndCopy(end, positions);
+  transformPoints(_vertex.data() + first, count);
+
+  return first;
+  }
+
+void Modeller::addNormals( const Vector3D *normals, xsize count )
+  {
+  xAssert(count <= _vertex.size());
+  setNormals(_vertex.size() - count, normals, count);
+  }
+
+void Modeller::addTextures( const Vector2D *textures, xsize count )
+  {
+  xAssert(count <= _vertex.size());
+  setTextures(_vertex.size() - count, textures, count);
+  }
+
+void Modeller::addColours( const Vector4D *colours, xsize count )
+  {
+  xAssert(count <= _vertex.size());
+  setColours(_vertex.size() - count, colours, count);
+  }
+
+void Modeller::addTriangles( const xuint32 *indices, xsize count, xsize firstVertex )
+  {
+  xAssert((count % 3) == 0);
+  const xsize first = _triIndices.size();
+  _triIndices.resize(first + count, 0);
+
+  xuint32 *out = _triIndices.data() + first;
+  const xuint32 offset = (xuint32)firstVertex;
+  for( xsize i = 0; i < count; ++i )
+    {
+    xAssert(firstVertex + indices[i] < _vertex.size());
+    out[i] = indices[i] + offset;
+    }
+
+  _areTriangleIndicesSequential = false;
+  }
+
+void Modeller::setVertices( xsize first, const Vector3D *positions, xsize count )
+  {
+  xAssert(first + count <= _vertex.size());
+
+  std::copy(positions, positions + count, _vertex.data() + first);
+  transformPoints(_vertex.data() + first, count);
+  _dirtyVertices.mark(first, first + count);
+  }
+
+void Modeller::setNormals( xsize first, const Vector3D *normals, xsize count )
+  {
+  xAssert(first + count <= _vertex.size());
+
+  _normals.resize(_vertex.size(), Vector3D::Zero());
+  std::copy(normals, normals + count, _normals.data() + first);
+  transformNormals(_normals.data() + first, count, false);
+  _dirtyVertices.mark(first, first + count);
+  }
+
+void Modeller::setTextures( xsize first, const Vector2D *textures, xsize count )
+  {
+  xAssert(first + count <= _vertex.size());
+
+  _texture.resize(_vertex.size(), Vector2D::Zero());
+  std::copy(textures, textures + count, _texture.data() + first);
+  _dirtyVertices.mark(first, first + count);
+  }
+
+void Modeller::setColours( xsize first, const Vector4D *colours, xsize count )
+  {
+  xAssert(first + count <= _vertex.size());
+
+  _colours.resize(_vertex.size(), Vector4D::Zero());
+  std::copy(colours, colours + count, _colours.data() + first);
+  _dirtyVertices.mark(first, first + count);
+  }
+
+void Modeller::setTriangles( xsize first, const xuint32 *indices, xsize count, xsize firstVertex )
+  {
+  xAssert(first + count <= _triIndices.size());
+
+  xuint32 *out = _triIndices.data() + first;
+  const xuint32 offset = (xuint32)firstVertex;
+  for( xsize i = 0; i < count; ++i )
+    {
+    xAssert(firstVertex + indices[i] < _vertex.size());
+    out[i] = indices[i] + offset;
+    }
+
+  _areTriangleIndicesSequential = false;
+  _dirtyTriangles.mark(first, first + count);
+  }
+
 void Modeller::setNormalsAutomatic( bool nAuto )
   {
   _states.back().normalsAutomatic = nAuto;
@@ -285,11 +703,351 @@ void Modeller::setNormalsAutomatic( bool nAuto )
     }
   }
 
+void Modeller::optimiseTriangles()
+  {
+  const xsize indexCount = _triIndices.size() - (_triIndices.size() % 3);
+  const xsize vertexCount = _vertex.size();
+  if( !indexCount )
+    {
+    return;
+    }
+
+  MeshOptimiser optimiser(_allocator);
+  optimiser.optimiseVertexCache(_triIndices.data(), indexCount, vertexCount);
+  optimiser.optimiseOverdraw(_triIndices.data(), indexCount, _vertex.data()->data(), sizeof(Vector3D), vertexCount);
+
+  Vector<xuint32> remap(_allocator);
+  remap.resize(vertexCount, 0);
+  MeshOptimiser::buildFetchRemap(_triIndices.data(), indexCount, vertexCount, remap.data());
+
+  // Partial attribute arrays are padded so every vertex moves with its attributes.
+  if( _texture.size() )
+    {
+    while( _texture.size() < vertexCount )
+      {
+      _texture << Vector2D::Zero();
+      }
+    }
+  if( _normals.size() )
+    {
+    while( _normals.size() < vertexCount )
+      {
+      _normals << Vector3D::Zero();
+      }
+    }
+  if( _colours.size() )
+    {
+    while( _colours.size() < vertexCount )
+      {
+      _colours << Vector4D::Zero();
+      }
+    }
+
+  permuteVertices(_vertex, remap, _allocator);
+  permuteVertices(_texture, remap, _allocator);
+  permuteVertices(_normals, remap, _allocator);
+  permuteVertices(_colours, remap, _allocator);
+
+  for( xsize i = 0; i < _triIndices.size(); ++i )
+    {
+    _triIndices[i] = remap[_triIndices[i]];
+    }
+  for( xsize i = 0; i < _linIndices.size(); ++i )
+    {
+    _linIndices[i] = remap[_linIndices[i]];
+    }
+
+  _areTriangleIndicesSequential = false;
+  _areLineIndicesSequential = false;
+
+  _dirtyVertices.mark(0, _vertex.size());
+  _dirtyTriangles.mark(0, _triIndices.size());
+  _dirtyLines.mark(0, _linIndices.size());
+  }
+
 bool Modeller::normalsAutomatic( ) const
   {
   return _states.back().normalsAutomatic;
   }
 
+void Modeller::generateSmoothNormals( Real creaseAngle )
+  {
+  const xsize cornerCount = _triIndices.size() - (_triIndices.size() % 3);
+  if( !cornerCount )
+    {
+    return;
+    }
+
+  // Vertices are usually duplicated per face, so weld them by position first.
+  Vector<xuint32> remap(_allocator);
+  NormalGenerator::weldPositions(_vertex.data(), _vertex.size(), &remap);
+
+  Vector<xuint32> positionIndices(_allocator);
+  positionIndices.resize(cornerCount, 0);
+  for( xsize i = 0; i < cornerCount; ++i )
+    {
+    positionIndices[i] = remap[_triIndices[i]];
+    }
+
+  Vector<Vector3D> normals(_allocator);
+  Vector<xuint32> normalIndices(_allocator);
+  NormalGenerator generator(_allocator);
+  generator.generate(_vertex.data(), _vertex.size(), positionIndices.data(), cornerCount, creaseAngle, &normals, &normalIndices);
+
+  while( _normals.size() < _vertex.size() )
+    {
+    _normals << Vector3D::Zero();
+    }
+
+  // A vertex shared by corners that need different normals is split, [nextSplit] chains
+  // each vertex to its copies, and [assigned] records which normal each one carries.
+  const xuint32 unassigned = Eks::maxFor(unassigned);
+  Vector<xuint32> assigned(_allocator);
+  Vector<xuint32> nextSplit(_allocator);
+  assigned.resize(_vertex.size(), unassigned);
+  nextSplit.resize(_vertex.size(), unassigned);
+
+  for( xsize i = 0; i < cornerCount; ++i )
+    {
+    const xuint32 normal = normalIndices[i];
+    xuint32 vert = _triIndices[i];
+
+    xuint32 last = vert;
+    while( vert != unassigned && assigned[vert] != unassigned && assigned[vert] != normal )
+      {
+      last = vert;
+      vert = nextSplit[vert];
+      }
+
+    if( vert == unassigned )
+      {
+      vert = (xuint32)_vertex.size();
+
+      const xuint32 source = _triIndices[i];
+      if( _texture.size() )
+        {
+        while( _texture.size() < _vertex.size() )
+          {
+          _texture << Vector2D::Zero();
+          }
+        const Vector2D tex = _texture[source];
+        _texture << tex;
+        }
+      if( _colours.size() )
+        {
+        while( _colours.size() < _vertex.size() )
+          {
+          _colours << Vector4D::Zero();
+          }
+        const Vector4D col = _colours[source];
+        _colours << col;
+        }
+      const Vector3D position = _vertex[source];
+      _vertex << position;
+      _normals << Vector3D::Zero();
+      assigned << unassigned;
+      nextSplit << unassigned;
+
+      nextSplit[last] = vert;
+      _areTriangleIndicesSequential = false;
+      }
+
+    assigned[vert] = normal;
+    _normals[vert] = normals[normal];
+    _triIndices[i] = (xuint32)vert;
+    }
+
+  _dirtyVertices.mark(0, _vertex.size());
+  _dirtyTriangles.mark(0, cornerCount);
+  }
+
+void Modeller::copyState( const Modeller &other )
+  {
+  _states.clear();
+  _states << other._states.back();
+  _transform = other._transform;
+  _primitiveCache = other._primitiveCache;
+  _quadCount = 0;
+  }
+
+void Modeller::merge( const Modeller *const *parts, xsize count )
+  {
+  if( !count )
+    {
+    return;
+    }
+
+  // Where each part's vertices and indices start in the merged arrays.
+  Vector<xsize> vertexOffsets(_allocator);
+  Vector<xsize> triangleOffsets(_allocator);
+  Vector<xsize> lineOffsets(_allocator);
+  vertexOffsets.resize(count + 1, 0);
+  triangleOffsets.resize(count + 1, 0);
+  lineOffsets.resize(count + 1, 0);
+  vertexOffsets[0] = _vertex.size();
+  triangleOffsets[0] = _triIndices.size();
+  lineOffsets[0] = _linIndices.size();
+
+  bool normals = _normals.size() != 0;
+  bool textures = _texture.size() != 0;
+  bool colours = _colours.size() != 0;
+
+  // Indices stay sequential only if every part's indices cover its vertices in order.
+  bool trianglesSequential = _areTriangleIndicesSequential && _triIndices.size() == _vertex.size();
+  bool linesSequential = _areLineIndicesSequential && _linIndices.size() == _vertex.size();
+
+  for( xsize i = 0; i < count; ++i )
+    {
+    const Modeller &part = *parts[i];
+    vertexOffsets[i + 1] = vertexOffsets[i] + part._vertex.size();
+    triangleOffsets[i + 1] = triangleOffsets[i] + part._triIndices.size();
+    lineOffsets[i + 1] = lineOffsets[i] + part._linIndices.size();
+
+    normals |= part._normals.size() != 0;
+    textures |= part._texture.size() != 0;
+    colours |= part._colours.size() != 0;
+
+    trianglesSequential &= part._areTriangleIndicesSequential && part._triIndices.size() == part._vertex.size();
+    linesSequential &= part._areLineIndicesSequential && part._linIndices.size() == part._vertex.size();
+    }
+
+  const xsize first = _vertex.size();
+  const xsize vertexCount = vertexOffsets[count];
+  if( normals )
+    {
+    _normals.resize(first, Vector3D::Zero());
+    _normals.resize(vertexCount);
+    }
+  if( textures )
+    {
+    _texture.resize(first, Vector2D::Zero());
+    _texture.resize(vertexCount);
+    }
+  if( colours )
+    {
+    _colours.resize(first, Vector4D::Zero());
+    _colours.resize(vertexCount);
+    }
+  _vertex.resize(vertexCount);
+  _triIndices.resize(triangleOffsets[count]);
+  _linIndices.resize(lineOffsets[count]);
+
+  // Every part writes its own slice of the arrays.
+  ParallelUtilities::forRanges(count, 1, [&](xsize, xsize begin, xsize end)
+    {
+    for( xsize p = begin; p < end; ++p )
+      {
+      const Modeller &part = *parts[p];
+      const xsize offset = vertexOffsets[p];
+      const xsize partVertices = part._vertex.size();
+
+      copyPadded(_vertex, offset, part._vertex, partVertices);
+      if( normals )
+        {
+        copyPadded(_normals, offset, part._normals, partVertices);
+        }
+      if( textures )
+        {
+        copyPadded(_texture, offset, part._texture, partVertices);
+        }
+      if( colours )
+        {
+        copyPadded(_colours, offset, part._colours, partVertices);
+        }
+
+      xuint32 *triangles = _triIndices.data() + triangleOffsets[p];
+      for( xsize i = 0; i < part._triIndices.size(); ++i )
+        {
+        triangles[i] = part._triIndices[i] + (xuint32)offset;
+        }
+
+      xuint32 *lines = _linIndices.data() + lineOffsets[p];
+      for( xsize i = 0; i < part._linIndices.size(); ++i )
+        {
+        lines[i] = part._linIndices[i] + (xuint32)offset;
+        }
+      }
+    });
+
+  _areTriangleIndicesSequential = trianglesSequential;
+  _areLineIndicesSequential = linesSequential;
+  }
+
+void Modeller::setPrimitiveCache( PrimitiveCache *cache )
+  {
+  _primitiveCache = cache;
+  }
+
+PrimitiveCache *Modeller::primitiveCache( ) const
+  {
+  return _primitiveCache;
+  }
+
+void Modeller::drawPrimitive(const PrimitiveCache::Primitive &primitive, const Transform &instance)
+  {
+  appendPrimitive(primitive, _transform * instance, _transform.linear() * instance.linear());
+  }
+
+void Modeller::appendPrimitive(const PrimitiveCache::Primitive &primitive, const Transform &points, const Matrix3x3 &normals)
+  {
+  const xsize first = _vertex.size();
+  const xsize count = primitive.positions.size();
+  const xsize end = first + count;
+  if(!count)
+    {
+    return;
+    }
+
+  typedef Eigen::Map<Eigen::Matrix<Real, 3, Eigen::Dynamic> > Map;
+
+  _vertex.resizeAndCopy(end, primitive.positions.data());
+  Map vertices(_vertex[first].data(), 3, count);
+  vertices = (points.linear() * vertices).colwise() + points.translation();
+
+  if(primitive.normals.size())
+    {
+    _normals.resize(first, Vector3D::Zero());
+    _normals.resizeAndCopy(end, primitive.normals.data());
+    Map transformed(_normals[first].data(), 3, count);
+    transformed = normals * transformed;
+    }
+
+  if(primitive.textures.size())
+    {
+    _texture.resize(first, Vector2D::Zero());
+    _texture.resizeAndCopy(end, primitive.textures.data());
+    }
+
+  if(_colours.size() || !_states.back().colour.isZero())
+    {
+    _colours.resize(first, Vector4D::Zero());
+    _colours.resize(end, _states.back().colour);
+    }
+
+  const xuint32 offset = (xuint32)first;
+  if(primitive.triangles.size())
+    {
+    _areTriangleIndicesSequential = false;
+    const xsize firstIndex = _triIndices.size();
+    _triIndices.resize(firstIndex + primitive.triangles.size(), 0);
+    for(xsize i = 0; i < primitive.triangles.size(); ++i)
+      {
+      _triIndices[firstIndex + i] = primitive.triangles[i] + offset;
+      }
+    }
+
+  if(primitive.lines.size())
+    {
+    _areLineIndicesSequential = false;
+    const xsize firstIndex = _linIndices.size();
+    _linIndices.resize(firstIndex + primitive.lines.size(), 0);
+    for(xsize i = 0; i < primitive.lines.size(); ++i)
+      {
+      _linIndices[firstIndex + i] = primitive.lines[i] + offset;
+      }
+    }
+  }
+
 void Modeller::drawWireCube( const BoundingBox &cube )
   {
   _areLineIndicesSequential = false;
@@ -297,7 +1055,7 @@ void Modeller::drawWireCube( const BoundingBox &cube )
   Vector3D size = cube.size();
   Vector3D min = cube.minimum();
 
-  xuint16 sI = (xuint16)_vertex.size();
+  xuint32 sI = (xuint32)_vertex.size();
 
   _vertex << min
           << min + Vector3D(size.x(), 0.0f, 0.0f)
@@ -340,11 +1098,20 @@ void Modeller::drawWireCircle(const Vector3D &pos, const Vector3D &normal, float
   Vector3D x = up.cross(normal);
   Vector3D y = normal.cross(x);
 
-  xuint16 initialIndex = (xuint16)_vertex.size();
-  for(xuint16 i = 0; i < (xuint16)pts; ++i)
+  if(_primitiveCache)
+    {
+    Transform points = Transform::Identity();
+    points.linear() << x * radius, y * radius, normal * radius;
+    points.translation() = pos;
+    appendPrimitive(_primitiveCache->wireCircle((xuint32)pts), points, Matrix3x3::Identity());
+    return;
+    }
+
+  xuint32 initialIndex = (xuint32)_vertex.size();
+  for(xuint32 i = 0; i < (xuint32)pts; ++i)
     {
     float angle = i * (X_PI * 2.0f / (float)pts);
-    xuint16 otherIndex = (xuint16)(i+1) % pts;
+    xuint32 otherIndex = (xuint32)(i+1) % pts;
 
     _normals << Vector3D::Zero();
     _texture << Vector2D::Zero();
@@ -364,16 +1131,31 @@ void Modeller::drawCone(
   _areTriangleIndicesSequential = false;
   Vector3D dirNorm = direction.normalized();
 
+  if(_primitiveCache)
+    {
+    // The cached cone's axes are x, y and -z, map them onto the cone's frame.
+    Eks::Frame f(dirNorm);
+    Matrix3x3 rotation;
+    rotation << f.facing(), f.up(), -f.across();
+
+    Transform points = Transform::Identity();
+    points.linear() = rotation * Vector3D(length, radius, radius).asDiagonal();
+    points.translation() = point;
+    appendPrimitive(_primitiveCache->cone(divs, capped), _transform * points, _transform.linear() * rotation);
+    return;
+    }
+
   _vertex.reserve(1 + divs);
   _normals.reserve(1 + divs);
   _texture.reserve(1 + divs);
   _triIndices.reserve(3 * divs);
 
-  xuint16 eIndex = (xuint16)(_vertex.size());
+  Eks::Vector2D t = Eks::Vector2D::Zero();
+
+  xuint32 eIndex = (xuint32)(_vertex.size());
   _vertex << transformPoint(point + dirNorm * length);
   _normals << transformNormal(dirNorm);
-
-  Eks::Vector2D t = Eks::Vector2D::Zero();
+  _texture << t;
 
   Eks::Frame f(dirNorm);
   for(xuint32 i=0; i<divs; ++i)
@@ -409,6 +1191,14 @@ void Modeller::drawCone(
 
 void Modeller::drawSphere(float r, int lats, int longs)
   {
+  if(_primitiveCache && !_states.back().normalsAutomatic)
+    {
+    Transform points = _transform;
+    points.scale(r);
+    appendPrimitive(_primitiveCache->sphere((xuint32)lats, (xuint32)longs), points, _transform.linear());
+    return;
+    }
+
   int i, j;
   for(i = 0; i < lats; i++)
     {
@@ -475,6 +1265,14 @@ void Modeller::drawCube(
   {
   _areTriangleIndicesSequential = false;
 
+  if(_primitiveCache)
+    {
+    Transform points = Transform::Identity();
+    points.linear() << hor, ver, dep;
+    appendPrimitive(_primitiveCache->cube(pX, pY), _transform * points, _transform.linear());
+    return;
+    }
+
   Vector3D h = hor * 0.5f;
   Vector3D v = ver * 0.5f;
   Vector3D d = dep * 0.5f;
@@ -497,7 +1295,7 @@ void Modeller::drawCube(
 
   // Top Face BL
   {
-  xuint16 begin = (xuint16)_vertex.size();
+  xuint32 begin = (xuint32)_vertex.size();
   _triIndices << begin << begin + 1 << begin + 2 << begin + 2 << begin + 1 << begin + 3;
 
   _normals << n1 << n1 << n1 << n1;
@@ -507,7 +1305,7 @@ void Modeller::drawCube(
 
   // Back Face BM
   {
-  xuint16 begin = (xuint16) _vertex.size();
+  xuint32 begin = (xuint32) _vertex.size();
   _triIndices << begin << begin + 1 << begin + 2 << begin + 2 << begin + 1 << begin + 3;
 
   _normals << n5 << n5 << n5 << n5;
@@ -517,7 +1315,7 @@ void Modeller::drawCube(
 
   // Bottom Face BR
   {
-  xuint16 begin = (xuint16)_vertex.size();
+  xuint32 begin = (xuint32)_vertex.size();
   _triIndices << begin << begin + 1 << begin + 2 << begin + 2 << begin + 1 << begin + 3;
 
   _normals << n2 << n2 << n2 << n2;
@@ -527,7 +1325,7 @@ void Modeller::drawCube(
 
   // Left Face TL
   {
-  xuint16 begin = (xuint16)_vertex.size();
+  xuint32 begin = (xuint32)_vertex.size();
   _triIndices << begin << begin + 1 << begin + 2 << begin + 2 << begin + 1 << begin + 3;
 
   _normals << n3 << n3 << n3 << n3;
@@ -537,7 +1335,7 @@ void Modeller::drawCube(
 
   // Front Face TM
   {
-  xuint16 begin = (xuint16)_vertex.size();
+  xuint32 begin = (xuint32)_vertex.size();
   _triIndices << begin << begin + 1 << begin + 2 << begin + 2 << begin + 1 << begin + 3;
 
   _normals << n6 << n6 << n6 << n6;
@@ -547,7 +1345,7 @@ void Modeller::drawCube(
 
   // Right Face TR
   {
-  xuint16 begin = (xuint16)_vertex.size();
+  xuint32 begin = (xuint32)_vertex.size();
   _triIndices << begin << begin + 1 << begin + 2 << begin + 2 << begin + 1 << begin + 3;
 
   _normals << n4 << n4 << n4 << n4;
@@ -562,7 +1360,7 @@ void Modeller::drawQuad(const Vector3D &hor, const Vector3D &ver)
   Vector3D h = hor / 2.0;
   Vector3D v = ver / 2.0;
 
-  xuint16 begin = (xuint16)_vertex.size();
+  xuint32 begin = (xuint32)_vertex.size();
   _triIndices << begin << begin + 1 << begin + 2 << begin << begin + 2 << begin + 3;
   _vertex << transformPoint( -h - v ) << transformPoint( h - v ) << transformPoint( h + v ) << transformPoint( -h + v );
   _texture << Eks::Vector2D(0,0) << Eks::Vector2D(1,0) << Eks::Vector2D(1,1) << Eks::Vector2D(0,1);
@@ -573,7 +1371,7 @@ void Modeller::drawQuad(const Vector3D &hor, const Vector3D &ver)
 
 void Modeller::drawLocator(const Vector3D &size, const Vector3D &center)
   {
-  xuint16 begin = (xuint16)_vertex.size();
+  xuint32 begin = (xuint32)_vertex.size();
   _linIndices << begin << begin + 1 << begin + 2 << begin + 3 << begin + 4 << begin + 5;
 
   _vertex << transformPoint( center + Vector3D( -size.x(), 0, 0 ) )
@@ -615,19 +1413,15 @@ Vector3D Modeller::transformPoint( const Vector3D &in )
   return _transform * in;
   }
 
-void Modeller::transformPoints(Vector <Vector3D> &list)
+void Modeller::transformPoints(Vector3D *points, xsize count)
   {
-  if( _transform.isApprox(Transform::Identity()) )
+  if( !count || _transform.isApprox(Transform::Identity()) )
     {
     return;
     }
 
-  for(xsize i = 0, s = list.size(); i < s; ++i)
-    {
-    Vector3D& v = list[i];
-    Vector3D tr = _transform * v;
-    v = tr;
-    }
+  Eigen::Map<Eigen::Matrix<Real, 3, Eigen::Dynamic> > list(points->data(), 3, count);
+  list = (_transform.linear() * list).colwise() + _transform.translation();
   }
 
 Vector3D Modeller::transformNormal( Vector3D in )
@@ -635,29 +1429,21 @@ Vector3D Modeller::transformNormal( Vector3D in )
   return _transform.linear() * in;
   }
 
-void Modeller::transformNormals( Vector <Vector3D> &list, bool reNormalize )
+void Modeller::transformNormals( Vector3D *normals, xsize count, bool reNormalize )
   {
-  if( _transform.isApprox(Transform::Identity()) )
+  if( !count || _transform.isApprox(Transform::Identity()) )
     {
     return;
     }
 
+  Eigen::Map<Eigen::Matrix<Real, 3, Eigen::Dynamic> > list(normals->data(), 3, count);
+  list = _transform.linear() * list;
+
   if(reNormalize)
     {
-    for(xsize i = 0, s = list.size(); i < s; ++i)
-      {
-      Vector3D& v = list[i];
-      Vector3D tr = (_transform.linear() * v).normalized();
-      v = tr;
-      }
-    }
-  else
-    {
-    for(xsize i = 0, s = list.size(); i < s; ++i)
+    for(xsize i = 0; i < count; ++i)
       {
-      Vector3D& v = list[i];
-      Vector3D tr = _transform.linear() * v;
-      v = tr;
+      list.col(i).normalize();
       }
     }
   }
@@ -667,13 +1453,13 @@ void Modeller::drawCurve(const AbstractCurve <Vector3D> &curve, xsize segments )
   Real start( curve.minimumT() );
   Real inc( ( curve.maximumT() - curve.minimumT() ) / (segments-1) );
 
-  xuint16 begin = (xuint16)_vertex.size();
+  xuint32 begin = (xuint32)_vertex.size();
 
   _vertex << transformPoint( curve.sample( start ) );
   _texture << Eks::Vector2D();
   _normals << Vector3D();
 
-  for( xuint16 x=1; x<(xuint16)segments; x++ )
+  for( xuint32 x=1; x<(xuint32)segments; x++ )
     {
     _linIndices << begin + (x-1) << begin + x;
 
@@ -684,4 +1470,82 @@ void Modeller::drawCurve(const AbstractCurve <Vector3D> &curve, xsize segments )
     }
   }
 
+void Modeller::drawCurve(
+    const AbstractCurve<Vector3D> &curve,
+    const ComplexTransform &projection,
+    const Vector2D &viewport,
+    Real pixelTolerance )
+  {
+  const AbstractCurve<Vector3D> *curves[] = { &curve };
+  drawCurves(curves, 1, projection, viewport, pixelTolerance);
+  }
+
+void Modeller::drawCurves(
+    const AbstractCurve<Vector3D> *const *curves,
+    xsize count,
+    const ComplexTransform &projection,
+    const Vector2D &viewport,
+    Real pixelTolerance )
+  {
+  // Curves are sampled untransformed, addVertices applies the transform.
+  const CurveTessellator tessellator(projection * _transform, viewport, pixelTolerance);
+
+  const xsize ranges = ParallelUtilities::rangeCount(count, CurveTessellator::MinParallelCurves);
+  Vector<Vector<Vector3D> *> points(_allocator);
+  Vector<xuint32> pointCounts(_allocator);
+  points.resize(ranges, 0);
+  pointCounts.resize(count, 0);
+  for( xsize i = 0; i < ranges; ++i )
+    {
+    points[i] = _allocator->create<Vector<Vector3D>>(_allocator);
+    }
+
+  try
+    {
+    ParallelUtilities::forRanges(count, CurveTessellator::MinParallelCurves, [&](xsize range, xsize begin, xsize end)
+      {
+      Vector<Vector3D> &rangePoints = *points[range];
+      for( xsize i = begin; i < end; ++i )
+        {
+        const xsize first = rangePoints.size();
+        tessellator.tessellate(*curves[i], &rangePoints);
+        pointCounts[i] = (xuint32)(rangePoints.size() - first);
+        }
+      });
+
+    // Ranges cover the curves in order, so appending them in range order keeps curve order.
+    xsize curve = 0;
+    for( xsize r = 0; r < ranges; ++r )
+      {
+      const Vector<Vector3D> &rangePoints = *points[r];
+      xuint32 vertex = (xuint32)addVertices(rangePoints.data(), rangePoints.size());
+      const xuint32 rangeEnd = vertex + (xuint32)rangePoints.size();
+
+      for( ; vertex < rangeEnd; ++curve )
+        {
+        for( xuint32 p = 1; p < pointCounts[curve]; ++p )
+          {
+          _linIndices << vertex + p - 1 << vertex + p;
+          }
+        vertex += pointCounts[curve];
+        }
+      }
+    }
+  catch(...)
+    {
+    for( xsize i = 0; i < ranges; ++i )
+      {
+      _allocator->destroy(points[i]);
+      }
+    throw;
+    }
+
+  for( xsize i = 0; i < ranges; ++i )
+    {
+    _allocator->destroy(points[i]);
+    }
+
+  _areLineIndicesSequential = false;
+  }
+
 }
@@ -0,0 +1,278 @@
+#include "XNormalGenerator.h"
+#include "XParallel.h"
+#include <algorithm>
+#include <cmath>
+
+#if EKS_XREAL_IS_DOUBLE == 0 && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+# define X_NORMAL_GENERATOR_SIMD 1
+# include <emmintrin.h>
+#else
+# define X_NORMAL_GENERATOR_SIMD 0
+#endif
+
+namespace Eks
+{
+
+NormalGenerator::NormalGenerator(AllocatorBase *allocator)
+    : _allocator(allocator)
+  {
+  }
+
+void NormalGenerator::generate(
+    const Vector3D *positions,
+    xsize positionCount,
+    const xuint32 *positionIndices,
+    xsize indexCount,
+    Real creaseAngle,
+    Vector<Vector3D> *normals,
+    Vector<xuint32> *normalIndices)
+  {
+  xAssert(normals);
+  xAssert(normalIndices);
+  xAssert((indexCount % 3) == 0);
+
+  const xsize triCount = indexCount / 3;
+
+  // Unnormalised face normals have length twice the triangle's area, so summing them
+  // weights each face by its area.
+  Vector<Vector3D> faceNormals(_allocator);
+  Vector<Vector3D> faceDirections(_allocator);
+  faceNormals.resize(triCount, Vector3D::Zero());
+  faceDirections.resize(triCount, Vector3D::Zero());
+
+  ParallelUtilities::forRanges(triCount, MinimumParallelTriangles, [&](xsize, xsize begin, xsize end)
+    {
+    for(xsize t = begin; t < end; ++t)
+      {
+      const xuint32 *tri = positionIndices + t * 3;
+      xAssert(tri[0] < positionCount && tri[1] < positionCount && tri[2] < positionCount);
+
+      const Vector3D &a = positions[tri[0]];
+      const Vector3D n = (positions[tri[1]] - a).cross(positions[tri[2]] - a);
+      faceNormals[t] = n;
+      faceDirections[t] = n;
+      }
+
+    normalise(faceDirections.data() + begin, end - begin);
+    });
+
+  // Bucket the corners by position, in corner order so the output is deterministic.
+  Vector<xuint32> offsets(_allocator);
+  offsets.resize(positionCount + 1, 0);
+  for(xsize i = 0; i < indexCount; ++i)
+    {
+    ++offsets[positionIndices[i] + 1];
+    }
+  for(xsize i = 0; i < positionCount; ++i)
+    {
+    offsets[i + 1] += offsets[i];
+    }
+
+  Vector<xuint32> corners(_allocator);
+  corners.resize(indexCount, 0);
+  Vector<xuint32> fill(_allocator);
+  fill.resizeAndCopy(positionCount, offsets.data());
+  for(xsize i = 0; i < indexCount; ++i)
+    {
+    corners[fill[positionIndices[i]]++] = (xuint32)i;
+    }
+
+  const bool smoothAll = creaseAngle >= X_PI;
+  const Real minimumCosine = std::cos(creaseAngle);
+
+  // For each corner, sum the face normals within the crease angle of its face, and number the
+  // distinct sums at each position.
+  Vector<Vector3D> cornerNormals(_allocator);
+  Vector<xuint32> cornerUnique(_allocator);
+  Vector<xuint32> uniqueOffsets(_allocator);
+  cornerNormals.resize(indexCount, Vector3D::Zero());
+  cornerUnique.resize(indexCount, 0);
+  uniqueOffsets.resize(positionCount + 1, 0);
+
+  ParallelUtilities::forRanges(positionCount, MinimumParallelPositions, [&](xsize, xsize begin, xsize end)
+    {
+    for(xsize p = begin; p < end; ++p)
+      {
+      const xsize first = offsets[p];
+      const xsize last = offsets[p + 1];
+
+      if(smoothAll)
+        {
+        Vector3D sum = Vector3D::Zero();
+        for(xsize s = first; s < last; ++s)
+          {
+          sum += faceNormals[corners[s] / 3];
+          }
+        for(xsize s = first; s < last; ++s)
+          {
+          cornerNormals[s] = sum;
+          cornerUnique[s] = 0;
+          }
+        uniqueOffsets[p + 1] = first != last ? 1 : 0;
+        continue;
+        }
+
+      xuint32 unique = 0;
+      for(xsize s = first; s < last; ++s)
+        {
+        const Vector3D &direction = faceDirections[corners[s] / 3];
+
+        Vector3D sum = Vector3D::Zero();
+        for(xsize o = first; o < last; ++o)
+          {
+          const xsize face = corners[o] / 3;
+          if(o == s || direction.dot(faceDirections[face]) >= minimumCosine)
+            {
+            sum += faceNormals[face];
+            }
+          }
+        cornerNormals[s] = sum;
+
+        xuint32 found = unique;
+        for(xsize q = first; q < s; ++q)
+          {
+          if(cornerNormals[q] == sum)
+            {
+            found = cornerUnique[q];
+            break;
+            }
+          }
+
+        if(found == unique)
+          {
+          ++unique;
+          }
+        cornerUnique[s] = found;
+        }
+      uniqueOffsets[p + 1] = unique;
+      }
+    });
+
+  for(xsize i = 0; i < positionCount; ++i)
+    {
+    uniqueOffsets[i + 1] += uniqueOffsets[i];
+    }
+
+  const xsize normalCount = uniqueOffsets[positionCount];
+  normals->clear();
+  normals->resize(normalCount, Vector3D::Zero());
+  normalIndices->clear();
+  normalIndices->resize(indexCount, 0);
+
+  ParallelUtilities::forRanges(positionCount, MinimumParallelPositions, [&](xsize, xsize begin, xsize end)
+    {
+    for(xsize p = begin; p < end; ++p)
+      {
+      for(xsize s = offsets[p]; s < offsets[p + 1]; ++s)
+        {
+        const xuint32 out = uniqueOffsets[p] + cornerUnique[s];
+        (*normals)[out] = cornerNormals[s];
+        (*normalIndices)[corners[s]] = out;
+        }
+      }
+
+    const xsize normalBegin = uniqueOffsets[begin];
+    normalise(normals->data() + normalBegin, uniqueOffsets[end] - normalBegin);
+    });
+  }
+
+void NormalGenerator::weldPositions(
+    const Vector3D *positions,
+    xsize count,
+    Vector<xuint32> *remap)
+  {
+  xAssert(remap);
+  remap->clear();
+  remap->resize(count, 0);
+  if(!count)
+    {
+    return;
+    }
+
+  Vector<xuint32> order(remap->allocator());
+  order.resize(count, 0);
+  for(xsize i = 0; i < count; ++i)
+    {
+    order[i] = (xuint32)i;
+    }
+
+  std::sort(order.data(), order.data() + count, [positions](xuint32 a, xuint32 b)
+    {
+    const Vector3D &pA = positions[a];
+    const Vector3D &pB = positions[b];
+    if(pA(0) != pB(0))
+      {
+      return pA(0) < pB(0);
+      }
+    if(pA(1) != pB(1))
+      {
+      return pA(1) < pB(1);
+      }
+    if(pA(2) != pB(2))
+      {
+      return pA(2) < pB(2);
+      }
+    return a < b;
+    });
+
+  // Equal positions are now adjacent, with the lowest index first in each run.
+  xuint32 canonical = order[0];
+  for(xsize i = 0; i < count; ++i)
+    {
+    if(positions[order[i]] != positions[canonical])
+      {
+      canonical = order[i];
+      }
+    (*remap)[order[i]] = canonical;
+    }
+  }
+
+void NormalGenerator::normalise(Vector3D *vectors, xsize count)
+  {
+  xsize i = 0;
+
+#if X_NORMAL_GENERATOR_SIMD
+  xCompileTimeAssert(sizeof(Vector3D) == sizeof(float) * 3);
+  float *data = reinterpret_cast<float *>(vectors);
+
+  const __m128 zero = _mm_setzero_ps();
+  const __m128 one = _mm_set1_ps(1.0f);
+  for(; i + 4 <= count; i += 4)
+    {
+    float *v = data + i * 3;
+    __m128 x = _mm_set_ps(v[9], v[6], v[3], v[0]);
+    __m128 y = _mm_set_ps(v[10], v[7], v[4], v[1]);
+    __m128 z = _mm_set_ps(v[11], v[8], v[5], v[2]);
+
+    __m128 lengthSq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z));
+    __m128 nonZero = _mm_cmpgt_ps(lengthSq, zero);
+    __m128 scale = _mm_and_ps(nonZero, _mm_div_ps(one, _mm_sqrt_ps(lengthSq)));
+
+    float xs[4], ys[4], zs[4];
+    _mm_storeu_ps(xs, _mm_mul_ps(x, scale));
+    _mm_storeu_ps(ys, _mm_mul_ps(y, scale));
+    _mm_storeu_ps(zs, _mm_mul_ps(z, scale));
+
+    for(xsize j = 0; j < 4; ++j)
+      {
+      v[j * 3 + 0] = xs[j];
+      v[j * 3 + 1] = ys[j];
+      v[j * 3 + 2] = zs[j];
+      }
+    }
+#endif
+
+  // The same operations as the SIMD lanes, so a vector's result doesn't depend on where
+  // the range splits put it.
+  for(; i < count; ++i)
+    {
+    Vector3D &v = vectors[i];
+    const Real lengthSq = (v.x() * v.x() + v.y() * v.y()) + v.z() * v.z();
+    if(lengthSq > 0)
+      {
+      v *= 1.0f / std::sqrt(lengthSq);
+      }
+    }
+  }
+
+}
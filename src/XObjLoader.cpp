@@ -1,6 +1,14 @@
 #include "XObjLoader.h"
+#include "XGeometry.h"
 #include "Containers/XStringBuilder.h"
 #include "Utilities/XParseException.h"
+#include "XParallel.h"
+#include "XNumberScanner.h"
+#include "XNormalGenerator.h"
+#include "XTangentGenerator.h"
+#include "XVertexEncoder.h"
+#include "XMappedFile.h"
+#include <algorithm>
 
 namespace Eks
 {
@@ -38,21 +46,21 @@ xsize skipSpaces(const ObjLoader::LineCache &line, xsize from, xsize &firstSpace
   return from;
   }
 
+// Four component elements take their w from [w], rather than from [elem].
 template <xsize MaxCount> void writeVector(
     const ObjLoader::ElementVector &elem,
+    Real w,
     Vector<xuint8> *data)
   {
+  const Real values[] = { elem(0), elem(1), elem(2), w };
   const xsize oldEnd = data->size();
   const xsize expandSize = sizeof(ObjLoader::ElementVector::Scalar) * MaxCount;
 
-  const xuint8* elemData = (const xuint8*)elem.data();
-
-  data->resizeAndCopy(oldEnd + expandSize, elemData);
+  data->resizeAndCopy(oldEnd + expandSize, (const xuint8 *)values);
   }
 
 template <xsize MaxCount>
 bool readVector(
-    Eks::String &scratch,
     const ObjLoader::LineCache &arr,
     xsize lineIdx,
     xsize start,
@@ -68,18 +76,15 @@ bool readVector(
         count < MaxCount &&
         pos != std::numeric_limits<xsize>::max())
     {
-    scratch.mid(arr, pos, end - pos);
-
-    bool error = false;
-    ret(count++) = scratch.toType<Real>(&error);
-    if (error)
+    const char *token = arr.data() + pos;
+    if (!NumberScanner::parseReal(token, arr.data() + end, &ret(count++)))
       {
       throw Eks::ParseException(X_PARSE_ERROR(
         Eks::ParseError::LineContext,
         Eks::String(arr.data(), arr.length()),
         lineIdx,
         pos,
-        Eks::StringBuilder() << "Error reading number '" << scratch << "'"));
+        Eks::StringBuilder() << "Error reading number '" << Eks::String(token, end - pos) << "'"));
       }
 
     pos = skipSpaces(arr, pos, firstSpace);
@@ -88,16 +93,107 @@ bool readVector(
   (*data) << ret;
   return count == MaxCount;
   }
+
+// A single line of an in place parse, [begin, end) points into the callers buffer.
+struct ObjLine
+  {
+  const char *begin;
+  const char *end;
+  xsize index;
+
+  Eks::String string() const
+    {
+    return Eks::String(begin, end - begin);
+    }
+
+  xsize column(const char *pos) const
+    {
+    return pos - begin;
+    }
+  };
+
+inline bool isBlank(char c)
+  {
+  return c == ' ' || c == '\t' || c == '\r';
+  }
+
+inline const char *skipBlanks(const char *pos, const char *end)
+  {
+  while(pos < end && isBlank(*pos))
+    {
+    ++pos;
+    }
+  return pos;
+  }
+
+inline const char *findBlank(const char *pos, const char *end)
+  {
+  while(pos < end && !isBlank(*pos))
+    {
+    ++pos;
+    }
+  return pos;
+  }
+
+inline bool tokenEquals(const char *begin, const char *end, const char *str, xsize len)
+  {
+  return (xsize)(end - begin) == len && memcmp(begin, str, len) == 0;
+  }
+
+template <xsize MaxCount>
+bool readVectorInPlace(
+    const ObjLine &line,
+    const char *pos,
+    Vector<ObjLoader::ElementVector>* data)
+  {
+  ObjLoader::ElementVector ret = ObjLoader::ElementVector::Zero();
+
+  xsize count = 0;
+  pos = skipBlanks(pos, line.end);
+  while(pos < line.end && count < MaxCount)
+    {
+    const char *tokenEnd = findBlank(pos, line.end);
+
+    if (!NumberScanner::parseReal(pos, tokenEnd, &ret(count++)))
+      {
+      throw Eks::ParseException(X_PARSE_ERROR(
+        Eks::ParseError::LineContext,
+        line.string(),
+        line.index,
+        line.column(pos),
+        Eks::StringBuilder() << "Error reading number '" << Eks::String(pos, tokenEnd - pos) << "'"));
+      }
+
+    pos = skipBlanks(tokenEnd, line.end);
+    }
+
+  (*data) << ret;
+  return count == MaxCount;
+  }
 }
 
 bool readAndFlipYVector2(
-    Eks::String &scratch,
     const ObjLoader::LineCache &arr,
     xsize lineIdx,
     xsize start,
     Vector<ObjLoader::ElementVector>* data)
   {
-  if(!readVector<2>(scratch, arr, lineIdx, start, data))
+  if(!readVector<2>(arr, lineIdx, start, data))
+    {
+    return false;
+    }
+  ObjLoader::ElementVector& toFlip = data->back();
+  toFlip.y() = 1.0f + (-1.0f * toFlip.y());
+
+  return true;
+  }
+
+bool readAndFlipYVector2InPlace(
+    const ObjLine &line,
+    const char *pos,
+    Vector<ObjLoader::ElementVector>* data)
+  {
+  if(!readVectorInPlace<2>(line, pos, data))
     {
     return false;
     }
@@ -113,31 +209,94 @@ struct ObjLoader::ObjElement
   const char* name;
   xsize components;
   bool (*read)(
-      Eks::String &scratch,
       const ObjLoader::LineCache &line,
       xsize lineIdx,
       xsize index,
       Vector<ElementVector>* data);
+  bool (*readInPlace)(
+      const ObjLine &line,
+      const char *pos,
+      Vector<ElementVector>* data);
   void (*write)(
       const ElementVector &elem,
+      Real w,
       Vector<xuint8> *data);
   void (*compute)(
       ObjLoader::ElementData *elements,
       xsize itemCount,
       Vector<VectorI3D> *triangles,
-      xsize i);
+      xsize i,
+      Real creaseAngle,
+      AllocatorBase *allocator);
+  // Per corner elements are generated, not read, and are indexed by triangle corner
+  // rather than by an index in the triangle.
+  bool perCorner;
   };
 
 namespace
 {
 
+ShaderVertexLayoutDescription::Format floatFormat(xsize components)
+  {
+  xAssert(components >= 1 && components <= 4);
+  return (ShaderVertexLayoutDescription::Format)(ShaderVertexLayoutDescription::FormatFloat1 + components - 1);
+  }
+
+// Append [elem], with [w] as its fourth component if it has one, to [data] in [element]'s
+// format, float formats are copied directly.
+void writeElement(const ObjLoader::ElementData &element, const ObjLoader::ElementVector &elem, Real w, Vector<xuint8> *data)
+  {
+  const ObjLoader::ObjElement *desc = element.desc;
+  if(element.format == floatFormat(desc->components))
+    {
+    desc->write(elem, w, data);
+    return;
+    }
+
+  const Real values[] = { elem(0), elem(1), elem(2), w };
+  const xsize oldEnd = data->size();
+  data->resize(oldEnd + ShaderVertexLayoutDescription::formatSize(element.format));
+  VertexEncoder::encode(element.format, values, desc->components, data->data() + oldEnd);
+  }
+
+// Append [element]'s value at [index], and its sign if it has them.
+void writeElement(const ObjLoader::ElementData &element, xsize index, Vector<xuint8> *data)
+  {
+  const Real w = index < element.signs.size() ? element.signs[index] : 0.0f;
+  writeElement(element, element.data[index], w, data);
+  }
+
+}
+
+namespace
+{
+
+inline xuint32 hashIndices(const VectorI3D &idx)
+  {
+  xuint32 hash = (xuint32)idx(0) * 0x9E3779B1u;
+  hash ^= (xuint32)idx(1) * 0x85EBCA77u + (hash << 6) + (hash >> 2);
+  hash ^= (xuint32)idx(2) * 0xC2B2AE3Du + (hash << 6) + (hash >> 2);
+  return hash ^ (hash >> 15);
+  }
+
+bool readNone(const ObjLoader::LineCache &, xsize, xsize, Vector<ObjLoader::ElementVector> *)
+  {
+  return false;
+  }
+
+bool readNoneInPlace(const ObjLine &, const char *, Vector<ObjLoader::ElementVector> *)
+  {
+  return false;
+  }
+
 void computeNull(
     ObjLoader::ElementData *elements,
     xsize,
     Vector<VectorI3D> *triangles,
-    xsize i)
+    xsize i,
+    Real,
+    AllocatorBase *)
   {
-  xAssertFail();
   ObjLoader::ElementData &el = elements[i];
 
   el.data.clear();
@@ -154,7 +313,9 @@ void computeNormal(
     ObjLoader::ElementData *elements,
     xsize itemCount,
     Vector<VectorI3D> *triangles,
-    xsize elIdx)
+    xsize elIdx,
+    Real creaseAngle,
+    AllocatorBase *allocator)
   {
   xsize posIdx = Eks::maxFor(posIdx);
   ObjLoader::ElementData *position = 0;
@@ -179,6 +340,37 @@ void computeNormal(
   el.data.clear();
 
   xAssert((triangles->size() % 3) == 0);
+  if(creaseAngle >= 0.0f)
+    {
+    const xsize cornerCount = triangles->size();
+
+    Vector<xuint32> positionIndices(allocator);
+    positionIndices.resize(cornerCount, 0);
+    for(xsize i = 0; i < cornerCount; ++i)
+      {
+      positionIndices[i] = (xuint32)(*triangles)[i][posIdx];
+      }
+
+    Vector<Vector3D> normals(allocator);
+    Vector<xuint32> normalIndices(allocator);
+    NormalGenerator generator(allocator);
+    generator.generate(
+      position->data.data(),
+      position->data.size(),
+      positionIndices.data(),
+      cornerCount,
+      creaseAngle,
+      &normals,
+      &normalIndices);
+
+    el.data.resizeAndCopy(normals.size(), normals.data());
+    for(xsize i = 0; i < cornerCount; ++i)
+      {
+      (*triangles)[i][elIdx] = (int)normalIndices[i];
+      }
+    return;
+    }
+
   for(xsize triIndex = 0, s = triangles->size(); triIndex < s; triIndex+=3)
     {
     VectorI3D &triA = triangles->at(triIndex);
@@ -198,13 +390,134 @@ void computeNormal(
     triC[elIdx] = (int)newNorm;
     }
   }
+
+xsize findIndexedElement(
+    const ObjLoader::ElementData *elements,
+    xsize itemCount,
+    ShaderVertexLayoutDescription::Semantic semantic)
+  {
+  for(xsize i = 0; i < itemCount; ++i)
+    {
+    if(!elements[i].desc->perCorner && elements[i].desc->semantic == semantic)
+      {
+      return i;
+      }
+    }
+  return Eks::maxFor(itemCount);
+  }
+
+const ObjLoader::ElementVector &elementValue(const ObjLoader::ElementData &element, const VectorI3D &idx, xsize elIdx)
+  {
+  const xsize index = idx(elIdx);
+  if(index >= element.data.size())
+    {
+    throw Eks::ParseException(X_PARSE_ERROR(Eks::StringBuilder() << "Error generating tangents, attribute '" << element.desc->name << "' invalid index [" << index << "/" << element.data.size() << "]"));
+    }
+  return element.data[index];
+  }
+
+// Generate a tangent per triangle corner, shared by corners with the same indices, so that
+// bakeIndexed() still welds them.
+void computeTangent(
+    ObjLoader::ElementData *elements,
+    xsize itemCount,
+    Vector<VectorI3D> *triangles,
+    xsize elIdx,
+    Real,
+    AllocatorBase *allocator)
+  {
+  ObjLoader::ElementData &el = elements[elIdx];
+  el.data.clear();
+
+  const xsize posIdx = findIndexedElement(elements, itemCount, ShaderVertexLayoutDescription::Position);
+  const xsize normIdx = findIndexedElement(elements, itemCount, ShaderVertexLayoutDescription::Normal);
+  const xsize texIdx = findIndexedElement(elements, itemCount, ShaderVertexLayoutDescription::TextureCoordinate);
+  if(posIdx >= itemCount || normIdx >= itemCount)
+    {
+    xAssertFail();
+    return;
+    }
+
+  const xsize cornerCount = triangles->size();
+  xAssert((cornerCount % 3) == 0);
+
+  // Number the unique index tuples, as bakeIndexed does.
+  xsize tableSize = 16;
+  while(tableSize < cornerCount * 2)
+    {
+    tableSize <<= 1;
+    }
+  const xsize tableMask = tableSize - 1;
+
+  Vector<xuint32> table(allocator);
+  table.resize(tableSize, 0);
+
+  Vector<VectorI3D> unique(allocator);
+  Vector<Vector3D> positions(allocator);
+  Vector<Vector3D> normals(allocator);
+  Vector<Vector2D> texCoords(allocator);
+  Vector<xuint32> vertexIds(allocator);
+  vertexIds.resize(cornerCount, 0);
+
+  for(xsize i = 0; i < cornerCount; ++i)
+    {
+    const VectorI3D &idx = (*triangles)[i];
+
+    xsize slot = hashIndices(idx) & tableMask;
+    while(table[slot] != 0 && unique[table[slot] - 1] != idx)
+      {
+      slot = (slot + 1) & tableMask;
+      }
+
+    if(table[slot] == 0)
+      {
+      unique << idx;
+      table[slot] = (xuint32)unique.size();
+
+      positions << elementValue(elements[posIdx], idx, posIdx);
+      normals << elementValue(elements[normIdx], idx, normIdx);
+
+      Vector2D tex = Vector2D::Zero();
+      if(texIdx < itemCount)
+        {
+        const ObjLoader::ElementVector &value = elementValue(elements[texIdx], idx, texIdx);
+        tex = Vector2D(value(0), value(1));
+        }
+      texCoords << tex;
+      }
+
+    vertexIds[i] = table[slot] - 1;
+    }
+
+  Vector<Vector4D> tangents(allocator);
+  TangentGenerator generator(allocator);
+  generator.generate(
+    positions.data(),
+    normals.data(),
+    texCoords.data(),
+    unique.size(),
+    vertexIds.data(),
+    cornerCount,
+    &tangents);
+
+  el.data.resize(cornerCount);
+  el.signs.resize(cornerCount);
+  for(xsize i = 0; i < cornerCount; ++i)
+    {
+    const Vector4D &tangent = tangents[vertexIds[i]];
+    el.data[i] = tangent.head<3>();
+    el.signs[i] = tangent.w();
+    }
+  }
+
 }
 
 const ObjLoader::ObjElement elementDescriptionsImpl[] =
   {
-    { ShaderVertexLayoutDescription::Position, "v", 3, readVector<3>, writeVector<3>, computeNull  },
-    { ShaderVertexLayoutDescription::Normal, "vn", 3, readVector<3>, writeVector<3>, computeNormal },
-    { ShaderVertexLayoutDescription::TextureCoordinate, "vt", 2, readAndFlipYVector2, writeVector<2>, computeNull }
+    { ShaderVertexLayoutDescription::Position, "v", 3, readVector<3>, readVectorInPlace<3>, writeVector<3>, computeNull, false },
+    { ShaderVertexLayoutDescription::Normal, "vn", 3, readVector<3>, readVectorInPlace<3>, writeVector<3>, computeNormal, false },
+    { ShaderVertexLayoutDescription::TextureCoordinate, "vt", 2, readAndFlipYVector2, readAndFlipYVector2InPlace, writeVector<2>, computeNull, false },
+    { ShaderVertexLayoutDescription::BiNormal, "tangent", 4, readNone, readNoneInPlace, writeVector<4>, computeTangent, true }
   };
 
 const ObjLoader::ObjElement *elementDescriptions[] =
@@ -213,16 +526,27 @@ const ObjLoader::ObjElement *elementDescriptions[] =
   0,                           // colour
   &elementDescriptionsImpl[2], // tex
   &elementDescriptionsImpl[1], // normal
-  0,                           // binormal
+  &elementDescriptionsImpl[3], // binormal
   };
 
 xCompileTimeAssert(X_ARRAY_COUNT(elementDescriptions) == ShaderVertexLayoutDescription::SemanticCount);
 
 ObjLoader::ObjLoader(AllocatorBase *allocator)
     : _allocator(allocator),
-      _scratchString(_allocator)
+      _monitor(0),
+      _parallelChunkSize(MinimumParallelChunkSize),
+      _parallelChunks(0)
+  {
+  for(xsize i = 0; i < ShaderVertexLayoutDescription::SemanticCount; ++i)
+    {
+    _formats[i] = ShaderVertexLayoutDescription::FormatCount;
+    }
+  }
+
+void ObjLoader::setFormat(ShaderVertexLayoutDescription::Semantic semantic, ShaderVertexLayoutDescription::Format fmt)
   {
-  _scratchString.reserve(ExpectedFloatLength);
+  xAssert(semantic < ShaderVertexLayoutDescription::SemanticCount);
+  _formats[semantic] = fmt;
   }
 
 const ObjLoader::ObjElement *ObjLoader::findObjectDescriptionForSemantic(ShaderVertexLayoutDescription::Semantic s)
@@ -230,6 +554,30 @@ const ObjLoader::ObjElement *ObjLoader::findObjectDescriptionForSemantic(ShaderV
   return elementDescriptions[s];
   }
 
+namespace
+{
+
+void bakeVertex(
+    const VectorI3D &idx,
+    xsize corner,
+    const ObjLoader::ElementData *elements,
+    xsize elementCount,
+    Vector<xuint8> *bakedData)
+  {
+  for(xsize elIdx = 0; elIdx < elementCount; ++elIdx)
+    {
+    const ObjLoader::ElementData &element(elements[elIdx]);
+    xsize index = element.desc->perCorner ? corner : idx(elIdx);
+    if (index >= element.data.size())
+      {
+      throw Eks::ParseException(X_PARSE_ERROR(Eks::StringBuilder() << "Error baking attribute '" << element.desc->name << "' invalid index [" << index << "/" << element.data.size() << "]"));
+      }
+    writeElement(element, index, bakedData);
+    }
+  }
+
+}
+
 bool ObjLoader::bake(
     const Vector<VectorI3D>& unbakedTriangles,
     const ElementData *elements,
@@ -237,20 +585,89 @@ bool ObjLoader::bake(
     Vector<xuint8> *bakedData)
   {
   for(xsize i = 0, s = unbakedTriangles.size(); i < s; ++i)
+    {
+    bakeVertex(unbakedTriangles[i], i, elements, elementCount, bakedData);
+    }
+  return true;
+  }
+
+namespace
+{
+
+// Bake a vertex per unique index tuple in [unbakedTriangles], and an index per corner.
+template <typename IndexType> void bakeIndexedVertices(
+    const Vector<VectorI3D>& unbakedTriangles,
+    const ObjLoader::ElementData *elements,
+    xsize elementCount,
+    Vector<xuint8> *bakedData,
+    Vector<IndexType> *indices,
+    AllocatorBase *allocator)
+  {
+  const xsize cornerCount = unbakedTriangles.size();
+
+  // Open addressed table of (unique vertex + 1), 0 marks an empty slot.
+  xsize tableSize = 16;
+  while(tableSize < cornerCount * 2)
+    {
+    tableSize <<= 1;
+    }
+  const xsize tableMask = tableSize - 1;
+
+  Vector<xuint32> table(allocator);
+  table.resize(tableSize);
+  memset(table.data(), 0, tableSize * sizeof(xuint32));
+
+  Vector<VectorI3D> unique(allocator);
+  unique.reserve(cornerCount / 4);
+
+  indices->reserve(indices->size() + cornerCount);
+  for(xsize i = 0; i < cornerCount; ++i)
     {
     const VectorI3D &idx = unbakedTriangles[i];
 
-    for(xsize elIdx = 0; elIdx < elementCount; ++elIdx)
+    xsize slot = hashIndices(idx) & tableMask;
+    while(table[slot] != 0 && unique[table[slot] - 1] != idx)
       {
-      const ElementData &element(elements[elIdx]);
-      xsize index = idx(elIdx);
-      if (index >= element.data.size())
+      slot = (slot + 1) & tableMask;
+      }
+
+    if(table[slot] == 0)
+      {
+      if(unique.size() > std::numeric_limits<IndexType>::max())
         {
-        throw Eks::ParseException(X_PARSE_ERROR(Eks::StringBuilder() << "Error baking attribute '" << element.desc->name << "' invalid index [" << index << "/" << element.data.size() << "]"));
+        throw Eks::ParseException(X_PARSE_ERROR(Eks::StringBuilder() << "Error baking indices, more than " << (xuint64)std::numeric_limits<IndexType>::max() + 1 << " unique vertices"));
         }
-      element.desc->write(element.data[index], bakedData);
+
+      bakeVertex(idx, i, elements, elementCount, bakedData);
+      unique << idx;
+      table[slot] = (xuint32)unique.size();
       }
+
+    (*indices) << (IndexType)(table[slot] - 1);
     }
+  }
+
+}
+
+bool ObjLoader::bakeIndexed(
+    const Vector<VectorI3D>& unbakedTriangles,
+    const ElementData *elements,
+    xsize elementCount,
+    Vector<xuint8> *bakedData,
+    Vector<xuint16> *indices)
+  {
+  bakeIndexedVertices(unbakedTriangles, elements, elementCount, bakedData, indices, _allocator);
+  return true;
+  }
+
+bool ObjLoader::bakeIndexed(
+    const Vector<VectorI3D>& unbakedTriangles,
+    const ElementData *elements,
+    xsize elementCount,
+    Vector<xuint8> *bakedData,
+    Vector<xuint32> *indices)
+  {
+  bakeIndexedVertices(unbakedTriangles, elements, elementCount, bakedData, indices, _allocator);
   return true;
   }
 
@@ -290,7 +707,8 @@ bool ObjLoader::readIndices(
       doneLast = true;
       sepEnd = firstSpace;
       }
-    _scratchString.mid(arr, pos, sepEnd - pos);
+    const char *token = arr.data() + pos;
+    const char *tokenEnd = arr.data() + sepEnd;
 
     ShaderVertexLayoutDescription::Semantic semantic = SemanticMap[count++];
     xsize index = Eks::maxFor(index);
@@ -309,18 +727,17 @@ bool ObjLoader::readIndices(
       continue;
       }
 
-    if (_scratchString.length())
+    if (tokenEnd > token)
       {
-      bool error = false;
-      int val = _scratchString.toType<int>(&error);
-      if(error)
+      int val = 0;
+      if(!NumberScanner::parseInteger(token, tokenEnd, &val))
         {
         throw Eks::ParseException(X_PARSE_ERROR(
           Eks::ParseError::LineContext,
           Eks::String(arr.data(), arr.length()),
           lineIdx,
           pos,
-          Eks::StringBuilder() << "Failed reading index '" << _scratchString << "'"));
+          Eks::StringBuilder() << "Failed reading index '" << Eks::String(token, tokenEnd - token) << "'"));
         }
       indices(index) = val - 1;
       }
@@ -357,6 +774,11 @@ bool ObjLoader::findElementType(
     {
     const ShaderVertexLayoutDescription::Semantic item = items[i];
     const ObjElement* element = elementDescriptions[item];
+    if(element->perCorner)
+      {
+      continue;
+      }
+
     xsize len = strlen(element->name);
 
     if(line.compare(element->name, len) && line[len] == space)
@@ -368,71 +790,955 @@ bool ObjLoader::findElementType(
   return false;
   }
 
-bool ObjLoader::load(
-    const char *data,
-    xsize dataSize,
+bool ObjLoader::initialiseElements(
     const ShaderVertexLayoutDescription::Semantic *items,
     xsize itemCount,
-    Vector<VectorI3D> *tris,
     xsize *vertexSize,
     ElementData *elementData)
   {
-  xAssert(tris);
-  xAssert(vertexSize);
-  xAssert(elementData);
-
-  LineCache line(ExpectedLineLength, ' ', _allocator);
-  xsize lineIdx = 0;
-
   *vertexSize = 0;
   for(xsize i = 0; i < itemCount; ++i)
     {
     ShaderVertexLayoutDescription::Semantic semantic = items[i];
     const ObjElement *el = elementDescriptions[semantic];
 
+    elementData[i].desc = el;
     if(el != 0)
       {
-      elementData[i].desc = el;
+      const ShaderVertexLayoutDescription::Format fmt = _formats[semantic];
+      elementData[i].format = fmt != ShaderVertexLayoutDescription::FormatCount ? fmt : floatFormat(el->components);
+
       elementData[i].data.setAllocator(_allocator);
       elementData[i].data.reserve(ExpectedVertices);
+      elementData[i].signs.setAllocator(_allocator);
+      elementData[i].signs.clear();
       }
     }
 
 
+  // Triangles hold an index for each read element, so those must come first.
+  xsize indexedCount = 0;
   for(xsize i = 0; i < itemCount; ++i)
     {
     const ObjElement *el = elementData[i].desc;
-    if(!el)
+    if(!el || (!el->perCorner && indexedCount != i))
       {
       xAssertFail();
       return false;
       }
 
-    *vertexSize += sizeof(float) * el->components;
+    if(!el->perCorner)
+      {
+      ++indexedCount;
+      }
+
+    *vertexSize += ShaderVertexLayoutDescription::formatSize(elementData[i].format);
     }
 
-  Vector<VectorI3D, 6> tempPoly(_allocator);
+  return indexedCount <= MaxComponent;
+  }
 
-  const char *pos = data;
-  while(pos < (data + dataSize))
-    {
-    line.clear();
-    ++lineIdx;
+namespace
+{
 
-    while(*pos != '\n' && pos < (data + dataSize))
+const ShaderVertexLayoutDescription::Semantic FaceSemanticMap[] =
+  {
+  ShaderVertexLayoutDescription::Position,
+  ShaderVertexLayoutDescription::TextureCoordinate,
+  ShaderVertexLayoutDescription::Normal
+  };
+
+void findFaceElements(
+    const ObjLoader::ElementData *elementData,
+    xsize elementCount,
+    xsize (&faceElements)[X_ARRAY_COUNT(FaceSemanticMap)])
+  {
+  for(xsize f = 0; f < X_ARRAY_COUNT(FaceSemanticMap); ++f)
+    {
+    faceElements[f] = Eks::maxFor(faceElements[f]);
+    for(xsize i = 0; i < elementCount; ++i)
       {
-      line << *pos;
-      ++pos;
+      if(elementData[i].desc->semantic == FaceSemanticMap[f])
+        {
+        faceElements[f] = i;
+        break;
+        }
       }
-    ++pos; // skip \n
+    }
+  }
 
-    // remove the carriage return from win files.
-    if(line.back() == '\r')
+xsize findElementInPlace(
+    const char *keyword,
+    const char *keywordEnd,
+    const ObjLoader::ElementData *elementData,
+    xsize elementCount)
+  {
+  for(xsize i = 0; i < elementCount; ++i)
+    {
+    if(elementData[i].desc->perCorner)
       {
-      line.popBack();
+      continue;
       }
 
-    // add a space to the end
+    const char *name = elementData[i].desc->name;
+    if(tokenEquals(keyword, keywordEnd, name, strlen(name)))
+      {
+      return i;
+      }
+    }
+
+  return Eks::maxFor(elementCount);
+  }
+
+// Read a "v/vt/vn" face vertex from [begin, end), writing indices for the elements that are loaded.
+// Negative indices count back from the elements read so far, and are flagged in the returned
+// mask (one bit per element) so chunked parses can rebase them.
+xuint8 readFaceVertexInPlace(
+    const ObjLine &line,
+    const char *begin,
+    const char *end,
+    const xsize (&faceElements)[X_ARRAY_COUNT(FaceSemanticMap)],
+    const ObjLoader::ElementData *elementData,
+    VectorI3D &indices)
+  {
+  indices = VectorI3D::Zero();
+  xuint8 relative = 0;
+
+  const char *pos = begin;
+  for(xsize count = 0; count < X_ARRAY_COUNT(FaceSemanticMap) && pos <= end; ++count)
+    {
+    const char *sepEnd = (const char *)memchr(pos, separator, end - pos);
+    if(!sepEnd)
+      {
+      sepEnd = end;
+      }
+
+    const xsize element = faceElements[count];
+    if(element != Eks::maxFor(element) && sepEnd != pos)
+      {
+      int val = 0;
+      if(!NumberScanner::parseInteger(pos, sepEnd, &val))
+        {
+        throw Eks::ParseException(X_PARSE_ERROR(
+          Eks::ParseError::LineContext,
+          line.string(),
+          line.index,
+          line.column(pos),
+          Eks::StringBuilder() << "Failed reading index '" << Eks::String(pos, sepEnd - pos) << "'"));
+        }
+
+      if(val < 0)
+        {
+        indices(element) = (int)elementData[element].data.size() + val;
+        relative |= 1 << element;
+        }
+      else
+        {
+        indices(element) = val - 1;
+        }
+      }
+
+    pos = sepEnd + 1;
+    }
+
+  return relative;
+  }
+
+// Close the current submesh at [indexCount], and start a new one for an o, g or usemtl line.
+// The new submesh keeps the name or material the line doesn't change.
+void beginSubmesh(
+    Vector<ObjLoader::Submesh> *submeshes,
+    xsize indexCount,
+    bool material,
+    const char *value,
+    const char *valueEnd,
+    AllocatorBase *allocator)
+  {
+  xAssert(submeshes->size());
+  ObjLoader::Submesh &current = submeshes->back();
+  current.indexCount = indexCount - current.firstIndex;
+
+  ObjLoader::Submesh next;
+  next.name = current.name;
+  next.material = current.material;
+  next.firstIndex = indexCount;
+
+  String &dest = material ? next.material : next.name;
+  dest = String(value, valueEnd - value, allocator);
+
+  (*submeshes) << next;
+  }
+
+// Remove the empty submeshes after [first], and find the bounds of the rest.
+void finishSubmeshes(
+    Vector<ObjLoader::Submesh> *submeshes,
+    xsize first,
+    const Vector<VectorI3D> &tris,
+    const ObjLoader::ElementData *elementData,
+    xsize itemCount)
+  {
+  xsize posIdx = Eks::maxFor(posIdx);
+  for(xsize i = 0; i < itemCount; ++i)
+    {
+    if(elementData[i].desc->semantic == ShaderVertexLayoutDescription::Position)
+      {
+      posIdx = i;
+      }
+    }
+
+  xsize out = first;
+  for(xsize i = first, s = submeshes->size(); i < s; ++i)
+    {
+    ObjLoader::Submesh &submesh = (*submeshes)[i];
+    if(!submesh.indexCount)
+      {
+      continue;
+      }
+
+    submesh.bounds = BoundingBox();
+    if(posIdx < itemCount)
+      {
+      const Vector<ObjLoader::ElementVector> &positions = elementData[posIdx].data;
+      for(xsize idx = submesh.firstIndex, end = submesh.firstIndex + submesh.indexCount; idx < end; ++idx)
+        {
+        const xsize pos = tris[idx](posIdx);
+        if(pos < positions.size())
+          {
+          submesh.bounds.unite(positions[pos]);
+          }
+        }
+      }
+
+    if(out != i)
+      {
+      (*submeshes)[out] = submesh;
+      }
+    ++out;
+    }
+
+  while(submeshes->size() > out)
+    {
+    submeshes->popBack();
+    }
+  }
+
+// Of the submeshes a parse started, the first whose name, and the first whose material, was
+// set by a line in the parsed range. Those before carry what preceded the range.
+struct SubmeshInheritance
+  {
+  xsize firstNamed;
+  xsize firstWithMaterial;
+  };
+
+// Parse the lines in [begin, end), numbering them from [firstLine]. Relative face indices are
+// resolved against the elements in [elementData], and if [relativeFixups] is non-null, the
+// triangle corner and element of each is recorded as (corner * MaxComponent + element).
+// If [submeshes] is non-null, an unnamed submesh is started at the current end of [tris], and
+// each o, g or usemtl line starts another. The last submesh is closed at the end of the range,
+// and if [inheritance] is non-null it is filled relative to that first submesh.
+// [afterFace] is called after each face's triangles are appended to [tris].
+// Returns false if [monitor] cancelled the parse.
+template <typename AfterFace> bool parseRangeInPlace(
+    const char *begin,
+    const char *end,
+    xsize firstLine,
+    ObjLoader::ElementData *elementData,
+    xsize itemCount,
+    const xsize (&faceElements)[X_ARRAY_COUNT(FaceSemanticMap)],
+    Vector<VectorI3D> *tris,
+    Vector<xsize> *relativeFixups,
+    Vector<ObjLoader::Submesh> *submeshes,
+    SubmeshInheritance *inheritance,
+    ObjLoader::Monitor *monitor,
+    AllocatorBase *allocator,
+    const AfterFace &afterFace)
+  {
+  Vector<VectorI3D, 6> tempPoly(allocator);
+  Vector<xuint8, 6> tempRelative(allocator);
+
+  const xsize firstSubmesh = submeshes ? submeshes->size() : 0;
+  if(submeshes)
+    {
+    ObjLoader::Submesh initial;
+    initial.firstIndex = tris->size();
+    (*submeshes) << initial;
+    }
+
+  if(inheritance)
+    {
+    inheritance->firstNamed = Eks::maxFor(inheritance->firstNamed);
+    inheritance->firstWithMaterial = Eks::maxFor(inheritance->firstWithMaterial);
+    }
+
+  ObjLine line;
+  line.index = firstLine;
+
+  const char *pos = begin;
+  const char *reported = begin;
+  while(pos < end)
+    {
+    if(monitor && (xsize)(pos - reported) >= ObjLoader::MonitorInterval)
+      {
+      if(!monitor->advance(pos - reported))
+        {
+        return false;
+        }
+      reported = pos;
+      }
+
+    const char *lineEnd = (const char *)memchr(pos, '\n', end - pos);
+    line.begin = pos;
+    line.end = lineEnd ? lineEnd : end;
+    ++line.index;
+
+    pos = line.end + 1;
+
+    // remove the carriage return from win files.
+    if(line.end > line.begin && line.end[-1] == '\r')
+      {
+      --line.end;
+      }
+
+    const char *keyword = skipBlanks(line.begin, line.end);
+    const char *keywordEnd = findBlank(keyword, line.end);
+    if(keyword == keywordEnd)
+      {
+      continue;
+      }
+
+    xsize foundItem = findElementInPlace(keyword, keywordEnd, elementData, itemCount);
+    if(foundItem < itemCount)
+      {
+      ObjLoader::ElementData &data = elementData[foundItem];
+      const ObjLoader::ObjElement *element(data.desc);
+      xAssert(element);
+
+      if (!element->readInPlace(line, keywordEnd, &(data.data)))
+        {
+        throw Eks::ParseException(X_PARSE_ERROR(
+          Eks::ParseError::LineContext,
+          line.string(),
+          line.index,
+          line.column(keywordEnd),
+          "Failed reading element"));
+        }
+      }
+    else if(tokenEquals(keyword, keywordEnd, "f", 1))
+      {
+      tempPoly.clear();
+      tempRelative.clear();
+
+      VectorI3D indices;
+      const char *vertex = skipBlanks(keywordEnd, line.end);
+      while(vertex < line.end)
+        {
+        const char *vertexEnd = findBlank(vertex, line.end);
+        tempRelative << readFaceVertexInPlace(line, vertex, vertexEnd, faceElements, elementData, indices);
+        tempPoly << indices;
+
+        vertex = skipBlanks(vertexEnd, line.end);
+        }
+
+      for(xsize i = 2; i < tempPoly.size(); ++i)
+        {
+        const xsize corners[] = { 0, i-1, i };
+        xForeach(xsize corner, corners)
+          {
+          const xuint8 relative = tempRelative[corner];
+          if(relativeFixups && relative)
+            {
+            for(xsize el = 0; el < ObjLoader::MaxComponent; ++el)
+              {
+              if(relative & (1 << el))
+                {
+                (*relativeFixups) << (tris->size() * ObjLoader::MaxComponent + el);
+                }
+              }
+            }
+
+          (*tris) << tempPoly[corner];
+          }
+        }
+
+      afterFace();
+      }
+    else if(submeshes &&
+            (tokenEquals(keyword, keywordEnd, "o", 1) ||
+             tokenEquals(keyword, keywordEnd, "g", 1) ||
+             tokenEquals(keyword, keywordEnd, "usemtl", 6)))
+      {
+      const char *value = skipBlanks(keywordEnd, line.end);
+      const char *valueEnd = line.end;
+      while(valueEnd > value && isBlank(valueEnd[-1]))
+        {
+        --valueEnd;
+        }
+
+      const bool material = *keyword == 'u';
+      beginSubmesh(submeshes, tris->size(), material, value, valueEnd, allocator);
+
+      if(inheritance)
+        {
+        xsize &first = material ? inheritance->firstWithMaterial : inheritance->firstNamed;
+        first = std::min(first, submeshes->size() - 1 - firstSubmesh);
+        }
+      }
+    }
+
+  if(submeshes)
+    {
+    ObjLoader::Submesh &last = submeshes->back();
+    last.indexCount = tris->size() - last.firstIndex;
+    }
+
+  return !monitor || monitor->advance(end - reported);
+  }
+
+}
+
+bool ObjLoader::load(
+    const char *data,
+    xsize dataSize,
+    const ShaderVertexLayoutDescription::Semantic *items,
+    xsize itemCount,
+    Vector<VectorI3D> *tris,
+    xsize *vertexSize,
+    ElementData *elementData,
+    Vector<Submesh> *submeshes)
+  {
+  xAssert(tris);
+  xAssert(vertexSize);
+  xAssert(elementData);
+
+  if(!initialiseElements(items, itemCount, vertexSize, elementData))
+    {
+    return false;
+    }
+
+  xsize faceElements[X_ARRAY_COUNT(FaceSemanticMap)];
+  findFaceElements(elementData, itemCount, faceElements);
+
+  if(_monitor)
+    {
+    _monitor->begin(dataSize);
+    }
+
+  const xsize firstSubmesh = submeshes ? submeshes->size() : 0;
+  if(!parseRangeInPlace(data, data + dataSize, 0, elementData, itemCount, faceElements, tris, 0, submeshes, 0, _monitor, _allocator, [](){}))
+    {
+    return false;
+    }
+
+  if(submeshes)
+    {
+    finishSubmeshes(submeshes, firstSubmesh, *tris, elementData, itemCount);
+    }
+
+  return true;
+  }
+
+bool ObjLoader::loadParallel(
+    const char *data,
+    xsize dataSize,
+    const ShaderVertexLayoutDescription::Semantic *items,
+    xsize itemCount,
+    Vector<VectorI3D> *tris,
+    xsize *vertexSize,
+    ElementData *elementData,
+    Vector<Submesh> *submeshes)
+  {
+  xAssert(tris);
+  xAssert(vertexSize);
+  xAssert(elementData);
+
+  const xsize chunkCount = ParallelUtilities::rangeCount(dataSize, _parallelChunkSize, _parallelChunks);
+  if(chunkCount <= 1)
+    {
+    return load(data, dataSize, items, itemCount, tris, vertexSize, elementData, submeshes);
+    }
+
+  if(itemCount > MaxElements || !initialiseElements(items, itemCount, vertexSize, elementData))
+    {
+    xAssertFail();
+    return false;
+    }
+
+  xsize faceElements[X_ARRAY_COUNT(FaceSemanticMap)];
+  findFaceElements(elementData, itemCount, faceElements);
+
+  if(_monitor)
+    {
+    _monitor->begin(dataSize);
+    }
+
+  struct Chunk
+    {
+    const char *begin;
+    const char *end;
+    xsize lineCount;
+    xsize firstLine;
+
+    ElementData elements[MaxElements];
+    Vector<VectorI3D> triangles;
+    Vector<xsize> relativeFixups;
+    Vector<Submesh> submeshes;
+    SubmeshInheritance inheritance;
+    bool completed;
+
+    xsize elementOffsets[MaxElements];
+    xsize triangleOffset;
+    };
+
+  Vector<Chunk> chunks(_allocator);
+  chunks.resize(chunkCount);
+
+  // Split at the first newline after each even division of the data.
+  const char *dataEnd = data + dataSize;
+  const char *chunkBegin = data;
+  for(xsize c = 0; c < chunkCount; ++c)
+    {
+    Chunk &chunk = chunks[c];
+    const char *chunkEnd = dataEnd;
+    if(c < chunkCount - 1)
+      {
+      const char *split = std::max(chunkBegin, data + (dataSize * (c + 1)) / chunkCount);
+      const char *newLine = (const char *)memchr(split, '\n', dataEnd - split);
+      chunkEnd = newLine ? newLine + 1 : dataEnd;
+      }
+
+    chunk.begin = chunkBegin;
+    chunk.end = chunkEnd;
+    chunkBegin = chunkEnd;
+
+    chunk.triangles.setAllocator(_allocator);
+    chunk.relativeFixups.setAllocator(_allocator);
+    chunk.submeshes.setAllocator(_allocator);
+    for(xsize i = 0; i < itemCount; ++i)
+      {
+      chunk.elements[i].desc = elementData[i].desc;
+      chunk.elements[i].format = elementData[i].format;
+      chunk.elements[i].data.setAllocator(_allocator);
+      }
+    }
+
+  // Count lines first, so errors report the same line numbers as a serial load.
+  ParallelUtilities::forRanges(chunkCount, 1, [&](xsize, xsize begin, xsize end)
+    {
+    for(xsize c = begin; c < end; ++c)
+      {
+      Chunk &chunk = chunks[c];
+      chunk.lineCount = std::count(chunk.begin, chunk.end, '\n');
+      }
+    });
+
+  xsize lines = 0;
+  for(xsize c = 0; c < chunkCount; ++c)
+    {
+    chunks[c].firstLine = lines;
+    lines += chunks[c].lineCount;
+    }
+
+  ParallelUtilities::forRanges(chunkCount, 1, [&](xsize, xsize begin, xsize end)
+    {
+    for(xsize c = begin; c < end; ++c)
+      {
+      Chunk &chunk = chunks[c];
+      chunk.completed = parseRangeInPlace(
+        chunk.begin,
+        chunk.end,
+        chunk.firstLine,
+        chunk.elements,
+        itemCount,
+        faceElements,
+        &chunk.triangles,
+        &chunk.relativeFixups,
+        submeshes ? &chunk.submeshes : 0,
+        &chunk.inheritance,
+        _monitor,
+        _allocator,
+        [](){});
+      }
+    });
+
+  for(xsize c = 0; c < chunkCount; ++c)
+    {
+    if(!chunks[c].completed)
+      {
+      return false;
+      }
+    }
+
+  // Stitch the chunks back together in file order.
+  xsize elementTotals[MaxElements] = { 0 };
+  for(xsize i = 0; i < itemCount; ++i)
+    {
+    elementTotals[i] = elementData[i].data.size();
+    }
+  xsize triangleTotal = tris->size();
+  for(xsize c = 0; c < chunkCount; ++c)
+    {
+    Chunk &chunk = chunks[c];
+    for(xsize i = 0; i < itemCount; ++i)
+      {
+      chunk.elementOffsets[i] = elementTotals[i];
+      elementTotals[i] += chunk.elements[i].data.size();
+      }
+
+    chunk.triangleOffset = triangleTotal;
+    triangleTotal += chunk.triangles.size();
+    }
+
+  for(xsize i = 0; i < itemCount; ++i)
+    {
+    elementData[i].data.resize(elementTotals[i]);
+    }
+  tris->resize(triangleTotal);
+
+  ParallelUtilities::forRanges(chunkCount, 1, [&](xsize, xsize begin, xsize end)
+    {
+    for(xsize c = begin; c < end; ++c)
+      {
+      const Chunk &chunk = chunks[c];
+      for(xsize i = 0; i < itemCount; ++i)
+        {
+        const Vector<ElementVector> &src = chunk.elements[i].data;
+        std::copy(src.data(), src.data() + src.size(), elementData[i].data.data() + chunk.elementOffsets[i]);
+        }
+
+      VectorI3D *triOut = tris->data() + chunk.triangleOffset;
+      std::copy(chunk.triangles.data(), chunk.triangles.data() + chunk.triangles.size(), triOut);
+
+      for(xsize f = 0, s = chunk.relativeFixups.size(); f < s; ++f)
+        {
+        const xsize fixup = chunk.relativeFixups[f];
+        const xsize element = fixup % MaxComponent;
+        triOut[fixup / MaxComponent](element) += (int)chunk.elementOffsets[element];
+        }
+      }
+    });
+
+  if(submeshes)
+    {
+    // Each chunk after the first begins by continuing the previous chunk's last submesh.
+    const xsize firstSubmesh = submeshes->size();
+    for(xsize c = 0; c < chunkCount; ++c)
+      {
+      const Chunk &chunk = chunks[c];
+      for(xsize i = 0, s = chunk.submeshes.size(); i < s; ++i)
+        {
+        if(c > 0 && i == 0)
+          {
+          submeshes->back().indexCount += chunk.submeshes[i].indexCount;
+          continue;
+          }
+
+        Submesh submesh = chunk.submeshes[i];
+        submesh.firstIndex += chunk.triangleOffset;
+
+        // Until the chunk's own o, g or usemtl lines, names and materials come from the
+        // submesh before, which earlier chunks have already resolved.
+        if(c > 0)
+          {
+          const Submesh &previous = submeshes->back();
+          if(i < chunk.inheritance.firstNamed)
+            {
+            submesh.name = previous.name;
+            }
+          if(i < chunk.inheritance.firstWithMaterial)
+            {
+            submesh.material = previous.material;
+            }
+          }
+        (*submeshes) << submesh;
+        }
+      }
+
+    finishSubmeshes(submeshes, firstSubmesh, *tris, elementData, itemCount);
+    }
+
+  return true;
+  }
+
+namespace
+{
+
+// Bake [tris] for a streamed batch. Elements marked in [generate] are generated per
+// triangle, flat normals for normals, flat tangents for binormals and zero for anything else.
+void bakeStreamingBatch(
+    const Vector<VectorI3D> &tris,
+    const ObjLoader::ElementData *elements,
+    const bool *generate,
+    xsize elementCount,
+    Vector<xuint8> *bakedData)
+  {
+  const xsize posIdx = findIndexedElement(elements, elementCount, ShaderVertexLayoutDescription::Position);
+  const xsize texIdx = findIndexedElement(elements, elementCount, ShaderVertexLayoutDescription::TextureCoordinate);
+
+  xAssert((tris.size() % 3) == 0);
+  for(xsize triIndex = 0, s = tris.size(); triIndex < s; triIndex += 3)
+    {
+    ObjLoader::ElementVector flatNormal = ObjLoader::ElementVector::Zero();
+    ObjLoader::ElementVector flatTangent = ObjLoader::ElementVector::Zero();
+    Real flatSign = 0.0f;
+    if(posIdx < elementCount)
+      {
+      const Vector<ObjLoader::ElementVector> &pos = elements[posIdx].data;
+      const xsize a = tris[triIndex](posIdx);
+      const xsize b = tris[triIndex+1](posIdx);
+      const xsize c = tris[triIndex+2](posIdx);
+      if(a < pos.size() && b < pos.size() && c < pos.size())
+        {
+        flatNormal = (pos[b]-pos[a]).cross(pos[c]-pos[a]).normalized();
+
+        Vector2D uv[3] = { Vector2D::Zero(), Vector2D::Zero(), Vector2D::Zero() };
+        if(texIdx < elementCount)
+          {
+          const Vector<ObjLoader::ElementVector> &tex = elements[texIdx].data;
+          for(xsize corner = 0; corner < 3; ++corner)
+            {
+            const xsize t = tris[triIndex + corner](texIdx);
+            if(t < tex.size())
+              {
+              uv[corner] = Vector2D(tex[t](0), tex[t](1));
+              }
+            }
+          }
+
+        flatTangent = TangentGenerator::orthogonalise(
+          TangentGenerator::triangleTangent(pos[a], pos[b], pos[c], uv[0], uv[1], uv[2]),
+          flatNormal);
+        flatSign = TangentGenerator::bitangentSign(
+          flatNormal,
+          flatTangent,
+          TangentGenerator::triangleBitangent(pos[a], pos[b], pos[c], uv[0], uv[1], uv[2]));
+        }
+      }
+
+    for(xsize corner = 0; corner < 3; ++corner)
+      {
+      const VectorI3D &idx = tris[triIndex + corner];
+      for(xsize elIdx = 0; elIdx < elementCount; ++elIdx)
+        {
+        const ObjLoader::ElementData &element(elements[elIdx]);
+        if(generate[elIdx])
+          {
+          const ShaderVertexLayoutDescription::Semantic semantic = element.desc->semantic;
+          if(semantic == ShaderVertexLayoutDescription::Normal)
+            {
+            writeElement(element, flatNormal, 0.0f, bakedData);
+            }
+          else if(semantic == ShaderVertexLayoutDescription::BiNormal)
+            {
+            writeElement(element, flatTangent, flatSign, bakedData);
+            }
+          else
+            {
+            writeElement(element, ObjLoader::ElementVector::Zero(), 0.0f, bakedData);
+            }
+          continue;
+          }
+
+        xsize index = idx(elIdx);
+        if (index >= element.data.size())
+          {
+          throw Eks::ParseException(X_PARSE_ERROR(Eks::StringBuilder() << "Error baking attribute '" << element.desc->name << "' invalid index [" << index << "/" << element.data.size() << "]"));
+          }
+        writeElement(element, index, bakedData);
+        }
+      }
+    }
+  }
+
+}
+
+bool ObjLoader::loadFile(
+    const char *path,
+    const ShaderVertexLayoutDescription::Semantic *items,
+    xsize itemCount,
+    Vector<VectorI3D> *tris,
+    xsize *vertexSize,
+    ElementData *elementData,
+    bool parallel,
+    Vector<Submesh> *submeshes)
+  {
+  return withMappedFile(path, [&](const char *data, xsize dataSize)
+    {
+    if(parallel)
+      {
+      return loadParallel(data, dataSize, items, itemCount, tris, vertexSize, elementData, submeshes);
+      }
+    return load(data, dataSize, items, itemCount, tris, vertexSize, elementData, submeshes);
+    });
+  }
+
+bool ObjLoader::loadStreaming(
+    const char *data,
+    xsize dataSize,
+    const ShaderVertexLayoutDescription::Semantic *items,
+    xsize itemCount,
+    xsize *vertexSize,
+    BatchReceiver *receiver,
+    xsize batchTriangles)
+  {
+  xAssert(vertexSize);
+  xAssert(receiver);
+  xAssert(batchTriangles > 0);
+
+  ElementData elementData[MaxElements];
+  if(itemCount > MaxElements || !initialiseElements(items, itemCount, vertexSize, elementData))
+    {
+    xAssertFail();
+    return false;
+    }
+
+  xsize faceElements[X_ARRAY_COUNT(FaceSemanticMap)];
+  findFaceElements(elementData, itemCount, faceElements);
+
+  const xsize batchVertices = batchTriangles * 3;
+
+  Vector<VectorI3D> tris(_allocator);
+  tris.reserve(batchVertices + 6);
+
+  Vector<xuint8> batch(_allocator);
+  batch.reserve(batchVertices * *vertexSize);
+
+  // Which elements are generated is decided once, at the first batch, so every batch agrees.
+  bool generate[MaxElements];
+  bool generateDecided = false;
+
+  auto flush = [&]()
+    {
+    if(!generateDecided)
+      {
+      for(xsize i = 0; i < itemCount; ++i)
+        {
+        generate[i] = elementData[i].data.size() == 0;
+        }
+      generateDecided = true;
+      }
+
+    bakeStreamingBatch(tris, elementData, generate, itemCount, &batch);
+    receiver->receive(batch.data(), tris.size(), *vertexSize);
+
+    tris.clear();
+    batch.clear();
+    };
+
+  if(_monitor)
+    {
+    _monitor->begin(dataSize);
+    }
+
+  const bool completed = parseRangeInPlace(data, data + dataSize, 0, elementData, itemCount, faceElements, &tris, 0, 0, 0, _monitor, _allocator, [&]()
+    {
+    if(tris.size() >= batchVertices)
+      {
+      flush();
+      }
+    });
+
+  if(!completed)
+    {
+    return false;
+    }
+
+  if(tris.size())
+    {
+    flush();
+    }
+
+  return true;
+  }
+
+bool ObjLoader::loadFileStreaming(
+    const char *path,
+    const ShaderVertexLayoutDescription::Semantic *items,
+    xsize itemCount,
+    xsize *vertexSize,
+    BatchReceiver *receiver,
+    xsize batchTriangles)
+  {
+  return withMappedFile(path, [&](const char *data, xsize dataSize)
+    {
+    return loadStreaming(data, dataSize, items, itemCount, vertexSize, receiver, batchTriangles);
+    });
+  }
+
+ObjLoader::GeometryBatchReceiver::GeometryBatchReceiver(AllocatorBase *allocator, xsize expectedBytes)
+    : _data(allocator),
+      _vertexSize(0),
+      _vertexCount(0)
+  {
+  _data.reserve(expectedBytes);
+  }
+
+void ObjLoader::GeometryBatchReceiver::receive(const xuint8 *vertexData, xsize vertexCount, xsize vertexSize)
+  {
+  xAssert(!_vertexSize || _vertexSize == vertexSize);
+  _vertexSize = vertexSize;
+
+  _data.resizeAndCopy(_data.size() + vertexCount * vertexSize, vertexData);
+  _vertexCount += vertexCount;
+  }
+
+bool ObjLoader::GeometryBatchReceiver::create(Renderer *r, Geometry *geo)
+  {
+  xAssert(geo);
+  if(!_vertexCount)
+    {
+    return false;
+    }
+
+  bool result = Geometry::delayedCreate(*geo, r, _data.data(), _vertexSize, _vertexCount);
+
+  _data.clear();
+  _vertexCount = 0;
+  return result;
+  }
+
+bool ObjLoader::loadLineCached(
+    const char *data,
+    xsize dataSize,
+    const ShaderVertexLayoutDescription::Semantic *items,
+    xsize itemCount,
+    Vector<VectorI3D> *tris,
+    xsize *vertexSize,
+    ElementData *elementData)
+  {
+  xAssert(tris);
+  xAssert(vertexSize);
+  xAssert(elementData);
+
+  LineCache line(ExpectedLineLength, ' ', _allocator);
+  xsize lineIdx = 0;
+
+  if(!initialiseElements(items, itemCount, vertexSize, elementData))
+    {
+    return false;
+    }
+
+  Vector<VectorI3D, 6> tempPoly(_allocator);
+
+  const char *pos = data;
+  while(pos < (data + dataSize))
+    {
+    line.clear();
+    ++lineIdx;
+
+    while(*pos != '\n' && pos < (data + dataSize))
+      {
+      line << *pos;
+      ++pos;
+      }
+    ++pos; // skip \n
+
+    // remove the carriage return from win files.
+    if(line.back() == '\r')
+      {
+      line.popBack();
+      }
+
+    // add a space to the end
     line << space;
 
     xsize firstSpace = 1;
@@ -461,7 +1767,7 @@ bool ObjLoader::load(
       const ObjElement *element(data.desc);
       xAssert(element);
 
-      if (!element->read(_scratchString, line, lineIdx, nonSpace, &(data.data)))
+      if (!element->read(line, lineIdx, nonSpace, &(data.data)))
         {
         throw Eks::ParseException(X_PARSE_ERROR(
           Eks::ParseError::LineContext,
@@ -499,7 +1805,8 @@ bool ObjLoader::load(
 void ObjLoader::computeUnusedElements(
     ObjLoader::ElementData *elements,
     xsize itemCount,
-    Vector<VectorI3D> *triangles)
+    Vector<VectorI3D> *triangles,
+    Real normalCreaseAngle)
   {
   for(xsize i = 0; i < itemCount; ++i)
     {
@@ -509,7 +1816,7 @@ void ObjLoader::computeUnusedElements(
       continue;
       }
 
-    el.desc->compute(elements, itemCount, triangles, i);
+    el.desc->compute(elements, itemCount, triangles, i, normalCreaseAngle, _allocator);
     }
   }
 
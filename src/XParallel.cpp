@@ -0,0 +1,17 @@
+#include "XParallel.h"
+
+namespace Eks
+{
+
+namespace ParallelUtilities
+{
+
+xsize threadCount()
+  {
+  static const xsize count = std::max((xsize)std::thread::hardware_concurrency(), (xsize)1);
+  return count;
+  }
+
+}
+
+}
@@ -0,0 +1,834 @@
+#include "XPlyLoader.h"
+#include "Containers/XStringBuilder.h"
+#include "Utilities/XParseException.h"
+#include "XNumberScanner.h"
+#include "XMappedFile.h"
+#include <algorithm>
+#include <cstring>
+
+namespace Eks
+{
+
+namespace
+{
+
+const xsize Unused = Eks::maxFor(Unused);
+
+enum Encoding
+  {
+  Ascii,
+  BinaryLittleEndian,
+  BinaryBigEndian
+  };
+
+enum Type
+  {
+  Int8,
+  UInt8,
+  Int16,
+  UInt16,
+  Int32,
+  UInt32,
+  Float32,
+  Float64,
+
+  TypeCount
+  };
+
+const xsize TypeSizes[] = { 1, 1, 2, 2, 4, 4, 4, 8 };
+xCompileTimeAssert(X_ARRAY_COUNT(TypeSizes) == TypeCount);
+
+struct TypeName
+  {
+  const char *name;
+  Type type;
+  };
+
+const TypeName TypeNames[] =
+  {
+  { "char", Int8 },
+  { "int8", Int8 },
+  { "uchar", UInt8 },
+  { "uint8", UInt8 },
+  { "short", Int16 },
+  { "int16", Int16 },
+  { "ushort", UInt16 },
+  { "uint16", UInt16 },
+  { "int", Int32 },
+  { "int32", Int32 },
+  { "uint", UInt32 },
+  { "uint32", UInt32 },
+  { "float", Float32 },
+  { "float32", Float32 },
+  { "double", Float64 },
+  { "float64", Float64 }
+  };
+
+struct PropertyMap
+  {
+  const char *name;
+  ShaderVertexLayoutDescription::Semantic semantic;
+  xsize component;
+  };
+
+const PropertyMap PropertyMaps[] =
+  {
+  { "x", ShaderVertexLayoutDescription::Position, 0 },
+  { "y", ShaderVertexLayoutDescription::Position, 1 },
+  { "z", ShaderVertexLayoutDescription::Position, 2 },
+  { "nx", ShaderVertexLayoutDescription::Normal, 0 },
+  { "ny", ShaderVertexLayoutDescription::Normal, 1 },
+  { "nz", ShaderVertexLayoutDescription::Normal, 2 },
+  { "u", ShaderVertexLayoutDescription::TextureCoordinate, 0 },
+  { "v", ShaderVertexLayoutDescription::TextureCoordinate, 1 },
+  { "s", ShaderVertexLayoutDescription::TextureCoordinate, 0 },
+  { "t", ShaderVertexLayoutDescription::TextureCoordinate, 1 },
+  { "texture_u", ShaderVertexLayoutDescription::TextureCoordinate, 0 },
+  { "texture_v", ShaderVertexLayoutDescription::TextureCoordinate, 1 },
+  { "texture_s", ShaderVertexLayoutDescription::TextureCoordinate, 0 },
+  { "texture_t", ShaderVertexLayoutDescription::TextureCoordinate, 1 }
+  };
+
+const char *const ColourNames[] = { "red", "green", "blue", "alpha" };
+
+struct Token
+  {
+  Token() : begin(0), end(0) { }
+
+  bool equals(const char *str) const
+    {
+    const xsize length = strlen(str);
+    return (xsize)(end - begin) == length && memcmp(begin, str, length) == 0;
+    }
+
+  const char *begin;
+  const char *end;
+  };
+
+struct Property
+  {
+  Token name;
+  Type type;
+  bool list;
+  Type countType;
+  };
+
+struct Element
+  {
+  Token name;
+  xsize count;
+  Property properties[PlyLoader::MaxProperties];
+  xsize propertyCount;
+  // Bytes per binary record, or 0 if a property is a list.
+  xsize stride;
+  };
+
+struct Header
+  {
+  Encoding encoding;
+  Element elements[PlyLoader::MaxElements];
+  xsize elementCount;
+  // The first byte after end_header.
+  const char *body;
+  };
+
+inline bool isSpace(char c)
+  {
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+  }
+
+Token nextToken(const char *&pos, const char *end)
+  {
+  while(pos < end && isSpace(*pos))
+    {
+    ++pos;
+    }
+
+  Token token;
+  token.begin = pos;
+  while(pos < end && !isSpace(*pos))
+    {
+    ++pos;
+    }
+  token.end = pos;
+  return token;
+  }
+
+Type parseType(const Token &token)
+  {
+  for(xsize i = 0; i < X_ARRAY_COUNT(TypeNames); ++i)
+    {
+    if(token.equals(TypeNames[i].name))
+      {
+      return TypeNames[i].type;
+      }
+    }
+
+  throw Eks::ParseException(X_PARSE_ERROR(Eks::StringBuilder() << "Unknown PLY property type '" << Eks::String(token.begin, token.end - token.begin) << "'"));
+  }
+
+void parseHeader(const char *data, xsize dataSize, Header *header)
+  {
+  const char *pos = data;
+  const char *end = data + dataSize;
+
+  header->encoding = Ascii;
+  header->elementCount = 0;
+  header->body = 0;
+
+  bool first = true;
+  bool formatFound = false;
+  while(pos < end)
+    {
+    const char *lineEnd = (const char *)memchr(pos, '\n', end - pos);
+    if(!lineEnd)
+      {
+      break;
+      }
+    const char *next = lineEnd + 1;
+
+    const Token keyword = nextToken(pos, lineEnd);
+    if(first)
+      {
+      if(!keyword.equals("ply"))
+        {
+        throw Eks::ParseException(X_PARSE_ERROR(Eks::StringBuilder() << "Not a PLY file"));
+        }
+      first = false;
+      }
+    else if(keyword.equals("format"))
+      {
+      const Token format = nextToken(pos, lineEnd);
+      if(format.equals("ascii"))
+        {
+        header->encoding = Ascii;
+        }
+      else if(format.equals("binary_little_endian"))
+        {
+        header->encoding = BinaryLittleEndian;
+        }
+      else if(format.equals("binary_big_endian"))
+        {
+        header->encoding = BinaryBigEndian;
+        }
+      else
+        {
+        throw Eks::ParseException(X_PARSE_ERROR(Eks::StringBuilder() << "Unknown PLY format '" << Eks::String(format.begin, format.end - format.begin) << "'"));
+        }
+      formatFound = true;
+      }
+    else if(keyword.equals("element"))
+      {
+      if(header->elementCount == PlyLoader::MaxElements)
+        {
+        throw Eks::ParseException(X_PARSE_ERROR(Eks::StringBuilder() << "PLY file has more than " << (xsize)PlyLoader::MaxElements << " elements"));
+        }
+
+      Element &element = header->elements[header->elementCount++];
+      element.name = nextToken(pos, lineEnd);
+      element.propertyCount = 0;
+      element.stride = 0;
+
+      const Token count = nextToken(pos, lineEnd);
+      if(!NumberScanner::parseInteger(count.begin, count.end, &element.count))
+        {
+        throw Eks::ParseException(X_PARSE_ERROR(Eks::StringBuilder() << "Invalid PLY element count '" << Eks::String(count.begin, count.end - count.begin) << "'"));
+        }
+      }
+    else if(keyword.equals("property"))
+      {
+      if(!header->elementCount)
+        {
+        throw Eks::ParseException(X_PARSE_ERROR(Eks::StringBuilder() << "PLY property outside an element"));
+        }
+
+      Element &element = header->elements[header->elementCount - 1];
+      if(element.propertyCount == PlyLoader::MaxProperties)
+        {
+        throw Eks::ParseException(X_PARSE_ERROR(Eks::StringBuilder() << "PLY element has more than " << (xsize)PlyLoader::MaxProperties << " properties"));
+        }
+
+      Property &property = element.properties[element.propertyCount++];
+      const Token type = nextToken(pos, lineEnd);
+      property.list = type.equals("list");
+      property.countType = UInt8;
+      if(property.list)
+        {
+        property.countType = parseType(nextToken(pos, lineEnd));
+        property.type = parseType(nextToken(pos, lineEnd));
+        }
+      else
+        {
+        property.type = parseType(type);
+        }
+      property.name = nextToken(pos, lineEnd);
+      }
+    else if(keyword.equals("end_header"))
+      {
+      if(!formatFound)
+        {
+        throw Eks::ParseException(X_PARSE_ERROR(Eks::StringBuilder() << "PLY header has no format"));
+        }
+      header->body = next;
+      break;
+      }
+    else if(!keyword.equals("comment") && !keyword.equals("obj_info") && keyword.begin != keyword.end)
+      {
+      throw Eks::ParseException(X_PARSE_ERROR(Eks::StringBuilder() << "Unknown PLY header line '" << Eks::String(keyword.begin, keyword.end - keyword.begin) << "'"));
+      }
+
+    pos = next;
+    }
+
+  if(!header->body)
+    {
+    throw Eks::ParseException(X_PARSE_ERROR(Eks::StringBuilder() << "PLY header is not terminated"));
+    }
+
+  for(xsize e = 0; e < header->elementCount; ++e)
+    {
+    Element &element = header->elements[e];
+    for(xsize p = 0; p < element.propertyCount; ++p)
+      {
+      if(element.properties[p].list)
+        {
+        element.stride = 0;
+        break;
+        }
+      element.stride += TypeSizes[element.properties[p].type];
+      }
+    }
+  }
+
+Encoding nativeEncoding()
+  {
+  const xuint16 probe = 1;
+  xuint8 first = 0;
+  memcpy(&first, &probe, 1);
+  return first ? BinaryLittleEndian : BinaryBigEndian;
+  }
+
+// Reads the values of the body in order, from text or binary.
+class Reader
+  {
+public:
+  Reader(const Header &header, const char *end)
+      : _pos(header.body),
+        _end(end),
+        _encoding(header.encoding),
+        _swap(header.encoding != Ascii && header.encoding != nativeEncoding())
+    {
+    }
+
+  double read(Type type)
+    {
+    if(_encoding == Ascii)
+      {
+      while(_pos < _end && isSpace(*_pos))
+        {
+        ++_pos;
+        }
+
+      const char *token = _pos;
+      double value = 0.0;
+      if(!NumberScanner::scanReal(_pos, _end, &value) || (_pos < _end && !isSpace(*_pos)))
+        {
+        const char *tokenEnd = token;
+        while(tokenEnd < _end && !isSpace(*tokenEnd))
+          {
+          ++tokenEnd;
+          }
+        throw Eks::ParseException(X_PARSE_ERROR(Eks::StringBuilder() << "Error reading PLY value '" << Eks::String(token, tokenEnd - token) << "'"));
+        }
+      return value;
+      }
+
+    const xsize size = TypeSizes[type];
+    if((xsize)(_end - _pos) < size)
+      {
+      throw Eks::ParseException(X_PARSE_ERROR(Eks::StringBuilder() << "PLY data ends early"));
+      }
+
+    xuint8 bytes[8];
+    memcpy(bytes, _pos, size);
+    _pos += size;
+    if(_swap)
+      {
+      std::reverse(bytes, bytes + size);
+      }
+
+    switch(type)
+      {
+    case Int8:
+      return (xint8)bytes[0];
+    case UInt8:
+      return bytes[0];
+    case Int16:
+      return readAs<xint16>(bytes);
+    case UInt16:
+      return readAs<xuint16>(bytes);
+    case Int32:
+      return readAs<xint32>(bytes);
+    case UInt32:
+      return readAs<xuint32>(bytes);
+    case Float32:
+      return readAs<float>(bytes);
+    case Float64:
+    default:
+      return readAs<double>(bytes);
+      }
+    }
+
+  // Read a list length or vertex index.
+  xsize readIndex(Type type)
+    {
+    const double value = read(type);
+    if(value < 0 || value != (double)(xsize)value)
+      {
+      throw Eks::ParseException(X_PARSE_ERROR(Eks::StringBuilder() << "Invalid PLY index " << value));
+      }
+    return (xsize)value;
+    }
+
+  void skip(const Property &property)
+    {
+    const xsize count = property.list ? readIndex(property.countType) : 1;
+    if(_encoding != Ascii)
+      {
+      const xsize size = count * TypeSizes[property.type];
+      if((xsize)(_end - _pos) < size)
+        {
+        throw Eks::ParseException(X_PARSE_ERROR(Eks::StringBuilder() << "PLY data ends early"));
+        }
+      _pos += size;
+      return;
+      }
+
+    for(xsize i = 0; i < count; ++i)
+      {
+      read(property.type);
+      }
+    }
+
+  void skip(const Element &element)
+    {
+    if(_encoding != Ascii && element.stride)
+      {
+      const xsize size = element.count * element.stride;
+      if((xsize)(_end - _pos) < size)
+        {
+        throw Eks::ParseException(X_PARSE_ERROR(Eks::StringBuilder() << "PLY data ends early"));
+        }
+      _pos += size;
+      return;
+      }
+
+    for(xsize i = 0; i < element.count; ++i)
+      {
+      for(xsize p = 0; p < element.propertyCount; ++p)
+        {
+        skip(element.properties[p]);
+        }
+      }
+    }
+
+  const char *position() const { return _pos; }
+
+private:
+  template <typename T> static double readAs(const xuint8 *bytes)
+    {
+    T value;
+    memcpy(&value, bytes, sizeof(T));
+    return value;
+    }
+
+  const char *_pos;
+  const char *_end;
+  Encoding _encoding;
+  bool _swap;
+  };
+
+const Element *findElement(const Header &header, const char *name, xsize *index)
+  {
+  for(xsize e = 0; e < header.elementCount; ++e)
+    {
+    if(header.elements[e].name.equals(name))
+      {
+      *index = e;
+      return &header.elements[e];
+      }
+    }
+  return 0;
+  }
+
+const PropertyMap *findPropertyMap(const Property &property)
+  {
+  for(xsize i = 0; i < X_ARRAY_COUNT(PropertyMaps); ++i)
+    {
+    if(property.name.equals(PropertyMaps[i].name))
+      {
+      return &PropertyMaps[i];
+      }
+    }
+  return 0;
+  }
+
+// Read the face element, calling fn(vertices, count) for each polygon's vertex indices.
+template <typename Fn> void readFaces(Reader &reader, const Element &faces, xsize vertexCount, Vector<xuint32> *polygon, const Fn &fn)
+  {
+  xsize indexProperty = Unused;
+  for(xsize p = 0; p < faces.propertyCount; ++p)
+    {
+    const Property &property = faces.properties[p];
+    if(property.list && (property.name.equals("vertex_indices") || property.name.equals("vertex_index")))
+      {
+      indexProperty = p;
+      }
+    }
+
+  if(indexProperty == Unused)
+    {
+    throw Eks::ParseException(X_PARSE_ERROR(Eks::StringBuilder() << "PLY face element has no vertex_indices list"));
+    }
+
+  for(xsize f = 0; f < faces.count; ++f)
+    {
+    for(xsize p = 0; p < faces.propertyCount; ++p)
+      {
+      const Property &property = faces.properties[p];
+      if(p != indexProperty)
+        {
+        reader.skip(property);
+        continue;
+        }
+
+      const xsize count = reader.readIndex(property.countType);
+      polygon->resize(count, 0);
+      for(xsize c = 0; c < count; ++c)
+        {
+        const xsize index = reader.readIndex(property.type);
+        if(index >= vertexCount)
+          {
+          throw Eks::ParseException(X_PARSE_ERROR(Eks::StringBuilder() << "PLY face index out of range [" << index << "/" << vertexCount << "]"));
+          }
+        (*polygon)[c] = (xuint32)index;
+        }
+
+      fn(polygon->data(), count);
+      }
+    }
+  }
+
+// Check the vertex element holds exactly [items], in order, as their default formats.
+bool isDirectLayout(const Element &vertices, const ShaderVertexLayoutDescription::Semantic *items, xsize itemCount)
+  {
+  xsize property = 0;
+  for(xsize i = 0; i < itemCount; ++i)
+    {
+    const bool colour = items[i] == ShaderVertexLayoutDescription::Colour;
+    xsize components = 4;
+    if(items[i] == ShaderVertexLayoutDescription::Position || items[i] == ShaderVertexLayoutDescription::Normal)
+      {
+      components = 3;
+      }
+    else if(items[i] == ShaderVertexLayoutDescription::TextureCoordinate)
+      {
+      components = 2;
+      }
+    else if(!colour)
+      {
+      return false;
+      }
+
+    for(xsize c = 0; c < components; ++c, ++property)
+      {
+      if(property == vertices.propertyCount || vertices.properties[property].list)
+        {
+        return false;
+        }
+
+      const Property &p = vertices.properties[property];
+      if(colour)
+        {
+        if(p.type != UInt8 || !p.name.equals(ColourNames[c]))
+          {
+          return false;
+          }
+        continue;
+        }
+
+      const PropertyMap *map = findPropertyMap(p);
+      if(p.type != Float32 || !map || map->semantic != items[i] || map->component != c)
+        {
+        return false;
+        }
+      }
+    }
+
+  return property == vertices.propertyCount;
+  }
+
+// Find the vertex data for [header], if it can be used directly, leaving [reader] after it.
+bool findDirectVertices(
+    const Header &header,
+    Reader &reader,
+    const ShaderVertexLayoutDescription::Semantic *items,
+    xsize itemCount,
+    const xuint8 **vertexData,
+    xsize *vertexSize,
+    xsize *vertexCount)
+  {
+  xsize vertexElement = 0;
+  const Element *vertices = findElement(header, "vertex", &vertexElement);
+  if(header.encoding != nativeEncoding() || !vertices || !isDirectLayout(*vertices, items, itemCount))
+    {
+    return false;
+    }
+
+  for(xsize e = 0; e < vertexElement; ++e)
+    {
+    reader.skip(header.elements[e]);
+    }
+
+  *vertexData = (const xuint8 *)reader.position();
+  *vertexSize = vertices->stride;
+  *vertexCount = vertices->count;
+  reader.skip(*vertices);
+  return true;
+  }
+
+}
+
+PlyLoader::PlyLoader(AllocatorBase *allocator)
+    : _allocator(allocator),
+      _loader(allocator)
+  {
+  }
+
+bool PlyLoader::load(
+    const char *data,
+    xsize dataSize,
+    const ShaderVertexLayoutDescription::Semantic *items,
+    xsize itemCount,
+    Vector<VectorI3D> *triangles,
+    xsize *vertexSize,
+    ObjLoader::ElementData *elements)
+  {
+  xAssert(triangles);
+  xAssert(vertexSize);
+  xAssert(elements);
+
+  if(itemCount > ObjLoader::MaxElements || !_loader.initialiseElements(items, itemCount, vertexSize, elements))
+    {
+    xAssertFail();
+    return false;
+    }
+
+  Header header;
+  parseHeader(data, dataSize, &header);
+
+  xsize indexedCount = 0;
+  while(indexedCount < itemCount && indexedCount < ObjLoader::MaxComponent && items[indexedCount] != ShaderVertexLayoutDescription::BiNormal)
+    {
+    ++indexedCount;
+    }
+
+  xsize vertexElement = 0;
+  const Element *vertices = findElement(header, "vertex", &vertexElement);
+  const xsize vertexCount = vertices ? vertices->count : 0;
+
+  Vector<xuint32> polygon(_allocator);
+  Reader reader(header, data + dataSize);
+  for(xsize e = 0; e < header.elementCount; ++e)
+    {
+    const Element &element = header.elements[e];
+    if(e == vertexElement && vertices)
+      {
+      // The item and component each property is read to.
+      xsize propertyItems[MaxProperties];
+      xsize propertyComponents[MaxProperties];
+      for(xsize p = 0; p < element.propertyCount; ++p)
+        {
+        propertyItems[p] = Unused;
+        propertyComponents[p] = 0;
+
+        const PropertyMap *map = findPropertyMap(element.properties[p]);
+        for(xsize i = 0; map && !element.properties[p].list && i < indexedCount; ++i)
+          {
+          if(items[i] == map->semantic)
+            {
+            propertyItems[p] = i;
+            propertyComponents[p] = map->component;
+            }
+          }
+
+        if(propertyItems[p] != Unused)
+          {
+          elements[propertyItems[p]].data.resize(vertexCount, ObjLoader::ElementVector::Zero());
+          }
+        }
+
+      for(xsize v = 0; v < vertexCount; ++v)
+        {
+        for(xsize p = 0; p < element.propertyCount; ++p)
+          {
+          const Property &property = element.properties[p];
+          if(propertyItems[p] == Unused)
+            {
+            reader.skip(property);
+            continue;
+            }
+          elements[propertyItems[p]].data[v](propertyComponents[p]) = (Real)reader.read(property.type);
+          }
+        }
+
+      for(xsize i = 0; i < indexedCount; ++i)
+        {
+        if(items[i] == ShaderVertexLayoutDescription::TextureCoordinate)
+          {
+          Vector<ObjLoader::ElementVector> &texcoords = elements[i].data;
+          for(xsize v = 0; v < texcoords.size(); ++v)
+            {
+            texcoords[v].y() = 1.0f - texcoords[v].y();
+            }
+          }
+        }
+      }
+    else if(element.name.equals("face"))
+      {
+      readFaces(reader, element, vertexCount, &polygon, [&](const xuint32 *indices, xsize count)
+        {
+        for(xsize c = 2; c < count; ++c)
+          {
+          const xuint32 corners[] = { indices[0], indices[c - 1], indices[c] };
+          for(xsize k = 0; k < 3; ++k)
+            {
+            VectorI3D corner = VectorI3D::Zero();
+            for(xsize i = 0; i < indexedCount; ++i)
+              {
+              corner(i) = elements[i].data.size() ? (int)corners[k] : 0;
+              }
+            *triangles << corner;
+            }
+          }
+        });
+      }
+    else
+      {
+      reader.skip(element);
+      }
+    }
+
+  return true;
+  }
+
+bool PlyLoader::findDirectVertexData(
+    const char *data,
+    xsize dataSize,
+    const ShaderVertexLayoutDescription::Semantic *items,
+    xsize itemCount,
+    const xuint8 **vertexData,
+    xsize *vertexSize,
+    xsize *vertexCount)
+  {
+  xAssert(vertexData);
+  xAssert(vertexSize);
+  xAssert(vertexCount);
+
+  Header header;
+  parseHeader(data, dataSize, &header);
+
+  Reader reader(header, data + dataSize);
+  return findDirectVertices(header, reader, items, itemCount, vertexData, vertexSize, vertexCount);
+  }
+
+bool PlyLoader::createDirect(
+    const char *data,
+    xsize dataSize,
+    const ShaderVertexLayoutDescription::Semantic *items,
+    xsize itemCount,
+    Renderer *r,
+    Geometry *geo,
+    IndexGeometry *indexGeo)
+  {
+  xAssert(geo);
+
+  Header header;
+  parseHeader(data, dataSize, &header);
+
+  Reader reader(header, data + dataSize);
+  const xuint8 *vertexData = 0;
+  xsize vertexSize = 0;
+  xsize vertexCount = 0;
+  if(!findDirectVertices(header, reader, items, itemCount, &vertexData, &vertexSize, &vertexCount))
+    {
+    return false;
+    }
+
+  if(!Geometry::delayedCreate(*geo, r, vertexData, vertexSize, vertexCount))
+    {
+    return false;
+    }
+
+  if(!indexGeo)
+    {
+    return true;
+    }
+
+  // Faces hold a length before each polygon, so the indices are gathered into a triangle list.
+  xsize vertexElement = 0;
+  findElement(header, "vertex", &vertexElement);
+
+  Vector<xuint32> indices(_allocator);
+  Vector<xuint32> polygon(_allocator);
+  for(xsize e = vertexElement + 1; e < header.elementCount; ++e)
+    {
+    const Element &element = header.elements[e];
+    if(!element.name.equals("face"))
+      {
+      reader.skip(element);
+      continue;
+      }
+
+    indices.reserve(element.count * 3);
+    readFaces(reader, element, vertexCount, &polygon, [&](const xuint32 *polygonIndices, xsize count)
+      {
+      for(xsize c = 2; c < count; ++c)
+        {
+        indices << polygonIndices[0] << polygonIndices[c - 1] << polygonIndices[c];
+        }
+      });
+    }
+
+  return IndexGeometry::delayedCreateNarrowest(*indexGeo, r, indices.data(), indices.size(), vertexCount);
+  }
+
+bool PlyLoader::loadFile(
+    const char *path,
+    const ShaderVertexLayoutDescription::Semantic *items,
+    xsize itemCount,
+    Vector<VectorI3D> *triangles,
+    xsize *vertexSize,
+    ObjLoader::ElementData *elements)
+  {
+  return withMappedFile(path, [&](const char *data, xsize dataSize)
+    {
+    return load(data, dataSize, items, itemCount, triangles, vertexSize, elements);
+    });
+  }
+
+bool PlyLoader::createDirectFromFile(
+    const char *path,
+    const ShaderVertexLayoutDescription::Semantic *items,
+    xsize itemCount,
+    Renderer *r,
+    Geometry *geo,
+    IndexGeometry *indexGeo)
+  {
+  return withMappedFile(path, [&](const char *data, xsize dataSize)
+    {
+    return createDirect(data, dataSize, items, itemCount, r, geo, indexGeo);
+    });
+  }
+
+}
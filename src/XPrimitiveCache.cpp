@@ -0,0 +1,168 @@
+#include "XPrimitiveCache.h"
+#include "XModeller.h"
+#include <cstring>
+
+namespace Eks
+{
+
+namespace
+{
+
+xuint32 realBits(Real value)
+  {
+  float f = (float)value;
+  xuint32 bits;
+  memcpy(&bits, &f, sizeof(bits));
+  return bits;
+  }
+
+Real bitsReal(xuint32 bits)
+  {
+  float f;
+  memcpy(&f, &bits, sizeof(f));
+  return f;
+  }
+
+}
+
+PrimitiveCache::PrimitiveCache(AllocatorBase *allocator)
+    : _allocator(allocator)
+  {
+  for(xsize i = 0; i < BucketCount; ++i)
+    {
+    _buckets[i].store(0, std::memory_order_relaxed);
+    }
+  }
+
+PrimitiveCache::~PrimitiveCache()
+  {
+  clear();
+  }
+
+const PrimitiveCache::Primitive &PrimitiveCache::sphere(xuint32 lats, xuint32 longs)
+  {
+  Key key = { Sphere, lats, longs, false };
+  return find(key);
+  }
+
+const PrimitiveCache::Primitive &PrimitiveCache::cone(xuint32 divs, bool capped)
+  {
+  Key key = { Cone, divs, 0, capped };
+  return find(key);
+  }
+
+const PrimitiveCache::Primitive &PrimitiveCache::wireCircle(xuint32 points)
+  {
+  Key key = { WireCircle, points, 0, false };
+  return find(key);
+  }
+
+const PrimitiveCache::Primitive &PrimitiveCache::cube(Real textureX, Real textureY)
+  {
+  Key key = { Cube, realBits(textureX), realBits(textureY), false };
+  return find(key);
+  }
+
+void PrimitiveCache::clear()
+  {
+  std::lock_guard<std::mutex> l(_lock);
+  for(xsize i = 0; i < BucketCount; ++i)
+    {
+    Entry *entry = _buckets[i].exchange(0, std::memory_order_relaxed);
+    while(entry)
+      {
+      Entry *next = entry->next;
+      _allocator->destroy(entry->primitive);
+      _allocator->destroy(entry);
+      entry = next;
+      }
+    }
+  }
+
+xsize PrimitiveCache::bucket(const Key &key)
+  {
+  xuint32 hash = (xuint32)key.type;
+  hash = hash * 0x9E3779B1 ^ key.a;
+  hash = hash * 0x9E3779B1 ^ key.b;
+  hash = hash * 0x9E3779B1 ^ (xuint32)key.capped;
+  hash ^= hash >> 15;
+  return hash % BucketCount;
+  }
+
+const PrimitiveCache::Entry *PrimitiveCache::findInChain(const Entry *first, const Key &key)
+  {
+  for(const Entry *entry = first; entry; entry = entry->next)
+    {
+    if(entry->key.equals(key))
+      {
+      return entry;
+      }
+    }
+  return 0;
+  }
+
+const PrimitiveCache::Primitive &PrimitiveCache::find(const Key &key)
+  {
+  std::atomic<Entry *> &head = _buckets[bucket(key)];
+  if(const Entry *found = findInChain(head.load(std::memory_order_acquire), key))
+    {
+    return *found->primitive;
+    }
+
+  std::lock_guard<std::mutex> l(_lock);
+  // Another thread may have built it while this one waited.
+  Entry *first = head.load(std::memory_order_relaxed);
+  if(const Entry *found = findInChain(first, key))
+    {
+    return *found->primitive;
+    }
+
+  Entry *entry = _allocator->create<Entry>();
+  entry->key = key;
+  entry->primitive = build(key);
+  entry->next = first;
+  head.store(entry, std::memory_order_release);
+  return *entry->primitive;
+  }
+
+PrimitiveCache::Primitive *PrimitiveCache::build(const Key &key)
+  {
+  // The Modeller's immediate mode draws are the reference tessellation.
+  Modeller m(_allocator);
+  switch(key.type)
+    {
+  case Sphere:
+    m.drawSphere(1.0f, (int)key.a, (int)key.b);
+    break;
+  case Cone:
+    m.drawCone(Vector3D::Zero(), Vector3D(1, 0, 0), 1.0f, 1.0f, key.a, key.capped);
+    break;
+  case WireCircle:
+    m.drawWireCircle(Vector3D::Zero(), Vector3D(0, 0, 1), 1.0f, key.a);
+    break;
+  case Cube:
+    m.drawCube(Vector3D(1, 0, 0), Vector3D(0, 1, 0), Vector3D(0, 0, 1), bitsReal(key.a), bitsReal(key.b));
+    break;
+    }
+
+  Primitive *primitive = _allocator->create<Primitive>(_allocator);
+
+  const xsize vertexCount = m._vertex.size();
+  primitive->positions.resizeAndCopy(vertexCount, m._vertex.data());
+  if(m._normals.size())
+    {
+    primitive->normals.resizeAndCopy(m._normals.size(), m._normals.data());
+    primitive->normals.resize(vertexCount, Vector3D::Zero());
+    }
+  if(m._texture.size())
+    {
+    primitive->textures.resizeAndCopy(m._texture.size(), m._texture.data());
+    primitive->textures.resize(vertexCount, Vector2D::Zero());
+    }
+  primitive->triangles.resizeAndCopy(m._triIndices.size(), m._triIndices.data());
+  primitive->lines.resizeAndCopy(m._linIndices.size(), m._linIndices.data());
+
+  return primitive;
+  }
+
+}
@@ -0,0 +1,174 @@
+#include "XTangentGenerator.h"
+#include "XParallel.h"
+#include <cmath>
+
+namespace Eks
+{
+
+TangentGenerator::TangentGenerator(AllocatorBase *allocator)
+    : _allocator(allocator)
+  {
+  }
+
+void TangentGenerator::generate(
+    const Vector3D *positions,
+    const Vector3D *normals,
+    const Vector2D *texCoords,
+    xsize vertexCount,
+    const xuint32 *indices,
+    xsize indexCount,
+    Vector<Vector4D> *tangents)
+  {
+  xAssert(tangents);
+  xAssert((indexCount % 3) == 0);
+
+  const xsize triCount = indexCount / 3;
+
+  // Each corner's contribution, so the per vertex sums can run in parallel without sharing.
+  Vector<Vector3D> cornerTangents(_allocator);
+  Vector<Vector3D> cornerBitangents(_allocator);
+  cornerTangents.resize(indexCount, Vector3D::Zero());
+  cornerBitangents.resize(indexCount, Vector3D::Zero());
+
+  ParallelUtilities::forRanges(triCount, MinimumParallelTriangles, [&](xsize, xsize begin, xsize end)
+    {
+    for(xsize t = begin; t < end; ++t)
+      {
+      const xuint32 *tri = indices + t * 3;
+      xAssert(tri[0] < vertexCount && tri[1] < vertexCount && tri[2] < vertexCount);
+
+      const Vector3D faceTangent = triangleTangent(
+        positions[tri[0]], positions[tri[1]], positions[tri[2]],
+        texCoords[tri[0]], texCoords[tri[1]], texCoords[tri[2]]);
+      const Vector3D faceBitangent = triangleBitangent(
+        positions[tri[0]], positions[tri[1]], positions[tri[2]],
+        texCoords[tri[0]], texCoords[tri[1]], texCoords[tri[2]]);
+
+      for(xsize c = 0; c < 3; ++c)
+        {
+        const xuint32 v = tri[c];
+        const Vector3D &n = normals[v];
+
+        Vector3D projected = faceTangent - n * n.dot(faceTangent);
+        const Real length = projected.norm();
+        if(length <= 0)
+          {
+          continue;
+          }
+
+        const Vector3D edgeA = (positions[tri[(c + 1) % 3]] - positions[v]).normalized();
+        const Vector3D edgeB = (positions[tri[(c + 2) % 3]] - positions[v]).normalized();
+        const Real cosine = std::max((Real)-1, std::min((Real)1, edgeA.dot(edgeB)));
+
+        const Real angle = std::acos(cosine);
+        cornerTangents[t * 3 + c] = projected * (angle / length);
+        cornerBitangents[t * 3 + c] = faceBitangent * angle;
+        }
+      }
+    });
+
+  // Bucket the corners by vertex, in corner order so the sums are deterministic.
+  Vector<xuint32> offsets(_allocator);
+  offsets.resize(vertexCount + 1, 0);
+  for(xsize i = 0; i < indexCount; ++i)
+    {
+    ++offsets[indices[i] + 1];
+    }
+  for(xsize i = 0; i < vertexCount; ++i)
+    {
+    offsets[i + 1] += offsets[i];
+    }
+
+  Vector<xuint32> corners(_allocator);
+  corners.resize(indexCount, 0);
+  Vector<xuint32> fill(_allocator);
+  fill.resizeAndCopy(vertexCount, offsets.data());
+  for(xsize i = 0; i < indexCount; ++i)
+    {
+    corners[fill[indices[i]]++] = (xuint32)i;
+    }
+
+  tangents->clear();
+  tangents->resize(vertexCount, Vector4D::Zero());
+
+  ParallelUtilities::forRanges(vertexCount, MinimumParallelVertices, [&](xsize, xsize begin, xsize end)
+    {
+    for(xsize v = begin; v < end; ++v)
+      {
+      Vector3D sum = Vector3D::Zero();
+      Vector3D bitangentSum = Vector3D::Zero();
+      for(xsize s = offsets[v]; s < offsets[v + 1]; ++s)
+        {
+        sum += cornerTangents[corners[s]];
+        bitangentSum += cornerBitangents[corners[s]];
+        }
+
+      const Vector3D tangent = orthogonalise(sum, normals[v]);
+      const Real sign = bitangentSign(normals[v], tangent, bitangentSum);
+      (*tangents)[v] = Vector4D(tangent.x(), tangent.y(), tangent.z(), sign);
+      }
+    });
+  }
+
+Vector3D TangentGenerator::triangleTangent(
+    const Vector3D &p0, const Vector3D &p1, const Vector3D &p2,
+    const Vector2D &t0, const Vector2D &t1, const Vector2D &t2)
+  {
+  const Vector3D e1 = p1 - p0;
+  const Vector3D e2 = p2 - p0;
+  const Vector2D d1 = t1 - t0;
+  const Vector2D d2 = t2 - t0;
+
+  const Real det = d1.x() * d2.y() - d2.x() * d1.y();
+  if(det == 0)
+    {
+    return Vector3D::Zero();
+    }
+
+  // The sign of det flips the tangent with mirrored texture coordinates, the magnitude
+  // is left for the caller to normalise.
+  const Vector3D tangent = e1 * d2.y() - e2 * d1.y();
+  return det > 0 ? tangent : Vector3D(-tangent);
+  }
+
+Vector3D TangentGenerator::triangleBitangent(
+    const Vector3D &p0, const Vector3D &p1, const Vector3D &p2,
+    const Vector2D &t0, const Vector2D &t1, const Vector2D &t2)
+  {
+  const Vector3D e1 = p1 - p0;
+  const Vector3D e2 = p2 - p0;
+  const Vector2D d1 = t1 - t0;
+  const Vector2D d2 = t2 - t0;
+
+  const Real det = d1.x() * d2.y() - d2.x() * d1.y();
+  if(det == 0)
+    {
+    return Vector3D::Zero();
+    }
+
+  const Vector3D bitangent = e2 * d1.x() - e1 * d2.x();
+  return det > 0 ? bitangent : Vector3D(-bitangent);
+  }
+
+Real TangentGenerator::bitangentSign(const Vector3D &normal, const Vector3D &tangent, const Vector3D &bitangent)
+  {
+  return normal.cross(tangent).dot(bitangent) < 0 ? (Real)-1 : (Real)1;
+  }
+
+Vector3D TangentGenerator::orthogonalise(const Vector3D &tangent, const Vector3D &normal)
+  {
+  Vector3D result = tangent - normal * normal.dot(tangent);
+  const Real lengthSq = result.squaredNorm();
+  if(lengthSq > 1e-12f)
+    {
+    return result / std::sqrt(lengthSq);
+    }
+
+  // Any perpendicular will do, pick the axis least aligned with the normal.
+  const Vector3D axis = std::abs(normal.x()) < 0.9f ? Vector3D(1, 0, 0) : Vector3D(0, 1, 0);
+  result = axis - normal * normal.dot(axis);
+  const Real axisLengthSq = result.squaredNorm();
+  return axisLengthSq > 0 ? Vector3D(result / std::sqrt(axisLengthSq)) : axis;
+  }
+
+}
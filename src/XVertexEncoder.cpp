@@ -0,0 +1,319 @@
+#include "XVertexEncoder.h"
+#include <cmath>
+#include <cstring>
+
+namespace Eks
+{
+
+namespace
+{
+
+template <typename T> T encodeSigned(Real value)
+  {
+  const Real maximum = (Real)std::numeric_limits<T>::max();
+  const Real clamped = std::max((Real)-1, std::min((Real)1, value));
+  return (T)std::floor(clamped * maximum + (Real)0.5);
+  }
+
+template <typename T> T encodeUnsigned(Real value)
+  {
+  const Real maximum = (Real)std::numeric_limits<T>::max();
+  const Real clamped = std::max((Real)0, std::min((Real)1, value));
+  return (T)std::floor(clamped * maximum + (Real)0.5);
+  }
+
+template <typename T> Real decodeSigned(T value)
+  {
+  return std::max((Real)-1, (Real)value / (Real)std::numeric_limits<T>::max());
+  }
+
+template <typename T> Real decodeUnsigned(T value)
+  {
+  return (Real)value / (Real)std::numeric_limits<T>::max();
+  }
+
+template <typename T> void encodeArray(const Real *values, xsize valueCount, xsize count, T (*fn)(Real), xuint8 *out)
+  {
+  T result[4];
+  for(xsize i = 0; i < count; ++i)
+    {
+    result[i] = fn(i < valueCount ? values[i] : 0);
+    }
+  memcpy(out, result, sizeof(T) * count);
+  }
+
+template <typename T> void decodeArray(const xuint8 *in, xsize count, Real (*fn)(T), Real *values)
+  {
+  T data[4];
+  memcpy(data, in, sizeof(T) * count);
+  for(xsize i = 0; i < count; ++i)
+    {
+    values[i] = fn(data[i]);
+    }
+  }
+
+xuint16 encodeHalf(Real value)
+  {
+  return VertexEncoder::toHalf((float)value);
+  }
+
+Real decodeHalf(xuint16 value)
+  {
+  return VertexEncoder::fromHalf(value);
+  }
+
+// Unsigned normalised value in [bits] bits.
+xuint32 encodePacked(Real value, xuint32 bits)
+  {
+  const xuint32 maximum = (1u << bits) - 1;
+  const Real clamped = std::max((Real)0, std::min((Real)1, value));
+  return (xuint32)std::floor(clamped * maximum + (Real)0.5);
+  }
+
+Real decodePacked(xuint32 packed, xuint32 shift, xuint32 bits)
+  {
+  const xuint32 maximum = (1u << bits) - 1;
+  return (Real)((packed >> shift) & maximum) / maximum;
+  }
+
+}
+
+void VertexEncoder::encode(Format fmt, const Real *values, xsize valueCount, xuint8 *out)
+  {
+  switch(fmt)
+    {
+  case ShaderVertexLayoutDescription::FormatFloat1:
+  case ShaderVertexLayoutDescription::FormatFloat2:
+  case ShaderVertexLayoutDescription::FormatFloat3:
+  case ShaderVertexLayoutDescription::FormatFloat4:
+    {
+    float result[4];
+    const xsize count = ShaderVertexLayoutDescription::formatComponents(fmt);
+    for(xsize i = 0; i < count; ++i)
+      {
+      result[i] = i < valueCount ? (float)values[i] : 0.0f;
+      }
+    memcpy(out, result, sizeof(float) * count);
+    break;
+    }
+  case ShaderVertexLayoutDescription::FormatHalf2:
+    encodeArray<xuint16>(values, valueCount, 2, encodeHalf, out);
+    break;
+  case ShaderVertexLayoutDescription::FormatHalf4:
+    encodeArray<xuint16>(values, valueCount, 4, encodeHalf, out);
+    break;
+  case ShaderVertexLayoutDescription::FormatNormalisedShort2:
+    encodeArray<xint16>(values, valueCount, 2, encodeSigned<xint16>, out);
+    break;
+  case ShaderVertexLayoutDescription::FormatNormalisedShort4:
+    encodeArray<xint16>(values, valueCount, 4, encodeSigned<xint16>, out);
+    break;
+  case ShaderVertexLayoutDescription::FormatNormalisedUnsignedShort2:
+    encodeArray<xuint16>(values, valueCount, 2, encodeUnsigned<xuint16>, out);
+    break;
+  case ShaderVertexLayoutDescription::FormatNormalisedByte4:
+    encodeArray<xint8>(values, valueCount, 4, encodeSigned<xint8>, out);
+    break;
+  case ShaderVertexLayoutDescription::FormatNormalisedUnsignedByte4:
+    encodeArray<xuint8>(values, valueCount, 4, encodeUnsigned<xuint8>, out);
+    break;
+  case ShaderVertexLayoutDescription::FormatNormalisedUnsigned10_10_10_2:
+    {
+    const xuint32 bits[] = { 10, 10, 10, 2 };
+    xuint32 packed = 0;
+    for(xsize i = 0, shift = 0; i < 4; shift += bits[i], ++i)
+      {
+      packed |= encodePacked(i < valueCount ? values[i] : 0, bits[i]) << shift;
+      }
+    memcpy(out, &packed, sizeof(packed));
+    break;
+    }
+  case ShaderVertexLayoutDescription::FormatOctahedralNormal:
+    {
+    xAssert(valueCount >= 3);
+    const Vector2D encoded = octahedralEncode(Vector3D(values[0], values[1], values[2]));
+    encodeArray<xint16>(encoded.data(), 2, 2, encodeSigned<xint16>, out);
+    break;
+    }
+  default:
+    xAssertFail();
+    }
+  }
+
+void VertexEncoder::decode(Format fmt, const xuint8 *in, Real *values)
+  {
+  switch(fmt)
+    {
+  case ShaderVertexLayoutDescription::FormatFloat1:
+  case ShaderVertexLayoutDescription::FormatFloat2:
+  case ShaderVertexLayoutDescription::FormatFloat3:
+  case ShaderVertexLayoutDescription::FormatFloat4:
+    {
+    float data[4];
+    const xsize count = ShaderVertexLayoutDescription::formatComponents(fmt);
+    memcpy(data, in, sizeof(float) * count);
+    for(xsize i = 0; i < count; ++i)
+      {
+      values[i] = data[i];
+      }
+    break;
+    }
+  case ShaderVertexLayoutDescription::FormatHalf2:
+    decodeArray<xuint16>(in, 2, decodeHalf, values);
+    break;
+  case ShaderVertexLayoutDescription::FormatHalf4:
+    decodeArray<xuint16>(in, 4, decodeHalf, values);
+    break;
+  case ShaderVertexLayoutDescription::FormatNormalisedShort2:
+    decodeArray<xint16>(in, 2, decodeSigned<xint16>, values);
+    break;
+  case ShaderVertexLayoutDescription::FormatNormalisedShort4:
+    decodeArray<xint16>(in, 4, decodeSigned<xint16>, values);
+    break;
+  case ShaderVertexLayoutDescription::FormatNormalisedUnsignedShort2:
+    decodeArray<xuint16>(in, 2, decodeUnsigned<xuint16>, values);
+    break;
+  case ShaderVertexLayoutDescription::FormatNormalisedByte4:
+    decodeArray<xint8>(in, 4, decodeSigned<xint8>, values);
+    break;
+  case ShaderVertexLayoutDescription::FormatNormalisedUnsignedByte4:
+    decodeArray<xuint8>(in, 4, decodeUnsigned<xuint8>, values);
+    break;
+  case ShaderVertexLayoutDescription::FormatNormalisedUnsigned10_10_10_2:
+    {
+    xuint32 packed;
+    memcpy(&packed, in, sizeof(packed));
+    values[0] = decodePacked(packed, 0, 10);
+    values[1] = decodePacked(packed, 10, 10);
+    values[2] = decodePacked(packed, 20, 10);
+    values[3] = decodePacked(packed, 30, 2);
+    break;
+    }
+  case ShaderVertexLayoutDescription::FormatOctahedralNormal:
+    {
+    Real encoded[2];
+    decodeArray<xint16>(in, 2, decodeSigned<xint16>, encoded);
+    const Vector3D normal = octahedralDecode(Vector2D(encoded[0], encoded[1]));
+    values[0] = normal.x();
+    values[1] = normal.y();
+    values[2] = normal.z();
+    break;
+    }
+  default:
+    xAssertFail();
+    }
+  }
+
+xuint16 VertexEncoder::toHalf(float value)
+  {
+  xuint32 bits;
+  memcpy(&bits, &value, sizeof(bits));
+
+  const xuint32 sign = (bits >> 16) & 0x8000;
+  const xuint32 magnitude = bits & 0x7fffffff;
+
+  // Infinity and NaN, keeping NaNs quiet.
+  if(magnitude >= 0x7f800000)
+    {
+    return (xuint16)(sign | 0x7c00 | (magnitude > 0x7f800000 ? 0x200 : 0));
+    }
+
+  // Values that round up past the largest half.
+  if(magnitude >= 0x477ff000)
+    {
+    return (xuint16)(sign | 0x7c00);
+    }
+
+  // Values below the smallest normal half become denormals.
+  if(magnitude < 0x38800000)
+    {
+    if(magnitude < 0x33000000)
+      {
+      return (xuint16)sign;
+      }
+
+    const xuint32 exponent = magnitude >> 23;
+    const xuint32 mantissa = (magnitude & 0x7fffff) | 0x800000;
+    const xuint32 shift = 126 - exponent;
+
+    xuint32 half = mantissa >> shift;
+    const xuint32 remainder = mantissa & ((1u << shift) - 1);
+    const xuint32 halfway = 1u << (shift - 1);
+    if(remainder > halfway || (remainder == halfway && (half & 1)))
+      {
+      ++half;
+      }
+    return (xuint16)(sign | half);
+    }
+
+  // Rebias the exponent from 127 to 15, a carry out of the mantissa correctly bumps it.
+  xuint32 half = (magnitude - 0x38000000) >> 13;
+  const xuint32 remainder = magnitude & 0x1fff;
+  if(remainder > 0x1000 || (remainder == 0x1000 && (half & 1)))
+    {
+    ++half;
+    }
+  return (xuint16)(sign | half);
+  }
+
+float VertexEncoder::fromHalf(xuint16 value)
+  {
+  const xuint32 sign = (xuint32)(value & 0x8000) << 16;
+  const xuint32 exponent = (value >> 10) & 0x1f;
+  const xuint32 mantissa = value & 0x3ff;
+
+  xuint32 bits;
+  if(exponent == 0x1f)
+    {
+    bits = sign | 0x7f800000 | (mantissa << 13);
+    }
+  else if(exponent)
+    {
+    bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+    }
+  else
+    {
+    const float denormal = (float)mantissa / (float)(1 << 24);
+    return sign ? -denormal : denormal;
+    }
+
+  float result;
+  memcpy(&result, &bits, sizeof(result));
+  return result;
+  }
+
+Vector2D VertexEncoder::octahedralEncode(const Vector3D &normal)
+  {
+  const Real length = std::abs(normal.x()) + std::abs(normal.y()) + std::abs(normal.z());
+  if(length <= 0)
+    {
+    return Vector2D::Zero();
+    }
+
+  Vector2D result(normal.x() / length, normal.y() / length);
+  if(normal.z() < 0)
+    {
+    const Real x = result.x();
+    const Real y = result.y();
+    result.x() = (1 - std::abs(y)) * (x >= 0 ? 1 : -1);
+    result.y() = (1 - std::abs(x)) * (y >= 0 ? 1 : -1);
+    }
+
+  return result;
+  }
+
+Vector3D VertexEncoder::octahedralDecode(const Vector2D &encoded)
+  {
+  Vector3D result(encoded.x(), encoded.y(), 1 - std::abs(encoded.x()) - std::abs(encoded.y()));
+  if(result.z() < 0)
+    {
+    const Real x = result.x();
+    const Real y = result.y();
+    result.x() = (1 - std::abs(y)) * (x >= 0 ? 1 : -1);
+    result.y() = (1 - std::abs(x)) * (y >= 0 ? 1 : -1);
+    }
+
+  return result.normalized();
+  }
+
+}
@@ -0,0 +1,247 @@
+#include "XVertexInterleaver.h"
+#include "XParallel.h"
+#include <algorithm>
+#include <cstring>
+
+#if EKS_XREAL_IS_DOUBLE == 0 && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+# define X_VERTEX_INTERLEAVER_SIMD 1
+# include <emmintrin.h>
+#else
+# define X_VERTEX_INTERLEAVER_SIMD 0
+#endif
+
+namespace Eks
+{
+
+namespace
+{
+
+typedef VertexInterleaver::Stream Stream;
+typedef void (*WideFunction)(const Stream *streams, xsize streamCount, xsize stride, xsize begin, xsize end, Real *out);
+
+// Copy an element with a single four wide load and store. The SIMD version reads and writes
+// past elements with fewer components, callers must leave room after [in] and [out].
+inline void copyWide(const Real *in, Real *out, xsize components)
+  {
+#if X_VERTEX_INTERLEAVER_SIMD
+  (void)components;
+  _mm_storeu_ps(out, _mm_loadu_ps(in));
+#else
+  for(xsize i = 0; i < components; ++i)
+    {
+    out[i] = in[i];
+    }
+#endif
+  }
+
+inline void copyExact(const Stream &stream, xsize vertex, Real *out)
+  {
+  if(vertex < stream.count)
+    {
+    const Real *in = stream.data + vertex * stream.components;
+    std::copy(in, in + stream.components, out);
+    }
+  else
+    {
+    memset(out, 0, sizeof(Real) * stream.components);
+    }
+  }
+
+// The number of leading vertices in [stream] copyWide can read.
+xsize wideReadable(const Stream &stream)
+  {
+#if X_VERTEX_INTERLEAVER_SIMD
+  const xsize values = stream.count * stream.components;
+  if(values < VertexInterleaver::MaxComponents)
+    {
+    return 0;
+    }
+  return (values - VertexInterleaver::MaxComponents) / stream.components + 1;
+#else
+  return stream.count;
+#endif
+  }
+
+// One vertex after another, the wide stores of later elements overwrite what earlier ones
+// wrote past their end.
+void interleaveGeneric(const Stream *streams, xsize streamCount, xsize stride, xsize begin, xsize end, Real *out)
+  {
+  for(xsize v = begin; v < end; ++v)
+    {
+    Real *vertex = out + v * stride;
+    for(xsize s = 0; s < streamCount; ++s)
+      {
+      const Stream &stream = streams[s];
+      copyWide(stream.data + v * stream.components, vertex, stream.components);
+      vertex += stream.components;
+      }
+    }
+  }
+
+// Vertices where some streams can't be read wide: those are copied exactly, or zeroed past
+// their end, in place so wide stores of the streams before them are still overwritten.
+void interleaveMixed(const Stream *streams, const xsize *readable, xsize streamCount, xsize stride, xsize begin, xsize end, Real *out)
+  {
+  for(xsize v = begin; v < end; ++v)
+    {
+    Real *vertex = out + v * stride;
+    for(xsize s = 0; s < streamCount; ++s)
+      {
+      const Stream &stream = streams[s];
+      if(v < readable[s])
+        {
+        copyWide(stream.data + v * stream.components, vertex, stream.components);
+        }
+      else
+        {
+        copyExact(stream, v, vertex);
+        }
+      vertex += stream.components;
+      }
+    }
+  }
+
+// The generic loop with the layout known at compile time, so offsets are constant and
+// the stream loop is unrolled.
+template <xsize A, xsize B, xsize C, xsize D> struct FixedLayout
+  {
+  static void interleave(const Stream *streams, xsize, xsize, xsize begin, xsize end, Real *out)
+    {
+    const xsize stride = A + B + C + D;
+    const Real *a = streams[0].data;
+    const Real *b = B ? streams[1].data : 0;
+    const Real *c = C ? streams[2].data : 0;
+    const Real *d = D ? streams[3].data : 0;
+
+    for(xsize v = begin; v < end; ++v)
+      {
+      Real *vertex = out + v * stride;
+      copyWide(a + v * A, vertex, A);
+      if(B)
+        {
+        copyWide(b + v * B, vertex + A, B);
+        }
+      if(C)
+        {
+        copyWide(c + v * C, vertex + A + B, C);
+        }
+      if(D)
+        {
+        copyWide(d + v * D, vertex + A + B + C, D);
+        }
+      }
+    }
+  };
+
+struct Kernel
+  {
+  xsize components[4];
+  WideFunction function;
+  };
+
+// Layouts Modeller bakes by default: Position with Normal, TextureCoordinate, Colour and BiNormal.
+const Kernel kernels[] =
+  {
+    { { 3, 0, 0, 0 }, FixedLayout<3, 0, 0, 0>::interleave },
+    { { 3, 3, 0, 0 }, FixedLayout<3, 3, 0, 0>::interleave },
+    { { 3, 2, 0, 0 }, FixedLayout<3, 2, 0, 0>::interleave },
+    { { 3, 4, 0, 0 }, FixedLayout<3, 4, 0, 0>::interleave },
+    { { 3, 3, 2, 0 }, FixedLayout<3, 3, 2, 0>::interleave },
+    { { 3, 2, 3, 0 }, FixedLayout<3, 2, 3, 0>::interleave },
+    { { 3, 3, 4, 0 }, FixedLayout<3, 3, 4, 0>::interleave },
+    { { 3, 4, 3, 0 }, FixedLayout<3, 4, 3, 0>::interleave },
+    { { 3, 4, 2, 0 }, FixedLayout<3, 4, 2, 0>::interleave },
+    { { 3, 3, 2, 4 }, FixedLayout<3, 3, 2, 4>::interleave },
+    { { 3, 4, 2, 4 }, FixedLayout<3, 4, 2, 4>::interleave },
+  };
+
+WideFunction findKernel(const Stream *streams, xsize streamCount)
+  {
+  if(streamCount > 4)
+    {
+    return interleaveGeneric;
+    }
+
+  xsize components[4] = { 0, 0, 0, 0 };
+  for(xsize i = 0; i < streamCount; ++i)
+    {
+    components[i] = streams[i].components;
+    }
+
+  for(xsize i = 0; i < X_ARRAY_COUNT(kernels); ++i)
+    {
+    if(memcmp(kernels[i].components, components, sizeof(components)) == 0)
+      {
+      return kernels[i].function;
+      }
+    }
+
+  return interleaveGeneric;
+  }
+
+}
+
+xsize VertexInterleaver::vertexSize(const Stream *streams, xsize streamCount)
+  {
+  xsize size = 0;
+  for(xsize i = 0; i < streamCount; ++i)
+    {
+    size += streams[i].components * sizeof(Real);
+    }
+  return size;
+  }
+
+void VertexInterleaver::interleave(const Stream *streams, xsize streamCount, xsize vertexCount, void *outData)
+  {
+  xAssert(streamCount <= MaxStreams);
+  if(!vertexCount || !streamCount)
+    {
+    return;
+    }
+
+  // Values written per vertex, and the furthest past a vertex's start the wide stores reach.
+  // Absent or short streams only limit the vertices the specialised kernel handles.
+  xsize stride = 0;
+  xsize reach = 0;
+  xsize allReadable = vertexCount;
+  xsize anyReadable = 0;
+  xsize readable[MaxStreams];
+  for(xsize i = 0; i < streamCount; ++i)
+    {
+    xAssert(streams[i].components > 0 && streams[i].components <= MaxComponents);
+#if X_VERTEX_INTERLEAVER_SIMD
+    reach = std::max(reach, stride + MaxComponents);
+#endif
+    stride += streams[i].components;
+    readable[i] = std::min(vertexCount, wideReadable(streams[i]));
+    allReadable = std::min(allReadable, readable[i]);
+    anyReadable = std::max(anyReadable, readable[i]);
+    }
+  reach = std::max(reach, stride);
+
+  const WideFunction wide = findKernel(streams, streamCount);
+  Real *out = reinterpret_cast<Real *>(outData);
+
+  ParallelUtilities::forRanges(vertexCount, MinParallelVertices, [&](xsize, xsize begin, xsize end)
+    {
+    // Wide stores must stay inside the range, so they never race with another thread's.
+    const xsize writable = end * stride >= reach ? (end * stride - reach) / stride + 1 : 0;
+    const xsize wideEnd = std::max(begin, std::min(writable, allReadable));
+    const xsize mixedEnd = std::max(wideEnd, std::min(writable, anyReadable));
+
+    wide(streams, streamCount, stride, begin, wideEnd, out);
+    interleaveMixed(streams, readable, streamCount, stride, wideEnd, mixedEnd, out);
+
+    for(xsize v = mixedEnd; v < end; ++v)
+      {
+      Real *vertex = out + v * stride;
+      for(xsize s = 0; s < streamCount; ++s)
+        {
+        copyExact(streams[s], v, vertex);
+        vertex += streams[s].components;
+        }
+      }
+    });
+  }
+
+}
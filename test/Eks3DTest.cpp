@@ -2,6 +2,33 @@
 #include "XLine.h"
 #include "XPlane.h"
 #include "XShape.h"
+#include "XObjLoader.h"
+#include "XNumberScanner.h"
+#include "XCookedMesh.h"
+#include "XNormalGenerator.h"
+#include "XTangentGenerator.h"
+#include "XAsyncMeshLoader.h"
+#include "XVertexEncoder.h"
+#include "XMeshOptimiser.h"
+#include "XMeshSimplifier.h"
+#include "XMeshletBuilder.h"
+#include "XFrustum.h"
+#include "XColladaFile.h"
+#include "XPlyLoader.h"
+#include "XGltfLoader.h"
+#include "XVertexInterleaver.h"
+#include "XPrimitiveCache.h"
+#include "XParallel.h"
+#include "XCurveTessellator.h"
+#include "XModeller.h"
+#include "XRenderer.h"
+#include "XCore.h"
+#include "Utilities/XParseException.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <stdexcept>
+#include <vector>
 
 class Eks3DTest : public QObject
   {
@@ -15,6 +42,38 @@ private Q_SLOTS:
   void lineTest();
   void planeTest();
   void shapeTest();
+  void numberScannerTest();
+  void objLoaderTest();
+  void objLoaderParallelTest();
+  void objLoaderIndexedBakeTest();
+  void objLoaderWideIndexTest();
+  void objLoaderStreamingTest();
+  void objLoaderSubmeshTest();
+  void cookedMeshTest();
+  void normalGeneratorTest();
+  void tangentGeneratorTest();
+  void asyncMeshLoaderTest();
+  void vertexEncoderTest();
+  void meshOptimiserTest();
+  void meshSimplifierTest();
+  void meshletTest();
+  void colladaTest();
+  void plyLoaderTest();
+  void gltfLoaderTest();
+  void vertexInterleaverTest();
+  void primitiveCacheTest();
+  void modellerMergeTest();
+  void modellerMappedBakeTest();
+  void modellerUpdateBakeTest();
+  void modellerBulkTest();
+  void curveTessellatorTest();
+  void gltfByteIndexTest();
+  void objLoaderLineCachedBenchmark();
+  void objLoaderInPlaceBenchmark();
+  void objLoaderParallelBenchmark();
+  void meshletCullBenchmark();
+  void vertexInterleaveBenchmark();
+  void vertexInterleaveStridedBenchmark();
   };
 
 Eks3DTest::Eks3DTest()
@@ -114,6 +173,2120 @@ void Eks3DTest::shapeTest()
   QVERIFY(isct3.is<Eks::Vector3D>());
   }
 
+void Eks3DTest::numberScannerTest()
+  {
+  const char *reals[] =
+    {
+    "1", "-2.5", "3.14159265", "1e10", "-1.5E-3", "0.000001", "+7", ".5", "5.",
+    "123456789012345678901234", "1.17549435e-38", "12345678901234567890.125"
+    };
+
+  xForeach(const char *str, reals)
+    {
+    float value = 0.0f;
+    QVERIFY(Eks::NumberScanner::parseReal(str, str + strlen(str), &value));
+    QCOMPARE(value, strtof(str, 0));
+    }
+
+  // Long mantissas and exponents outside [-22, 22] are rounded more than once.
+  const char *nearReals[] =
+    {
+    "0e999", "-0", "1e-50", "1.4e-45", "1e-40", "3.4028235e38",
+    "0.1000000000000000055511151231257827", "1.234567890123456789e-30", "7.038531e-26"
+    };
+
+  xForeach(const char *str, nearReals)
+    {
+    float value = 0.0f;
+    QVERIFY(Eks::NumberScanner::parseReal(str, str + strlen(str), &value));
+    const float expected = strtof(str, 0);
+    QVERIFY(value == expected || std::nextafter(value, expected) == expected);
+    }
+
+  float huge = 0.0f;
+  const char *hugeReal = "1e39";
+  QVERIFY(Eks::NumberScanner::parseReal(hugeReal, hugeReal + strlen(hugeReal), &huge));
+  QVERIFY(std::isinf(huge) && huge > 0.0f);
+
+  double tiny = 0.0;
+  const char *tinyReal = "123456789012345678901234567890e-350";
+  QVERIFY(Eks::NumberScanner::parseReal(tinyReal, tinyReal + strlen(tinyReal), &tiny));
+  QVERIFY(tiny > 0.0 && tiny == strtod(tinyReal, 0));
+
+  float value = 0.0f;
+  const char *bad = "1.0x";
+  QVERIFY(!Eks::NumberScanner::parseReal(bad, bad + 4, &value));
+
+  const char *vector = "0.5 -2e2";
+  const char *pos = vector;
+  QVERIFY(Eks::NumberScanner::scanReal(pos, vector + 8, &value));
+  QCOMPARE(value, 0.5f);
+  QCOMPARE(*pos, ' ');
+
+  int integer = 0;
+  const char *index = "-42/";
+  pos = index;
+  QVERIFY(Eks::NumberScanner::scanInteger(pos, index + 4, &integer));
+  QCOMPARE(integer, -42);
+  QCOMPARE(*pos, '/');
+  QVERIFY(!Eks::NumberScanner::parseInteger(index, index + 4, &integer));
+
+  const char *overflow = "2147483648";
+  QVERIFY(!Eks::NumberScanner::parseInteger(overflow, overflow + 10, &integer));
+
+  const char *minimum = "-2147483648";
+  QVERIFY(Eks::NumberScanner::parseInteger(minimum, minimum + strlen(minimum), &integer));
+  QCOMPARE(integer, std::numeric_limits<int>::min());
+  const char *underflow = "-2147483649";
+  QVERIFY(!Eks::NumberScanner::parseInteger(underflow, underflow + strlen(underflow), &integer));
+
+  xuint32 unsignedInteger = 0;
+  const char *negative = "-1";
+  QVERIFY(!Eks::NumberScanner::parseInteger(negative, negative + 2, &unsignedInteger));
+
+  xuint64 wide = 0;
+  const char *wideMaximum = "18446744073709551615";
+  QVERIFY(Eks::NumberScanner::parseInteger(wideMaximum, wideMaximum + strlen(wideMaximum), &wide));
+  QCOMPARE(wide, std::numeric_limits<xuint64>::max());
+  const char *wideOverflow = "18446744073709551616";
+  QVERIFY(!Eks::NumberScanner::parseInteger(wideOverflow, wideOverflow + strlen(wideOverflow), &wide));
+  }
+
+namespace
+{
+
+const Eks::ShaderVertexLayoutDescription::Semantic objSemantics[] =
+  {
+  Eks::ShaderVertexLayoutDescription::Position,
+  Eks::ShaderVertexLayoutDescription::TextureCoordinate,
+  Eks::ShaderVertexLayoutDescription::Normal
+  };
+const xsize objSemanticCount = X_ARRAY_COUNT(objSemantics);
+
+// Build a [size] x [size] grid of quads as obj text.
+QByteArray buildObjGrid(int size)
+  {
+  QByteArray obj;
+  obj.reserve(size * size * 96);
+
+  for(int y = 0; y <= size; ++y)
+    {
+    for(int x = 0; x <= size; ++x)
+      {
+      obj += "v " + QByteArray::number(x * 0.5) + " " + QByteArray::number(y * -0.25) + " " + QByteArray::number((x * y) % 7 * 0.125) + "\n";
+      obj += "vt " + QByteArray::number((float)x / size) + " " + QByteArray::number((float)y / size) + "\n";
+      }
+    }
+  obj += "vn 0 0 1\r\n";
+
+  for(int y = 0; y < size; ++y)
+    {
+    for(int x = 0; x < size; ++x)
+      {
+      int a = y * (size + 1) + x + 1;
+      int b = a + 1;
+      int c = a + size + 2;
+      int d = a + size + 1;
+      obj += "f " + QByteArray::number(a) + "/" + QByteArray::number(a) + "/1 " +
+          QByteArray::number(b) + "/" + QByteArray::number(b) + "/1 " +
+          QByteArray::number(c) + "/" + QByteArray::number(c) + "/1 " +
+          QByteArray::number(d) + "/" + QByteArray::number(d) + "/1\n";
+      }
+    }
+
+  return obj;
+  }
+
+// Build the same grid as buildObjGrid as a COLLADA polylist.
+QByteArray buildColladaGrid(int size)
+  {
+  QByteArray positions;
+  QByteArray texcoords;
+  for(int y = 0; y <= size; ++y)
+    {
+    for(int x = 0; x <= size; ++x)
+      {
+      positions += QByteArray::number(x * 0.5) + " " + QByteArray::number(y * -0.25) + " " + QByteArray::number((x * y) % 7 * 0.125) + "\n";
+      texcoords += QByteArray::number((float)x / size) + " " + QByteArray::number((float)y / size) + "\n";
+      }
+    }
+
+  QByteArray vcount;
+  QByteArray p;
+  for(int y = 0; y < size; ++y)
+    {
+    for(int x = 0; x < size; ++x)
+      {
+      int a = y * (size + 1) + x;
+      int corners[] = { a, a + 1, a + size + 2, a + size + 1 };
+      for(int c = 0; c < 4; ++c)
+        {
+        p += QByteArray::number(corners[c]) + " " + QByteArray::number(corners[c]) + " 0 ";
+        }
+      vcount += "4 ";
+      }
+    }
+
+  const QByteArray vertexCount = QByteArray::number((size + 1) * (size + 1));
+  return "<?xml version=\"1.0\"?>\n"
+    "<COLLADA><library_geometries><geometry id=\"grid\"><mesh>\n"
+    "<source id=\"pos\"><float_array>" + positions + "</float_array>"
+    "<technique_common><accessor source=\"#pos-array\" count=\"" + vertexCount + "\" stride=\"3\"/></technique_common></source>\n"
+    "<source id=\"uv\"><float_array>" + texcoords + "</float_array>"
+    "<technique_common><accessor count=\"" + vertexCount + "\" stride=\"2\"/></technique_common></source>\n"
+    "<source id=\"n\"><float_array count=\"3\">0 0 1</float_array>"
+    "<technique_common><accessor count=\"1\" stride=\"3\"/></technique_common></source>\n"
+    "<vertices id=\"verts\"><input semantic=\"POSITION\" source=\"#pos\"/></vertices>\n"
+    "<polylist count=\"" + QByteArray::number(size * size) + "\">"
+    "<input semantic=\"VERTEX\" source=\"#verts\" offset=\"0\"/>"
+    "<input semantic=\"TEXCOORD\" source=\"#uv\" offset=\"1\" set=\"0\"/>"
+    "<input semantic=\"NORMAL\" source=\"#n\" offset=\"2\"/>"
+    "<vcount>" + vcount + "</vcount><p>" + p + "</p></polylist>\n"
+    "</mesh></geometry></library_geometries></COLLADA>\n";
+  }
+
+// Build a unit sphere of [lats] x [longs] quads, facing outwards.
+void buildSphere(int lats, int longs, Eks::Vector<float> *positions, Eks::Vector<xuint32> *indices)
+  {
+  for(int la = 0; la <= lats; ++la)
+    {
+    for(int lo = 0; lo <= longs; ++lo)
+      {
+      const float theta = X_PI * la / lats;
+      const float phi = 2.0f * X_PI * lo / longs;
+      *positions << sin(theta) * cos(phi) << sin(theta) * sin(phi) << cos(theta);
+      }
+    }
+
+  for(int la = 0; la < lats; ++la)
+    {
+    for(int lo = 0; lo < longs; ++lo)
+      {
+      const xuint32 a = la * (longs + 1) + lo;
+      const xuint32 b = a + 1;
+      const xuint32 c = a + longs + 2;
+      const xuint32 d = a + longs + 1;
+      *indices << a << d << c << a << c << b;
+      }
+    }
+  }
+
+}
+
+void Eks3DTest::objLoaderTest()
+  {
+  QByteArray obj = buildObjGrid(8);
+
+  Eks::ObjLoader loader(Eks::Core::defaultAllocator());
+
+  Eks::Vector<Eks::VectorI3D> trisA(Eks::Core::defaultAllocator());
+  Eks::Vector<Eks::VectorI3D> trisB(Eks::Core::defaultAllocator());
+  Eks::ObjLoader::ElementData elementsA[objSemanticCount];
+  Eks::ObjLoader::ElementData elementsB[objSemanticCount];
+  xsize vertSizeA = 0;
+  xsize vertSizeB = 0;
+
+  QVERIFY(loader.loadLineCached(obj.constData(), obj.size(), objSemantics, objSemanticCount, &trisA, &vertSizeA, elementsA));
+  QVERIFY(loader.load(obj.constData(), obj.size(), objSemantics, objSemanticCount, &trisB, &vertSizeB, elementsB));
+
+  QCOMPARE(vertSizeA, vertSizeB);
+  QCOMPARE(trisA.size(), (xsize)(8 * 8 * 6));
+  QCOMPARE(trisA.size(), trisB.size());
+  for(xsize i = 0; i < trisA.size(); ++i)
+    {
+    QVERIFY(trisA[i] == trisB[i]);
+    }
+
+  for(xsize e = 0; e < objSemanticCount; ++e)
+    {
+    QCOMPARE(elementsA[e].data.size(), elementsB[e].data.size());
+    for(xsize i = 0; i < elementsA[e].data.size(); ++i)
+      {
+      QVERIFY(elementsA[e].data[i] == elementsB[e].data[i]);
+      }
+    }
+  }
+
+void Eks3DTest::objLoaderParallelTest()
+  {
+  QByteArray obj = buildObjGrid(256);
+  obj += "v 1 2 3\nvt 0.5 0.5\nf -1/-1/1 1/1/1 2/2/-1\n";
+
+  Eks::ObjLoader loader(Eks::Core::defaultAllocator());
+  // Force several chunks, whatever the thread count, so the stitching is exercised.
+  loader.setParallelChunking(4096, 8);
+
+  Eks::Vector<Eks::VectorI3D> trisA(Eks::Core::defaultAllocator());
+  Eks::Vector<Eks::VectorI3D> trisB(Eks::Core::defaultAllocator());
+  Eks::ObjLoader::ElementData elementsA[objSemanticCount];
+  Eks::ObjLoader::ElementData elementsB[objSemanticCount];
+  xsize vertSizeA = 0;
+  xsize vertSizeB = 0;
+
+  QVERIFY(loader.load(obj.constData(), obj.size(), objSemantics, objSemanticCount, &trisA, &vertSizeA, elementsA));
+  QVERIFY(loader.loadParallel(obj.constData(), obj.size(), objSemantics, objSemanticCount, &trisB, &vertSizeB, elementsB));
+
+  const xsize lastPosition = elementsA[0].data.size() - 1;
+  QCOMPARE((xsize)trisA[trisA.size() - 3].x(), lastPosition);
+
+  QCOMPARE(trisA.size(), trisB.size());
+  for(xsize i = 0; i < trisA.size(); ++i)
+    {
+    QVERIFY(trisA[i] == trisB[i]);
+    }
+
+  for(xsize e = 0; e < objSemanticCount; ++e)
+    {
+    QCOMPARE(elementsA[e].data.size(), elementsB[e].data.size());
+    for(xsize i = 0; i < elementsA[e].data.size(); ++i)
+      {
+      QVERIFY(elementsA[e].data[i] == elementsB[e].data[i]);
+      }
+    }
+  }
+
+void Eks3DTest::objLoaderIndexedBakeTest()
+  {
+  QByteArray obj = buildObjGrid(8);
+
+  Eks::ObjLoader loader(Eks::Core::defaultAllocator());
+
+  Eks::Vector<Eks::VectorI3D> tris(Eks::Core::defaultAllocator());
+  Eks::ObjLoader::ElementData elements[objSemanticCount];
+  xsize vertSize = 0;
+  QVERIFY(loader.load(obj.constData(), obj.size(), objSemantics, objSemanticCount, &tris, &vertSize, elements));
+
+  Eks::Vector<xuint8> flat(Eks::Core::defaultAllocator());
+  QVERIFY(loader.bake(tris, elements, objSemanticCount, &flat));
+
+  Eks::Vector<xuint8> welded(Eks::Core::defaultAllocator());
+  Eks::Vector<xuint16> indices(Eks::Core::defaultAllocator());
+  QVERIFY(loader.bakeIndexed(tris, elements, objSemanticCount, &welded, &indices));
+
+  QCOMPARE(indices.size(), tris.size());
+  QCOMPARE(welded.size(), (xsize)(9 * 9) * vertSize);
+
+  for(xsize i = 0; i < indices.size(); ++i)
+    {
+    QVERIFY(memcmp(flat.data() + i * vertSize, welded.data() + indices[i] * vertSize, vertSize) == 0);
+    }
+  }
+
+void Eks3DTest::objLoaderWideIndexTest()
+  {
+  QCOMPARE(Eks::IndexGeometry::typeFor(65536), Eks::IndexGeometry::Unsigned16);
+  QCOMPARE(Eks::IndexGeometry::typeFor(65537), Eks::IndexGeometry::Unsigned32);
+  QCOMPARE(Eks::IndexGeometry::typeSize(Eks::IndexGeometry::Unsigned32), sizeof(xuint32));
+
+  // 301 x 301 unique vertices, too many for 16 bit indices.
+  QByteArray obj = buildObjGrid(300);
+
+  Eks::ObjLoader loader(Eks::Core::defaultAllocator());
+
+  Eks::Vector<Eks::VectorI3D> tris(Eks::Core::defaultAllocator());
+  Eks::ObjLoader::ElementData elements[objSemanticCount];
+  xsize vertSize = 0;
+  QVERIFY(loader.load(obj.constData(), obj.size(), objSemantics, objSemanticCount, &tris, &vertSize, elements));
+
+  Eks::Vector<xuint8> narrowWelded(Eks::Core::defaultAllocator());
+  Eks::Vector<xuint16> narrowIndices(Eks::Core::defaultAllocator());
+  QVERIFY_EXCEPTION_THROWN(loader.bakeIndexed(tris, elements, objSemanticCount, &narrowWelded, &narrowIndices), Eks::ParseException);
+
+  Eks::Vector<xuint8> flat(Eks::Core::defaultAllocator());
+  QVERIFY(loader.bake(tris, elements, objSemanticCount, &flat));
+
+  Eks::Vector<xuint8> welded(Eks::Core::defaultAllocator());
+  Eks::Vector<xuint32> indices(Eks::Core::defaultAllocator());
+  QVERIFY(loader.bakeIndexed(tris, elements, objSemanticCount, &welded, &indices));
+
+  const xsize vertexCount = welded.size() / vertSize;
+  QCOMPARE(vertexCount, (xsize)(301 * 301));
+  QCOMPARE(Eks::IndexGeometry::typeFor(vertexCount), Eks::IndexGeometry::Unsigned32);
+
+  for(xsize i = 0; i < indices.size(); ++i)
+    {
+    QVERIFY(memcmp(flat.data() + i * vertSize, welded.data() + indices[i] * vertSize, vertSize) == 0);
+    }
+  }
+
+namespace
+{
+
+class TestBatchReceiver : public Eks::ObjLoader::BatchReceiver
+  {
+public:
+  TestBatchReceiver() : data(Eks::Core::defaultAllocator()), batches(0), largestBatch(0) { }
+
+  void receive(const xuint8 *vertexData, xsize vertexCount, xsize vertexSize)
+    {
+    data.resizeAndCopy(data.size() + vertexCount * vertexSize, vertexData);
+    largestBatch = std::max(largestBatch, vertexCount);
+    ++batches;
+    }
+
+  Eks::Vector<xuint8> data;
+  xsize batches;
+  xsize largestBatch;
+  };
+
+}
+
+void Eks3DTest::objLoaderStreamingTest()
+  {
+  QByteArray obj = buildObjGrid(8);
+
+  Eks::ObjLoader loader(Eks::Core::defaultAllocator());
+
+  Eks::Vector<Eks::VectorI3D> tris(Eks::Core::defaultAllocator());
+  Eks::ObjLoader::ElementData elements[objSemanticCount];
+  xsize vertSize = 0;
+  QVERIFY(loader.load(obj.constData(), obj.size(), objSemantics, objSemanticCount, &tris, &vertSize, elements));
+
+  Eks::Vector<xuint8> flat(Eks::Core::defaultAllocator());
+  QVERIFY(loader.bake(tris, elements, objSemanticCount, &flat));
+
+  TestBatchReceiver receiver;
+  xsize streamedVertSize = 0;
+  QVERIFY(loader.loadStreaming(obj.constData(), obj.size(), objSemantics, objSemanticCount, &streamedVertSize, &receiver, 7));
+
+  QCOMPARE(streamedVertSize, vertSize);
+  QCOMPARE(receiver.batches, (xsize)((8 * 8 * 2 + 7) / 8));
+  QVERIFY(receiver.largestBatch <= 8 * 3);
+  QCOMPARE(receiver.data.size(), flat.size());
+  QVERIFY(memcmp(receiver.data.data(), flat.data(), flat.size()) == 0);
+
+  // Normals listed after the first batch's faces are generated for every batch, not only
+  // for the batches before them.
+  const char lateNormals[] =
+    "v 0 0 0\nv 1 0 0\nv 0 1 0\n"
+    "f 1//1 2//1 3//1\n"
+    "vn 0 0 -1\n"
+    "f 1//1 2//1 3//1\n";
+  TestBatchReceiver late;
+  QVERIFY(loader.loadStreaming(lateNormals, sizeof(lateNormals) - 1, objSemantics, objSemanticCount, &streamedVertSize, &late, 1));
+  QCOMPARE(late.batches, (xsize)2);
+  QCOMPARE(late.data.size(), 6 * streamedVertSize);
+
+  // Position, texture coordinate then normal, as floats.
+  const float *lateVertices = (const float *)late.data.data();
+  for(xsize i = 0; i < 6; ++i)
+    {
+    const float *normal = lateVertices + i * 8 + 5;
+    QVERIFY(Eks::Vector3D(normal[0], normal[1], normal[2]) == Eks::Vector3D(0, 0, 1));
+    }
+  }
+
+void Eks3DTest::objLoaderSubmeshTest()
+  {
+  const char obj[] =
+    "v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 2\n"
+    "f 1 2 3\n"
+    "o first \n"
+    "usemtl red\n"
+    "f 1 2 3 4\n"
+    "g second\n"
+    "g empty\n"
+    "usemtl blue\n"
+    "f 2 3 4\n";
+
+  const Eks::ShaderVertexLayoutDescription::Semantic semantic = Eks::ShaderVertexLayoutDescription::Position;
+  Eks::ObjLoader loader(Eks::Core::defaultAllocator());
+
+  Eks::Vector<Eks::VectorI3D> tris(Eks::Core::defaultAllocator());
+  Eks::ObjLoader::ElementData elements[1];
+  Eks::Vector<Eks::ObjLoader::Submesh> submeshes(Eks::Core::defaultAllocator());
+  xsize vertSize = 0;
+  QVERIFY(loader.load(obj, sizeof(obj) - 1, &semantic, 1, &tris, &vertSize, elements, &submeshes));
+
+  QCOMPARE(submeshes.size(), (xsize)3);
+  QCOMPARE(submeshes[0].firstIndex, (xsize)0);
+  QCOMPARE(submeshes[0].indexCount, (xsize)3);
+  QVERIFY(submeshes[0].name == Eks::String(""));
+
+  QVERIFY(submeshes[1].name == Eks::String("first"));
+  QVERIFY(submeshes[1].material == Eks::String("red"));
+  QCOMPARE(submeshes[1].firstIndex, (xsize)3);
+  QCOMPARE(submeshes[1].indexCount, (xsize)6);
+  QVERIFY(submeshes[1].bounds == Eks::BoundingBox(Eks::Vector3D(0, 0, 0), Eks::Vector3D(1, 1, 2)));
+
+  QVERIFY(submeshes[2].name == Eks::String("empty"));
+  QVERIFY(submeshes[2].material == Eks::String("blue"));
+  QCOMPARE(submeshes[2].firstIndex, (xsize)9);
+  QCOMPARE(submeshes[2].indexCount, (xsize)3);
+
+  QByteArray large = "o grid\n" + buildObjGrid(256) + "usemtl second\nf 1/1/1 2/2/1 3/3/1\n";
+
+  Eks::Vector<Eks::VectorI3D> trisA(Eks::Core::defaultAllocator());
+  Eks::Vector<Eks::VectorI3D> trisB(Eks::Core::defaultAllocator());
+  Eks::ObjLoader::ElementData elementsA[objSemanticCount];
+  Eks::ObjLoader::ElementData elementsB[objSemanticCount];
+  Eks::Vector<Eks::ObjLoader::Submesh> submeshesA(Eks::Core::defaultAllocator());
+  Eks::Vector<Eks::ObjLoader::Submesh> submeshesB(Eks::Core::defaultAllocator());
+  QVERIFY(loader.load(large.constData(), large.size(), objSemantics, objSemanticCount, &trisA, &vertSize, elementsA, &submeshesA));
+  // Many chunks whatever the core count, so later ones start mid submesh.
+  loader.setParallelChunking(4096, 8);
+  QVERIFY(loader.loadParallel(large.constData(), large.size(), objSemantics, objSemanticCount, &trisB, &vertSize, elementsB, &submeshesB));
+
+  QCOMPARE(submeshesA.size(), (xsize)2);
+  QCOMPARE(submeshesA.size(), submeshesB.size());
+  for(xsize i = 0; i < submeshesA.size(); ++i)
+    {
+    QVERIFY(submeshesA[i].name == submeshesB[i].name);
+    QVERIFY(submeshesA[i].material == submeshesB[i].material);
+    QCOMPARE(submeshesA[i].firstIndex, submeshesB[i].firstIndex);
+    QCOMPARE(submeshesA[i].indexCount, submeshesB[i].indexCount);
+    QVERIFY(submeshesA[i].bounds == submeshesB[i].bounds);
+    }
+  QCOMPARE(submeshesA[1].indexCount, (xsize)3);
+  QVERIFY(submeshesB[1].name == Eks::String("grid"));
+  QVERIFY(submeshesB[1].material == Eks::String("second"));
+  }
+
+void Eks3DTest::cookedMeshTest()
+  {
+  QByteArray obj = buildObjGrid(8);
+
+  Eks::ObjLoader loader(Eks::Core::defaultAllocator());
+
+  Eks::Vector<Eks::VectorI3D> tris(Eks::Core::defaultAllocator());
+  Eks::ObjLoader::ElementData elements[objSemanticCount];
+  xsize vertSize = 0;
+  QVERIFY(loader.load(obj.constData(), obj.size(), objSemantics, objSemanticCount, &tris, &vertSize, elements));
+
+  Eks::Vector<xuint8> vertices(Eks::Core::defaultAllocator());
+  Eks::Vector<xuint16> indices(Eks::Core::defaultAllocator());
+  QVERIFY(loader.bakeIndexed(tris, elements, objSemanticCount, &vertices, &indices));
+
+  const Eks::ShaderVertexLayoutDescription layout[] =
+  {
+    Eks::ShaderVertexLayoutDescription(Eks::ShaderVertexLayoutDescription::Position, Eks::ShaderVertexLayoutDescription::FormatFloat3),
+    Eks::ShaderVertexLayoutDescription(Eks::ShaderVertexLayoutDescription::TextureCoordinate, Eks::ShaderVertexLayoutDescription::FormatFloat2),
+    Eks::ShaderVertexLayoutDescription(Eks::ShaderVertexLayoutDescription::Normal, Eks::ShaderVertexLayoutDescription::FormatFloat3)
+  };
+
+  Eks::CookedMesh::Source source;
+  source.layout = layout;
+  source.layoutCount = X_ARRAY_COUNT(layout);
+  source.vertexData = vertices.data();
+  source.vertexSize = vertSize;
+  source.vertexCount = vertices.size() / vertSize;
+  source.indexData = indices.data();
+  source.indexCount = indices.size();
+  source.bounds = Eks::BoundingBox(Eks::Vector3D(0, -2, 0), Eks::Vector3D(4, 0, 0.75f));
+
+  const QByteArray path = QDir::temp().filePath("Eks3DTestCookedMesh.mesh").toUtf8();
+  QVERIFY(Eks::CookedMesh::write(path.constData(), source));
+
+  Eks::CookedMesh mesh;
+  QVERIFY(mesh.open(path.constData()));
+  QCOMPARE((xsize)mesh.header().vertexCount, source.vertexCount);
+  QCOMPARE((xsize)mesh.header().indexCount, indices.size());
+  QCOMPARE((xsize)mesh.header().submeshCount, (xsize)1);
+  QCOMPARE((xsize)mesh.submeshes()[0].indexCount, indices.size());
+  QVERIFY(mesh.bounds() == source.bounds);
+  QCOMPARE(((xsize)mesh.vertexData() % Eks::CookedMesh::DataAlignment), (xsize)0);
+
+  Eks::ShaderVertexLayoutDescription descs[X_ARRAY_COUNT(layout)];
+  QCOMPARE(mesh.layoutDescriptions(descs, X_ARRAY_COUNT(descs)), X_ARRAY_COUNT(layout));
+  QCOMPARE(descs[2].offset, (xsize)20);
+
+  QVERIFY(memcmp(mesh.vertexData(), vertices.data(), vertices.size()) == 0);
+  QVERIFY(memcmp(mesh.indexData(), indices.data(), indices.size() * sizeof(xuint16)) == 0);
+
+  const xuint64 vertexOffset = mesh.header().vertexOffset;
+  mesh.close();
+
+  // Misaligned sections, and offsets that wrap when their size is added, are rejected.
+  QFile cooked(QString::fromUtf8(path));
+  QVERIFY(cooked.open(QFile::ReadOnly));
+  const QByteArray original = cooked.readAll();
+  cooked.close();
+
+  const xuint64 badVertexOffsets[] =
+    {
+    vertexOffset + 4,
+    ~(xuint64)0 - 15
+    };
+  xForeach(xuint64 offset, badVertexOffsets)
+    {
+    QByteArray corrupt = original;
+    ((Eks::CookedMesh::Header *)corrupt.data())->vertexOffset = offset;
+    QVERIFY(cooked.open(QFile::WriteOnly | QFile::Truncate));
+    QCOMPARE(cooked.write(corrupt), (qint64)corrupt.size());
+    cooked.close();
+
+    QVERIFY(!mesh.open(path.constData()));
+    }
+
+  // As are files written with the other byte order.
+  QByteArray swapped = original;
+  ((Eks::CookedMesh::Header *)swapped.data())->byteOrder = 0x04030201;
+  QVERIFY(cooked.open(QFile::WriteOnly | QFile::Truncate));
+  QCOMPARE(cooked.write(swapped), (qint64)swapped.size());
+  cooked.close();
+  QVERIFY(!mesh.open(path.constData()));
+
+  QFile::remove(QString::fromUtf8(path));
+  }
+
+void Eks3DTest::normalGeneratorTest()
+  {
+  Eks::Vector3D positions[8];
+  for(xsize i = 0; i < 8; ++i)
+    {
+    positions[i] = Eks::Vector3D(i & 1 ? 1 : -1, i & 2 ? 1 : -1, i & 4 ? 1 : -1);
+    }
+
+  // Two outward facing triangles for each side of the cube.
+  const xuint32 indices[] =
+  {
+    0, 2, 3,  0, 3, 1, // -z
+    4, 5, 7,  4, 7, 6, // +z
+    0, 1, 5,  0, 5, 4, // -y
+    2, 6, 7,  2, 7, 3, // +y
+    0, 4, 6,  0, 6, 2, // -x
+    1, 3, 7,  1, 7, 5  // +x
+  };
+  const xsize indexCount = X_ARRAY_COUNT(indices);
+
+  Eks::NormalGenerator generator(Eks::Core::defaultAllocator());
+  Eks::Vector<Eks::Vector3D> normals(Eks::Core::defaultAllocator());
+  Eks::Vector<xuint32> normalIndices(Eks::Core::defaultAllocator());
+
+  generator.generate(positions, 8, indices, indexCount, X_PI / 3.0f, &normals, &normalIndices);
+  QCOMPARE(normals.size(), (xsize)24);
+  QCOMPARE(normalIndices.size(), indexCount);
+  for(xsize i = 0; i < indexCount; i += 3)
+    {
+    const Eks::Vector3D &a = positions[indices[i]];
+    const Eks::Vector3D face = (positions[indices[i+1]] - a).cross(positions[indices[i+2]] - a).normalized();
+    for(xsize c = 0; c < 3; ++c)
+      {
+      QVERIFY((normals[normalIndices[i + c]] - face).norm() < 0.0001f);
+      }
+    }
+
+  generator.generate(positions, 8, indices, indexCount, X_PI, &normals, &normalIndices);
+  QCOMPARE(normals.size(), (xsize)8);
+  for(xsize i = 0; i < indexCount; ++i)
+    {
+    // Area weighting favours sides where the corner touches both triangles.
+    const Eks::Vector3D &normal = normals[normalIndices[i]];
+    QVERIFY(std::abs(normal.norm() - 1.0f) < 0.0001f);
+    QVERIFY(normal.dot(positions[indices[i]].normalized()) > 0.9f);
+    }
+
+  // Vectors normalise identically in the SIMD lanes and the scalar tail.
+  Eks::Vector3D batch[7];
+  for(xsize i = 0; i < X_ARRAY_COUNT(batch); ++i)
+    {
+    const Eks::Real f = Eks::Real(i + 4);
+    batch[i] = Eks::Vector3D(0.1f + f, 3.0f - 0.7f * f, 1.0f / (f + 3.0f));
+    }
+  Eks::Vector3D single[X_ARRAY_COUNT(batch)];
+  std::copy(batch, batch + X_ARRAY_COUNT(batch), single);
+  Eks::NormalGenerator::normalise(batch, X_ARRAY_COUNT(batch));
+  for(xsize i = 0; i < X_ARRAY_COUNT(batch); ++i)
+    {
+    Eks::NormalGenerator::normalise(single + i, 1);
+    QVERIFY(batch[i] == single[i]);
+    }
+
+  Eks::Vector3D duplicated[] = { positions[0], positions[1], positions[0], positions[7], positions[1] };
+  Eks::Vector<xuint32> remap(Eks::Core::defaultAllocator());
+  Eks::NormalGenerator::weldPositions(duplicated, X_ARRAY_COUNT(duplicated), &remap);
+  QCOMPARE(remap[0], 0u);
+  QCOMPARE(remap[1], 1u);
+  QCOMPARE(remap[2], 0u);
+  QCOMPARE(remap[3], 3u);
+  QCOMPARE(remap[4], 1u);
+  }
+
+void Eks3DTest::tangentGeneratorTest()
+  {
+  // A quad in the xz plane, u along +x, and a copy with u mirrored.
+  const Eks::Vector3D positions[] =
+  {
+    Eks::Vector3D(-1, 0, -1), Eks::Vector3D(1, 0, -1), Eks::Vector3D(1, 0, 1), Eks::Vector3D(-1, 0, 1),
+    Eks::Vector3D(-1, 0, -1), Eks::Vector3D(1, 0, -1), Eks::Vector3D(1, 0, 1), Eks::Vector3D(-1, 0, 1)
+  };
+  const Eks::Vector3D normals[] =
+  {
+    Eks::Vector3D(0, 1, 0), Eks::Vector3D(0, 1, 0), Eks::Vector3D(0, 1, 0), Eks::Vector3D(0, 1, 0),
+    Eks::Vector3D(0, 1, 0), Eks::Vector3D(0, 1, 0), Eks::Vector3D(0, 1, 0), Eks::Vector3D(0, 1, 0)
+  };
+  const Eks::Vector2D texCoords[] =
+  {
+    Eks::Vector2D(0, 0), Eks::Vector2D(1, 0), Eks::Vector2D(1, 1), Eks::Vector2D(0, 1),
+    Eks::Vector2D(1, 0), Eks::Vector2D(0, 0), Eks::Vector2D(0, 1), Eks::Vector2D(1, 1)
+  };
+  const xuint32 indices[] = { 0, 2, 1, 0, 3, 2, 4, 6, 5, 4, 7, 6 };
+
+  Eks::TangentGenerator generator(Eks::Core::defaultAllocator());
+  Eks::Vector<Eks::Vector4D> tangents(Eks::Core::defaultAllocator());
+  generator.generate(positions, normals, texCoords, 8, indices, X_ARRAY_COUNT(indices), &tangents);
+
+  // v runs along +z in both, so the bitangent's sign flips with the mirrored tangent.
+  QCOMPARE(tangents.size(), (xsize)8);
+  for(xsize i = 0; i < 4; ++i)
+    {
+    QVERIFY((tangents[i] - Eks::Vector4D(1, 0, 0, -1)).norm() < 0.0001f);
+    QVERIFY((tangents[i + 4] - Eks::Vector4D(-1, 0, 0, 1)).norm() < 0.0001f);
+
+    const Eks::Vector3D tangent = tangents[i].head<3>();
+    const Eks::Vector3D bitangent = normals[i].cross(tangent) * tangents[i].w();
+    QVERIFY((bitangent - Eks::Vector3D(0, 0, 1)).norm() < 0.0001f);
+    }
+
+  const Eks::ShaderVertexLayoutDescription::Semantic semantics[] =
+  {
+    Eks::ShaderVertexLayoutDescription::Position,
+    Eks::ShaderVertexLayoutDescription::TextureCoordinate,
+    Eks::ShaderVertexLayoutDescription::Normal,
+    Eks::ShaderVertexLayoutDescription::BiNormal
+  };
+  const xsize semanticCount = X_ARRAY_COUNT(semantics);
+
+  QByteArray obj = buildObjGrid(8);
+  Eks::ObjLoader loader(Eks::Core::defaultAllocator());
+  Eks::Vector<Eks::VectorI3D> tris(Eks::Core::defaultAllocator());
+  Eks::ObjLoader::ElementData elements[semanticCount];
+  xsize vertSize = 0;
+  QVERIFY(loader.load(obj.constData(), obj.size(), semantics, semanticCount, &tris, &vertSize, elements));
+  QCOMPARE(vertSize, sizeof(float) * 12);
+
+  loader.computeUnusedElements(elements, semanticCount, &tris);
+  QCOMPARE(elements[3].data.size(), tris.size());
+  QCOMPARE(elements[3].signs.size(), tris.size());
+  for(xsize i = 0; i < tris.size(); ++i)
+    {
+    const Eks::ObjLoader::ElementVector &tangent = elements[3].data[i];
+    QVERIFY(std::abs(tangent.norm() - 1.0f) < 0.0001f);
+    QCOMPARE(elements[3].signs[i], 1.0f);
+    QVERIFY(std::abs(tangent.z()) < 0.0001f);
+    QVERIFY(tangent.x() > 0.5f);
+    }
+
+  Eks::Vector<xuint8> welded(Eks::Core::defaultAllocator());
+  Eks::Vector<xuint16> weldedIndices(Eks::Core::defaultAllocator());
+  QVERIFY(loader.bakeIndexed(tris, elements, semanticCount, &welded, &weldedIndices));
+  QCOMPARE(welded.size(), (xsize)(9 * 9) * vertSize);
+  }
+
+namespace
+{
+
+class CancellingMonitor : public Eks::ObjLoader::Monitor
+  {
+public:
+  CancellingMonitor() : total(0), parsed(0) { }
+
+  void begin(xsize totalBytes) { total = totalBytes; }
+  bool advance(xsize bytes)
+    {
+    parsed += bytes;
+    return parsed < total / 2;
+    }
+
+  xsize total;
+  xsize parsed;
+  };
+
+// Cancels [loader] from its first progress report, or throws from it.
+class AsyncCancellingMonitor : public Eks::ObjLoader::Monitor
+  {
+public:
+  AsyncCancellingMonitor(Eks::AsyncMeshLoader *l, bool t) : loader(l), throws(t), total(0), parsed(0) { }
+
+  void begin(xsize totalBytes) { total = totalBytes; }
+  bool advance(xsize bytes)
+    {
+    if(throws)
+      {
+      throw std::runtime_error("advance");
+      }
+    parsed += bytes;
+    loader->cancel();
+    return true;
+    }
+
+  Eks::AsyncMeshLoader *loader;
+  bool throws;
+  std::atomic<xsize> total;
+  std::atomic<xsize> parsed;
+  };
+
+}
+
+void Eks3DTest::asyncMeshLoaderTest()
+  {
+  QByteArray obj = buildObjGrid(128);
+
+  CancellingMonitor monitor;
+  Eks::ObjLoader loader(Eks::Core::defaultAllocator());
+  loader.setMonitor(&monitor);
+
+  Eks::Vector<Eks::VectorI3D> tris(Eks::Core::defaultAllocator());
+  Eks::ObjLoader::ElementData elements[objSemanticCount];
+  xsize vertSize = 0;
+  QVERIFY(!loader.load(obj.constData(), obj.size(), objSemantics, objSemanticCount, &tris, &vertSize, elements));
+  QCOMPARE(monitor.total, (xsize)obj.size());
+  QVERIFY(monitor.parsed < monitor.total);
+
+  loader.setMonitor(0);
+  tris.clear();
+  QVERIFY(loader.load(obj.constData(), obj.size(), objSemantics, objSemanticCount, &tris, &vertSize, elements));
+
+  Eks::Vector<xuint8> vertices(Eks::Core::defaultAllocator());
+  Eks::Vector<xuint32> indices(Eks::Core::defaultAllocator());
+  QVERIFY(loader.bakeIndexed(tris, elements, objSemanticCount, &vertices, &indices));
+
+  const QString path = QDir::temp().filePath("Eks3DTestAsync.obj");
+  QFile file(path);
+  QVERIFY(file.open(QFile::WriteOnly));
+  file.write(obj);
+  file.close();
+
+  Eks::AsyncMeshLoader async(Eks::Core::defaultAllocator());
+  QVERIFY(async.start(path.toUtf8().constData(), objSemantics, objSemanticCount));
+  QVERIFY(async.future().get());
+  QCOMPARE(async.state(), Eks::AsyncMeshLoader::Succeeded);
+  QCOMPARE(async.progress(), 1.0f);
+
+  const Eks::AsyncMeshLoader::Result &result = async.result();
+  QCOMPARE(result.vertexSize, vertSize);
+  QCOMPARE(result.vertices.size(), vertices.size());
+  QCOMPARE(result.indices.size(), indices.size());
+  QVERIFY(memcmp(result.vertices.data(), vertices.data(), vertices.size()) == 0);
+  QVERIFY(memcmp(result.indices.data(), indices.data(), indices.size() * sizeof(xuint32)) == 0);
+  QCOMPARE(result.submeshes.size(), (xsize)1);
+
+  // Cancelled from the first progress report, parsing stops before the end of the file.
+  AsyncCancellingMonitor cancelling(&async, false);
+  async.setMonitor(&cancelling);
+  QVERIFY(async.start(path.toUtf8().constData(), objSemantics, objSemanticCount));
+  QVERIFY(!async.future().get());
+  QCOMPARE(async.state(), Eks::AsyncMeshLoader::Cancelled);
+  QCOMPARE((xsize)cancelling.total, (xsize)obj.size());
+  QVERIFY(cancelling.parsed > 0);
+  QVERIFY(cancelling.parsed < cancelling.total);
+
+  // Any exception fails the load, and a new one can start.
+  AsyncCancellingMonitor throwing(&async, true);
+  async.setMonitor(&throwing);
+  QVERIFY(async.start(path.toUtf8().constData(), objSemantics, objSemanticCount));
+  QVERIFY(!async.future().get());
+  QCOMPARE(async.state(), Eks::AsyncMeshLoader::Failed);
+  QVERIFY(async.error().size() > 0);
+
+  async.setMonitor(0);
+  QVERIFY(async.start(path.toUtf8().constData(), objSemantics, objSemanticCount));
+  QVERIFY(async.future().get());
+
+  // Parse errors keep the parser's message.
+  QVERIFY(file.open(QFile::WriteOnly | QFile::Truncate));
+  file.write("v 0 0 x\n");
+  file.close();
+  QVERIFY(async.start(path.toUtf8().constData(), objSemantics, objSemanticCount));
+  QVERIFY(!async.future().get());
+  QCOMPARE(async.state(), Eks::AsyncMeshLoader::Failed);
+  QVERIFY(QByteArray(async.error().data(), (int)async.error().size()).contains("number"));
+
+  QFile::remove(path);
+  }
+
+void Eks3DTest::vertexEncoderTest()
+  {
+  for(xuint32 h = 0; h < 0x7c00; ++h)
+    {
+    QCOMPARE(Eks::VertexEncoder::toHalf(Eks::VertexEncoder::fromHalf((xuint16)h)), (xuint16)h);
+    }
+  QCOMPARE(Eks::VertexEncoder::toHalf(65520.0f), (xuint16)0x7c00);
+  QCOMPARE(Eks::VertexEncoder::toHalf(-1.0f), (xuint16)0xbc00);
+
+  for(int i = 0; i < 256; ++i)
+    {
+    const Eks::Vector3D normal = Eks::Vector3D(sin(i * 0.7), cos(i * 1.3), sin(i * 0.37) - 0.2).normalized();
+
+    xuint8 encoded[4];
+    Eks::VertexEncoder::encode(Eks::ShaderVertexLayoutDescription::FormatOctahedralNormal, normal.data(), 3, encoded);
+
+    Eks::Real decoded[3];
+    Eks::VertexEncoder::decode(Eks::ShaderVertexLayoutDescription::FormatOctahedralNormal, encoded, decoded);
+    QVERIFY((Eks::Vector3D(decoded[0], decoded[1], decoded[2]) - normal).norm() < 1e-3f);
+    }
+
+  const Eks::Real values[] = { 0.5f, 0.0f, 0.25f, 1.0f };
+  xuint8 packed[4];
+  Eks::VertexEncoder::encode(Eks::ShaderVertexLayoutDescription::FormatNormalisedUnsigned10_10_10_2, values, 4, packed);
+  Eks::Real unpacked[4];
+  Eks::VertexEncoder::decode(Eks::ShaderVertexLayoutDescription::FormatNormalisedUnsigned10_10_10_2, packed, unpacked);
+  for(xsize i = 0; i < 4; ++i)
+    {
+    QVERIFY(std::abs(unpacked[i] - values[i]) < 0.01f);
+    }
+
+  // Baking compact formats from the loader matches the float bake, within precision.
+  QByteArray obj = buildObjGrid(8);
+  Eks::ObjLoader loader(Eks::Core::defaultAllocator());
+
+  Eks::Vector<Eks::VectorI3D> tris(Eks::Core::defaultAllocator());
+  Eks::ObjLoader::ElementData elements[objSemanticCount];
+  xsize vertSize = 0;
+  QVERIFY(loader.load(obj.constData(), obj.size(), objSemantics, objSemanticCount, &tris, &vertSize, elements));
+  Eks::Vector<xuint8> floats(Eks::Core::defaultAllocator());
+  QVERIFY(loader.bake(tris, elements, objSemanticCount, &floats));
+
+  loader.setFormat(Eks::ShaderVertexLayoutDescription::TextureCoordinate, Eks::ShaderVertexLayoutDescription::FormatHalf2);
+  loader.setFormat(Eks::ShaderVertexLayoutDescription::Normal, Eks::ShaderVertexLayoutDescription::FormatOctahedralNormal);
+
+  Eks::Vector<Eks::VectorI3D> compactTris(Eks::Core::defaultAllocator());
+  Eks::ObjLoader::ElementData compactElements[objSemanticCount];
+  xsize compactVertSize = 0;
+  QVERIFY(loader.load(obj.constData(), obj.size(), objSemantics, objSemanticCount, &compactTris, &compactVertSize, compactElements));
+  QCOMPARE(vertSize, (xsize)32);
+  QCOMPARE(compactVertSize, (xsize)20);
+
+  Eks::Vector<xuint8> compact(Eks::Core::defaultAllocator());
+  QVERIFY(loader.bake(compactTris, compactElements, objSemanticCount, &compact));
+  QCOMPARE(compact.size() / compactVertSize, floats.size() / vertSize);
+
+  for(xsize v = 0, count = floats.size() / vertSize; v < count; ++v)
+    {
+    const float *expected = (const float *)(floats.data() + v * vertSize);
+    const xuint8 *vertex = compact.data() + v * compactVertSize;
+
+    Eks::Real decoded[3];
+    Eks::VertexEncoder::decode(Eks::ShaderVertexLayoutDescription::FormatFloat3, vertex, decoded);
+    QCOMPARE(decoded[0], expected[0]);
+
+    Eks::VertexEncoder::decode(Eks::ShaderVertexLayoutDescription::FormatHalf2, vertex + 12, decoded);
+    QVERIFY(std::abs(decoded[0] - expected[3]) < 1e-3f && std::abs(decoded[1] - expected[4]) < 1e-3f);
+
+    Eks::VertexEncoder::decode(Eks::ShaderVertexLayoutDescription::FormatOctahedralNormal, vertex + 16, decoded);
+    QVERIFY(std::abs(decoded[2] - expected[7]) < 1e-3f);
+    }
+  }
+
+void Eks3DTest::meshOptimiserTest()
+  {
+  QByteArray obj = buildObjGrid(64);
+  Eks::ObjLoader loader(Eks::Core::defaultAllocator());
+
+  Eks::Vector<Eks::VectorI3D> tris(Eks::Core::defaultAllocator());
+  Eks::ObjLoader::ElementData elements[objSemanticCount];
+  xsize vertSize = 0;
+  QVERIFY(loader.load(obj.constData(), obj.size(), objSemantics, objSemanticCount, &tris, &vertSize, elements));
+
+  Eks::Vector<xuint8> vertices(Eks::Core::defaultAllocator());
+  Eks::Vector<xuint32> indices(Eks::Core::defaultAllocator());
+  QVERIFY(loader.bakeIndexed(tris, elements, objSemanticCount, &vertices, &indices));
+  const xsize vertexCount = vertices.size() / vertSize;
+  const xsize triCount = indices.size() / 3;
+
+  // Shuffle the triangles, so the input has no locality to start with.
+  xuint32 seed = 1;
+  for(xsize t = triCount - 1; t > 0; --t)
+    {
+    seed = seed * 1664525 + 1013904223;
+    const xsize other = (seed >> 8) % (t + 1);
+    for(xsize c = 0; c < 3; ++c)
+      {
+      std::swap(indices[t * 3 + c], indices[other * 3 + c]);
+      }
+    }
+
+  // Each triangle as its corner positions, to check the same triangles come out.
+  auto triangleSet = [&](std::vector<std::vector<float>> &out)
+    {
+    out.clear();
+    for(xsize t = 0; t < triCount; ++t)
+      {
+      std::vector<float> corners;
+      for(xsize c = 0; c < 3; ++c)
+        {
+        const float *pos = (const float *)(vertices.data() + indices[t * 3 + c] * vertSize);
+        corners.insert(corners.end(), pos, pos + 3);
+        }
+      out.push_back(corners);
+      }
+    std::sort(out.begin(), out.end());
+    };
+
+  std::vector<std::vector<float>> expected;
+  triangleSet(expected);
+
+  Eks::MeshOptimiser optimiser(Eks::Core::defaultAllocator());
+  Eks::MeshOptimiser::Statistics before;
+  Eks::MeshOptimiser::Statistics after;
+  const xsize used = optimiser.optimise(indices.data(), indices.size(), vertices.data(), vertexCount, vertSize, 0, &before, &after);
+  QCOMPARE(used, vertexCount);
+  QVERIFY(after.acmr < before.acmr * 0.5f);
+  QVERIFY(after.atvr < before.atvr);
+
+  std::vector<std::vector<float>> optimised;
+  triangleSet(optimised);
+  QVERIFY(optimised == expected);
+
+  // After the fetch pass, vertices are first used in order.
+  xuint32 next = 0;
+  for(xsize i = 0; i < indices.size(); ++i)
+    {
+    QVERIFY(indices[i] <= next);
+    if(indices[i] == next)
+      {
+      ++next;
+      }
+    }
+  }
+
+void Eks3DTest::meshSimplifierTest()
+  {
+  QByteArray obj = buildObjGrid(32);
+  Eks::ObjLoader loader(Eks::Core::defaultAllocator());
+
+  Eks::Vector<Eks::VectorI3D> tris(Eks::Core::defaultAllocator());
+  Eks::ObjLoader::ElementData elements[objSemanticCount];
+  xsize vertSize = 0;
+  QVERIFY(loader.load(obj.constData(), obj.size(), objSemantics, objSemanticCount, &tris, &vertSize, elements));
+
+  Eks::Vector<xuint8> vertices(Eks::Core::defaultAllocator());
+  Eks::Vector<xuint32> indices(Eks::Core::defaultAllocator());
+  QVERIFY(loader.bakeIndexed(tris, elements, objSemanticCount, &vertices, &indices));
+  const xsize vertexCount = vertices.size() / vertSize;
+
+  // Flatten the grid, so simplifying it can keep its exact outline and area.
+  for(xsize v = 0; v < vertexCount; ++v)
+    {
+    ((float *)(vertices.data() + v * vertSize))[2] = 0.0f;
+    }
+
+  auto area = [&](const xuint32 *lodIndices, xsize count)
+    {
+    float result = 0.0f;
+    for(xsize i = 0; i < count; i += 3)
+      {
+      const float *a = (const float *)(vertices.data() + lodIndices[i + 0] * vertSize);
+      const float *b = (const float *)(vertices.data() + lodIndices[i + 1] * vertSize);
+      const float *c = (const float *)(vertices.data() + lodIndices[i + 2] * vertSize);
+      result += ((b[0] - a[0]) * (c[1] - a[1]) - (b[1] - a[1]) * (c[0] - a[0])) * 0.5f;
+      }
+    return std::abs(result);
+    };
+  const float fullArea = area(indices.data(), indices.size());
+
+  Eks::MeshSimplifier::Mesh mesh;
+  mesh.vertexData = vertices.data();
+  mesh.vertexSize = vertSize;
+  mesh.vertexCount = vertexCount;
+  mesh.positionOffset = 0;
+  mesh.indices = indices.data();
+  mesh.indexCount = indices.size();
+
+  const Eks::Real ratios[] = { 0.5f, 0.1f };
+  Eks::MeshSimplifier::LodChain chain(Eks::Core::defaultAllocator());
+  Eks::MeshSimplifier::buildLodChains(Eks::Core::defaultAllocator(), &mesh, 1, ratios, X_ARRAY_COUNT(ratios), 0.01f, &chain);
+
+  QCOMPARE(chain.lods.size(), (xsize)3);
+  QCOMPARE(chain.lods[0].indexCount, indices.size());
+  for(xsize l = 0; l < chain.lods.size(); ++l)
+    {
+    const Eks::MeshSimplifier::Lod &lod = chain.lods[l];
+    if(l > 0)
+      {
+      QVERIFY(lod.indexCount <= (xsize)(indices.size() * ratios[l - 1]) + 3);
+      QVERIFY(lod.vertexCount < chain.lods[l - 1].vertexCount);
+      }
+
+    // Coarser levels draw from a prefix of the reordered vertices.
+    for(xsize i = 0; i < lod.indexCount; ++i)
+      {
+      QVERIFY(chain.indices[lod.firstIndex + i] < lod.vertexCount);
+      }
+
+    // Triangle signs are kept, so no triangles folded over.
+    QVERIFY(std::abs(area(chain.indices.data() + lod.firstIndex, lod.indexCount) - fullArea) < 1e-3f);
+    }
+  }
+
+void Eks3DTest::meshletTest()
+  {
+  Eks::Vector<float> positions(Eks::Core::defaultAllocator());
+  Eks::Vector<xuint32> indices(Eks::Core::defaultAllocator());
+  buildSphere(32, 64, &positions, &indices);
+  const xsize vertexCount = positions.size() / 3;
+
+  Eks::Vector<xuint32> original(Eks::Core::defaultAllocator());
+  original.resizeAndCopy(indices.size(), indices.data());
+
+  Eks::MeshletBuilder builder(Eks::Core::defaultAllocator());
+  Eks::Vector<Eks::MeshletBuilder::Meshlet> meshlets(Eks::Core::defaultAllocator());
+  builder.build(indices.data(), indices.size(), positions.data(), sizeof(float) * 3, vertexCount, &meshlets);
+
+  // Meshlets cover the reordered triangles in order, within their limits and bounds.
+  xsize next = 0;
+  for(xsize i = 0; i < meshlets.size(); ++i)
+    {
+    const Eks::MeshletBuilder::Meshlet &meshlet = meshlets[i];
+    QCOMPARE((xsize)meshlet.firstIndex, next);
+    QVERIFY(meshlet.vertexCount <= Eks::MeshletBuilder::DefaultMaxVertices);
+    QVERIFY(meshlet.indexCount / 3 <= Eks::MeshletBuilder::DefaultMaxTriangles);
+    next += meshlet.indexCount;
+
+    for(xsize idx = meshlet.firstIndex; idx < meshlet.firstIndex + meshlet.indexCount; ++idx)
+      {
+      const float *p = positions.data() + indices[idx] * 3;
+      QVERIFY(meshlet.bounds.contains(Eks::Vector3D(p[0], p[1], p[2])));
+      QVERIFY((Eks::Vector3D(p[0], p[1], p[2]) - meshlet.centre).norm() <= meshlet.radius * 1.0001f);
+      }
+    }
+  QCOMPARE(next, indices.size());
+
+  auto sortedTriangles = [](const Eks::Vector<xuint32> &in)
+    {
+    std::vector<std::vector<xuint32>> result;
+    for(xsize i = 0; i < in.size(); i += 3)
+      {
+      result.push_back(std::vector<xuint32>(in.data() + i, in.data() + i + 3));
+      }
+    std::sort(result.begin(), result.end());
+    return result;
+    };
+  QVERIFY(sortedTriangles(indices) == sortedTriangles(original));
+
+  // Looking at the sphere from outside, about half is back facing, and none of the triangles
+  // culled face the camera.
+  const Eks::Vector3D camera(0, 0, 5);
+  Eks::Frustum frustum(camera, Eks::Vector3D(0, 0, -1), Eks::Vector3D(1, 0, 0), Eks::Vector3D(0, 1, 0), 60, 1, 0.1f, 100);
+
+  Eks::Vector<Eks::MeshletBuilder::DrawRange> ranges(Eks::Core::defaultAllocator());
+  const xsize visible = Eks::MeshletBuilder::cull(meshlets.data(), meshlets.size(), frustum, camera, &ranges);
+  QVERIFY(visible < indices.size() / 3 * 3 / 4);
+  QVERIFY(visible >= indices.size() / 3 / 2);
+
+  for(xsize i = 0; i < meshlets.size(); ++i)
+    {
+    const Eks::MeshletBuilder::Meshlet &meshlet = meshlets[i];
+    if(!Eks::MeshletBuilder::isBackFacing(meshlet, camera))
+      {
+      continue;
+      }
+
+    for(xsize idx = meshlet.firstIndex; idx < meshlet.firstIndex + meshlet.indexCount; idx += 3)
+      {
+      Eks::Vector3D corners[3];
+      for(xsize c = 0; c < 3; ++c)
+        {
+        const float *p = positions.data() + indices[idx + c] * 3;
+        corners[c] = Eks::Vector3D(p[0], p[1], p[2]);
+        }
+      const Eks::Vector3D normal = (corners[1] - corners[0]).cross(corners[2] - corners[0]);
+      QVERIFY(normal.dot(camera - corners[0]) <= 1e-6f);
+      }
+    }
+
+  // Nothing is drawn from behind the camera.
+  Eks::Frustum away(camera, Eks::Vector3D(0, 0, 1), Eks::Vector3D(1, 0, 0), Eks::Vector3D(0, 1, 0), 60, 1, 0.1f, 100);
+  ranges.clear();
+  QCOMPARE(Eks::MeshletBuilder::cull(meshlets.data(), meshlets.size(), away, camera, &ranges), (xsize)0);
+  QCOMPARE(ranges.size(), (xsize)0);
+  }
+
+void Eks3DTest::colladaTest()
+  {
+  const char dae[] =
+    "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n"
+    "<COLLADA version=\"1.4.1\">\n"
+    "<!-- <geometry id=\"ignored\"> -->\n"
+    "<library_geometries>\n"
+    " <geometry id=\"quad-mesh\" name=\"quad\">\n"
+    "  <mesh>\n"
+    "   <source id=\"quad-pos\"><float_array id=\"quad-pos-array\" count=\"12\">0 0 0  1 0 0  1 1 0  0 1 2</float_array>\n"
+    "    <technique_common><accessor source=\"#quad-pos-array\" count=\"4\" stride=\"3\"/></technique_common></source>\n"
+    "   <source id=\"quad-uv\"><float_array count=\"2\">0.5 0.25</float_array>\n"
+    "    <technique_common><accessor count=\"1\" stride=\"2\"/></technique_common></source>\n"
+    "   <vertices id=\"quad-verts\"><input semantic=\"POSITION\" source=\"#quad-pos\"/></vertices>\n"
+    "   <polylist material=\"red\" count=\"1\">\n"
+    "    <input semantic=\"VERTEX\" source=\"#quad-verts\" offset=\"0\"/>\n"
+    "    <input semantic=\"TEXCOORD\" source=\"#quad-uv\" offset=\"1\" set=\"0\"/>\n"
+    "    <vcount>4</vcount><p>0 0 1 0 2 0 3 0</p>\n"
+    "   </polylist>\n"
+    "   <triangles material=\"blue\" count=\"1\"><input semantic=\"VERTEX\" source=\"#quad-verts\" offset=\"0\"/><p>1 2 3</p></triangles>\n"
+    "  </mesh>\n"
+    " </geometry>\n"
+    "</library_geometries>\n"
+    "</COLLADA>\n";
+
+  Eks::ColladaFile collada(Eks::Core::defaultAllocator());
+  Eks::Vector<Eks::VectorI3D> tris(Eks::Core::defaultAllocator());
+  Eks::ObjLoader::ElementData elements[objSemanticCount];
+  Eks::Vector<Eks::ObjLoader::Submesh> submeshes(Eks::Core::defaultAllocator());
+  xsize vertSize = 0;
+  QVERIFY(collada.load(dae, sizeof(dae) - 1, objSemantics, objSemanticCount, &tris, &vertSize, elements, &submeshes));
+
+  QCOMPARE(tris.size(), (xsize)9);
+  QCOMPARE(elements[0].data.size(), (xsize)4);
+  QVERIFY(elements[1].data[0].isApprox(Eks::ObjLoader::ElementVector(0.5f, 0.75f, 0)));
+  QCOMPARE(elements[2].data.size(), (xsize)0);
+  QVERIFY(tris[4] == Eks::VectorI3D(2, 0, 0));
+
+  // The triangles have no texcoords, so use a zero one.
+  QCOMPARE(elements[1].data.size(), (xsize)2);
+  QVERIFY(tris[6] == Eks::VectorI3D(1, 1, 0));
+
+  QCOMPARE(submeshes.size(), (xsize)2);
+  QVERIFY(submeshes[0].name == Eks::String("quad"));
+  QVERIFY(submeshes[0].material == Eks::String("red"));
+  QCOMPARE(submeshes[0].indexCount, (xsize)6);
+  QVERIFY(submeshes[0].bounds == Eks::BoundingBox(Eks::Vector3D(0, 0, 0), Eks::Vector3D(1, 1, 2)));
+  QVERIFY(submeshes[1].material == Eks::String("blue"));
+  QCOMPARE(submeshes[1].firstIndex, (xsize)6);
+
+  const char badIndex[] =
+    "<COLLADA><library_geometries><geometry><mesh>"
+    "<source id=\"p\"><float_array>0 0 0</float_array></source>"
+    "<vertices id=\"v\"><input semantic=\"POSITION\" source=\"#p\"/></vertices>"
+    "<triangles><input semantic=\"VERTEX\" source=\"#v\" offset=\"0\"/><p>0 0 5</p></triangles>"
+    "</mesh></geometry></library_geometries></COLLADA>";
+  tris.clear();
+  QVERIFY_EXCEPTION_THROWN(collada.load(badIndex, sizeof(badIndex) - 1, objSemantics, 1, &tris, &vertSize, elements), Eks::ParseException);
+
+  // A grid large enough to parse its arrays on several threads loads as the obj does.
+  const QByteArray grid = buildColladaGrid(256);
+  const QByteArray obj = buildObjGrid(256);
+
+  Eks::Vector<Eks::VectorI3D> daeTris(Eks::Core::defaultAllocator());
+  Eks::Vector<Eks::VectorI3D> objTris(Eks::Core::defaultAllocator());
+  Eks::ObjLoader::ElementData daeElements[objSemanticCount];
+  Eks::ObjLoader::ElementData objElements[objSemanticCount];
+  QVERIFY(collada.load(grid.constData(), grid.size(), objSemantics, objSemanticCount, &daeTris, &vertSize, daeElements));
+  QVERIFY(collada.loader().load(obj.constData(), obj.size(), objSemantics, objSemanticCount, &objTris, &vertSize, objElements));
+
+  QCOMPARE(daeTris.size(), objTris.size());
+  QVERIFY(std::equal(daeTris.begin(), daeTris.end(), objTris.begin()));
+  for(xsize i = 0; i < objSemanticCount; ++i)
+    {
+    QCOMPARE(daeElements[i].data.size(), objElements[i].data.size());
+    QVERIFY(std::equal(daeElements[i].data.begin(), daeElements[i].data.end(), objElements[i].data.begin()));
+    }
+
+  Eks::Vector<xuint8> daeBaked(Eks::Core::defaultAllocator());
+  Eks::Vector<xuint8> objBaked(Eks::Core::defaultAllocator());
+  QVERIFY(collada.loader().bake(daeTris, daeElements, objSemanticCount, &daeBaked));
+  QVERIFY(collada.loader().bake(objTris, objElements, objSemanticCount, &objBaked));
+  QCOMPARE(daeBaked.size(), objBaked.size());
+  QVERIFY(memcmp(daeBaked.data(), objBaked.data(), objBaked.size()) == 0);
+  }
+
+void Eks3DTest::plyLoaderTest()
+  {
+  const char ascii[] =
+    "ply\n"
+    "format ascii 1.0\n"
+    "comment a unit quad\n"
+    "element vertex 4\n"
+    "property float x\nproperty float y\nproperty float z\n"
+    "property float nx\nproperty float ny\nproperty float nz\n"
+    "element face 1\n"
+    "property list uchar int vertex_indices\n"
+    "end_header\n"
+    "0 0 0 0 0 1\n1 0 0 0 0 1\n1 1 0 0 0 1\n0 1 2 0 0 1\n"
+    "4 0 1 2 3\n";
+
+  const float vertexData[] =
+    {
+    0, 0, 0, 0, 0, 1,
+    1, 0, 0, 0, 0, 1,
+    1, 1, 0, 0, 0, 1,
+    0, 1, 2, 0, 0, 1
+    };
+  const xint32 face[] = { 0, 1, 2, 3 };
+
+  QByteArray binary = QByteArray(ascii, strstr(ascii, "end_header") - ascii).replace("ascii", Q_BYTE_ORDER == Q_LITTLE_ENDIAN ? "binary_little_endian" : "binary_big_endian");
+  binary += "end_header\n";
+  binary.append((const char *)vertexData, sizeof(vertexData));
+  binary.append((char)4);
+  binary.append((const char *)face, sizeof(face));
+
+  const Eks::ShaderVertexLayoutDescription::Semantic semantics[] =
+    {
+    Eks::ShaderVertexLayoutDescription::Position,
+    Eks::ShaderVertexLayoutDescription::Normal
+    };
+
+  Eks::PlyLoader ply(Eks::Core::defaultAllocator());
+  Eks::Vector<Eks::VectorI3D> asciiTris(Eks::Core::defaultAllocator());
+  Eks::Vector<Eks::VectorI3D> binaryTris(Eks::Core::defaultAllocator());
+  Eks::ObjLoader::ElementData asciiElements[2];
+  Eks::ObjLoader::ElementData binaryElements[2];
+  xsize vertSize = 0;
+  QVERIFY(ply.load(ascii, sizeof(ascii) - 1, semantics, 2, &asciiTris, &vertSize, asciiElements));
+  QVERIFY(ply.load(binary.constData(), binary.size(), semantics, 2, &binaryTris, &vertSize, binaryElements));
+
+  QCOMPARE(asciiTris.size(), (xsize)6);
+  QVERIFY(asciiTris[5] == Eks::VectorI3D(3, 3, 0));
+  QVERIFY(asciiElements[0].data[3] == Eks::ObjLoader::ElementVector(0, 1, 2));
+  QVERIFY(std::equal(asciiTris.begin(), asciiTris.end(), binaryTris.begin()));
+  for(xsize i = 0; i < 2; ++i)
+    {
+    QCOMPARE(asciiElements[i].data.size(), (xsize)4);
+    QVERIFY(std::equal(asciiElements[i].data.begin(), asciiElements[i].data.end(), binaryElements[i].data.begin()));
+    }
+
+  // The binary vertices already match the layout, so are used where they are.
+  const xuint8 *direct = 0;
+  xsize directSize = 0;
+  xsize directCount = 0;
+  QVERIFY(Eks::PlyLoader::findDirectVertexData(binary.constData(), binary.size(), semantics, 2, &direct, &directSize, &directCount));
+  QVERIFY(direct == (const xuint8 *)binary.constData() + binary.indexOf("end_header\n") + 11);
+  QCOMPARE(directSize, vertSize);
+  QCOMPARE(directCount, (xsize)4);
+  QVERIFY(memcmp(direct, vertexData, sizeof(vertexData)) == 0);
+
+  QVERIFY(!Eks::PlyLoader::findDirectVertexData(ascii, sizeof(ascii) - 1, semantics, 2, &direct, &directSize, &directCount));
+  QVERIFY(!Eks::PlyLoader::findDirectVertexData(binary.constData(), binary.size(), semantics, 1, &direct, &directSize, &directCount));
+
+  QByteArray badIndex(ascii);
+  badIndex.replace("4 0 1 2 3", "3 0 1 4");
+  QVERIFY_EXCEPTION_THROWN(ply.load(badIndex.constData(), badIndex.size(), semantics, 2, &asciiTris, &vertSize, asciiElements), Eks::ParseException);
+  }
+
+void Eks3DTest::gltfLoaderTest()
+  {
+  // An interleaved quad with 16 bit indices, then a triangle with positions and normalised
+  // colours in separate views.
+  const float quad[] =
+    {
+    0, 0, 0, 0, 0, 1,
+    1, 0, 0, 0, 0, 1,
+    1, 1, 0, 0, 0, 1,
+    0, 1, 0, 0, 0, 1
+    };
+  const xuint16 quadIndices[] = { 0, 1, 2, 0, 2, 3 };
+  const float triangle[] = { 0, 0, 0, 2, 0, 0, 0, 3, -1 };
+  const xuint8 colours[] = { 255, 0, 0, 255, 0, 255, 0, 255, 0, 0, 255, 255 };
+
+  QByteArray bin;
+  bin.append((const char *)quad, sizeof(quad));
+  bin.append((const char *)quadIndices, sizeof(quadIndices));
+  bin.append((const char *)triangle, sizeof(triangle));
+  bin.append((const char *)colours, sizeof(colours));
+
+  const QByteArray json =
+    "{\"asset\":{\"version\":\"2.0\"},"
+    "\"buffers\":[{BUFFER\"byteLength\":156}],"
+    "\"bufferViews\":["
+      "{\"buffer\":0,\"byteOffset\":0,\"byteLength\":96,\"byteStride\":24},"
+      "{\"buffer\":0,\"byteOffset\":96,\"byteLength\":12},"
+      "{\"buffer\":0,\"byteOffset\":108,\"byteLength\":36},"
+      "{\"buffer\":0,\"byteOffset\":144,\"byteLength\":12}],"
+    "\"accessors\":["
+      "{\"bufferView\":0,\"componentType\":5126,\"count\":4,\"type\":\"VEC3\",\"min\":[0,0,0],\"max\":[1,1,0]},"
+      "{\"bufferView\":0,\"byteOffset\":12,\"componentType\":5126,\"count\":4,\"type\":\"VEC3\"},"
+      "{\"bufferView\":1,\"componentType\":5123,\"count\":6,\"type\":\"SCALAR\"},"
+      "{\"bufferView\":2,\"componentType\":5126,\"count\":3,\"type\":\"VEC3\"},"
+      "{\"bufferView\":3,\"componentType\":5121,\"normalized\":true,\"count\":3,\"type\":\"VEC4\"}],"
+    "\"meshes\":["
+      "{\"name\":\"quad\",\"primitives\":[{\"attributes\":{\"POSITION\":0,\"NORMAL\":1},\"indices\":2,\"material\":0}]},"
+      "{\"name\":\"triangle\",\"primitives\":[{\"attributes\":{\"POSITION\":3,\"COLOR_0\":4,\"TEXCOORD_1\":3}}]}],"
+    "\"nodes\":["
+      "{\"name\":\"root\",\"translation\":[1,0,0],\"children\":[1]},"
+      "{\"name\":\"child\",\"mesh\":0,\"scale\":[2,2,2]},"
+      "{\"mesh\":1,\"matrix\":[1,0,0,0, 0,1,0,0, 0,0,1,0, 0,5,0,1]}]}";
+
+  QByteArray glbJson = QByteArray(json).replace("BUFFER", "");
+  while(glbJson.size() % 4)
+    {
+    glbJson += ' ';
+    }
+
+  const xuint32 header[] = { 0x46546C67, 2, (xuint32)(12 + 8 + glbJson.size() + 8 + bin.size()) };
+  const xuint32 jsonChunk[] = { (xuint32)glbJson.size(), 0x4E4F534A };
+  const xuint32 binChunk[] = { (xuint32)bin.size(), 0x004E4942 };
+
+  QByteArray glb;
+  glb.append((const char *)header, sizeof(header));
+  glb.append((const char *)jsonChunk, sizeof(jsonChunk));
+  glb += glbJson;
+  glb.append((const char *)binChunk, sizeof(binChunk));
+  glb += bin;
+
+  Eks::GltfLoader loader(Eks::Core::defaultAllocator());
+  QVERIFY(loader.load(glb.constData(), glb.size()));
+
+  QCOMPARE(loader.meshes().size(), (xsize)2);
+  QVERIFY(loader.meshes()[1].name == Eks::String("triangle"));
+  QCOMPARE(loader.primitives().size(), (xsize)2);
+
+  // The quad is uploaded straight from the file.
+  const Eks::GltfLoader::Primitive &quadPrimitive = loader.primitives()[0];
+  const xuint8 *vertexData = 0;
+  xsize vertexSize = 0;
+  QVERIFY(Eks::GltfLoader::isInterleaved(quadPrimitive, &vertexData, &vertexSize));
+  QVERIFY(vertexData == (const xuint8 *)glb.constData() + glb.size() - bin.size());
+  QCOMPARE(vertexSize, (xsize)24);
+  QCOMPARE(quadPrimitive.vertexCount, (xsize)4);
+  QCOMPARE(quadPrimitive.material, (xsize)0);
+  QCOMPARE(quadPrimitive.indexType, Eks::IndexGeometry::Unsigned16);
+  QCOMPARE(quadPrimitive.indexCount, (xsize)6);
+  QVERIFY(memcmp(quadPrimitive.indexData, quadIndices, sizeof(quadIndices)) == 0);
+  QVERIFY(quadPrimitive.bounds == Eks::BoundingBox(Eks::Vector3D(0, 0, 0), Eks::Vector3D(1, 1, 0)));
+
+  Eks::ShaderVertexLayoutDescription descs[Eks::GltfLoader::MaxAttributes];
+  QCOMPARE(Eks::GltfLoader::layoutDescriptions(quadPrimitive, descs, Eks::GltfLoader::MaxAttributes), (xsize)2);
+  QCOMPARE(descs[1].semantic, Eks::ShaderVertexLayoutDescription::Normal);
+  QCOMPARE(descs[1].offset, (xsize)12);
+
+  // The triangle's views are apart, so it is interleaved before upload.
+  const Eks::GltfLoader::Primitive &trianglePrimitive = loader.primitives()[1];
+  QVERIFY(!Eks::GltfLoader::isInterleaved(trianglePrimitive, &vertexData, &vertexSize));
+  QCOMPARE(trianglePrimitive.attributeCount, (xsize)2);
+  QCOMPARE(trianglePrimitive.material, Eks::GltfLoader::NoIndex);
+  QVERIFY(!trianglePrimitive.indexData);
+  QVERIFY(trianglePrimitive.bounds == Eks::BoundingBox(Eks::Vector3D(0, 0, -1), Eks::Vector3D(2, 3, 0)));
+  QCOMPARE(Eks::GltfLoader::layoutDescriptions(trianglePrimitive, descs, Eks::GltfLoader::MaxAttributes), (xsize)2);
+  QCOMPARE(descs[1].format, Eks::ShaderVertexLayoutDescription::FormatNormalisedUnsignedByte4);
+  QCOMPARE(descs[1].offset, (xsize)12);
+
+  QCOMPARE(loader.nodes().size(), (xsize)3);
+  QCOMPARE(loader.nodes()[1].parent, (xsize)0);
+  QCOMPARE(loader.nodes()[1].mesh, (xsize)0);
+  QVERIFY((loader.nodes()[1].world * Eks::Vector3D(1, 0, 0)).isApprox(Eks::Vector3D(3, 0, 0)));
+  QVERIFY((loader.nodes()[2].world * Eks::Vector3D(0, 0, 0)).isApprox(Eks::Vector3D(0, 5, 0)));
+
+  // The same file as text, with the buffer embedded.
+  const QByteArray gltf = QByteArray(json).replace("BUFFER", "\"uri\":\"data:application/octet-stream;base64," + bin.toBase64() + "\",");
+  Eks::GltfLoader textLoader(Eks::Core::defaultAllocator());
+  QVERIFY(textLoader.load(gltf.constData(), gltf.size()));
+  QCOMPARE(textLoader.primitives().size(), (xsize)2);
+  QVERIFY(memcmp(textLoader.primitives()[0].attributes[0].data, quad, sizeof(quad)) == 0);
+
+  QByteArray badBin = bin;
+  const xuint16 badIndex = 4;
+  memcpy(badBin.data() + sizeof(quad), &badIndex, sizeof(badIndex));
+  const QByteArray badGltf = QByteArray(json).replace("BUFFER", "\"uri\":\"data:application/octet-stream;base64," + badBin.toBase64() + "\",");
+  QVERIFY_EXCEPTION_THROWN(textLoader.load(badGltf.constData(), badGltf.size()), Eks::ParseException);
+  }
+
+namespace
+{
+
+// Interleave one attribute at a time with a copy per vertex, as Modeller used to.
+void interleaveStrided(const Eks::VertexInterleaver::Stream *streams, xsize streamCount, xsize vertexCount, xuint8 *out)
+  {
+  const xsize vertexSize = Eks::VertexInterleaver::vertexSize(streams, streamCount);
+  xsize offset = 0;
+  for(xsize s = 0; s < streamCount; ++s)
+    {
+    const xsize size = streams[s].components * sizeof(Eks::Real);
+    for(xsize v = 0; v < vertexCount; ++v)
+      {
+      xuint8 *d = out + offset + v * vertexSize;
+      if(v < streams[s].count)
+        {
+        memcpy(d, streams[s].data + v * streams[s].components, size);
+        }
+      else
+        {
+        memset(d, 0, size);
+        }
+      }
+    offset += size;
+    }
+  }
+
+const xsize interleaveComponents[] = { 3, 3, 2, 4 };
+
+void buildInterleaveStreams(xsize vertexCount, Eks::Vector<Eks::Real> *values, Eks::VertexInterleaver::Stream *streams)
+  {
+  xsize total = 0;
+  for(xsize s = 0; s < X_ARRAY_COUNT(interleaveComponents); ++s)
+    {
+    total += interleaveComponents[s] * vertexCount;
+    }
+
+  values->resize(total, 0);
+  for(xsize i = 0; i < total; ++i)
+    {
+    (*values)[i] = (Eks::Real)i;
+    }
+
+  const Eks::Real *data = values->data();
+  for(xsize s = 0; s < X_ARRAY_COUNT(interleaveComponents); ++s)
+    {
+    streams[s].data = data;
+    streams[s].components = interleaveComponents[s];
+    streams[s].count = vertexCount;
+    data += interleaveComponents[s] * vertexCount;
+    }
+  }
+
+}
+
+void Eks3DTest::vertexInterleaverTest()
+  {
+  // Large enough to be split across threads.
+  const xsize vertexCount = Eks::VertexInterleaver::MinParallelVertices * 2 + 7;
+  Eks::Vector<Eks::Real> values(Eks::Core::defaultAllocator());
+  Eks::VertexInterleaver::Stream streams[X_ARRAY_COUNT(interleaveComponents)];
+  buildInterleaveStreams(vertexCount, &values, streams);
+
+  // A short stream is padded with zeros.
+  streams[2].count = vertexCount / 2;
+
+  // Fixed layouts, then layouts only the generic kernel handles.
+  const xsize layouts[][2] =
+    {
+      { 0, 2 },
+      { 0, 4 },
+      { 2, 2 },
+      { 1, 3 },
+    };
+
+  for(xsize l = 0; l < X_ARRAY_COUNT(layouts); ++l)
+    {
+    const Eks::VertexInterleaver::Stream *first = streams + layouts[l][0];
+    const xsize streamCount = layouts[l][1];
+    const xsize vertexSize = Eks::VertexInterleaver::vertexSize(first, streamCount);
+
+    Eks::Vector<xuint8> expected(Eks::Core::defaultAllocator());
+    Eks::Vector<xuint8> result(Eks::Core::defaultAllocator());
+    expected.resize(vertexCount * vertexSize, 0);
+    result.resize(vertexCount * vertexSize, 0xff);
+
+    interleaveStrided(first, streamCount, vertexCount, expected.data());
+    Eks::VertexInterleaver::interleave(first, streamCount, vertexCount, result.data());
+    QVERIFY(memcmp(expected.data(), result.data(), expected.size()) == 0);
+
+    // A small mesh ends within the wide stores' reach, nothing past it is written.
+    memset(result.data(), 0xff, result.size());
+    interleaveStrided(first, streamCount, 3, expected.data());
+    Eks::VertexInterleaver::interleave(first, streamCount, 3, result.data());
+    QVERIFY(memcmp(expected.data(), result.data(), vertexSize * 3) == 0);
+    QCOMPARE(result[vertexSize * 3], (xuint8)0xff);
+    }
+
+  // A missing stream is zeroed, the others are still written whole.
+  streams[1].data = 0;
+  streams[1].count = 0;
+  const xsize vertexSize = Eks::VertexInterleaver::vertexSize(streams, X_ARRAY_COUNT(streams));
+  Eks::Vector<xuint8> expected(Eks::Core::defaultAllocator());
+  Eks::Vector<xuint8> result(Eks::Core::defaultAllocator());
+  expected.resize(vertexCount * vertexSize, 0);
+  result.resize(vertexCount * vertexSize, 0xff);
+
+  interleaveStrided(streams, X_ARRAY_COUNT(streams), vertexCount, expected.data());
+  Eks::VertexInterleaver::interleave(streams, X_ARRAY_COUNT(streams), vertexCount, result.data());
+  QVERIFY(memcmp(expected.data(), result.data(), expected.size()) == 0);
+  }
+
+void Eks3DTest::primitiveCacheTest()
+  {
+  Eks::PrimitiveCache cache(Eks::Core::defaultAllocator());
+
+  const Eks::PrimitiveCache::Primitive &sphere = cache.sphere(8, 12);
+  QVERIFY(&cache.sphere(8, 12) == &sphere);
+  QVERIFY(&cache.sphere(8, 16) != &sphere);
+
+  QVERIFY(sphere.positions.size() > 0);
+  QCOMPARE(sphere.normals.size(), sphere.positions.size());
+  QCOMPARE(sphere.textures.size(), sphere.positions.size());
+  QCOMPARE(sphere.triangles.size() % 3, (xsize)0);
+  for(xsize i = 0; i < sphere.positions.size(); ++i)
+    {
+    QVERIFY(qAbs(sphere.positions[i].norm() - 1.0f) < 1e-5f);
+    QVERIFY(sphere.normals[i].isApprox(sphere.positions[i], 1e-4f));
+    }
+  for(xsize i = 0; i < sphere.triangles.size(); ++i)
+    {
+    QVERIFY(sphere.triangles[i] < sphere.positions.size());
+    }
+
+  const Eks::PrimitiveCache::Primitive &cone = cache.cone(6, true);
+  QVERIFY(&cache.cone(6, false) != &cone);
+  QCOMPARE(cone.positions.size(), (xsize)7);
+  QCOMPARE(cone.triangles.size(), (xsize)(6 + 5) * 3);
+  QVERIFY(cone.positions[0].isApprox(Eks::Vector3D(1, 0, 0)));
+
+  const Eks::PrimitiveCache::Primitive &circle = cache.wireCircle(24);
+  QCOMPARE(circle.positions.size(), (xsize)24);
+  QCOMPARE(circle.lines.size(), (xsize)48);
+  QVERIFY(circle.positions[0].isApprox(Eks::Vector3D(0, 1, 0)));
+
+  const Eks::PrimitiveCache::Primitive &cube = cache.cube(0, 0);
+  QCOMPARE(cube.positions.size(), (xsize)24);
+  QCOMPARE(cube.triangles.size(), (xsize)36);
+
+  // More primitives than hash buckets, looked up from several threads at once, each built once.
+  const xsize circleCount = 100;
+  std::vector<const Eks::PrimitiveCache::Primitive *> found(circleCount * 4);
+  Eks::ParallelUtilities::forRanges(found.size(), 1, [&](xsize, xsize begin, xsize end)
+    {
+    for(xsize i = begin; i < end; ++i)
+      {
+      found[i] = &cache.wireCircle((xuint32)(3 + i % circleCount));
+      }
+    }, 8);
+
+  for(xsize i = 0; i < found.size(); ++i)
+    {
+    QVERIFY(found[i] == &cache.wireCircle((xuint32)(3 + i % circleCount)));
+    QCOMPARE(found[i]->positions.size(), 3 + i % circleCount);
+    }
+  QVERIFY(&cache.sphere(8, 12) == &sphere);
+  }
+
+namespace
+{
+
+// Keeps the data baked into geometry, instead of creating GPU buffers.
+class RecordingRenderer : public Eks::Renderer
+  {
+public:
+  // If [mapping], geometry is written in place as if into a mapped buffer.
+  RecordingRenderer(bool mapping = false) : vertexSize(0), indexType(0), indexCount(0), written(0), updated(0)
+    {
+    Eks::detail::RendererFunctions fns;
+    memset(&fns, 0, sizeof(fns));
+    fns.create.geometry = createGeometry;
+    fns.create.indexGeometry = createIndexGeometry;
+    fns.destroy.geometry = destroyGeometry;
+    fns.destroy.indexGeometry = destroyIndexGeometry;
+    if(mapping)
+      {
+      fns.buffer.geometry = writeGeometry;
+      fns.buffer.indexGeometry = writeIndexGeometry;
+      }
+    fns.buffer.updateGeometry = updateGeometry;
+    fns.buffer.updateIndexGeometry = updateIndexGeometry;
+    setFunctions(fns);
+    }
+
+  ~RecordingRenderer()
+    {
+    }
+
+  std::vector<xuint8> vertices;
+  xsize vertexSize;
+  std::vector<xuint8> indices;
+  int indexType;
+  xsize indexCount;
+  xsize written;
+  // Bytes overwritten by updates.
+  xsize updated;
+
+private:
+  static bool createGeometry(Eks::Renderer *r, Eks::Geometry *, const void *data, xsize elementSize, xsize elementCount)
+    {
+    RecordingRenderer *ths = static_cast<RecordingRenderer *>(r);
+    const xuint8 *bytes = (const xuint8 *)data;
+    ths->vertices.assign(bytes, bytes + elementSize * elementCount);
+    ths->vertexSize = elementSize;
+    return true;
+    }
+
+  static bool createIndexGeometry(Eks::Renderer *r, Eks::IndexGeometry *, int type, const void *data, xsize count)
+    {
+    RecordingRenderer *ths = static_cast<RecordingRenderer *>(r);
+    const xuint8 *bytes = (const xuint8 *)data;
+    ths->indices.assign(bytes, bytes + Eks::IndexGeometry::typeSize((Eks::IndexGeometry::Type)type) * count);
+    ths->indexType = type;
+    ths->indexCount = count;
+    return true;
+    }
+
+  static bool writeGeometry(Eks::Renderer *r, Eks::Geometry *, xsize elementSize, xsize elementCount, void (*write)(void *, void *), void *context)
+    {
+    RecordingRenderer *ths = static_cast<RecordingRenderer *>(r);
+    // Garbage, as a fresh mapping would hold.
+    ths->vertices.assign(elementSize * elementCount, 0xcd);
+    write(ths->vertices.data(), context);
+    ths->vertexSize = elementSize;
+    ++ths->written;
+    return true;
+    }
+
+  static bool writeIndexGeometry(Eks::Renderer *r, Eks::IndexGeometry *, int type, xsize count, void (*write)(void *, void *), void *context)
+    {
+    RecordingRenderer *ths = static_cast<RecordingRenderer *>(r);
+    ths->indices.assign(Eks::IndexGeometry::typeSize((Eks::IndexGeometry::Type)type) * count, 0xcd);
+    write(ths->indices.data(), context);
+    ths->indexType = type;
+    ths->indexCount = count;
+    ++ths->written;
+    return true;
+    }
+
+  static bool updateGeometry(Eks::Renderer *r, Eks::Geometry *, xsize elementSize, xsize first, xsize count, void (*write)(void *, void *), void *context)
+    {
+    RecordingRenderer *ths = static_cast<RecordingRenderer *>(r);
+    if(elementSize != ths->vertexSize || (first + count) * elementSize > ths->vertices.size())
+      {
+      return false;
+      }
+    write(ths->vertices.data() + first * elementSize, context);
+    ths->updated += count * elementSize;
+    return true;
+    }
+
+  static bool updateIndexGeometry(Eks::Renderer *r, Eks::IndexGeometry *, int type, xsize first, xsize count, void (*write)(void *, void *), void *context)
+    {
+    RecordingRenderer *ths = static_cast<RecordingRenderer *>(r);
+    const xsize size = Eks::IndexGeometry::typeSize((Eks::IndexGeometry::Type)type);
+    if(type != ths->indexType || first + count > ths->indexCount)
+      {
+      return false;
+      }
+    write(ths->indices.data() + first * size, context);
+    ths->updated += count * size;
+    return true;
+    }
+
+  static void destroyGeometry(Eks::Renderer *, Eks::Geometry *)
+    {
+    }
+
+  static void destroyIndexGeometry(Eks::Renderer *, Eks::IndexGeometry *)
+    {
+    }
+  };
+
+const Eks::ShaderVertexLayoutDescription::Semantic modellerSemantics[] =
+  {
+  Eks::ShaderVertexLayoutDescription::Position,
+  Eks::ShaderVertexLayoutDescription::Normal,
+  Eks::ShaderVertexLayoutDescription::TextureCoordinate,
+  Eks::ShaderVertexLayoutDescription::Colour
+  };
+
+// A row of spheres and quads, some coloured, so parts carry different attributes.
+void buildModellerJob(Eks::Modeller &m, xsize job)
+  {
+  Eks::Transform tr = Eks::Transform::Identity();
+  tr.translate(Eks::Vector3D((float)job, 0, 0));
+  m.setTransform(tr);
+  if(job % 3 == 1)
+    {
+    m.colour(1, 0, 0, 1);
+    }
+  m.drawSphere(0.4f, 4 + (int)(job % 4), 6);
+  m.drawQuad();
+  }
+
+}
+
+void Eks3DTest::modellerMergeTest()
+  {
+  const xsize jobCount = 13;
+
+  // The same jobs one after another in one Modeller.
+  RecordingRenderer serial;
+    {
+    Eks::Modeller m(Eks::Core::defaultAllocator());
+    for(xsize i = 0; i < jobCount; ++i)
+      {
+      m.save();
+      buildModellerJob(m, i);
+      m.restore();
+      }
+
+    Eks::Geometry geo;
+    Eks::IndexGeometry index;
+    m.bakeTriangles(&serial, modellerSemantics, X_ARRAY_COUNT(modellerSemantics), &index, &geo);
+    }
+
+  RecordingRenderer parallel;
+    {
+    Eks::Modeller m(Eks::Core::defaultAllocator());
+    m.buildParallel(jobCount, buildModellerJob);
+
+    Eks::Geometry geo;
+    Eks::IndexGeometry index;
+    m.bakeTriangles(&parallel, modellerSemantics, X_ARRAY_COUNT(modellerSemantics), &index, &geo);
+    }
+
+  QVERIFY(serial.vertices.size() > 0);
+  QVERIFY(serial.vertices == parallel.vertices);
+  QVERIFY(serial.indices == parallel.indices);
+  QCOMPARE(serial.indexCount, parallel.indexCount);
+  }
+
+void Eks3DTest::modellerMappedBakeTest()
+  {
+  Eks::Modeller m(Eks::Core::defaultAllocator());
+  for(xsize i = 0; i < 4; ++i)
+    {
+    buildModellerJob(m, i);
+    }
+
+  // Packed normals take the per attribute path rather than the interleaver.
+  const Eks::ShaderVertexLayoutDescription::Format packed[] =
+    {
+    Eks::ShaderVertexLayoutDescription::FormatFloat3,
+    Eks::ShaderVertexLayoutDescription::FormatNormalisedByte4,
+    Eks::ShaderVertexLayoutDescription::FormatHalf2,
+    Eks::ShaderVertexLayoutDescription::FormatNormalisedUnsignedByte4
+    };
+  const Eks::ShaderVertexLayoutDescription::Format *formats[] = { 0, packed };
+
+  for(xsize f = 0; f < X_ARRAY_COUNT(formats); ++f)
+    {
+    RecordingRenderer copied;
+    RecordingRenderer mapped(true);
+    Eks::Geometry geo, mappedGeo;
+    Eks::IndexGeometry index, mappedIndex;
+    m.bakeTriangles(&copied, modellerSemantics, X_ARRAY_COUNT(modellerSemantics), &index, &geo, formats[f]);
+    m.bakeTriangles(&mapped, modellerSemantics, X_ARRAY_COUNT(modellerSemantics), &mappedIndex, &mappedGeo, formats[f]);
+
+    QCOMPARE(copied.written, (xsize)0);
+    QCOMPARE(mapped.written, (xsize)2);
+    QVERIFY(copied.vertices.size() > 0);
+    QVERIFY(copied.vertices == mapped.vertices);
+    QVERIFY(copied.indices == mapped.indices);
+    QCOMPARE(copied.indexType, (int)Eks::IndexGeometry::Unsigned16);
+    }
+  }
+
+void Eks3DTest::modellerUpdateBakeTest()
+  {
+  const xsize semanticCount = X_ARRAY_COUNT(modellerSemantics);
+
+  Eks::Modeller m(Eks::Core::defaultAllocator());
+  for(xsize i = 0; i < 4; ++i)
+    {
+    buildModellerJob(m, i);
+    }
+
+  RecordingRenderer r;
+  Eks::Geometry geo;
+  Eks::IndexGeometry index;
+  m.bakeTriangles(&r, modellerSemantics, semanticCount, &index, &geo);
+
+  // Nothing changed, nothing is uploaded.
+  m.updateTriangles(&r, modellerSemantics, semanticCount, &index, &geo);
+  QCOMPARE(r.updated, (xsize)0);
+
+  const Eks::Vector3D positions[] = { Eks::Vector3D(1, 2, 3), Eks::Vector3D(4, 5, 6) };
+  const Eks::Vector4D colours[] = { Eks::Vector4D(0, 1, 0, 1) };
+  const xuint32 triangle[] = { 0, 2, 1 };
+  m.setVertices(5, positions, X_ARRAY_COUNT(positions));
+  m.setColours(9, colours, X_ARRAY_COUNT(colours));
+  m.setTriangles(6, triangle, X_ARRAY_COUNT(triangle), 3);
+  m.updateTriangles(&r, modellerSemantics, semanticCount, &index, &geo);
+
+  // Only vertices 5 to 9 and the edited triangle are rewritten.
+  QCOMPARE(r.updated, 5 * r.vertexSize + 3 * sizeof(xuint16));
+
+    {
+    RecordingRenderer fresh;
+    Eks::Geometry freshGeo;
+    Eks::IndexGeometry freshIndex;
+    m.bakeTriangles(&fresh, modellerSemantics, semanticCount, &freshIndex, &freshGeo);
+    QVERIFY(r.vertices == fresh.vertices);
+    QVERIFY(r.indices == fresh.indices);
+    }
+
+  // Growing the mesh creates the buffers again.
+  m.drawQuad();
+  const xsize updated = r.updated;
+  m.updateTriangles(&r, modellerSemantics, semanticCount, &index, &geo);
+  QCOMPARE(r.updated, updated);
+
+    {
+    RecordingRenderer fresh;
+    Eks::Geometry freshGeo;
+    Eks::IndexGeometry freshIndex;
+    m.bakeTriangles(&fresh, modellerSemantics, semanticCount, &freshIndex, &freshGeo);
+    QVERIFY(r.vertices == fresh.vertices);
+    QVERIFY(r.indices == fresh.indices);
+    QCOMPARE(r.indexCount, fresh.indexCount);
+    }
+
+  // Edits baked into another buffer are still pushed to this one.
+    {
+    RecordingRenderer other;
+    Eks::Geometry otherGeo;
+    Eks::IndexGeometry otherIndex;
+    m.setVertices(1, positions, X_ARRAY_COUNT(positions));
+    m.bakeTriangles(&other, modellerSemantics, semanticCount, &otherIndex, &otherGeo);
+    m.updateTriangles(&r, modellerSemantics, semanticCount, &index, &geo);
+    QVERIFY(r.vertices == other.vertices);
+    QVERIFY(r.indices == other.indices);
+    }
+
+  // A layout of the same size is written whole, not over part of the old layout.
+  const Eks::ShaderVertexLayoutDescription::Semantic swapped[] =
+    {
+    Eks::ShaderVertexLayoutDescription::Normal,
+    Eks::ShaderVertexLayoutDescription::Position,
+    Eks::ShaderVertexLayoutDescription::TextureCoordinate,
+    Eks::ShaderVertexLayoutDescription::Colour
+    };
+  m.setVertices(2, positions, X_ARRAY_COUNT(positions));
+  m.updateVertices(&r, swapped, semanticCount, &geo);
+
+    {
+    RecordingRenderer fresh;
+    Eks::Geometry freshGeo;
+    m.bakeVertices(&fresh, swapped, semanticCount, &freshGeo);
+    QVERIFY(r.vertices == fresh.vertices);
+    }
+  }
+
+void Eks3DTest::modellerBulkTest()
+  {
+  Eks::Modeller m(Eks::Core::defaultAllocator());
+
+  // A coloured triangle in immediate mode, before any normals or texture coordinates.
+  m.save();
+  m.colour(1, 0, 0, 1);
+  m.begin(Eks::Modeller::Triangles);
+  m.vertex(0, 0, 0);
+  m.vertex(1, 0, 0);
+  m.vertex(0, 1, 0);
+  m.end();
+  m.restore();
+
+  // Then a quarter turn about z and a shift along x for the bulk data.
+  Eks::Transform tr = Eks::Transform::Identity();
+  tr.translate(Eks::Vector3D(5, 0, 0));
+  tr.rotate(Eigen::AngleAxisf((float)X_PI * 0.5f, Eks::Vector3D::UnitZ()));
+  m.setTransform(tr);
+
+  const Eks::Vector3D positions[] = { Eks::Vector3D(1, 0, 0), Eks::Vector3D(0, 1, 0), Eks::Vector3D(0, 0, 1) };
+  const Eks::Vector3D normals[] = { Eks::Vector3D(1, 0, 0), Eks::Vector3D(1, 0, 0), Eks::Vector3D(0, 1, 0) };
+  const Eks::Vector2D textures[] = { Eks::Vector2D(0, 0), Eks::Vector2D(1, 0), Eks::Vector2D(0, 1) };
+  const xuint32 triangle[] = { 0, 2, 1 };
+
+  const xsize first = m.addVertices(positions, X_ARRAY_COUNT(positions));
+  QCOMPARE(first, (xsize)3);
+  m.addNormals(normals, X_ARRAY_COUNT(normals));
+  m.addTextures(textures, X_ARRAY_COUNT(textures));
+  m.addTriangles(triangle, X_ARRAY_COUNT(triangle), first);
+
+  RecordingRenderer r;
+  Eks::Geometry geo;
+  Eks::IndexGeometry index;
+  m.bakeTriangles(&r, modellerSemantics, X_ARRAY_COUNT(modellerSemantics), &index, &geo);
+
+  // Position, normal, texture and colour, all as floats.
+  const xsize stride = 12;
+  QCOMPARE(r.vertexSize, stride * sizeof(float));
+  QCOMPARE(r.vertices.size(), 6 * r.vertexSize);
+  const float *v = (const float *)r.vertices.data();
+
+  const Eks::Vector3D movedPositions[] = { Eks::Vector3D(5, 1, 0), Eks::Vector3D(4, 0, 0), Eks::Vector3D(5, 0, 1) };
+  const Eks::Vector3D movedNormals[] = { Eks::Vector3D(0, 1, 0), Eks::Vector3D(0, 1, 0), Eks::Vector3D(-1, 0, 0) };
+  for(xsize i = 0; i < 3; ++i)
+    {
+    const float *bulk = v + (first + i) * stride;
+    QVERIFY(Eks::Vector3D(bulk[0], bulk[1], bulk[2]).isApprox(movedPositions[i], 0.0001f));
+    QVERIFY((Eks::Vector3D(bulk[3], bulk[4], bulk[5]) - movedNormals[i]).norm() < 0.0001f);
+    QVERIFY(Eks::Vector2D(bulk[6], bulk[7]) == textures[i]);
+
+    // The bulk vertices have no colour set, the immediate ones no normal or texture.
+    QVERIFY(Eks::Vector4D(bulk[8], bulk[9], bulk[10], bulk[11]).isZero());
+
+    const float *immediate = v + i * stride;
+    QVERIFY(Eks::Vector3D(immediate[3], immediate[4], immediate[5]).isZero());
+    QVERIFY(Eks::Vector2D(immediate[6], immediate[7]).isZero());
+    QVERIFY(Eks::Vector4D(immediate[8], immediate[9], immediate[10], immediate[11]) == Eks::Vector4D(1, 0, 0, 1));
+    }
+
+  // The bulk triangle's indices are offset by [first].
+  QCOMPARE(r.indexCount, (xsize)6);
+  const xuint16 *indices = (const xuint16 *)r.indices.data();
+  QCOMPARE(indices[3], (xuint16)3);
+  QCOMPARE(indices[4], (xuint16)5);
+  QCOMPARE(indices[5], (xuint16)4);
+  }
+
+void Eks3DTest::curveTessellatorTest()
+  {
+  auto circle = [](Eks::Real t, const void *) -> Eks::Vector3D
+    {
+    return Eks::Vector3D(std::cos(t), std::sin(t), 0.0f);
+    };
+  const Eks::Real end = 2.0f * (Eks::Real)X_PI;
+
+  // The unit circle fills a 200 pixel viewport, so has a radius of 100 pixels.
+  const Eks::Vector2D viewport(200, 200);
+  const Eks::ComplexTransform identity = Eks::ComplexTransform::Identity();
+
+  Eks::Vector<Eks::Vector3D> fine(Eks::Core::defaultAllocator());
+  Eks::CurveTessellator(identity, viewport, 0.5f).tessellate(circle, 0, 0, end, &fine);
+
+  QVERIFY((fine[0] - circle(0, 0)).norm() < 1e-5f);
+  QVERIFY((fine[fine.size() - 1] - circle(end, 0)).norm() < 1e-5f);
+  for(xsize i = 1; i < fine.size(); ++i)
+    {
+    // How far the chord's middle is inside the circle, in pixels.
+    const Eks::Real sagitta = 100.0f * (1.0f - ((fine[i - 1] + fine[i]) * 0.5f).norm());
+    QVERIFY(sagitta <= 0.5f);
+    }
+
+  Eks::Vector<Eks::Vector3D> coarse(Eks::Core::defaultAllocator());
+  Eks::CurveTessellator(identity, viewport, 4.0f).tessellate(circle, 0, 0, end, &coarse);
+  QVERIFY(coarse.size() < fine.size());
+  QVERIFY(coarse.size() > (xsize)Eks::CurveTessellator::MinSpans + 1);
+
+  // Off screen, only the initial spans are kept.
+  Eks::ComplexTransform offscreen = identity;
+  offscreen.translate(Eks::Vector3D(10, 0, 0));
+  Eks::Vector<Eks::Vector3D> hidden(Eks::Core::defaultAllocator());
+  Eks::CurveTessellator(offscreen, viewport, 0.5f).tessellate(circle, 0, 0, end, &hidden);
+  QCOMPARE(hidden.size(), (xsize)Eks::CurveTessellator::MinSpans + 1);
+  }
+
+void Eks3DTest::gltfByteIndexTest()
+  {
+  // A triangle indexed with unsigned bytes, which no renderer is given directly.
+  const float triangle[] = { 0, 0, 0, 1, 0, 0, 0, 1, 0 };
+  const xuint8 indices[] = { 2, 1, 0, 0 };
+
+  QByteArray bin;
+  bin.append((const char *)triangle, sizeof(triangle));
+  bin.append((const char *)indices, sizeof(indices));
+
+  const QByteArray gltf =
+    "{\"asset\":{\"version\":\"2.0\"},"
+    "\"buffers\":[{\"uri\":\"data:application/octet-stream;base64," + bin.toBase64() + "\",\"byteLength\":40}],"
+    "\"bufferViews\":["
+      "{\"buffer\":0,\"byteOffset\":0,\"byteLength\":36},"
+      "{\"buffer\":0,\"byteOffset\":36,\"byteLength\":3}],"
+    "\"accessors\":["
+      "{\"bufferView\":0,\"componentType\":5126,\"count\":3,\"type\":\"VEC3\"},"
+      "{\"bufferView\":1,\"componentType\":5121,\"count\":3,\"type\":\"SCALAR\"}],"
+    "\"meshes\":[{\"primitives\":[{\"attributes\":{\"POSITION\":0},\"indices\":1}]}]}";
+
+  Eks::GltfLoader loader(Eks::Core::defaultAllocator());
+  QVERIFY(loader.load(gltf.constData(), gltf.size()));
+  const Eks::GltfLoader::Primitive &primitive = loader.primitives()[0];
+  QCOMPARE(primitive.indexType, Eks::IndexGeometry::Unsigned8);
+
+  RecordingRenderer r;
+  Eks::IndexGeometry index;
+  QVERIFY(Eks::GltfLoader::createIndexGeometry(primitive, &r, &index));
+  QCOMPARE(r.indexType, (int)Eks::IndexGeometry::Unsigned16);
+  QCOMPARE(r.indexCount, (xsize)3);
+
+  const xuint16 widened[] = { 2, 1, 0 };
+  QVERIFY(memcmp(r.indices.data(), widened, sizeof(widened)) == 0);
+  }
+
+void Eks3DTest::objLoaderLineCachedBenchmark()
+  {
+  QByteArray obj = buildObjGrid(256);
+  Eks::ObjLoader loader(Eks::Core::defaultAllocator());
+
+  QBENCHMARK
+    {
+    Eks::Vector<Eks::VectorI3D> tris(Eks::Core::defaultAllocator());
+    Eks::ObjLoader::ElementData elements[objSemanticCount];
+    xsize vertSize = 0;
+    loader.loadLineCached(obj.constData(), obj.size(), objSemantics, objSemanticCount, &tris, &vertSize, elements);
+    }
+  }
+
+void Eks3DTest::objLoaderInPlaceBenchmark()
+  {
+  QByteArray obj = buildObjGrid(256);
+  Eks::ObjLoader loader(Eks::Core::defaultAllocator());
+
+  QBENCHMARK
+    {
+    Eks::Vector<Eks::VectorI3D> tris(Eks::Core::defaultAllocator());
+    Eks::ObjLoader::ElementData elements[objSemanticCount];
+    xsize vertSize = 0;
+    loader.load(obj.constData(), obj.size(), objSemantics, objSemanticCount, &tris, &vertSize, elements);
+    }
+  }
+
+void Eks3DTest::objLoaderParallelBenchmark()
+  {
+  QByteArray obj = buildObjGrid(256);
+  Eks::ObjLoader loader(Eks::Core::defaultAllocator());
+
+  QBENCHMARK
+    {
+    Eks::Vector<Eks::VectorI3D> tris(Eks::Core::defaultAllocator());
+    Eks::ObjLoader::ElementData elements[objSemanticCount];
+    xsize vertSize = 0;
+    loader.loadParallel(obj.constData(), obj.size(), objSemantics, objSemanticCount, &tris, &vertSize, elements);
+    }
+  }
+
+void Eks3DTest::meshletCullBenchmark()
+  {
+  Eks::Vector<float> positions(Eks::Core::defaultAllocator());
+  Eks::Vector<xuint32> indices(Eks::Core::defaultAllocator());
+  buildSphere(256, 512, &positions, &indices);
+  const xsize vertexCount = positions.size() / 3;
+
+  Eks::MeshOptimiser optimiser(Eks::Core::defaultAllocator());
+  optimiser.optimiseVertexCache(indices.data(), indices.size(), vertexCount);
+
+  Eks::MeshletBuilder builder(Eks::Core::defaultAllocator());
+  Eks::Vector<Eks::MeshletBuilder::Meshlet> meshlets(Eks::Core::defaultAllocator());
+  builder.build(indices.data(), indices.size(), positions.data(), sizeof(float) * 3, vertexCount, &meshlets);
+
+  // Close to the sphere and looking across it, so both frustum and cone culling apply.
+  const Eks::Vector3D camera(0, 0, 1.5f);
+  Eks::Frustum frustum(camera, Eks::Vector3D(0, 0.5f, -1), Eks::Vector3D(1, 0, 0), Eks::Vector3D(0, 1, 0.5f), 45, 1, 0.1f, 100);
+
+  Eks::Vector<Eks::MeshletBuilder::DrawRange> ranges(Eks::Core::defaultAllocator());
+  xsize visible = 0;
+  QBENCHMARK
+    {
+    ranges.clear();
+    visible = Eks::MeshletBuilder::cull(meshlets.data(), meshlets.size(), frustum, camera, &ranges);
+    }
+
+  // Some of the sphere is drawn, less than half of it, in fewer ranges than meshlets.
+  const xsize triangles = indices.size() / 3;
+  QVERIFY(visible > 0);
+  QVERIFY(visible < triangles / 2);
+  QVERIFY(ranges.size() > 0);
+  QVERIFY(ranges.size() < meshlets.size());
+
+  xsize rangeIndices = 0;
+  for(xsize i = 0; i < ranges.size(); ++i)
+    {
+    rangeIndices += ranges[i].indexCount;
+    }
+  QCOMPARE(rangeIndices, visible * 3);
+  }
+
+void Eks3DTest::vertexInterleaveBenchmark()
+  {
+  const xsize vertexCount = 1024 * 1024;
+  Eks::Vector<Eks::Real> values(Eks::Core::defaultAllocator());
+  Eks::VertexInterleaver::Stream streams[X_ARRAY_COUNT(interleaveComponents)];
+  buildInterleaveStreams(vertexCount, &values, streams);
+
+  Eks::Vector<xuint8> data(Eks::Core::defaultAllocator());
+  data.resize(vertexCount * Eks::VertexInterleaver::vertexSize(streams, X_ARRAY_COUNT(streams)), 0);
+  QBENCHMARK
+    {
+    Eks::VertexInterleaver::interleave(streams, X_ARRAY_COUNT(streams), vertexCount, data.data());
+    }
+  }
+
+void Eks3DTest::vertexInterleaveStridedBenchmark()
+  {
+  const xsize vertexCount = 1024 * 1024;
+  Eks::Vector<Eks::Real> values(Eks::Core::defaultAllocator());
+  Eks::VertexInterleaver::Stream streams[X_ARRAY_COUNT(interleaveComponents)];
+  buildInterleaveStreams(vertexCount, &values, streams);
+
+  Eks::Vector<xuint8> data(Eks::Core::defaultAllocator());
+  data.resize(vertexCount * Eks::VertexInterleaver::vertexSize(streams, X_ARRAY_COUNT(streams)), 0);
+  QBENCHMARK
+    {
+    interleaveStrided(streams, X_ARRAY_COUNT(streams), vertexCount, data.data());
+    }
+  }
+
 QTEST_APPLESS_MAIN(Eks3DTest)
 
 #include "Eks3DTest.moc"
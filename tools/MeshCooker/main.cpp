@@ -0,0 +1,275 @@
+#include "XCore.h"
+#include "XObjLoader.h"
+#include "XCookedMesh.h"
+#include "XParallel.h"
+#include "XMeshOptimiser.h"
+#include "Utilities/XParseException.h"
+#include "QDir"
+#include "QStringList"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+// Converts every .obj file in a directory to a cooked mesh, one file per thread.
+//
+//   MeshCooker <input directory> <output directory> [--no-texcoords] [--compact] [--optimise]
+//
+// --compact stores normals octahedrally encoded and texture coordinates as half floats.
+// --optimise reorders each submesh for the vertex cache and overdraw, then the vertices for
+// fetch locality, and reports the cache statistics before and after.
+
+namespace
+{
+
+struct CookOptions
+  {
+  const Eks::ShaderVertexLayoutDescription::Semantic *semantics;
+  const Eks::ShaderVertexLayoutDescription::Format *formats;
+  xsize semanticCount;
+  bool optimise;
+  };
+
+void copyName(char (&out)[Eks::CookedMesh::MaxNameLength], const Eks::String &in)
+  {
+  memset(out, 0, sizeof(out));
+  const xsize length = std::min(in.size(), (xsize)Eks::CookedMesh::MaxNameLength - 1);
+  if(length)
+    {
+    std::copy(in.data(), in.data() + length, out);
+    }
+  }
+
+bool cookObj(const QString &input, const QString &output, const CookOptions &options)
+  {
+  Eks::AllocatorBase *allocator = Eks::Core::defaultAllocator();
+  Eks::ObjLoader loader(allocator);
+  for(xsize i = 0; i < options.semanticCount; ++i)
+    {
+    loader.setFormat(options.semantics[i], options.formats[i]);
+    }
+
+  Eks::Vector<Eks::VectorI3D> tris(allocator);
+  Eks::ObjLoader::ElementData elements[Eks::ObjLoader::MaxElements];
+  xsize vertexSize = 0;
+
+  Eks::Vector<xuint8> vertices(allocator);
+  Eks::Vector<xuint32> indices(allocator);
+  Eks::Vector<Eks::ObjLoader::Submesh> submeshes(allocator);
+
+  if(!loader.loadFile(input.toUtf8().constData(), options.semantics, options.semanticCount, &tris, &vertexSize, elements, false, &submeshes))
+    {
+    return false;
+    }
+
+  // Semantics the file has no data for, like texture coordinates, are zero filled.
+  loader.computeUnusedElements(elements, options.semanticCount, &tris);
+
+  if(!loader.bakeIndexed(tris, elements, options.semanticCount, &vertices, &indices))
+    {
+    return false;
+    }
+
+  Eks::ShaderVertexLayoutDescription layout[Eks::ObjLoader::MaxElements];
+  Eks::BoundingBox bounds;
+  xsize positionOffset = 0;
+  bool positionFound = false;
+  for(xsize i = 0; i < options.semanticCount; ++i)
+    {
+    layout[i] = Eks::ShaderVertexLayoutDescription(options.semantics[i], options.formats[i]);
+
+    if(!positionFound && options.semantics[i] != Eks::ShaderVertexLayoutDescription::Position)
+      {
+      positionOffset += Eks::ShaderVertexLayoutDescription::formatSize(options.formats[i]);
+      }
+
+    if(options.semantics[i] == Eks::ShaderVertexLayoutDescription::Position)
+      {
+      positionFound = true;
+      for(xsize p = 0; p < elements[i].data.size(); ++p)
+        {
+        const Eks::ObjLoader::ElementVector &pos = elements[i].data[p];
+        bounds.unite(Eks::Vector3D(pos(0), pos(1), pos(2)));
+        }
+      }
+    }
+
+  const xsize vertexCount = vertices.size() / vertexSize;
+  if(options.optimise && positionFound && indices.size())
+    {
+    Eks::MeshOptimiser optimiser(allocator);
+    const Eks::MeshOptimiser::Statistics before = optimiser.analyseVertexCache(indices.data(), indices.size(), vertexCount);
+
+    // Submeshes are optimised separately so their index ranges stay valid.
+    const float *positions = (const float *)(vertices.data() + positionOffset);
+    for(xsize i = 0; i < submeshes.size(); ++i)
+      {
+      xuint32 *first = indices.data() + submeshes[i].firstIndex;
+      optimiser.optimiseVertexCache(first, submeshes[i].indexCount, vertexCount);
+      optimiser.optimiseOverdraw(first, submeshes[i].indexCount, positions, vertexSize, vertexCount);
+      }
+    optimiser.optimiseVertexFetch(indices.data(), indices.size(), vertices.data(), vertexCount, vertexSize);
+
+    const Eks::MeshOptimiser::Statistics after = optimiser.analyseVertexCache(indices.data(), indices.size(), vertexCount);
+
+    // Formatted first, so lines from other threads do not interleave.
+    char report[256];
+    snprintf(report, sizeof(report), "%s: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n",
+      input.toUtf8().constData(), before.acmr, after.acmr, before.atvr, after.atvr);
+    std::cout << report;
+    }
+
+  Eks::Vector<Eks::CookedMesh::Submesh> cookedSubmeshes(allocator);
+  cookedSubmeshes.resize(submeshes.size());
+  for(xsize i = 0; i < submeshes.size(); ++i)
+    {
+    const Eks::ObjLoader::Submesh &submesh = submeshes[i];
+    Eks::CookedMesh::Submesh &cooked = cookedSubmeshes[i];
+
+    copyName(cooked.name, submesh.name);
+    copyName(cooked.material, submesh.material);
+    cooked.firstIndex = (xuint32)submesh.firstIndex;
+    cooked.indexCount = (xuint32)submesh.indexCount;
+    for(xsize c = 0; c < 3; ++c)
+      {
+      cooked.minimum[c] = submesh.bounds.minimum()(c);
+      cooked.maximum[c] = submesh.bounds.maximum()(c);
+      }
+    }
+
+  Eks::CookedMesh::Source source;
+  source.layout = layout;
+  source.layoutCount = options.semanticCount;
+  source.vertexData = vertices.data();
+  source.vertexSize = vertexSize;
+  source.vertexCount = vertexCount;
+  source.indexType = Eks::IndexGeometry::typeFor(source.vertexCount);
+  source.indexData = indices.data();
+  source.indexCount = indices.size();
+
+  Eks::Vector<xuint16> narrowIndices(allocator);
+  if(source.indexType == Eks::IndexGeometry::Unsigned16)
+    {
+    narrowIndices.resize(indices.size());
+    for(xsize i = 0; i < indices.size(); ++i)
+      {
+      narrowIndices[i] = (xuint16)indices[i];
+      }
+    source.indexData = narrowIndices.data();
+    }
+  source.bounds = bounds;
+  source.submeshes = cookedSubmeshes.data();
+  source.submeshCount = cookedSubmeshes.size();
+
+  return Eks::CookedMesh::write(output.toUtf8().constData(), source);
+  }
+
+void reportFailure(const QString &file, const char *reason)
+  {
+  char report[512];
+  snprintf(report, sizeof(report), "Failed to cook %s: %s\n", file.toUtf8().constData(), reason);
+  std::cerr << report;
+  }
+
+}
+
+int main(int argc, char **argv)
+  {
+  Eks::Core core;
+
+  if(argc < 3)
+    {
+    std::cerr << "Usage: MeshCooker <input directory> <output directory> [--no-texcoords] [--compact] [--optimise]" << std::endl;
+    return 1;
+    }
+
+  const Eks::ShaderVertexLayoutDescription::Semantic semantics[] =
+  {
+    Eks::ShaderVertexLayoutDescription::Position,
+    Eks::ShaderVertexLayoutDescription::Normal,
+    Eks::ShaderVertexLayoutDescription::TextureCoordinate
+  };
+  const Eks::ShaderVertexLayoutDescription::Format formats[] =
+  {
+    Eks::ShaderVertexLayoutDescription::FormatFloat3,
+    Eks::ShaderVertexLayoutDescription::FormatFloat3,
+    Eks::ShaderVertexLayoutDescription::FormatFloat2
+  };
+  const Eks::ShaderVertexLayoutDescription::Format compactFormats[] =
+  {
+    Eks::ShaderVertexLayoutDescription::FormatFloat3,
+    Eks::ShaderVertexLayoutDescription::FormatOctahedralNormal,
+    Eks::ShaderVertexLayoutDescription::FormatHalf2
+  };
+  xCompileTimeAssert(X_ARRAY_COUNT(semantics) == X_ARRAY_COUNT(formats));
+  xCompileTimeAssert(X_ARRAY_COUNT(semantics) == X_ARRAY_COUNT(compactFormats));
+
+  CookOptions options;
+  options.semantics = semantics;
+  options.formats = formats;
+  options.semanticCount = X_ARRAY_COUNT(semantics);
+  options.optimise = false;
+  for(int i = 3; i < argc; ++i)
+    {
+    if(strcmp(argv[i], "--no-texcoords") == 0)
+      {
+      options.semanticCount = 2;
+      }
+    else if(strcmp(argv[i], "--compact") == 0)
+      {
+      options.formats = compactFormats;
+      }
+    else if(strcmp(argv[i], "--optimise") == 0)
+      {
+      options.optimise = true;
+      }
+    }
+
+  QDir input(QString::fromUtf8(argv[1]));
+  QDir output(QString::fromUtf8(argv[2]));
+  if(!input.exists() || !output.mkpath("."))
+    {
+    std::cerr << "Invalid input or output directory" << std::endl;
+    return 1;
+    }
+
+  const QStringList files = input.entryList(QStringList() << "*.obj", QDir::Files, QDir::Name);
+
+  std::atomic<xsize> failures(0);
+  Eks::ParallelUtilities::forRanges((xsize)files.size(), 1, [&](xsize, xsize begin, xsize end)
+    {
+    for(xsize i = begin; i < end; ++i)
+      {
+      const QString &file = files[(int)i];
+      const QString cooked = output.filePath(file.left(file.size() - 4) + ".mesh");
+
+      // One bad file is reported and skipped, rather than ending the whole run.
+      bool succeeded = false;
+      try
+        {
+        succeeded = cookObj(input.filePath(file), cooked, options);
+        if(!succeeded)
+          {
+          reportFailure(file, "could not be read or written");
+          }
+        }
+      catch(const Eks::ParseException &e)
+        {
+        reportFailure(file, e.error().message().data());
+        }
+      catch(const std::exception &e)
+        {
+        reportFailure(file, e.what());
+        }
+
+      if(!succeeded)
+        {
+        ++failures;
+        }
+      }
+    });
+
+  std::cout << "Cooked " << ((xsize)files.size() - failures.load()) << "/" << files.size() << " meshes" << std::endl;
+  return failures ? 1 : 0;
+  }